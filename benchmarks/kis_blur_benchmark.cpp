@@ -36,6 +36,7 @@
 
 #include "kis_selection.h"
 #include <kis_iterator_ng.h>
+#include <kis_gaussian_kernel.h>
 
 void KisBlurBenchmark::initTestCase()
 {
@@ -88,5 +89,24 @@ void KisBlurBenchmark::benchmarkFilter()
 }
 
 
+void KisBlurBenchmark::benchmarkLargeGaussianConvolution()
+{
+    KisPaintDeviceSP device = new KisPaintDevice(*m_device);
+    const QRect rect(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    QBENCHMARK_ONCE {
+        KisGaussianKernel::applyGaussianConvolution(device, rect, 100, 100, QBitArray(), 0);
+    }
+}
+
+void KisBlurBenchmark::benchmarkLargeGaussianRecursive()
+{
+    KisPaintDeviceSP device = new KisPaintDevice(*m_device);
+    const QRect rect(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    QBENCHMARK_ONCE {
+        KisGaussianKernel::applyGaussianRecursive(device, rect, 100, 100, QBitArray(), 0);
+    }
+}
 
 QTEST_MAIN(KisBlurBenchmark)
@@ -39,6 +39,8 @@ private Q_SLOTS:
     void cleanupTestCase();
     
     void benchmarkFilter();
+    void benchmarkLargeGaussianConvolution();
+    void benchmarkLargeGaussianRecursive();
     
 };
 
@@ -32,6 +32,9 @@
 #include "kis_floodfill_benchmark.h"
 
 #include <kis_fill_painter.h>
+#include <kis_pixel_selection.h>
+#include <floodfill/kis_scanline_fill.h>
+#include <floodfill/kis_fill_similarity_cache.h>
 
 #include <KoCompositeOps.h>
 
@@ -104,6 +107,79 @@ void KisFloodFillBenchmark::benchmarkFlood()
     //out.save("fill_output.png");
 }
 
+void KisFloodFillBenchmark::benchmarkFloodReference()
+{
+    KoColor fg(m_colorSpace);
+    fg.fromQColor(Qt::blue);
+
+    KisPaintDeviceSP dstDevice = new KisPaintDevice(m_colorSpace);
+
+    // several fills of the same reference layer, like a user filling line art
+    QBENCHMARK
+    {
+        for (int i = 0; i < 10; i++) {
+            KisFillPainter fillPainter(dstDevice);
+            fillPainter.setPaintColor(fg);
+            fillPainter.setOpacity(OPACITY_OPAQUE_U8);
+            fillPainter.setFillThreshold(15);
+            fillPainter.setCompositeOp(COMPOSITE_OVER);
+            fillPainter.setUseCompositioning(true);
+            fillPainter.setWidth(GMP_IMAGE_WIDTH);
+            fillPainter.setHeight(GMP_IMAGE_HEIGHT);
+            fillPainter.setUseSimilarityCache(true);
+
+            fillPainter.fillColor(1 + i * 10, 1, m_device);
+        }
+    }
+}
+
+void KisFloodFillBenchmark::benchmarkFloodSelectionDirect()
+{
+    benchmarkFloodSelection(false);
+}
+
+void KisFloodFillBenchmark::benchmarkFloodSelectionCached()
+{
+    benchmarkFloodSelection(true);
+}
+
+void KisFloodFillBenchmark::benchmarkSimilarityMap()
+{
+    KoColor seedColor(Qt::transparent, m_colorSpace);
+    const QRect rect(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    QBENCHMARK
+    {
+        KisFillSimilarityCache::instance()->clear();
+
+        KisFillSimilarityMapSP map = KisFillSimilarityCache::instance()->differenceMap(m_device, seedColor);
+        KisRandomConstAccessorSP it = map->createAccessor();
+
+        // calculate all the blocks
+        for (int y = rect.top(); y <= rect.bottom(); y += 256) {
+            for (int x = rect.left(); x <= rect.right(); x += 256) {
+                it->moveTo(x, y);
+            }
+        }
+    }
+}
+
+void KisFloodFillBenchmark::benchmarkFloodSelection(bool useCache)
+{
+    const QRect rect(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    KisFillSimilarityCache::instance()->clear();
+
+    QBENCHMARK
+    {
+        KisPixelSelectionSP selection = new KisPixelSelection();
+
+        KisScanlineFill gc(m_device, QPoint(1, 1), rect);
+        gc.setThreshold(15);
+        gc.setUseSimilarityCache(useCache);
+        gc.fillSelection(selection);
+    }
+}
 
 void KisFloodFillBenchmark::cleanupTestCase()
 {
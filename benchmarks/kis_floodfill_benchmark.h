@@ -36,12 +36,18 @@ private:
     KisPaintDeviceSP m_device;        
     int m_startX;
     int m_startY;
+
+    void benchmarkFloodSelection(bool useCache);
     
 private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
     
     void benchmarkFlood();
+    void benchmarkFloodReference();
+    void benchmarkFloodSelectionDirect();
+    void benchmarkFloodSelectionCached();
+    void benchmarkSimilarityMap();
     
     
     
@@ -21,8 +21,10 @@
 #include "kis_benchmark_values.h"
 
 #include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
 
 #include <kis_group_layer.h>
+#include <kis_paint_layer.h>
 #include <kis_paint_device.h>
 #include <KisDocument.h>
 #include <kis_image.h>
@@ -58,5 +60,38 @@ void KisProjectionBenchmark::benchmarkLoading()
     }
 }
 
+void KisProjectionBenchmark::benchmarkDeepStackUpdate()
+{
+    const int numLayers = 100;
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT, cs, "projection benchmark");
+
+    KisPaintLayerSP topLayer;
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8 / 2);
+
+        const QColor color = QColor::fromHsv(i * 359 / numLayers, 255, 255);
+        const QRect fillRect = image->bounds().adjusted(i * 10, i * 10, -i * 10, -i * 10);
+        layer->paintDevice()->fill(fillRect, KoColor(color, cs));
+
+        image->addNode(layer, image->rootLayer());
+        topLayer = layer;
+    }
+
+    image->initialRefreshGraph();
+
+    /**
+     * Emulate painting on the topmost layer: the layers below it
+     * are not changed, so they should be taken from the group cache
+     */
+    const QRect dabRect(TEST_IMAGE_WIDTH / 2, TEST_IMAGE_HEIGHT / 2, 256, 256);
+
+    QBENCHMARK {
+        topLayer->setDirty(dabRect);
+        image->waitForDone();
+    }
+}
 
 QTEST_MAIN(KisProjectionBenchmark)
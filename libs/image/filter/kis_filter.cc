@@ -29,6 +29,7 @@
 #include "kis_selection.h"
 #include "kis_types.h"
 #include <kis_painter.h>
+#include "kis_lod_transform.h"
 
 KoID KisFilter::categoryAdjust()
 {
@@ -108,7 +109,11 @@ void KisFilter::process(const KisPaintDeviceSP src,
                         KoUpdater* progressUpdater ) const
 {
     if (applyRect.isEmpty()) return;
-    QRect needRect = neededRect(applyRect, config, src->defaultBounds()->currentLevelOfDetail());
+
+    const int lod = src->defaultBounds()->currentLevelOfDetail();
+    const KisFilterConfigurationSP lodConfig = lodScaledConfiguration(config, lod);
+
+    QRect needRect = neededRect(applyRect, lodConfig, lod);
 
     KisPaintDeviceSP temporary;
     KisTransaction *transaction = 0;
@@ -126,7 +131,7 @@ void KisFilter::process(const KisPaintDeviceSP src,
     }
 
     try {
-        processImpl(temporary, applyRect, config, progressUpdater);
+        processImpl(temporary, applyRect, lodConfig, progressUpdater);
     }
     catch (std::bad_alloc) {
         warnKrita << "Filter" << name() << "failed to allocate enough memory to run.";
@@ -165,6 +170,41 @@ void KisFilter::setSupportsLevelOfDetail(bool value)
     m_supportsLevelOfDetail = value;
 }
 
+void KisFilter::addLodScaledProperty(const QString &name)
+{
+    m_lodScaledProperties << name;
+    m_supportsLevelOfDetail = true;
+}
+
+KisFilterConfigurationSP KisFilter::lodScaledConfiguration(const KisFilterConfigurationSP config, int lod) const
+{
+    if (!config || lod <= 0 || m_lodScaledProperties.isEmpty()) return config;
+
+    const qreal scale = KisLodTransform::lodToScale(lod);
+    KisFilterConfigurationSP scaledConfig = new KisFilterConfiguration(*config);
+
+    Q_FOREACH (const QString &name, m_lodScaledProperties) {
+        QVariant value;
+        if (!config->getProperty(name, value)) continue;
+
+        bool isInteger = false;
+        const int size = value.type() != QVariant::Double ? value.toInt(&isInteger) : 0;
+
+        if (isInteger) {
+            /**
+             * Do not let non-zero sizes to collapse into zero, most of
+             * the filters cannot handle it
+             */
+            const int scaledSize = size > 0 ? qMax(1, qRound(scale * size)) : qRound(scale * size);
+            scaledConfig->setProperty(name, scaledSize);
+        } else {
+            scaledConfig->setProperty(name, scale * value.toDouble());
+        }
+    }
+
+    return scaledConfig;
+}
+
 bool KisFilter::needsTransparentPixels(const KisFilterConfigurationSP config, const KoColorSpace *cs) const
 {
     Q_UNUSED(config);
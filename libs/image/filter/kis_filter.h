@@ -21,6 +21,7 @@
 #include <list>
 
 #include <QString>
+#include <QStringList>
 
 #include <klocalizedstring.h>
 
@@ -125,6 +126,18 @@ public:
      */
     virtual bool supportsLevelOfDetail(const KisFilterConfigurationSP config, int lod) const;
 
+    /**
+     * Returns a copy of \p config with all the properties registered
+     * with addLodScaledProperty() scaled down to the level of detail
+     * \p lod. If the filter has no such properties or \p lod is zero,
+     * \p config itself is returned.
+     *
+     * process() passes the scaled configuration to processImpl()
+     * automatically, but the callers of neededRect() and changedRect()
+     * should do the conversion themselves.
+     */
+    KisFilterConfigurationSP lodScaledConfiguration(const KisFilterConfigurationSP config, int lod) const;
+
     virtual bool needsTransparentPixels(const KisFilterConfigurationSP config, const KoColorSpace *cs) const;
 
 protected:
@@ -132,9 +145,23 @@ protected:
     QString configEntryGroup() const;
     void setSupportsLevelOfDetail(bool value);
 
+    /**
+     * Registers a property of the filter configuration as a linear
+     * size measured in pixels (a radius, an offset, a wavelength,
+     * etc.). Such properties are scaled when the filter is applied to
+     * a LoD plane, so the filter doesn't need to do any LoD-specific
+     * work itself. Registering a property also marks the filter as
+     * supporting level of detail.
+     *
+     * NOTE: the configuration of such a filter must be a plain
+     *       KisFilterConfiguration, because it is copied on scaling.
+     */
+    void addLodScaledProperty(const QString &name);
+
 
 private:
     bool m_supportsLevelOfDetail;
+    QStringList m_lodScaledProperties;
 };
 
 
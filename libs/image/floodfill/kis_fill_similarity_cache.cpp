@@ -0,0 +1,448 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_fill_similarity_cache.h"
+
+#include <algorithm>
+
+#include <QGlobalStatic>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRect>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_paint_device.h"
+#include "kis_paint_device_frames_interface.h"
+#include "kis_datamanager.h"
+#include "kis_random_accessor_ng.h"
+
+
+Q_GLOBAL_STATIC(KisFillSimilarityCache, s_instance)
+
+const int KisFillSimilarityCache::maxCachedBlocks = 256;
+
+namespace {
+
+const int blockSize = 256;
+
+inline int blockIndex(int value)
+{
+    return value >= 0 ?
+        value / blockSize :
+        -((-value + blockSize - 1) / blockSize);
+}
+
+/**
+ * Line art usually has very few distinct colors, so the differences
+ * are cached in a hash, the same way KisScanlineFill does
+ */
+template <typename PixelType>
+void calculateDifferencesOptimized(const KoColorSpace *colorSpace,
+                                   const quint8 *seedPixel,
+                                   const quint8 *pixels,
+                                   quint8 *differences,
+                                   int numPixels)
+{
+    QHash<PixelType, quint8> cache;
+
+    for (int i = 0; i < numPixels; i++) {
+        const quint8 *pixelPtr = pixels + i * sizeof(PixelType);
+        const PixelType key = *reinterpret_cast<const PixelType*>(pixelPtr);
+
+        typename QHash<PixelType, quint8>::const_iterator it = cache.constFind(key);
+
+        if (it != cache.constEnd()) {
+            differences[i] = *it;
+        } else {
+            const quint8 result = colorSpace->difference(seedPixel, pixelPtr);
+            cache.insert(key, result);
+            differences[i] = result;
+        }
+    }
+}
+
+void calculateDifferencesSlow(const KoColorSpace *colorSpace,
+                              const quint8 *seedPixel,
+                              const quint8 *pixels,
+                              quint8 *differences,
+                              int numPixels)
+{
+    const int pixelSize = colorSpace->pixelSize();
+
+    for (int i = 0; i < numPixels; i++) {
+        differences[i] = colorSpace->difference(seedPixel, pixels + i * pixelSize);
+    }
+}
+
+/**
+ * Calculates the differences of a part of \p source and writes them
+ * into \p map
+ */
+struct DifferenceTileJob
+{
+    DifferenceTileJob(KisPaintDeviceSP _source, KisPaintDeviceSP _map, const KoColor &_seedColor)
+        : source(_source), map(_map), seedColor(_seedColor)
+    {
+    }
+
+    void operator() (const QRect &rc) const {
+        const KoColorSpace *colorSpace = source->colorSpace();
+        const int pixelSize = colorSpace->pixelSize();
+        const int numPixels = rc.width() * rc.height();
+
+        QVector<quint8> pixels(numPixels * pixelSize);
+        source->readBytes(pixels.data(), rc);
+
+        QVector<quint8> differences(numPixels);
+
+        const quint8 *seedPixel = seedColor.data();
+
+        switch (pixelSize) {
+        case 1:
+            calculateDifferencesOptimized<quint8>(colorSpace, seedPixel, pixels.constData(), differences.data(), numPixels);
+            break;
+        case 2:
+            calculateDifferencesOptimized<quint16>(colorSpace, seedPixel, pixels.constData(), differences.data(), numPixels);
+            break;
+        case 4:
+            calculateDifferencesOptimized<quint32>(colorSpace, seedPixel, pixels.constData(), differences.data(), numPixels);
+            break;
+        case 8:
+            calculateDifferencesOptimized<quint64>(colorSpace, seedPixel, pixels.constData(), differences.data(), numPixels);
+            break;
+        default:
+            calculateDifferencesSlow(colorSpace, seedPixel, pixels.constData(), differences.data(), numPixels);
+            break;
+        }
+
+        map->writeBytes(differences.constData(), rc);
+    }
+
+    KisPaintDeviceSP source;
+    KisPaintDeviceSP map;
+    KoColor seedColor;
+};
+
+inline quint64 blockKey(int column, int row)
+{
+    return (quint64(quint32(column)) << 32) | quint32(row);
+}
+
+}
+
+struct KisFillSimilarityMap::Private
+{
+    Private() : useCounter(0) {}
+
+    KisPaintDeviceWSP source;
+    const KoColorSpace *colorSpace;
+    QPoint offset;
+    int frameId;
+    KoColor seedColor;
+
+    KisPaintDeviceSP map;
+
+    /**
+     * The source tiles the blocks have been calculated from. The map
+     * and the snapshot have the same offset as the source, so their
+     * tiles are aligned with the ones of the source and the snapshot
+     * can share them.
+     */
+    KisPaintDeviceSP snapshot;
+
+    QMutex lock;
+
+    // the key of the block -> the value of useCounter when it was used
+    QHash<quint64, qint64> blocks;
+    qint64 useCounter;
+
+    QAtomicInt numAccessors;
+
+    static int currentFrameId(KisPaintDeviceSP device) {
+        return device->framesInterface() ? device->framesInterface()->currentFrameId() : -1;
+    }
+
+    static QRect blockRect(int column, int row) {
+        return QRect(column * blockSize, row * blockSize, blockSize, blockSize);
+    }
+
+    /**
+     * Makes sure the differences are up to date in the block containing
+     * the pixel (\p x, \p y), unless it is in \p preparedBlocks already.
+     * \return the rect of the block in the coordinates of the map
+     */
+    QRect prepareBlock(int x, int y, QSet<quint64> *preparedBlocks);
+
+    /**
+     * Calculates the differences in \p rc, which is given in the
+     * coordinates of the data managers
+     */
+    void calculateBlock(KisPaintDeviceSP source, const QRect &rc);
+};
+
+QRect KisFillSimilarityMap::Private::prepareBlock(int x, int y, QSet<quint64> *preparedBlocks)
+{
+    const int column = blockIndex(x - offset.x());
+    const int row = blockIndex(y - offset.y());
+    const quint64 key = blockKey(column, row);
+
+    // the rect in the coordinates of the data managers
+    const QRect rc = blockRect(column, row);
+
+    if (!preparedBlocks->contains(key)) {
+        QMutexLocker l(&lock);
+
+        KisPaintDeviceSP source = this->source;
+
+        if (source) {
+            QHash<quint64, qint64>::iterator it = blocks.find(key);
+
+            if (it == blocks.end() ||
+                !source->dataManager()->differingRect(snapshot->dataManager().data(), rc).isEmpty()) {
+
+                calculateBlock(source, rc);
+                it = blocks.insert(key, 0);
+            }
+
+            it.value() = ++useCounter;
+        }
+
+        preparedBlocks->insert(key);
+    }
+
+    return rc.translated(offset);
+}
+
+void KisFillSimilarityMap::Private::calculateBlock(KisPaintDeviceSP source, const QRect &rc)
+{
+    /**
+     * The source is copied first and the differences are calculated
+     * from the copy, so even if the source is being changed meanwhile,
+     * the map is consistent with the snapshot
+     */
+    snapshot->dataManager()->bitBlt(source->dataManager().data(), rc);
+
+    const int tileSize = 64;
+    QVector<QRect> tiles;
+
+    for (int y = rc.top(); y <= rc.bottom(); y += tileSize) {
+        for (int x = rc.left(); x <= rc.right(); x += tileSize) {
+            tiles << QRect(x, y, tileSize, tileSize).translated(offset);
+        }
+    }
+
+    QtConcurrent::blockingMap(tiles, DifferenceTileJob(snapshot, map, seedColor));
+}
+
+/**
+ * Brings the blocks of the map up to date before reading them. The
+ * map must outlive the accessor.
+ */
+class KisFillSimilarityMapAccessor : public KisRandomConstAccessorNG
+{
+public:
+    KisFillSimilarityMapAccessor(KisFillSimilarityMap *map)
+        : m_map(map),
+          m_it(map->m_d->map->createRandomConstAccessorNG(0, 0))
+    {
+        m_map->m_d->numAccessors.ref();
+    }
+
+    ~KisFillSimilarityMapAccessor() {
+        m_map->m_d->numAccessors.deref();
+    }
+
+    void moveTo(qint32 x, qint32 y) {
+        if (!m_currentBlock.contains(x, y)) {
+            m_currentBlock = m_map->m_d->prepareBlock(x, y, &m_preparedBlocks);
+        }
+        m_it->moveTo(x, y);
+    }
+
+    qint32 numContiguousColumns(qint32 x) const {
+        return qMin(m_it->numContiguousColumns(x), m_currentBlock.right() - x + 1);
+    }
+
+    qint32 numContiguousRows(qint32 y) const {
+        return qMin(m_it->numContiguousRows(y), m_currentBlock.bottom() - y + 1);
+    }
+
+    qint32 rowStride(qint32 x, qint32 y) const {
+        return m_it->rowStride(x, y);
+    }
+
+    const quint8 * oldRawData() const {
+        return m_it->oldRawData();
+    }
+
+    const quint8 * rawDataConst() const {
+        return m_it->rawDataConst();
+    }
+
+    qint32 x() const {
+        return m_it->x();
+    }
+
+    qint32 y() const {
+        return m_it->y();
+    }
+
+private:
+    KisFillSimilarityMap *m_map;
+    KisRandomConstAccessorSP m_it;
+
+    QRect m_currentBlock;
+    QSet<quint64> m_preparedBlocks;
+};
+
+
+KisFillSimilarityMap::KisFillSimilarityMap(KisPaintDeviceSP source, const KoColor &seedColor)
+    : m_d(new Private)
+{
+    m_d->source = source;
+    m_d->colorSpace = source->colorSpace();
+    m_d->offset = source->offset();
+    m_d->frameId = Private::currentFrameId(source);
+    m_d->seedColor = seedColor;
+
+    m_d->map = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+    m_d->map->setX(m_d->offset.x());
+    m_d->map->setY(m_d->offset.y());
+
+    m_d->snapshot = new KisPaintDevice(source->colorSpace());
+    m_d->snapshot->setDefaultPixel(source->defaultPixel());
+    m_d->snapshot->setX(m_d->offset.x());
+    m_d->snapshot->setY(m_d->offset.y());
+}
+
+KisFillSimilarityMap::~KisFillSimilarityMap()
+{
+}
+
+bool KisFillSimilarityMap::isCreatedFor(KisPaintDeviceSP source, const KoColor &seedColor) const
+{
+    return m_d->source.isValid() && m_d->source == source.data() &&
+        m_d->colorSpace == source->colorSpace() &&
+        m_d->offset == source->offset() &&
+        m_d->frameId == Private::currentFrameId(source) &&
+        m_d->seedColor == seedColor;
+}
+
+KisPaintDeviceSP KisFillSimilarityMap::device() const
+{
+    return m_d->map;
+}
+
+KisRandomConstAccessorSP KisFillSimilarityMap::createAccessor()
+{
+    return new KisFillSimilarityMapAccessor(this);
+}
+
+void KisFillSimilarityMap::trim(int maxBlocks)
+{
+    QMutexLocker l(&m_d->lock);
+
+    if (m_d->numAccessors.load() > 0 || m_d->blocks.size() <= maxBlocks) return;
+
+    qint64 minStamp = m_d->useCounter + 1;
+
+    if (maxBlocks > 0) {
+        QVector<qint64> stamps;
+        stamps.reserve(m_d->blocks.size());
+
+        Q_FOREACH (qint64 stamp, m_d->blocks) {
+            stamps << stamp;
+        }
+
+        // the stamps are unique, so exactly maxBlocks of them are not less than minStamp
+        std::nth_element(stamps.begin(), stamps.end() - maxBlocks, stamps.end());
+        minStamp = *(stamps.end() - maxBlocks);
+    }
+
+    QHash<quint64, qint64>::iterator it = m_d->blocks.begin();
+    while (it != m_d->blocks.end()) {
+        if (it.value() < minStamp) {
+            const int column = qint32(quint32(it.key() >> 32));
+            const int row = qint32(quint32(it.key()));
+            const QRect rc = Private::blockRect(column, row).translated(m_d->offset);
+
+            m_d->snapshot->clear(rc);
+            m_d->map->clear(rc);
+
+            it = m_d->blocks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int KisFillSimilarityMap::numBlocks() const
+{
+    QMutexLocker l(&m_d->lock);
+    return m_d->blocks.size();
+}
+
+
+struct KisFillSimilarityCache::Private
+{
+    QMutex lock;
+    KisFillSimilarityMapSP map;
+};
+
+
+KisFillSimilarityCache::KisFillSimilarityCache()
+    : m_d(new Private)
+{
+}
+
+KisFillSimilarityCache::~KisFillSimilarityCache()
+{
+}
+
+KisFillSimilarityCache* KisFillSimilarityCache::instance()
+{
+    return s_instance;
+}
+
+KisFillSimilarityMapSP KisFillSimilarityCache::differenceMap(KisPaintDeviceSP device,
+                                                             const KoColor &seedColor)
+{
+    QMutexLocker l(&m_d->lock);
+
+    if (m_d->map && m_d->map->isCreatedFor(device, seedColor)) {
+        m_d->map->trim(maxCachedBlocks);
+    } else {
+        m_d->map.reset(new KisFillSimilarityMap(device, seedColor));
+    }
+
+    return m_d->map;
+}
+
+void KisFillSimilarityCache::clear()
+{
+    QMutexLocker l(&m_d->lock);
+    m_d->map.clear();
+}
@@ -0,0 +1,145 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_FILL_SIMILARITY_CACHE_H
+#define __KIS_FILL_SIMILARITY_CACHE_H
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+
+#include "kritaimage_export.h"
+#include "kis_types.h"
+
+class KoColor;
+class KisFillSimilarityMap;
+
+typedef QSharedPointer<KisFillSimilarityMap> KisFillSimilarityMapSP;
+
+
+/**
+ * The differences of the pixels of a source device to the seed color
+ * of a flood fill.
+ *
+ * The differences are stored in an alpha8 device, they are calculated
+ * by KoColorSpace::difference(). After that the fill only needs to find
+ * the connected area on a one-byte device.
+ *
+ * The map is calculated lazily in tile-aligned blocks of 256x256
+ * pixels, only for the blocks the fill actually reaches. The tiles of
+ * every block are processed in parallel.
+ *
+ * For every calculated block the map keeps the tiles of the source it
+ * was calculated from (they are shared with the source, copy-on-write
+ * makes them diverge when the source is painted on). When an accessor
+ * reaches a block for the first time, the block is compared with the
+ * actual content of the source tile by tile (see
+ * KisTiledDataManager::differingRect()), and only the changed blocks
+ * are calculated again. So any change of the source is noticed, no
+ * matter how it was done.
+ */
+class KRITAIMAGE_EXPORT KisFillSimilarityMap
+{
+public:
+    KisFillSimilarityMap(KisPaintDeviceSP source, const KoColor &seedColor);
+    ~KisFillSimilarityMap();
+
+    /**
+     * \return true if the map has been created for \p source and
+     * \p seedColor, and the source still has the same color space,
+     * offset and the current frame
+     */
+    bool isCreatedFor(KisPaintDeviceSP source, const KoColor &seedColor) const;
+
+    /**
+     * \return the alpha8 device the differences are stored in. It has
+     * the same offset as the source device.
+     */
+    KisPaintDeviceSP device() const;
+
+    /**
+     * \return an accessor to the differences. When the accessor is
+     * moved to a pixel, the differences of the whole block around it
+     * are brought up to date. Every block is checked only once
+     * during the life time of the accessor, so it should not outlive
+     * a single fill.
+     */
+    KisRandomConstAccessorSP createAccessor();
+
+    /**
+     * Drops the least recently used blocks until no more than
+     * \p maxBlocks are left. Does nothing while there are accessors
+     * to the map, because they might be reading the blocks.
+     */
+    void trim(int maxBlocks);
+
+    /**
+     * \return the number of blocks calculated
+     */
+    int numBlocks() const;
+
+private:
+    friend class KisFillSimilarityMapAccessor;
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+/**
+ * Keeps the similarity map of the most recent flood fill, so the
+ * following fills of the same device with the same seed color can
+ * reuse it.
+ *
+ * The user usually fills many areas of the same line art with the
+ * same color (or the same transparent background). The cached map
+ * holds no more than maxCachedBlocks blocks, the least recently used
+ * ones are dropped when the next fill starts. The source device is
+ * not kept alive by the cache.
+ */
+class KRITAIMAGE_EXPORT KisFillSimilarityCache
+{
+public:
+    KisFillSimilarityCache();
+    ~KisFillSimilarityCache();
+
+    static KisFillSimilarityCache* instance();
+
+    /**
+     * \return the similarity map of \p device to \p seedColor.
+     * The map is reused if it has been created for the same device,
+     * seed color and frame, otherwise a new one replaces it.
+     */
+    KisFillSimilarityMapSP differenceMap(KisPaintDeviceSP device,
+                                         const KoColor &seedColor);
+
+    /**
+     * Drops the cached map
+     */
+    void clear();
+
+    /**
+     * Maximum number of the 256x256 blocks of a cached map, that is
+     * 16 MiB of the differences
+     */
+    static const int maxCachedBlocks;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_FILL_SIMILARITY_CACHE_H */
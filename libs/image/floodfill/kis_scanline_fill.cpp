@@ -29,6 +29,7 @@
 #include "kis_pixel_selection.h"
 #include "kis_random_accessor_ng.h"
 #include "kis_fill_sanity_checks.h"
+#include "kis_fill_similarity_cache.h"
 
 
 template <class BaseClass>
@@ -189,6 +190,25 @@ private:
     const quint8 *m_srcPixelPtr;
 };
 
+/**
+ * The differences are read from the map calculated by
+ * KisFillSimilarityCache, the source device of the policy
+ * is the map itself and its accessor is the one created by
+ * KisFillSimilarityMap
+ */
+class DifferencePolicyPrecalculated
+{
+public:
+    ALWAYS_INLINE void initDifferencies(KisPaintDeviceSP device, const KoColor &srcPixel) {
+        Q_UNUSED(device);
+        Q_UNUSED(srcPixel);
+    }
+
+    ALWAYS_INLINE quint8 calculateDifference(quint8* pixelPtr) {
+        return *pixelPtr;
+    }
+};
+
 template <bool useSmoothSelection,
           class DifferencePolicy,
           template <class> class PixelFiller>
@@ -196,10 +216,12 @@ class SelectionPolicy : public PixelFiller<DifferencePolicy>
 {
 public:
     typename PixelFiller<DifferencePolicy>::SourceAccessorType m_srcIt;
+    int m_srcPixelSize;
 
 public:
     SelectionPolicy(KisPaintDeviceSP device, const KoColor &srcPixel, int threshold)
-        : m_threshold(threshold)
+        : m_srcPixelSize(device->pixelSize()),
+          m_threshold(threshold)
     {
         this->initDifferencies(device, srcPixel);
         m_srcIt = this->createSourceDeviceAccessor(device);
@@ -269,6 +291,7 @@ struct Q_DECL_HIDDEN KisScanlineFill::Private
     QPoint startPoint;
     QRect boundingRect;
     int threshold;
+    bool useSimilarityCache;
 
     int rowIncrement;
     KisFillIntervalMap backwardMap;
@@ -298,6 +321,7 @@ KisScanlineFill::KisScanlineFill(KisPaintDeviceSP device, const QPoint &startPoi
     m_d->rowIncrement = 1;
 
     m_d->threshold = 0;
+    m_d->useSimilarityCache = false;
 }
 
 KisScanlineFill::~KisScanlineFill()
@@ -309,6 +333,16 @@ void KisScanlineFill::setThreshold(int threshold)
     m_d->threshold = threshold;
 }
 
+void KisScanlineFill::setUseSimilarityCache(bool value)
+{
+    m_d->useSimilarityCache = value;
+}
+
+KisFillSimilarityMapSP KisScanlineFill::fetchDifferenceMap(const KoColor &srcColor) const
+{
+    return KisFillSimilarityCache::instance()->differenceMap(m_d->device, srcColor);
+}
+
 template <class T>
 void KisScanlineFill::extendedPass(KisFillInterval *currentInterval, int srcRow, bool extendRight, T &pixelPolicy)
 {
@@ -377,7 +411,7 @@ void KisScanlineFill::processLine(KisFillInterval interval, const int rowIncreme
 
     int numPixelsLeft = 0;
     quint8 *dataPtr = 0;
-    const int pixelSize = m_d->device->pixelSize();
+    const int pixelSize = pixelPolicy.m_srcPixelSize;
 
     while(x <= lastX) {
         // a bit of optimzation for not calling slow random accessor
@@ -506,6 +540,18 @@ void KisScanlineFill::fillColor(const KoColor &fillColor, KisPaintDeviceSP exter
     KisRandomConstAccessorSP it = m_d->device->createRandomConstAccessorNG(m_d->startPoint.x(), m_d->startPoint.y());
     KoColor srcColor(it->rawDataConst(), m_d->device->colorSpace());
 
+    if (m_d->useSimilarityCache) {
+        KisFillSimilarityMapSP map = fetchDifferenceMap(srcColor);
+
+        SelectionPolicy<false, DifferencePolicyPrecalculated, FillWithColorExternal>
+            policy(map->device(), srcColor, m_d->threshold);
+        policy.m_srcIt = map->createAccessor();
+        policy.setDestinationDevice(externalDevice);
+        policy.setFillColor(fillColor);
+        runImpl(policy);
+        return;
+    }
+
     const int pixelSize = m_d->device->pixelSize();
 
     if (pixelSize == 1) {
@@ -546,6 +592,17 @@ void KisScanlineFill::fillSelection(KisPixelSelectionSP pixelSelection)
     KisRandomConstAccessorSP it = m_d->device->createRandomConstAccessorNG(m_d->startPoint.x(), m_d->startPoint.y());
     KoColor srcColor(it->rawDataConst(), m_d->device->colorSpace());
 
+    if (m_d->useSimilarityCache) {
+        KisFillSimilarityMapSP map = fetchDifferenceMap(srcColor);
+
+        SelectionPolicy<true, DifferencePolicyPrecalculated, CopyToSelection>
+            policy(map->device(), srcColor, m_d->threshold);
+        policy.m_srcIt = map->createAccessor();
+        policy.setDestinationSelection(pixelSelection);
+        runImpl(policy);
+        return;
+    }
+
     const int pixelSize = m_d->device->pixelSize();
 
     if (pixelSize == 1) {
@@ -24,6 +24,7 @@
 #include <kritaimage_export.h>
 #include <kis_types.h>
 #include <kis_paint_device.h>
+#include "kis_fill_similarity_cache.h"
 
 class KisFillInterval;
 class KisFillIntervalMap;
@@ -64,6 +65,18 @@ public:
      */
     void setThreshold(int threshold);
 
+    /**
+     * Calculate the differences to the seed color in blocks in
+     * parallel and reuse them in the following fills (see
+     * KisFillSimilarityCache). It pays off when many fills use the
+     * same source device, e.g. filling line art on a single layer.
+     *
+     * Used in fillSelection() and fillColor() with an external
+     * device. Filling the source device itself changes it on every
+     * fill, so the cache is never used there.
+     */
+    void setUseSimilarityCache(bool value);
+
 private:
     friend class KisScanlineFillTest;
     Q_DISABLE_COPY(KisScanlineFill)
@@ -78,6 +91,8 @@ private:
     template <class T>
     void runImpl(T &pixelPolicy);
 
+    KisFillSimilarityMapSP fetchDifferenceMap(const KoColor &srcColor) const;
+
 private:
     void testingProcessLine(const KisFillInterval &processInterval);
     QVector<KisFillInterval> testingGetForwardIntervals() const;
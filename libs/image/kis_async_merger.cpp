@@ -40,6 +40,7 @@
 #include "kis_clone_layer.h"
 #include "kis_processing_information.h"
 #include "kis_busy_progress_indicator.h"
+#include "kis_group_projection_cache.h"
 
 
 #include "kis_merge_walker.h"
@@ -207,6 +208,20 @@ private:
 /*                     KisAsyncMerger                                */
 /*********************************************************************/
 
+/**
+ * There is no need to cache the composition of a single layer, it
+ * costs the same as copying the data from the cache
+ */
+static const int minBelowItemsForGroupCache = 2;
+
+KisAsyncMerger::KisAsyncMerger()
+    : m_groupCache(0),
+      m_groupCacheLevelOfDetail(0),
+      m_belowItemsToSkip(0),
+      m_belowItemsToStore(0)
+{
+}
+
 void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
     KisMergeWalker::LeafStack &leafStack = walker.leafStack();
 
@@ -237,9 +252,14 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
         }
 
 
-        if(!m_currentProjection)
+        if(!m_currentProjection) {
             setupProjection(currentLeaf, applyRect, useTempProjections);
 
+            if (m_currentProjection) {
+                prepareGroupCache(item, leafStack, walker.levelOfDetail());
+            }
+        }
+
         KisUpdateOriginalVisitor originalVisitor(applyRect,
                                                  m_currentProjection,
                                                  walker.cropRect());
@@ -271,7 +291,20 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
             /* nothing to do */
         }
 
-        compositeWithProjection(currentLeaf, applyRect);
+        if (m_belowItemsToSkip > 0) {
+            DEBUG_NODE_ACTION("Taking from group cache", "N_BELOW_FILTHY", currentLeaf, applyRect);
+            m_belowItemsToSkip--;
+        } else {
+            compositeWithProjection(currentLeaf, applyRect);
+        }
+
+        if (m_belowItemsToStore > 0 && !--m_belowItemsToStore) {
+            DEBUG_NODE_ACTION("Storing group cache", "N_BELOW_FILTHY", currentLeaf, m_groupCacheRect);
+            m_groupCache->storeBelow(m_groupCacheKey, m_groupCacheLevelOfDetail,
+                                     m_groupCacheRect, m_currentProjection);
+            m_groupCache = 0;
+            m_groupCacheKey = 0;
+        }
 
         if(item.m_position & KisMergeWalker::N_TOPMOST) {
             writeProjection(currentLeaf, useTempProjections, applyRect);
@@ -300,6 +333,11 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
 void KisAsyncMerger::resetProjection() {
     m_currentProjection = 0;
     m_finalProjection = 0;
+
+    m_groupCache = 0;
+    m_groupCacheKey = 0;
+    m_belowItemsToSkip = 0;
+    m_belowItemsToStore = 0;
 }
 
 void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection) {
@@ -353,6 +391,78 @@ bool KisAsyncMerger::compositeWithProjection(KisProjectionLeafSP leaf, const QRe
     return true;
 }
 
+void KisAsyncMerger::prepareGroupCache(const KisBaseRectsWalker::JobItem &firstItem,
+                                       const KisBaseRectsWalker::LeafStack &leafStack,
+                                       int levelOfDetail)
+{
+    KisGroupLayer *group =
+        qobject_cast<KisGroupLayer*>(firstItem.m_leaf->parent()->node().data());
+    if (!group) return;
+
+    KisGroupProjectionCache *cache = group->projectionCache();
+    KisNodeSP cachedKey = cache->keyNode();
+
+    /**
+     * The jobs of the group are stored in the stack in a continuous
+     * sequence, from the bottommost to the topmost one. Find the
+     * first node that is going to be changed by this merge. All the
+     * nodes lying below it are guaranteed to stay unchanged.
+     */
+    KisNodeSP keyNode;
+    int numBelowItems = 0;
+    bool belowRectsVary = false;
+    bool cachedKeyUnchanged = false;
+    QRect groupRect;
+
+    KisBaseRectsWalker::JobItem item = firstItem;
+    int stackIndex = leafStack.size();
+
+    forever {
+        groupRect |= item.m_applyRect;
+
+        if (!keyNode) {
+            if (cachedKey && item.m_leaf->node() == cachedKey) {
+                cachedKeyUnchanged = true;
+            }
+
+            if (item.m_position & KisMergeWalker::N_BELOW_FILTHY) {
+                belowRectsVary |= item.m_applyRect != firstItem.m_applyRect;
+                numBelowItems++;
+            } else {
+                keyNode = item.m_leaf->node();
+            }
+        }
+
+        if ((item.m_position & KisMergeWalker::N_TOPMOST) || --stackIndex < 0) break;
+        item = leafStack[stackIndex];
+    }
+
+    /**
+     * Something has changed below the cached key node, so the cached
+     * data is not valid in this area anymore
+     */
+    if (cachedKey && !cachedKeyUnchanged) {
+        cache->invalidate(groupRect);
+    }
+
+    if (!keyNode ||
+        belowRectsVary ||
+        numBelowItems < minBelowItemsForGroupCache) {
+
+        return;
+    }
+
+    if (cache->fetchBelow(keyNode, levelOfDetail, firstItem.m_applyRect, m_currentProjection)) {
+        m_belowItemsToSkip = numBelowItems;
+    } else {
+        m_groupCache = cache;
+        m_groupCacheKey = keyNode;
+        m_groupCacheRect = firstItem.m_applyRect;
+        m_groupCacheLevelOfDetail = levelOfDetail;
+        m_belowItemsToStore = numBelowItems;
+    }
+}
+
 void KisAsyncMerger::doNotifyClones(KisBaseRectsWalker &walker) {
     KisBaseRectsWalker::CloneNotificationsVector &vector =
         walker.cloneNotifications();
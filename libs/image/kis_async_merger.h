@@ -19,15 +19,19 @@
 #ifndef __KIS_ASYNC_MERGER_H
 #define __KIS_ASYNC_MERGER_H
 
+#include <QRect>
+
 #include "kritaimage_export.h"
 #include "kis_types.h"
+#include "kis_base_rects_walker.h"
 
-class QRect;
-class KisBaseRectsWalker;
+class KisGroupProjectionCache;
 
 class KRITAIMAGE_EXPORT KisAsyncMerger
 {
 public:
+    KisAsyncMerger();
+
     void startMerge(KisBaseRectsWalker &walker, bool notifyClones = true);
 
 private:
@@ -36,6 +40,9 @@ private:
     inline void writeProjection(KisProjectionLeafSP topmostLeaf, bool useTempProjection, const QRect &rect);
     inline bool compositeWithProjection(KisProjectionLeafSP leaf, const QRect &rect);
     inline void doNotifyClones(KisBaseRectsWalker &walker);
+    inline void prepareGroupCache(const KisBaseRectsWalker::JobItem &firstItem,
+                                  const KisBaseRectsWalker::LeafStack &leafStack,
+                                  int levelOfDetail);
 
 private:
     /**
@@ -62,6 +69,17 @@ private:
      * setupProjection()
      */
     KisPaintDeviceSP m_cachedPaintDevice;
+
+    /**
+     * The state of the flattened below-cache of the group being
+     * merged at the moment. See KisGroupProjectionCache.
+     */
+    KisGroupProjectionCache *m_groupCache;
+    KisNodeSP m_groupCacheKey;
+    QRect m_groupCacheRect;
+    int m_groupCacheLevelOfDetail;
+    int m_belowItemsToSkip;
+    int m_belowItemsToStore;
 };
 
 
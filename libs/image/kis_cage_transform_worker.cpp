@@ -369,13 +369,15 @@ void KisCageTransformWorker::run()
         m_d->dev->clearSelection(selection);
     }
 
-    GridIterationTools::PaintDevicePolygonOp polygonOp(srcDev, tempDevice);
+    GridIterationTools::ParallelRasterizationOp<GridIterationTools::PaintDevicePolygonOp>
+        rasterizationOp(GridIterationTools::PaintDevicePolygonOp(srcDev, tempDevice));
     Private::MapIndexesOp indexesOp(m_d.data());
     GridIterationTools::iterateThroughGrid
-        <GridIterationTools::IncompletePolygonPolicy>(polygonOp, indexesOp,
+        <GridIterationTools::IncompletePolygonPolicy>(rasterizationOp, indexesOp,
                                                       m_d->gridSize,
                                                       m_d->validPoints,
                                                       transformedPoints);
+    rasterizationOp.finish();
 
     QRect rect = tempDevice->extent();
     KisPainter gc(m_d->dev);
@@ -432,12 +434,14 @@ QImage KisCageTransformWorker::runOnQImage(QPointF *newOffset)
     }
 
     GridIterationTools::QImagePolygonOp polygonOp(m_d->srcImage, tempImage, m_d->srcImageOffset, dstQImageOffset);
+    GridIterationTools::ParallelRasterizationOp<GridIterationTools::QImagePolygonOp> rasterizationOp(polygonOp);
     Private::MapIndexesOp indexesOp(m_d.data());
     GridIterationTools::iterateThroughGrid
-        <GridIterationTools::IncompletePolygonPolicy>(polygonOp, indexesOp,
+        <GridIterationTools::IncompletePolygonPolicy>(rasterizationOp, indexesOp,
                                                       m_d->gridSize,
                                                       m_d->validPoints,
                                                       transformedPoints);
+    rasterizationOp.finish();
 
     {
         QPainter gc(&dstImage);
@@ -125,14 +125,26 @@ public:
         return ACTUAL_DATAMGR::write(writer);
     }
 
-    inline bool read(QIODevice *io) {
-        return ACTUAL_DATAMGR::read(io);
+    inline bool read(QIODevice *io, bool lazyLoading = false) {
+        return ACTUAL_DATAMGR::read(io, lazyLoading);
     }
 
     inline void purge(const QRect& area) {
         ACTUAL_DATAMGR::purge(area);
     }
 
+    /**
+     * Makes the uniform tiles in \p area share their data, see
+     * KisTiledDataManager::shareUniformTiles()
+     */
+    inline void shareUniformTiles(const QRect &area) {
+        ACTUAL_DATAMGR::shareUniformTiles(area);
+    }
+
+    inline qint64 tileDataMemoryUsage(QSet<const KisTileData*> *countedTileData) const {
+        return ACTUAL_DATAMGR::tileDataMemoryUsage(countedTileData);
+    }
+
     /**
      * The tiles may be not allocated directly from the glibc, but
      * instead can be allocated in bigger blobs. After you freed quite
@@ -0,0 +1,243 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_distance_transform.h"
+
+#include <limits>
+
+#include <QRect>
+#include <QtConcurrentMap>
+
+#include "kis_global.h"
+#include "kis_paint_device.h"
+
+
+const quint32 KisDistanceTransform::infinity = std::numeric_limits<quint32>::max();
+
+namespace {
+
+const int stripeSize = 64;
+
+inline int nextStripeBorder(int value, int stripeSize)
+{
+    const int stripeIndex = value >= 0 ?
+        value / stripeSize :
+        -((-value + stripeSize - 1) / stripeSize);
+
+    return (stripeIndex + 1) * stripeSize;
+}
+
+template <class Pass>
+void runPassInStripes(const Pass &pass, const QRect &rect, bool horizontal)
+{
+    QVector<QRect> stripes;
+
+    if (horizontal) {
+        for (int y = rect.top(); y <= rect.bottom();) {
+            const int nextY = qMin(nextStripeBorder(y, stripeSize), rect.bottom() + 1);
+            stripes << QRect(rect.left(), y, rect.width(), nextY - y);
+            y = nextY;
+        }
+    } else {
+        for (int x = rect.left(); x <= rect.right();) {
+            const int nextX = qMin(nextStripeBorder(x, stripeSize), rect.right() + 1);
+            stripes << QRect(x, rect.top(), nextX - x, rect.height());
+            x = nextX;
+        }
+    }
+
+    if (stripes.size() > 1) {
+        QtConcurrent::blockingMap(stripes, pass);
+    } else if (!stripes.isEmpty()) {
+        pass(stripes.first());
+    }
+}
+
+/**
+ * Finds the vertical distance to the closest feature pixel for the
+ * columns of a vertical stripe of the window. Only the rows of the
+ * destination rect are stored.
+ */
+struct ColumnPass
+{
+    ColumnPass(KisPaintDeviceSP _selection, const QRect &_window,
+               const QRect &_rect, quint16 _noFeature, bool _inverted,
+               quint16 *_columnDistances)
+        : selection(_selection), window(_window), rect(_rect),
+          noFeature(_noFeature), inverted(_inverted),
+          columnDistances(_columnDistances)
+    {
+    }
+
+    void operator() (const QRect &stripe) const {
+        const int width = stripe.width();
+        const int height = stripe.height();
+
+        QVector<quint8> pixels(width * height);
+        selection->readBytes(pixels.data(), stripe);
+
+        const int firstRow = rect.top() - window.top();
+        const int lastRow = rect.bottom() - window.top();
+        const int dstStride = window.width();
+
+        for (int x = 0; x < width; x++) {
+            quint16 *dstColumn = columnDistances + stripe.left() - window.left() + x;
+            int distance = noFeature;
+
+            for (int y = 0; y <= lastRow; y++) {
+                const bool isFeature = (pixels[y * width + x] > 127) != inverted;
+                distance = isFeature ? 0 : qMin(distance + 1, int(noFeature));
+
+                if (y >= firstRow) {
+                    dstColumn[(y - firstRow) * dstStride] = distance;
+                }
+            }
+
+            distance = noFeature;
+
+            for (int y = height - 1; y >= firstRow; y--) {
+                const bool isFeature = (pixels[y * width + x] > 127) != inverted;
+                distance = isFeature ? 0 : qMin(distance + 1, int(noFeature));
+
+                if (y <= lastRow) {
+                    quint16 &value = dstColumn[(y - firstRow) * dstStride];
+                    value = qMin(value, quint16(distance));
+                }
+            }
+        }
+    }
+
+    KisPaintDeviceSP selection;
+    QRect window;
+    QRect rect;
+    quint16 noFeature;
+    bool inverted;
+    quint16 *columnDistances;
+};
+
+/**
+ * Finds the lower envelope of the parabolas (x - c)^2 + g(c)^2 for
+ * every row of a horizontal stripe of the destination rect
+ */
+struct RowPass
+{
+    RowPass(const QRect &_window, const QRect &_rect, quint16 _noFeature,
+            int _maxDistance, const quint16 *_columnDistances, quint32 *_result)
+        : window(_window), rect(_rect), noFeature(_noFeature),
+          maxSquaredDistance(quint32(_maxDistance) * _maxDistance),
+          columnDistances(_columnDistances), result(_result)
+    {
+    }
+
+    void operator() (const QRect &stripe) const {
+        const int width = window.width();
+        const int xOffset = rect.left() - window.left();
+
+        QVector<int> vertices(width);
+        QVector<qreal> starts(width + 1);
+
+        for (int y = stripe.top(); y <= stripe.bottom(); y++) {
+            const int row = y - rect.top();
+            const quint16 *g = columnDistances + row * width;
+            quint32 *dst = result + row * rect.width();
+
+            auto height = [g] (int c) {
+                return qreal(g[c]) * g[c] + qreal(c) * c;
+            };
+
+            int numVertices = 0;
+
+            for (int c = 0; c < width; c++) {
+                if (g[c] == noFeature) continue;
+
+                qreal start = -std::numeric_limits<qreal>::infinity();
+
+                while (numVertices) {
+                    const int v = vertices[numVertices - 1];
+                    start = (height(c) - height(v)) / (2.0 * (c - v));
+
+                    if (start > starts[numVertices - 1]) break;
+
+                    numVertices--;
+                    start = -std::numeric_limits<qreal>::infinity();
+                }
+
+                vertices[numVertices] = c;
+                starts[numVertices] = start;
+                numVertices++;
+            }
+
+            if (!numVertices) {
+                std::fill(dst, dst + rect.width(), KisDistanceTransform::infinity);
+                continue;
+            }
+
+            starts[numVertices] = std::numeric_limits<qreal>::infinity();
+
+            int k = 0;
+
+            for (int x = 0; x < rect.width(); x++) {
+                const int c = x + xOffset;
+
+                while (starts[k + 1] < c) k++;
+
+                const int v = vertices[k];
+                const qint64 dx = c - v;
+                const qint64 value = dx * dx + qint64(g[v]) * g[v];
+
+                dst[x] = value <= maxSquaredDistance ? quint32(value) : KisDistanceTransform::infinity;
+            }
+        }
+    }
+
+    QRect window;
+    QRect rect;
+    quint16 noFeature;
+    quint32 maxSquaredDistance;
+    const quint16 *columnDistances;
+    quint32 *result;
+};
+
+}
+
+QVector<quint32> KisDistanceTransform::squaredDistances(KisPaintDeviceSP selection,
+                                                        const QRect &rect,
+                                                        int maxDistance,
+                                                        bool inverted)
+{
+    if (rect.isEmpty()) return QVector<quint32>();
+
+    KIS_ASSERT_RECOVER_NOOP(selection->pixelSize() == 1);
+
+    // the vertical distances are stored in 16 bits
+    maxDistance = qBound(0, maxDistance, int(std::numeric_limits<quint16>::max()) - 1);
+    const quint16 noFeature = maxDistance + 1;
+
+    const QRect window = kisGrowRect(rect, maxDistance);
+
+    QVector<quint16> columnDistances(window.width() * rect.height());
+    QVector<quint32> result(rect.width() * rect.height());
+
+    ColumnPass columnPass(selection, window, rect, noFeature, inverted, columnDistances.data());
+    runPassInStripes(columnPass, window, false);
+
+    RowPass rowPass(window, rect, noFeature, maxDistance, columnDistances.constData(), result.data());
+    runPassInStripes(rowPass, rect, true);
+
+    return result;
+}
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_DISTANCE_TRANSFORM_H
+#define __KIS_DISTANCE_TRANSFORM_H
+
+#include <QVector>
+
+#include "kritaimage_export.h"
+#include "kis_types.h"
+
+class QRect;
+
+
+/**
+ * Exact Euclidean distance transform of a selection.
+ *
+ * The transform is separable (Felzenszwalb and Huttenlocher, Meijster
+ * et al.): the first pass finds the vertical distance to the closest
+ * feature pixel in every column, the second one finds the lower
+ * envelope of the parabolas (x - c)^2 + g(c)^2 in every row. Both
+ * passes are linear in the number of pixels and are processed in
+ * tile-aligned stripes in parallel.
+ */
+class KRITAIMAGE_EXPORT KisDistanceTransform
+{
+public:
+    /**
+     * The value of the pixels having no feature pixels closer than
+     * the maximum distance
+     */
+    static const quint32 infinity;
+
+    /**
+     * Calculates squared Euclidean distances from the pixels of \p rect
+     * to the closest feature pixel. Feature pixels are the selected
+     * pixels of \p selection (with value higher than 127) or, if
+     * \p inverted is true, the unselected ones. The feature pixels
+     * themselves get zero distance.
+     *
+     * Only the area of \p rect grown by \p maxDistance is read from
+     * \p selection. The distances not exceeding \p maxDistance are
+     * exact, the pixels having no feature pixels that close get
+     * infinity.
+     *
+     * \return the distances of the pixels of \p rect row by row
+     */
+    static QVector<quint32> squaredDistances(KisPaintDeviceSP selection,
+                                             const QRect &rect,
+                                             int maxDistance,
+                                             bool inverted = false);
+};
+
+#endif /* __KIS_DISTANCE_TRANSFORM_H */
@@ -86,6 +86,7 @@ void KisFillPainter::initFillPainter()
     m_sizemod = 0;
     m_feather = 0;
     m_useCompositioning = false;
+    m_useSimilarityCache = false;
     m_threshold = 0;
 }
 
@@ -304,6 +305,7 @@ KisSelectionSP KisFillPainter::createFloodSelection(int startX, int startY, KisP
 
     KisScanlineFill gc(sourceDevice, startPoint, fillBoundsRect);
     gc.setThreshold(m_threshold);
+    gc.setUseSimilarityCache(m_useSimilarityCache);
     gc.fillSelection(pixelSelection);
 
     if (m_sizemod > 0) {
@@ -316,7 +318,7 @@ KisSelectionSP KisFillPainter::createFloodSelection(int startX, int startY, KisP
     }
     if (m_feather > 0) {
         KisFeatherSelectionFilter feathery(m_feather);
-        feathery.process(pixelSelection, selection->selectedRect().adjusted(-m_feather, -m_feather, m_feather, m_feather));
+        feathery.process(pixelSelection, feathery.changeRect(selection->selectedRect()));
     }
 
     return selection;
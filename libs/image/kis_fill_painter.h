@@ -196,6 +196,19 @@ public:
         m_careForSelection = set;
     }
 
+    /** If true, the flood fill reuses the differences to the seed color
+        calculated by the previous fills (see KisScanlineFill::setUseSimilarityCache) */
+    bool useSimilarityCache() const {
+        return m_useSimilarityCache;
+    }
+
+    /** Enables the similarity cache. It should be used only when the source
+        device is a single layer, which the user usually fills many times in
+        a row. The merged projection of the image changes too often for it. */
+    void setUseSimilarityCache(bool value) {
+        m_useSimilarityCache = value;
+    }
+
     /** Sets the auto growth/shrinking radius */
     void setSizemod(int sizemod) {
         m_sizemod = sizemod;
@@ -232,6 +245,7 @@ private:
     QRect m_rect;
     bool m_careForSelection;
     bool m_useCompositioning;
+    bool m_useSimilarityCache;
 };
 
 
@@ -96,7 +96,8 @@ QRect KisFilterMask::decorateRect(KisPaintDeviceSP &src,
 
     filter->process(src, dst, 0, rc, filterConfig.data(), 0);
 
-    QRect r = filter->changedRect(rc, filterConfig.data(), dst->defaultBounds()->currentLevelOfDetail());
+    const int lod = dst->defaultBounds()->currentLevelOfDetail();
+    QRect r = filter->changedRect(rc, filter->lodScaledConfiguration(filterConfig, lod), lod);
     return r;
 }
 
@@ -130,7 +131,7 @@ QRect KisFilterMask::changeRect(const QRect &rect, PositionToFilthy pos) const
             parent->projection()->defaultBounds()->currentLevelOfDetail() : 0;
 
         KisFilterSP filter = KisFilterRegistry::instance()->value(filterConfig->name());
-        filteredRect = filter->changedRect(rect, filterConfig.data(), lod);
+        filteredRect = filter->changedRect(rect, filter->lodScaledConfiguration(filterConfig, lod), lod);
     }
 
     /**
@@ -174,6 +175,6 @@ QRect KisFilterMask::needRect(const QRect& rect, PositionToFilthy pos) const
      * And no KisMask::needRect will prevent us from doing this! ;)
      * That's why simply we do not call KisMask::needRect here :)
      */
-    return filter->neededRect(rect, filterConfig.data(), lod);
+    return filter->neededRect(rect, filter->lodScaledConfiguration(filterConfig, lod), lod);
 }
 
@@ -22,6 +22,17 @@
 #include "kis_convolution_kernel.h"
 #include <kis_convolution_painter.h>
 #include <QRect>
+#include <QVector>
+#include <QBitArray>
+#include <QtConcurrentMap>
+
+#include <KoColorSpace.h>
+#include <KoUpdater.h>
+
+#include "kis_paint_device.h"
+
+
+const int KisGaussianKernel::minRecursiveRadius = 20;
 
 
 qreal KisGaussianKernel::sigmaFromRadius(qreal radius)
@@ -104,6 +115,19 @@ void KisGaussianKernel::applyGaussian(KisPaintDeviceSP device,
                                       qreal xRadius, qreal yRadius,
                                       const QBitArray &channelFlags,
                                       KoUpdater *progressUpdater)
+{
+    if (qMax(xRadius, yRadius) >= minRecursiveRadius) {
+        applyGaussianRecursive(device, rect, xRadius, yRadius, channelFlags, progressUpdater);
+    } else {
+        applyGaussianConvolution(device, rect, xRadius, yRadius, channelFlags, progressUpdater);
+    }
+}
+
+void KisGaussianKernel::applyGaussianConvolution(KisPaintDeviceSP device,
+                                                 const QRect& rect,
+                                                 qreal xRadius, qreal yRadius,
+                                                 const QBitArray &channelFlags,
+                                                 KoUpdater *progressUpdater)
 {
     QPoint srcTopLeft = rect.topLeft();
 
@@ -147,6 +171,330 @@ void KisGaussianKernel::applyGaussian(KisPaintDeviceSP device,
     }
 }
 
+namespace {
+
+/**
+ * Coefficients of the recursive gaussian filter described in
+ * I.T. Young, L.J. van Vliet, "Recursive implementation of the
+ * Gaussian filter", Signal Processing 44 (1995) 139-151
+ *
+ * NOTE: for big radii b1 + b2 + b3 gets very close to 1.0, so B is
+ *       a small difference of big numbers. The coefficients and the
+ *       state of the recursion are kept in double, otherwise the
+ *       gain of the filter drifts noticeably away from 1.0.
+ */
+struct RecursiveGaussianCoeffs
+{
+    RecursiveGaussianCoeffs(qreal sigma) {
+        const qreal q = sigma >= 2.5 ?
+            0.98711 * sigma - 0.96330 :
+            3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+
+        const qreal q2 = pow2(q);
+        const qreal q3 = q2 * q;
+
+        const qreal b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+        b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+        b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+        b3 = 0.422205 * q3 / b0;
+        B = 1.0 - (b1 + b2 + b3);
+    }
+
+    double B;
+    double b1;
+    double b2;
+    double b3;
+};
+
+/**
+ * Runs the causal and anti-causal passes over \p size samples of
+ * \p data placed \p stride floats apart. The samples outside the
+ * line are considered to be equal to the border ones, which is the
+ * same thing BORDER_REPEAT does for the convolution.
+ */
+inline void recursiveGaussianLine(float *data, int size, int stride,
+                                  const RecursiveGaussianCoeffs &c)
+{
+    double w1 = data[0];
+    double w2 = w1;
+    double w3 = w1;
+
+    float *ptr = data;
+    for (int i = 0; i < size; i++, ptr += stride) {
+        const double w = c.B * *ptr + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        *ptr = w;
+        w3 = w2; w2 = w1; w1 = w;
+    }
+
+    ptr -= stride;
+
+    w1 = *ptr;
+    w2 = w1;
+    w3 = w1;
+
+    for (int i = 0; i < size; i++, ptr -= stride) {
+        const double w = c.B * *ptr + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        *ptr = w;
+        w3 = w2; w2 = w1; w1 = w;
+    }
+}
+
+/**
+ * Converts pixels into premultiplied floating point values and back
+ */
+class GaussianPixelConverter
+{
+public:
+    GaussianPixelConverter(const KoColorSpace *cs, const QBitArray &channelFlags)
+        : m_cs(cs),
+          m_numChannels(cs->channelCount()),
+          m_pixelSize(cs->pixelSize()),
+          m_alphaPos(cs->alphaPos()),
+          m_channelFlags(channelFlags),
+          m_isAlphaU8(cs->pixelSize() == 1 && cs->channelCount() == 1)
+    {
+        if (m_channelFlags.isEmpty()) {
+            m_channelFlags = QBitArray(m_numChannels, true);
+        }
+    }
+
+    int numChannels() const {
+        return m_numChannels;
+    }
+
+    /**
+     * \p channels is a scratch buffer of numChannels() values, it is
+     * passed by the caller so that it could be allocated only once
+     */
+    void toFloat(const quint8 *src, float *dst, int numPixels, QVector<float> &channels) const {
+        if (m_isAlphaU8) {
+            for (int i = 0; i < numPixels; i++) {
+                dst[i] = src[i];
+            }
+            return;
+        }
+
+        for (int i = 0; i < numPixels; i++) {
+            m_cs->normalisedChannelsValue(src, channels);
+
+            const float alpha = m_alphaPos >= 0 ? channels[m_alphaPos] : 1.0f;
+
+            for (int ch = 0; ch < m_numChannels; ch++) {
+                dst[ch] = ch != m_alphaPos ? channels[ch] * alpha : alpha;
+            }
+
+            src += m_pixelSize;
+            dst += m_numChannels;
+        }
+    }
+
+    void fromFloat(const float *src, quint8 *dst, int numPixels, QVector<float> &channels) const {
+        if (m_isAlphaU8) {
+            for (int i = 0; i < numPixels; i++) {
+                dst[i] = qBound(0, qRound(src[i]), 255);
+            }
+            return;
+        }
+
+        for (int i = 0; i < numPixels; i++) {
+            // fetch original values for the disabled channels
+            m_cs->normalisedChannelsValue(dst, channels);
+
+            const float alpha = m_alphaPos >= 0 ? src[m_alphaPos] : 1.0f;
+            const float invAlpha = alpha > 1e-6f ? 1.0f / alpha : 0.0f;
+
+            for (int ch = 0; ch < m_numChannels; ch++) {
+                if (!m_channelFlags.testBit(ch)) continue;
+
+                channels[ch] = ch != m_alphaPos ? src[ch] * invAlpha : alpha;
+            }
+
+            m_cs->fromNormalisedChannelsValue(dst, channels);
+
+            src += m_numChannels;
+            dst += m_pixelSize;
+        }
+    }
+
+private:
+    const KoColorSpace *m_cs;
+    const int m_numChannels;
+    const int m_pixelSize;
+    const int m_alphaPos;
+    QBitArray m_channelFlags;
+    const bool m_isAlphaU8;
+};
+
+/**
+ * Processes a single stripe of the rect in one direction. Horizontal
+ * stripes are processed by rows, vertical ones by columns, so the
+ * stripes are independent and can be processed in parallel.
+ */
+struct RecursiveGaussianPass
+{
+    RecursiveGaussianPass(KisPaintDeviceSP _src, KisPaintDeviceSP _dst,
+                          bool _horizontal, int _margin, qreal sigma,
+                          const QBitArray &channelFlags)
+        : src(_src), dst(_dst),
+          horizontal(_horizontal),
+          margin(_margin),
+          coeffs(sigma),
+          converter(_src->colorSpace(), channelFlags)
+    {
+    }
+
+    void operator() (const QRect &stripe) const {
+        const QRect readRect = horizontal ?
+            stripe.adjusted(-margin, 0, margin, 0) :
+            stripe.adjusted(0, -margin, 0, margin);
+
+        const int pixelSize = src->pixelSize();
+        const int numChannels = converter.numChannels();
+        const int numPixels = readRect.width() * readRect.height();
+
+        QVector<quint8> pixels(numPixels * pixelSize);
+        src->readBytes(pixels.data(), readRect);
+
+        QVector<float> values(numPixels * numChannels);
+        QVector<float> channels(numChannels);
+        converter.toFloat(pixels.constData(), values.data(), numPixels, channels);
+
+        if (horizontal) {
+            const int lineStride = readRect.width() * numChannels;
+            for (int row = 0; row < readRect.height(); row++) {
+                for (int ch = 0; ch < numChannels; ch++) {
+                    recursiveGaussianLine(values.data() + row * lineStride + ch,
+                                          readRect.width(), numChannels, coeffs);
+                }
+            }
+        } else {
+            const int lineStride = readRect.width() * numChannels;
+            for (int column = 0; column < readRect.width(); column++) {
+                for (int ch = 0; ch < numChannels; ch++) {
+                    recursiveGaussianLine(values.data() + column * numChannels + ch,
+                                          readRect.height(), lineStride, coeffs);
+                }
+            }
+        }
+
+        converter.fromFloat(values.constData(), pixels.data(), numPixels, channels);
+
+        if (horizontal) {
+            const int srcRowSize = readRect.width() * pixelSize;
+            const int dstRowSize = stripe.width() * pixelSize;
+
+            QVector<quint8> result(stripe.width() * stripe.height() * pixelSize);
+
+            for (int row = 0; row < stripe.height(); row++) {
+                memcpy(result.data() + row * dstRowSize,
+                       pixels.constData() + row * srcRowSize + margin * pixelSize,
+                       dstRowSize);
+            }
+
+            dst->writeBytes(result.constData(), stripe);
+        } else {
+            dst->writeBytes(pixels.constData() + margin * readRect.width() * pixelSize, stripe);
+        }
+    }
+
+    KisPaintDeviceSP src;
+    KisPaintDeviceSP dst;
+    bool horizontal;
+    int margin;
+    RecursiveGaussianCoeffs coeffs;
+    GaussianPixelConverter converter;
+};
+
+inline int nextStripeBorder(int value, int stripeSize)
+{
+    const int stripeIndex = value >= 0 ?
+        value / stripeSize :
+        -((-value + stripeSize - 1) / stripeSize);
+
+    return (stripeIndex + 1) * stripeSize;
+}
+
+void runRecursiveGaussianPass(KisPaintDeviceSP src, KisPaintDeviceSP dst,
+                              const QRect &rect, bool horizontal,
+                              int margin, qreal sigma,
+                              const QBitArray &channelFlags)
+{
+    /**
+     * Stripes are aligned to the tiles, so that the threads would not
+     * fight for the same tile
+     */
+    const int stripeSize = 64;
+
+    QVector<QRect> stripes;
+
+    if (horizontal) {
+        for (int y = rect.top(); y <= rect.bottom();) {
+            const int nextY = qMin(nextStripeBorder(y, stripeSize), rect.bottom() + 1);
+            stripes << QRect(rect.left(), y, rect.width(), nextY - y);
+            y = nextY;
+        }
+    } else {
+        for (int x = rect.left(); x <= rect.right();) {
+            const int nextX = qMin(nextStripeBorder(x, stripeSize), rect.right() + 1);
+            stripes << QRect(x, rect.top(), nextX - x, rect.height());
+            x = nextX;
+        }
+    }
+
+    RecursiveGaussianPass pass(src, dst, horizontal, margin, sigma, channelFlags);
+
+    if (stripes.size() > 1) {
+        QtConcurrent::blockingMap(stripes, pass);
+    } else if (!stripes.isEmpty()) {
+        pass(stripes.first());
+    }
+}
+
+}
+
+void KisGaussianKernel::applyGaussianRecursive(KisPaintDeviceSP device,
+                                               const QRect& rect,
+                                               qreal xRadius, qreal yRadius,
+                                               const QBitArray &channelFlags,
+                                               KoUpdater *progressUpdater)
+{
+    if (rect.isEmpty()) return;
+
+    const int xMargin = xRadius > 0.0 ? kernelSizeFromRadius(xRadius) / 2 : 0;
+    const int yMargin = yRadius > 0.0 ? kernelSizeFromRadius(yRadius) / 2 : 0;
+
+    if (xRadius > 0.0 && yRadius > 0.0) {
+        KisPaintDeviceSP interm = new KisPaintDevice(device->colorSpace());
+
+        runRecursiveGaussianPass(device, interm,
+                                 rect.adjusted(0, -yMargin, 0, yMargin),
+                                 true, xMargin, sigmaFromRadius(xRadius),
+                                 channelFlags);
+
+        if (progressUpdater) {
+            progressUpdater->setProgress(50);
+        }
+
+        runRecursiveGaussianPass(interm, device, rect,
+                                 false, yMargin, sigmaFromRadius(yRadius),
+                                 channelFlags);
+
+    } else if (xRadius > 0.0) {
+        runRecursiveGaussianPass(device, device, rect,
+                                 true, xMargin, sigmaFromRadius(xRadius),
+                                 channelFlags);
+
+    } else if (yRadius > 0.0) {
+        runRecursiveGaussianPass(device, device, rect,
+                                 false, yMargin, sigmaFromRadius(yRadius),
+                                 channelFlags);
+    }
+
+    if (progressUpdater) {
+        progressUpdater->setProgress(100);
+    }
+}
+
 Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic>
 KisGaussianKernel::createLoGMatrix(qreal radius)
 {
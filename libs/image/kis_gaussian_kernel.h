@@ -44,12 +44,51 @@ public:
     static qreal sigmaFromRadius(qreal radius);
     static int kernelSizeFromRadius(qreal radius);
 
+    /**
+     * Blurs \p rect of \p device. Small radii are processed with
+     * the usual convolution kernel, for radii larger than
+     * minRecursiveRadius the recursive filter is used, whose speed
+     * doesn't depend on the radius.
+     */
     static void applyGaussian(KisPaintDeviceSP device,
                               const QRect& rect,
                               qreal xRadius, qreal yRadius,
                               const QBitArray &channelFlags,
                               KoUpdater *updater);
 
+    /**
+     * Blurs \p rect of \p device by convolving it with the kernels
+     * created by createHorizontalKernel() and createVerticalKernel().
+     * The cost of the operation is proportional to the radius.
+     */
+    static void applyGaussianConvolution(KisPaintDeviceSP device,
+                                         const QRect& rect,
+                                         qreal xRadius, qreal yRadius,
+                                         const QBitArray &channelFlags,
+                                         KoUpdater *updater);
+
+    /**
+     * Blurs \p rect of \p device with a recursive (IIR) approximation
+     * of the gaussian by Young and van Vliet. The cost per pixel is
+     * constant for any radius. The device is processed in tile-aligned
+     * stripes in parallel.
+     *
+     * The filter reads the same area of the device as
+     * applyGaussianConvolution() does, so the need rects of the
+     * callers stay valid.
+     */
+    static void applyGaussianRecursive(KisPaintDeviceSP device,
+                                       const QRect& rect,
+                                       qreal xRadius, qreal yRadius,
+                                       const QBitArray &channelFlags,
+                                       KoUpdater *updater);
+
+    /**
+     * The radius starting from which applyGaussian() switches to
+     * the recursive filter
+     */
+    static const int minRecursiveRadius;
+
     static Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> createLoGMatrix(qreal radius);
 
     static void applyLoG(KisPaintDeviceSP device,
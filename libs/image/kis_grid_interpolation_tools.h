@@ -21,8 +21,10 @@
 
 #include <limits>
 #include <algorithm>
+#include <cmath>
 
 #include <QImage>
+#include <QtConcurrentMap>
 
 #include "kis_algebra_2d.h"
 #include "kis_four_point_interpolator_forward.h"
@@ -184,7 +186,16 @@ struct PaintDevicePolygonOp
     }
 
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
-        QRect boundRect = clipDstPolygon.boundingRect().toAlignedRect();
+        processPolygon(srcPolygon, dstPolygon, clipDstPolygon,
+                       clipDstPolygon.boundingRect().toAlignedRect());
+    }
+
+    /**
+     * Processes only the part of the polygon lying inside \p boundRect.
+     * It lets us split rasterization of the grid into independent
+     * stripes (see ParallelRasterizationOp)
+     */
+    void processPolygon(const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon, const QRect &boundRect) {
         if (boundRect.isEmpty()) return;
 
         KisSequentialIterator dstIt(m_dstDev, boundRect);
@@ -229,6 +240,12 @@ struct PaintDevicePolygonOp
     KisPaintDeviceSP m_dstDev;
 };
 
+/**
+ * Please note that the operation writes directly into the bits of
+ * \p dstImage, so it is safe to use it from several threads as long
+ * as they process different areas of the image. Both images should be
+ * in Format_ARGB32.
+ */
 struct QImagePolygonOp
 {
     QImagePolygonOp(const QImage &srcImage, QImage &dstImage,
@@ -238,8 +255,12 @@ struct QImagePolygonOp
           m_srcImageOffset(srcImageOffset),
           m_dstImageOffset(dstImageOffset),
           m_srcImageRect(m_srcImage.rect()),
-          m_dstImageRect(m_dstImage.rect())
+          m_dstImageRect(m_dstImage.rect()),
+          m_dstBits(m_dstImage.bits()),
+          m_dstBytesPerLine(m_dstImage.bytesPerLine())
     {
+        KIS_ASSERT_RECOVER_NOOP(m_srcImage.depth() == 32);
+        KIS_ASSERT_RECOVER_NOOP(m_dstImage.depth() == 32);
     }
 
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon) {
@@ -247,7 +268,28 @@ struct QImagePolygonOp
     }
 
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
-        QRect boundRect = clipDstPolygon.boundingRect().toAlignedRect();
+        processPolygon(srcPolygon, dstPolygon, clipDstPolygon,
+                       clipDstPolygon.boundingRect().toAlignedRect());
+
+#ifdef DEBUG_PAINTING_POLYGONS
+        QPainter gc(&m_dstImage);
+        gc.setPen(Qt::red);
+        gc.setOpacity(0.5);
+
+        gc.setBrush(Qt::green);
+        gc.drawPolygon(clipDstPolygon.translated(-m_dstImageOffset));
+
+        gc.setBrush(Qt::blue);
+        //gc.drawPolygon(dstPolygon.translated(-m_dstImageOffset));
+
+#endif /* DEBUG_PAINTING_POLYGONS */
+    }
+
+    /**
+     * Processes only the part of the polygon lying inside \p boundRect
+     * (see PaintDevicePolygonOp::processPolygon())
+     */
+    void processPolygon(const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon, const QRect &boundRect) {
         KisFourPointInterpolatorBackward interp(srcPolygon, dstPolygon);
 
         for (int y = boundRect.top(); y <= boundRect.bottom(); y++) {
@@ -272,24 +314,11 @@ struct QImagePolygonOp
                     if (!m_dstImageRect.contains(srcPointI)) continue;
                     if (!m_srcImageRect.contains(dstPointI)) continue;
 
-                    m_dstImage.setPixel(srcPointI, m_srcImage.pixel(dstPointI));
+                    QRgb *dstLine = reinterpret_cast<QRgb*>(m_dstBits + srcPointI.y() * m_dstBytesPerLine);
+                    dstLine[srcPointI.x()] = m_srcImage.pixel(dstPointI);
                 }
             }
         }
-
-#ifdef DEBUG_PAINTING_POLYGONS
-        QPainter gc(&m_dstImage);
-        gc.setPen(Qt::red);
-        gc.setOpacity(0.5);
-
-        gc.setBrush(Qt::green);
-        gc.drawPolygon(clipDstPolygon.translated(-m_dstImageOffset));
-
-        gc.setBrush(Qt::blue);
-        //gc.drawPolygon(dstPolygon.translated(-m_dstImageOffset));
-
-#endif /* DEBUG_PAINTING_POLYGONS */
-
     }
 
     const QImage &m_srcImage;
@@ -299,6 +328,172 @@ struct QImagePolygonOp
 
     QRect m_srcImageRect;
     QRect m_dstImageRect;
+
+    quint8 *m_dstBits;
+    int m_dstBytesPerLine;
+};
+
+/*************************************************************/
+/*      Parallel rasterization of the grid                   */
+/*************************************************************/
+
+struct RasterizationPolygon {
+    QPolygonF srcPolygon;
+    QPolygonF dstPolygon;
+    QPolygonF clipDstPolygon;
+    QRect dstBounds;
+};
+
+struct RasterizationStripe {
+    QRect rect;
+    QVector<int> polygonIndexes;
+};
+
+template <class PolygonOp>
+struct RasterizeStripeOp
+{
+    RasterizeStripeOp(const PolygonOp &_polygonOp,
+                      const QVector<RasterizationPolygon> &_polygons)
+        : polygonOp(_polygonOp),
+          polygons(_polygons)
+    {
+    }
+
+    void operator() (const RasterizationStripe &stripe) {
+        PolygonOp op(polygonOp);
+
+        Q_FOREACH (int index, stripe.polygonIndexes) {
+            const RasterizationPolygon &polygon = polygons[index];
+
+            op.processPolygon(polygon.srcPolygon,
+                              polygon.dstPolygon,
+                              polygon.clipDstPolygon,
+                              polygon.dstBounds & stripe.rect);
+        }
+    }
+
+    const PolygonOp &polygonOp;
+    const QVector<RasterizationPolygon> &polygons;
+};
+
+/**
+ * A polygon op that rasterizes the polygons generated by the grid
+ * iteration with \p PolygonOp in parallel.
+ *
+ * The polygons are collected into batches of limited size, so the
+ * memory usage doesn't depend on the size of the grid. When a batch is
+ * full, its destination area is split into stripes which are processed
+ * in parallel. Every stripe handles the polygons in the same order as
+ * the grid iteration generated them, and the batches are processed one
+ * after another, so the result is exactly the same as if the polygons
+ * were rasterized sequentially.
+ *
+ * finish() must be called after the iteration to rasterize the last
+ * batch.
+ */
+template <class PolygonOp>
+struct ParallelRasterizationOp
+{
+    /**
+     * If \p clipRect is not empty, only this part of the destination
+     * is rasterized.
+     */
+    ParallelRasterizationOp(const PolygonOp &polygonOp, const QRect &clipRect = QRect())
+        : m_polygonOp(polygonOp),
+          m_clipRect(clipRect)
+    {
+        m_polygons.reserve(maxBatchSize);
+    }
+
+    void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon) {
+        this->operator() (srcPolygon, dstPolygon, dstPolygon);
+    }
+
+    void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
+        RasterizationPolygon polygon;
+        polygon.dstBounds = clipDstPolygon.boundingRect().toAlignedRect();
+
+        if (!m_clipRect.isEmpty()) {
+            polygon.dstBounds &= m_clipRect;
+        }
+
+        if (polygon.dstBounds.isEmpty()) return;
+
+        polygon.srcPolygon = srcPolygon;
+        polygon.dstPolygon = dstPolygon;
+        polygon.clipDstPolygon = clipDstPolygon;
+
+        m_polygons.append(polygon);
+        m_bounds |= polygon.dstBounds;
+
+        if (m_polygons.size() >= maxBatchSize) {
+            finish();
+        }
+    }
+
+    /**
+     * Rasterizes the polygons collected so far
+     */
+    void finish() {
+        if (m_polygons.isEmpty()) return;
+
+        /**
+         * The stripes are aligned to the tiles of the paint device,
+         * so that different threads never write into the same tile.
+         * A batch usually covers a few rows of the grid cells, so
+         * the stripes are cut across the longer side of the batch
+         * to get enough of them for all the threads.
+         */
+        const int stripeSize = 64;
+        const bool horizontal = m_bounds.height() >= m_bounds.width();
+
+        const int boundsStart = horizontal ? m_bounds.top() : m_bounds.left();
+        const int boundsEnd = horizontal ? m_bounds.bottom() : m_bounds.right();
+
+        const int firstStripe = std::floor(qreal(boundsStart) / stripeSize);
+        const int lastStripe = std::floor(qreal(boundsEnd) / stripeSize);
+
+        QVector<RasterizationStripe> stripes(lastStripe - firstStripe + 1);
+        for (int i = 0; i < stripes.size(); i++) {
+            const int start = (firstStripe + i) * stripeSize;
+            const QRect stripeRect = horizontal ?
+                QRect(m_bounds.left(), start, m_bounds.width(), stripeSize) :
+                QRect(start, m_bounds.top(), stripeSize, m_bounds.height());
+
+            stripes[i].rect = stripeRect & m_bounds;
+        }
+
+        for (int i = 0; i < m_polygons.size(); i++) {
+            const QRect &rc = m_polygons[i].dstBounds;
+
+            const int first = std::floor(qreal(horizontal ? rc.top() : rc.left()) / stripeSize) - firstStripe;
+            const int last = std::floor(qreal(horizontal ? rc.bottom() : rc.right()) / stripeSize) - firstStripe;
+
+            for (int stripe = first; stripe <= last; stripe++) {
+                stripes[stripe].polygonIndexes.append(i);
+            }
+        }
+
+        /**
+         * The transform workers don't know the image, so they cannot
+         * use the pool of its updater context. They are run by an
+         * updater thread, which waits here and rasterizes stripes too,
+         * so the global pool is used, the same way KisAutoBrush does.
+         */
+        QtConcurrent::blockingMap(stripes, RasterizeStripeOp<PolygonOp>(m_polygonOp, m_polygons));
+
+        m_polygons.clear();
+        m_bounds = QRect();
+    }
+
+private:
+    static const int maxBatchSize = 16384;
+
+    PolygonOp m_polygonOp;
+    QRect m_clipRect;
+
+    QVector<RasterizationPolygon> m_polygons;
+    QRect m_bounds;
 };
 
 /*************************************************************/
@@ -23,6 +23,7 @@
 #include "kis_types.h"
 
 class KoColorSpace;
+class KisGroupProjectionCache;
 
 /**
  * A KisLayer that bundles child layers into a single layer.
@@ -107,6 +108,13 @@ public:
 
     bool projectionIsValid() const;
 
+    /**
+     * \return the cache of the flattened children of the group, used
+     *         by KisAsyncMerger to avoid recompositing the layers lying
+     *         below the changed one. See KisGroupProjectionCache.
+     */
+    KisGroupProjectionCache* projectionCache() const;
+
 protected:
     KisLayer* onlyMeaningfulChild() const;
     KisPaintDeviceSP tryObligeChild() const;
@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_group_projection_cache.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegion>
+
+#include <KoColorSpace.h>
+#include <KoColor.h>
+
+#include "kis_node.h"
+#include "kis_painter.h"
+#include "kis_paint_device.h"
+
+
+struct KisGroupProjectionCache::Private
+{
+    Private()
+        : levelOfDetail(0),
+          graphSequenceNumber(-1)
+    {
+    }
+
+    KisPaintDeviceSP device;
+    KisNodeWSP keyNode;
+    int levelOfDetail;
+    int graphSequenceNumber;
+    QPoint offset;
+    QRegion validRegion;
+
+    QMutex lock;
+
+    bool isCompatible(KisNodeSP node, int lod, KisPaintDeviceSP dev) const {
+        return device &&
+            keyNode.isValid() && keyNode == node.data() &&
+            levelOfDetail == lod &&
+            graphSequenceNumber == node->graphSequenceNumber() &&
+            offset == QPoint(dev->x(), dev->y()) &&
+            *device->colorSpace() == *dev->colorSpace() &&
+            device->defaultPixel() == dev->defaultPixel();
+    }
+
+    void resetUnlocked() {
+        device = 0;
+        keyNode = 0;
+        validRegion = QRegion();
+    }
+};
+
+
+KisGroupProjectionCache::KisGroupProjectionCache()
+    : m_d(new Private)
+{
+}
+
+KisGroupProjectionCache::~KisGroupProjectionCache()
+{
+}
+
+bool KisGroupProjectionCache::fetchBelow(KisNodeSP keyNode, int levelOfDetail,
+                                         const QRect &rect, KisPaintDeviceSP dstDevice)
+{
+    QMutexLocker l(&m_d->lock);
+
+    if (!m_d->isCompatible(keyNode, levelOfDetail, dstDevice)) return false;
+    if (!m_d->validRegion.contains(rect)) return false;
+
+    KisPainter::copyAreaOptimized(rect.topLeft(), m_d->device, dstDevice, rect);
+    return true;
+}
+
+void KisGroupProjectionCache::storeBelow(KisNodeSP keyNode, int levelOfDetail,
+                                         const QRect &rect, KisPaintDeviceSP srcDevice)
+{
+    QMutexLocker l(&m_d->lock);
+
+    if (!m_d->isCompatible(keyNode, levelOfDetail, srcDevice)) {
+        m_d->resetUnlocked();
+
+        m_d->device = new KisPaintDevice(srcDevice->colorSpace());
+        m_d->device->setDefaultPixel(srcDevice->defaultPixel());
+        m_d->device->setX(srcDevice->x());
+        m_d->device->setY(srcDevice->y());
+        m_d->keyNode = keyNode;
+        m_d->levelOfDetail = levelOfDetail;
+        m_d->graphSequenceNumber = keyNode->graphSequenceNumber();
+        m_d->offset = QPoint(srcDevice->x(), srcDevice->y());
+    }
+
+    KisPainter::copyAreaOptimized(rect.topLeft(), srcDevice, m_d->device, rect);
+    m_d->validRegion += rect;
+}
+
+KisNodeSP KisGroupProjectionCache::keyNode() const
+{
+    QMutexLocker l(&m_d->lock);
+    return m_d->keyNode;
+}
+
+void KisGroupProjectionCache::invalidate(const QRect &rect)
+{
+    QMutexLocker l(&m_d->lock);
+
+    if (!m_d->device) return;
+
+    m_d->validRegion -= rect;
+
+    if (m_d->validRegion.isEmpty()) {
+        m_d->resetUnlocked();
+    }
+}
+
+void KisGroupProjectionCache::reset()
+{
+    QMutexLocker l(&m_d->lock);
+    m_d->resetUnlocked();
+}
@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_GROUP_PROJECTION_CACHE_H
+#define __KIS_GROUP_PROJECTION_CACHE_H
+
+#include <QScopedPointer>
+
+#include "kritaimage_export.h"
+#include "kis_types.h"
+
+class QRect;
+
+
+/**
+ * KisGroupProjectionCache stores a flattened composition of all the
+ * children of a group layer lying below some "key" child. When the
+ * user paints on a layer in a deep stack, the merger composites all
+ * the unchanged layers below it again and again. With the cache it
+ * can just copy the precomposed result and start compositing from the
+ * key node.
+ *
+ * The cache keeps data for a single key node only. Switching to
+ * another key (e.g. the user selected another layer), changing the
+ * level of detail, the color space or the structure of the graph
+ * drops the cache completely. Dirty areas are removed from the cache
+ * by KisAsyncMerger, which knows what nodes are changed in every
+ * merge.
+ *
+ * The class is thread-safe. Please note that the updates scheduler
+ * guarantees that no two merge jobs access intersecting areas, so
+ * locking the whole cache on every access is enough.
+ */
+class KRITAIMAGE_EXPORT KisGroupProjectionCache
+{
+public:
+    KisGroupProjectionCache();
+    ~KisGroupProjectionCache();
+
+    /**
+     * Copies the cached composition of the children below \p keyNode
+     * into \p dstDevice.
+     *
+     * \return false if the cache doesn't have any data for \p keyNode
+     *         covering the whole \p rect. \p dstDevice is not touched
+     *         in such a case.
+     */
+    bool fetchBelow(KisNodeSP keyNode, int levelOfDetail,
+                    const QRect &rect, KisPaintDeviceSP dstDevice);
+
+    /**
+     * Saves area \p rect of \p srcDevice as a composition of the
+     * children below \p keyNode. If the cache has data for other key
+     * node, it is dropped.
+     */
+    void storeBelow(KisNodeSP keyNode, int levelOfDetail,
+                    const QRect &rect, KisPaintDeviceSP srcDevice);
+
+    /**
+     * \return the node the cache currently stores data for
+     */
+    KisNodeSP keyNode() const;
+
+    /**
+     * Removes \p rect from the valid area of the cache
+     */
+    void invalidate(const QRect &rect);
+
+    /**
+     * Drops all the cached data
+     */
+    void reset();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_GROUP_PROJECTION_CACHE_H */
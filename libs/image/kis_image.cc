@@ -31,6 +31,7 @@
 #include <QRect>
 #include <QRegion>
 #include <QtConcurrent>
+#include <QQueue>
 
 #include <klocalizedstring.h>
 
@@ -244,6 +245,57 @@ KisImage::KisImage(KisUndoStore *undoStore, qint32 width, qint32 height, const K
     connect(this, SIGNAL(sigImageModified()), KisMemoryStatisticsServer::instance(), SLOT(notifyImageChanged()));
 }
 
+KisImage::KisImage(const KisImage& rhs, KisUndoStore *undoStore, bool exactCopy)
+    : KisImage(undoStore, rhs.width(), rhs.height(), rhs.colorSpace(), rhs.objectName())
+{
+    m_d->xres = rhs.m_d->xres;
+    m_d->yres = rhs.m_d->yres;
+
+    if (rhs.m_d->proofingConfig) {
+        m_d->proofingConfig = toQShared(new KisProofingConfiguration(*rhs.m_d->proofingConfig));
+    }
+
+    delete m_d->animationInterface;
+    m_d->animationInterface = new KisImageAnimationInterface(*rhs.m_d->animationInterface, this);
+
+    const KoColor defaultProjectionColor = rhs.defaultProjectionColor();
+
+    KisNodeSP newRoot = rhs.root()->clone();
+    setRootLayer(static_cast<KisGroupLayer*>(newRoot.data()));
+    setDefaultProjectionColor(defaultProjectionColor);
+
+    if (exactCopy) {
+        QQueue<KisNodeSP> linearizedNodes;
+
+        KisLayerUtils::recursiveApplyNodes(rhs.root(),
+            [&linearizedNodes] (KisNodeSP node) {
+                linearizedNodes.enqueue(node);
+            });
+
+        KisLayerUtils::recursiveApplyNodes(newRoot,
+            [&linearizedNodes] (KisNodeSP node) {
+                KisNodeSP refNode = linearizedNodes.dequeue();
+                node->setUuid(refNode->uuid());
+            });
+    }
+
+    Q_FOREACH (KisLayerCompositionSP composition, rhs.m_d->compositions) {
+        m_d->compositions << toQShared(new KisLayerComposition(*composition, this));
+    }
+
+    // the annotations cannot be changed after creation, so they can be shared
+    m_d->annotations = rhs.m_d->annotations;
+
+    m_d->nserver = rhs.m_d->nserver;
+    m_d->wrapAroundModePermitted = rhs.m_d->wrapAroundModePermitted;
+    m_d->blockLevelOfDetail = rhs.m_d->blockLevelOfDetail;
+}
+
+KisImage* KisImage::clone(bool exactCopy)
+{
+    return new KisImage(*this, 0, exactCopy);
+}
+
 KisImage::~KisImage()
 {
     dbgImage << "deleting kisimage" << objectName();
@@ -82,6 +82,21 @@ public:
     KisImage(KisUndoStore *undoStore, qint32 width, qint32 height, const KoColorSpace * colorSpace, const QString& name);
     virtual ~KisImage();
 
+    /**
+     * Creates a copy of the image with all its layers, compositions
+     * and annotations. The paint devices of the layers are copied in
+     * copy-on-write manner, so cloning is cheap even for big images.
+     * The undo history is not copied.
+     *
+     * The image must be locked (or at least have no running strokes)
+     * while being cloned.
+     *
+     * @param exactCopy if true, the nodes of the clone get the same
+     *        UUIDs as the original ones, so the clone can be saved
+     *        instead of the original image (e.g. in a background thread)
+     */
+    KisImage* clone(bool exactCopy = false);
+
 public: // KisNodeGraphListener implementation
 
     void aboutToAddANode(KisNode *parent, int index);
@@ -888,7 +903,7 @@ public Q_SLOTS:
 
 private:
 
-    KisImage(const KisImage& rhs);
+    KisImage(const KisImage& rhs, KisUndoStore *undoStore, bool exactCopy);
     KisImage& operator=(const KisImage& rhs);
 
     void emitSizeChanged();
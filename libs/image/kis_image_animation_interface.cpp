@@ -84,6 +84,20 @@ KisImageAnimationInterface::KisImageAnimationInterface(KisImage *image)
     connect(this, SIGNAL(sigInternalRequestTimeSwitch(int, bool)), SLOT(switchCurrentTimeAsync(int, bool)));
 }
 
+KisImageAnimationInterface::KisImageAnimationInterface(const KisImageAnimationInterface &rhs, KisImage *newImage)
+    : m_d(new Private)
+{
+    m_d->image = newImage;
+
+    m_d->framerate = rhs.m_d->framerate;
+    m_d->fullClipRange = rhs.m_d->fullClipRange;
+    m_d->playbackRange = rhs.m_d->playbackRange;
+    m_d->setCurrentTime(rhs.m_d->currentTime());
+    m_d->setCurrentUITime(rhs.m_d->currentUITime());
+
+    connect(this, SIGNAL(sigInternalRequestTimeSwitch(int, bool)), SLOT(switchCurrentTimeAsync(int, bool)));
+}
+
 KisImageAnimationInterface::~KisImageAnimationInterface()
 {
 }
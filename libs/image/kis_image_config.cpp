@@ -453,3 +453,14 @@ void KisImageConfig::setUseLodForColorizeMask(bool value)
 {
     m_config.writeEntry("useLodForColorizeMask", value);
 }
+
+bool KisImageConfig::lazyLayerLoading(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("lazyLayerLoading", false) : false;
+}
+
+void KisImageConfig::setLazyLayerLoading(bool value)
+{
+    m_config.writeEntry("lazyLayerLoading", value);
+}
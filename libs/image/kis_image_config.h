@@ -111,6 +111,14 @@ public:
     bool useLodForColorizeMask(bool requestDefault = false) const;
     void setUseLodForColorizeMask(bool value);
 
+    /**
+     * When enabled, the tiles of the loaded paint devices are put into
+     * the swap file in their compressed form and are decompressed only
+     * when accessed for the first time
+     */
+    bool lazyLayerLoading(bool requestDefault = false) const;
+    void setLazyLayerLoading(bool value);
+
 
 private:
     Q_DISABLE_COPY(KisImageConfig)
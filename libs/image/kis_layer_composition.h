@@ -36,6 +36,13 @@ class KRITAIMAGE_EXPORT KisLayerComposition
 {
 public:
     KisLayerComposition(KisImageWSP image, const QString& name);
+
+   /**
+    * Creates a copy of \p rhs attached to \p otherImage. The nodes are
+    * referenced by their UUIDs, so the copy is valid only for the
+    * images with the same node UUIDs, e.g. an exact clone of the image.
+    */
+    KisLayerComposition(const KisLayerComposition &rhs, KisImageWSP otherImage);
     ~KisLayerComposition();
 
    /**
@@ -18,6 +18,8 @@
 
 #include "kis_liquify_transform_worker.h"
 
+#include <QTransform>
+
 #include "kis_grid_interpolation_tools.h"
 #include "kis_dom_utils.h"
 #include "krita_utils.h"
@@ -43,6 +45,23 @@ struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
     int pixelPrecision;
     QSize gridSize;
 
+    /**
+     * The result of the last runOnQImage() call. During an interactive
+     * stroke only a small part of the grid changes between the calls,
+     * so we can re-rasterize only the cells whose points have moved.
+     */
+    struct PreviewCache {
+        QImage srcImage;
+        QPointF srcImageOffset;
+        QTransform imageToThumbTransform;
+        QRect dstBounds;
+        QVector<QPointF> transformedPoints;
+        QImage dstImage;
+    };
+    PreviewCache previewCache;
+
+    QRect changedPreviewRect(const QVector<QPointF> &transformedPointsLocal) const;
+
     void preparePoints();
 
     struct MapIndexesOp;
@@ -421,12 +440,13 @@ void KisLiquifyTransformWorker::run(KisPaintDeviceSP device)
 
     using namespace GridIterationTools;
 
-    PaintDevicePolygonOp polygonOp(srcDev, device);
+    ParallelRasterizationOp<PaintDevicePolygonOp> rasterizationOp(PaintDevicePolygonOp(srcDev, device));
     Private::MapIndexesOp indexesOp(m_d.data());
-    iterateThroughGrid<AlwaysCompletePolygonPolicy>(polygonOp, indexesOp,
+    iterateThroughGrid<AlwaysCompletePolygonPolicy>(rasterizationOp, indexesOp,
                                                     m_d->gridSize,
                                                     m_d->originalPoints,
                                                     m_d->transformedPoints);
+    rasterizationOp.finish();
 }
 
 QRect KisLiquifyTransformWorker::approxChangeRect(const QRect &rc)
@@ -510,19 +530,103 @@ QImage KisLiquifyTransformWorker::runOnQImage(const QImage &srcImage,
 
     QRect dstBoundsI = dstBounds.toAlignedRect();
 
-    QImage dstImage(dstBoundsI.size(), srcImage.format());
-    dstImage.fill(0);
+    Private::PreviewCache &cache = m_d->previewCache;
+
+    const bool canReuseCache =
+        !cache.dstImage.isNull() &&
+        cache.dstBounds == dstBoundsI &&
+        cache.srcImageOffset == srcImageOffset &&
+        cache.imageToThumbTransform == imageToThumbTransform &&
+        cache.transformedPoints.size() == transformedPointsLocal.size() &&
+        cache.srcImage == srcImage;
+
+    QImage dstImage;
+    QRect changedRect;
+
+    if (canReuseCache) {
+        changedRect = m_d->changedPreviewRect(transformedPointsLocal);
+        if (changedRect.isEmpty()) {
+            return cache.dstImage;
+        }
+
+        dstImage = cache.dstImage;
+
+        /**
+         * Clear the pixels which are going to be rasterized again. The
+         * polygon op rounds the coordinates with QPointF::toPoint(),
+         * so we should do the same.
+         */
+        const QRect clearRect =
+            QRect((changedRect.topLeft() - dstQImageOffset).toPoint(),
+                  (changedRect.bottomRight() - dstQImageOffset).toPoint()) & dstImage.rect();
+
+        const int bytesPerPixel = dstImage.depth() / 8;
+        for (int y = clearRect.top(); y <= clearRect.bottom(); y++) {
+            memset(dstImage.scanLine(y) + clearRect.left() * bytesPerPixel,
+                   0, clearRect.width() * bytesPerPixel);
+        }
+    } else {
+        dstImage = QImage(dstBoundsI.size(), srcImage.format());
+        dstImage.fill(0);
+    }
 
     GridIterationTools::QImagePolygonOp polygonOp(srcImage, dstImage, srcImageOffset, dstQImageOffset);
+    GridIterationTools::ParallelRasterizationOp<GridIterationTools::QImagePolygonOp> rasterizationOp(polygonOp, changedRect);
     Private::MapIndexesOp indexesOp(m_d.data());
     GridIterationTools::iterateThroughGrid
-        <GridIterationTools::AlwaysCompletePolygonPolicy>(polygonOp, indexesOp,
+        <GridIterationTools::AlwaysCompletePolygonPolicy>(rasterizationOp, indexesOp,
                                                           m_d->gridSize,
                                                           originalPointsLocal,
                                                           transformedPointsLocal);
+    rasterizationOp.finish();
+
+    cache.srcImage = srcImage;
+    cache.srcImageOffset = srcImageOffset;
+    cache.imageToThumbTransform = imageToThumbTransform;
+    cache.dstBounds = dstBoundsI;
+    cache.transformedPoints = transformedPointsLocal;
+    cache.dstImage = dstImage;
+
     return dstImage;
 }
 
+QRect KisLiquifyTransformWorker::Private::changedPreviewRect(const QVector<QPointF> &transformedPointsLocal) const
+{
+    const QVector<QPointF> &cachedPoints = previewCache.transformedPoints;
+
+    QRectF changedRect;
+    bool hasChanges = false;
+
+    /**
+     * When a point moves, all the four cells around it change. Both
+     * the old and the new positions of the cells should be updated.
+     */
+    for (int row = 0; row < gridSize.height() - 1; row++) {
+        for (int col = 0; col < gridSize.width() - 1; col++) {
+            QVector<int> indexes = GridIterationTools::calculateCellIndexes(col, row, gridSize);
+
+            bool changed = false;
+            Q_FOREACH (int index, indexes) {
+                if (cachedPoints[index] != transformedPointsLocal[index]) {
+                    changed = true;
+                    break;
+                }
+            }
+
+            if (!changed) continue;
+            hasChanges = true;
+
+            Q_FOREACH (int index, indexes) {
+                KisAlgebra2D::accumulateBounds(cachedPoints[index], &changedRect);
+                KisAlgebra2D::accumulateBounds(transformedPointsLocal[index], &changedRect);
+            }
+        }
+    }
+
+    // rasterization of the polygons may spread one pixel further
+    return hasChanges ? changedRect.toAlignedRect().adjusted(-1, -1, 1, 1) : QRect();
+}
+
 void KisLiquifyTransformWorker::toXML(QDomElement *e) const
 {
     QDomDocument doc = e->ownerDocument();
@@ -21,6 +21,10 @@
 #include <QGlobalStatic>
 
 #include "kis_image.h"
+#include "kis_mask.h"
+#include "kis_selection.h"
+#include "kis_pixel_selection.h"
+#include "kis_datamanager.h"
 #include "kis_image_config.h"
 #include "kis_signal_compressor.h"
 
@@ -91,6 +95,30 @@ qint64 calculateNodeMemoryHiBound(KisNodeSP node)
     return calculateNodeMemoryHiBoundStep(node, devices);
 }
 
+void calculateSelectionsMemoryStep(KisNodeSP node,
+                                   QSet<const KisTileData*> &countedTileData,
+                                   qint64 &size, qint64 &unpackedSize)
+{
+    KisMask *mask = dynamic_cast<KisMask*>(node.data());
+
+    if (mask && mask->selection()) {
+        KisPixelSelectionSP pixelSelection = mask->selection()->pixelSelection();
+        KisDataManagerSP dm = pixelSelection->dataManager();
+
+        size += dm->tileDataMemoryUsage(&countedTileData);
+        unpackedSize +=
+            qint64(dm->numTiles()) *
+            KisTileData::WIDTH * KisTileData::HEIGHT *
+            pixelSelection->pixelSize();
+    }
+
+    node = node->firstChild();
+    while (node) {
+        calculateSelectionsMemoryStep(node, countedTileData, size, unpackedSize);
+        node = node->nextSibling();
+    }
+}
+
 
 KisMemoryStatisticsServer::Statistics
 KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
@@ -101,6 +129,11 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
     Statistics stats;
     if (image) {
         stats.imageSize = calculateNodeMemoryHiBound(image->root());
+
+        QSet<const KisTileData*> countedTileData;
+        calculateSelectionsMemoryStep(image->root(), countedTileData,
+                                      stats.selectionsSize,
+                                      stats.selectionsUnpackedSize);
     }
     stats.totalMemorySize = tileStats.totalMemorySize;
     stats.realMemorySize = tileStats.realMemorySize;
@@ -43,6 +43,9 @@ public:
 
               swapSize(0),
 
+              selectionsSize(0),
+              selectionsUnpackedSize(0),
+
               totalMemoryLimit(0),
               tilesHardLimit(0),
               tilesSoftLimit(0),
@@ -59,6 +62,14 @@ public:
 
         qint64 swapSize;
 
+        /**
+         * The memory taken by the masks and selections of the image
+         * and the memory they would take if their uniform tiles were
+         * not shared
+         */
+        qint64 selectionsSize;
+        qint64 selectionsUnpackedSize;
+
         qint64 totalMemoryLimit;
         qint64 tilesHardLimit;
         qint64 tilesSoftLimit;
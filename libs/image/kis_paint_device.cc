@@ -360,11 +360,11 @@ public:
         return m_frames.keys();
     }
 
-    bool readFrame(QIODevice *stream, int frameId)
+    bool readFrame(QIODevice *stream, int frameId, bool lazyLoading)
     {
         bool retval = false;
         DataSP data = m_frames[frameId];
-        retval = data->dataManager()->read(stream);
+        retval = data->dataManager()->read(stream, lazyLoading);
         data->cache()->invalidate();
         return retval;
     }
@@ -1401,11 +1401,11 @@ bool KisPaintDevice::write(KisPaintDeviceWriter &store)
     return m_d->dataManager()->write(store);
 }
 
-bool KisPaintDevice::read(QIODevice *stream)
+bool KisPaintDevice::read(QIODevice *stream, bool lazyLoading)
 {
     bool retval;
 
-    retval = m_d->dataManager()->read(stream);
+    retval = m_d->dataManager()->read(stream, lazyLoading);
     m_d->cache()->invalidate();
 
     return retval;
@@ -2024,12 +2024,12 @@ bool KisPaintDeviceFramesInterface::writeFrame(KisPaintDeviceWriter &store, int
     return q->m_d->writeFrame(store, frameId);
 }
 
-bool KisPaintDeviceFramesInterface::readFrame(QIODevice *stream, int frameId)
+bool KisPaintDeviceFramesInterface::readFrame(QIODevice *stream, int frameId, bool lazyLoading)
 {
     KIS_ASSERT_RECOVER(frameId >= 0) {
         return false;
     }
-    return q->m_d->readFrame(stream, frameId);
+    return q->m_d->readFrame(stream, frameId, lazyLoading);
 }
 
 int KisPaintDeviceFramesInterface::currentFrameId() const
@@ -122,8 +122,11 @@ public:
 
     /**
      * Fill this paint device with the pixels from the specified file store.
+     *
+     * If \p lazyLoading is true, the compressed tiles are put into the
+     * swap as they are and decompressed on the first access only.
      */
-    bool read(QIODevice *stream);
+    bool read(QIODevice *stream, bool lazyLoading = false);
 
 public:
 
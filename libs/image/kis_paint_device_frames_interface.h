@@ -103,8 +103,10 @@ public:
      *
      * NOTE: the frame must be created manually with createFrame()
      *       beforehand!
+     *
+     * See KisPaintDevice::read() for the meaning of \p lazyLoading.
      */
-    bool readFrame(QIODevice *stream, int frameId);
+    bool readFrame(QIODevice *stream, int frameId, bool lazyLoading = false);
 
 
     /**
@@ -24,6 +24,7 @@
 #include <QVector>
 
 #include <QMutex>
+#include <QAtomicInt>
 #include <QPoint>
 #include <QPolygon>
 
@@ -37,7 +38,8 @@
 #include "kis_debug.h"
 #include "kis_image.h"
 #include "kis_fill_painter.h"
-#include "kis_outline_generator.h"
+#include "kis_datamanager.h"
+#include "kis_selection_outline_generator.h"
 #include <kis_iterator_ng.h>
 #include "kis_lod_transform.h"
 
@@ -49,6 +51,19 @@ struct Q_DECL_HIDDEN KisPixelSelection::Private {
     bool outlineCacheValid;
     QMutex outlineCacheMutex;
 
+    /**
+     * Outlines for levels of detail starting from 1, empty if they
+     * haven't been calculated yet
+     */
+    QVector<QPainterPath> simplifiedOutlineCaches;
+
+    /**
+     * Incremented on every change of the outline cache, lets
+     * recalculateOutlineCache() know that the selection has been
+     * changed while the outline was being generated
+     */
+    QAtomicInt outlineCacheRevision;
+
     bool thumbnailImageValid;
     QImage thumbnailImage;
     QTransform thumbnailImageTransform;
@@ -60,6 +75,15 @@ struct Q_DECL_HIDDEN KisPixelSelection::Private {
         thumbnailImage = QImage();
         thumbnailImageTransform = QTransform();
     }
+
+    /**
+     * The simplified outlines cannot be updated incrementally, so
+     * they are dropped until the next recalculation
+     */
+    void outlineCacheChanged() {
+        outlineCacheRevision.ref();
+        simplifiedOutlineCaches.clear();
+    }
 };
 
 KisPixelSelection::KisPixelSelection(KisDefaultBoundsBaseSP defaultBounds, KisSelectionWSP parentSelection)
@@ -80,6 +104,7 @@ KisPixelSelection::KisPixelSelection(const KisPixelSelection& rhs)
     // parent selection is not supposed to be shared
     m_d->outlineCache = rhs.m_d->outlineCache;
     m_d->outlineCacheValid = rhs.m_d->outlineCacheValid;
+    m_d->simplifiedOutlineCaches = rhs.m_d->simplifiedOutlineCaches;
 
     m_d->thumbnailImageValid = rhs.m_d->thumbnailImageValid;
     m_d->thumbnailImage = rhs.m_d->thumbnailImage;
@@ -104,10 +129,11 @@ const KoColorSpace *KisPixelSelection::compositionSourceColorSpace() const
                    QString());
 }
 
-bool KisPixelSelection::read(QIODevice *stream)
+bool KisPixelSelection::read(QIODevice *stream, bool lazyLoading)
 {
-    bool retval = KisPaintDevice::read(stream);
+    bool retval = KisPaintDevice::read(stream, lazyLoading);
     m_d->outlineCacheValid = false;
+    m_d->outlineCacheChanged();
     m_d->invalidateThumbnailImage();
     return retval;
 }
@@ -131,9 +157,50 @@ void KisPixelSelection::select(const QRect & rc, quint8 selectedness)
             m_d->outlineCache -= path;
         }
     }
+    m_d->outlineCacheChanged();
     m_d->invalidateThumbnailImage();
 }
 
+namespace {
+
+/**
+ * Applies \p op to the pixels of \p dst and the old data of \p src
+ * run by run, where a run is a part of a row lying in one tile of
+ * both devices, so that the inner loop is simple enough to be
+ * vectorized by the compiler
+ */
+template <class Op>
+void processRuns(KisPaintDevice *dst, KisPaintDeviceSP src, const QRect &rc, Op op)
+{
+    KisHLineIteratorSP dstIt = dst->createHLineIteratorNG(rc.x(), rc.y(), rc.width());
+    KisHLineConstIteratorSP srcIt = src->createHLineConstIteratorNG(rc.x(), rc.y(), rc.width());
+
+    for (int i = 0; i < rc.height(); ++i) {
+        int pixelsLeft = rc.width();
+
+        while (pixelsLeft > 0) {
+            const int numPixels =
+                qMin(pixelsLeft, qMin(dstIt->nConseqPixels(), srcIt->nConseqPixels()));
+
+            quint8 *dstPtr = dstIt->rawData();
+            const quint8 *srcPtr = srcIt->oldRawData();
+
+            for (int j = 0; j < numPixels; j++) {
+                dstPtr[j] = op(dstPtr[j], srcPtr[j]);
+            }
+
+            dstIt->nextPixels(numPixels);
+            srcIt->nextPixels(numPixels);
+            pixelsLeft -= numPixels;
+        }
+
+        dstIt->nextRow();
+        srcIt->nextRow();
+    }
+}
+
+}
+
 void KisPixelSelection::applySelection(KisPixelSelectionSP selection, SelectionAction action)
 {
     switch (action) {
@@ -169,8 +236,11 @@ void KisPixelSelection::copyAlphaFrom(KisPaintDeviceSP src, const QRect &process
         *alpha8Ptr = srcCS->opacityU8(srcPtr);
     } while (srcIt.nextPixel() && dstIt.nextPixel());
 
+    shareUniformTiles(processRect);
+
     m_d->outlineCacheValid = false;
     m_d->outlineCache = QPainterPath();
+    m_d->outlineCacheChanged();
     m_d->invalidateThumbnailImage();
 }
 
@@ -179,25 +249,18 @@ void KisPixelSelection::addSelection(KisPixelSelectionSP selection)
     QRect r = selection->selectedRect();
     if (r.isEmpty()) return;
 
-    KisHLineIteratorSP dst = createHLineIteratorNG(r.x(), r.y(), r.width());
-    KisHLineConstIteratorSP src = selection->createHLineConstIteratorNG(r.x(), r.y(), r.width());
-    for (int i = 0; i < r.height(); ++i) {
-        do {
-            if (*src->oldRawData() + *dst->rawData() < MAX_SELECTED)
-                *dst->rawData() = *src->oldRawData() + *dst->rawData();
-            else
-                *dst->rawData() = MAX_SELECTED;
-
-        } while (src->nextPixel() && dst->nextPixel());
-        dst->nextRow();
-        src->nextRow();
-    }
+    processRuns(this, selection, r,
+                [] (quint8 dst, quint8 src) {
+                    return quint8(qMin(int(dst) + src, int(MAX_SELECTED)));
+                });
+    shareUniformTiles(r);
 
     m_d->outlineCacheValid &= selection->outlineCacheValid();
 
     if (m_d->outlineCacheValid) {
         m_d->outlineCache += selection->outlineCache();
     }
+    m_d->outlineCacheChanged();
 
     m_d->invalidateThumbnailImage();
 }
@@ -207,26 +270,18 @@ void KisPixelSelection::subtractSelection(KisPixelSelectionSP selection)
     QRect r = selection->selectedRect();
     if (r.isEmpty()) return;
 
-
-    KisHLineIteratorSP dst = createHLineIteratorNG(r.x(), r.y(), r.width());
-    KisHLineConstIteratorSP src = selection->createHLineConstIteratorNG(r.x(), r.y(), r.width());
-    for (int i = 0; i < r.height(); ++i) {
-        do {
-            if (*dst->rawData() - *src->oldRawData() > MIN_SELECTED)
-                *dst->rawData() = *dst->rawData() - *src->oldRawData();
-            else
-                *dst->rawData() = MIN_SELECTED;
-
-        } while (src->nextPixel() && dst->nextPixel());
-        dst->nextRow();
-        src->nextRow();
-    }
+    processRuns(this, selection, r,
+                [] (quint8 dst, quint8 src) {
+                    return quint8(qMax(int(dst) - src, int(MIN_SELECTED)));
+                });
+    shareUniformTiles(r);
 
     m_d->outlineCacheValid &= selection->outlineCacheValid();
 
     if (m_d->outlineCacheValid) {
         m_d->outlineCache -= selection->outlineCache();
     }
+    m_d->outlineCacheChanged();
 
     m_d->invalidateThumbnailImage();
 }
@@ -236,21 +291,18 @@ void KisPixelSelection::intersectSelection(KisPixelSelectionSP selection)
     QRect r = selection->selectedRect().united(selectedRect());
     if (r.isEmpty()) return;
 
-    KisHLineIteratorSP dst = createHLineIteratorNG(r.x(), r.y(), r.width());
-    KisHLineConstIteratorSP src = selection->createHLineConstIteratorNG(r.x(), r.y(), r.width());
-    for (int i = 0; i < r.height(); ++i) {
-        do {
-            *dst->rawData() = qMin(*dst->rawData(), *src->oldRawData());
-        }  while (src->nextPixel() && dst->nextPixel());
-        dst->nextRow();
-        src->nextRow();
-    }
+    processRuns(this, selection, r,
+                [] (quint8 dst, quint8 src) {
+                    return qMin(dst, src);
+                });
+    shareUniformTiles(r);
 
     m_d->outlineCacheValid &= selection->outlineCacheValid();
 
     if (m_d->outlineCacheValid) {
         m_d->outlineCache &= selection->outlineCache();
     }
+    m_d->outlineCacheChanged();
 
     m_d->invalidateThumbnailImage();
 }
@@ -271,6 +323,7 @@ void KisPixelSelection::clear(const QRect & r)
 
         m_d->outlineCache -= path;
     }
+    m_d->outlineCacheChanged();
 
     m_d->invalidateThumbnailImage();
 }
@@ -282,6 +335,7 @@ void KisPixelSelection::clear()
 
     m_d->outlineCacheValid = true;
     m_d->outlineCache = QPainterPath();
+    m_d->outlineCacheChanged();
 
     // Empty the thumbnail image. It is a valid state.
     m_d->invalidateThumbnailImage();
@@ -303,12 +357,17 @@ void KisPixelSelection::invert()
     quint8 defPixel = MAX_SELECTED - *defaultPixel().data();
     setDefaultPixel(KoColor(&defPixel, colorSpace()));
 
+    if (!rc.isEmpty()) {
+        shareUniformTiles(rc);
+    }
+
     if (m_d->outlineCacheValid) {
         QPainterPath path;
         path.addRect(defaultBounds()->bounds());
 
         m_d->outlineCache = path - m_d->outlineCache;
     }
+    m_d->outlineCacheChanged();
 
     m_d->invalidateThumbnailImage();
 }
@@ -323,7 +382,12 @@ void KisPixelSelection::moveTo(const QPoint &pt)
 
     if (m_d->outlineCacheValid) {
         m_d->outlineCache.translate(offset);
+
+        for (int i = 0; i < m_d->simplifiedOutlineCaches.size(); i++) {
+            m_d->simplifiedOutlineCaches[i].translate(offset);
+        }
     }
+    m_d->outlineCacheRevision.ref();
 
     if (m_d->thumbnailImageValid) {
         m_d->thumbnailImageTransform =
@@ -349,6 +413,16 @@ QRect KisPixelSelection::selectedRect() const
     return extent();
 }
 
+void KisPixelSelection::shareUniformTiles(const QRect &rc)
+{
+    /**
+     * Most of the selections are binary, so after the boolean
+     * operations most of their tiles are either fully selected or
+     * fully unselected. Let them share the data.
+     */
+    dataManager()->shareUniformTiles(rc.translated(-x(), -y()));
+}
+
 QRect KisPixelSelection::selectedExactRect() const
 {
     return exactBounds();
@@ -368,28 +442,7 @@ QVector<QPolygon> KisPixelSelection::outline() const
         selectionExtent &= defaultBounds()->bounds();
     }
 
-    qint32 xOffset = selectionExtent.x();
-    qint32 yOffset = selectionExtent.y();
-    qint32 width = selectionExtent.width();
-    qint32 height = selectionExtent.height();
-
-    KisOutlineGenerator generator(colorSpace(), MIN_SELECTED);
-    // If the selection is small using a buffer is much faster
-    try {
-        quint8* buffer = new quint8[width*height];
-        readBytes(buffer, xOffset, yOffset, width, height);
-
-        QVector<QPolygon> paths = generator.outline(buffer, xOffset, yOffset, width, height);
-
-        delete[] buffer;
-        return paths;
-    }
-    catch(std::bad_alloc) {
-        // Allocating so much memory failed, so we fall through to the slow option.
-        warnKrita << "KisPixelSelection::outline ran out of memory allocating" << width << "*" << height << "bytes.";
-    }
-
-    return generator.outline(this, xOffset, yOffset, width, height);
+    return KisSelectionOutlineGenerator::outline(this, selectionExtent);
 }
 
 bool KisPixelSelection::isEmpty() const
@@ -403,11 +456,20 @@ QPainterPath KisPixelSelection::outlineCache() const
     return m_d->outlineCache;
 }
 
+QPainterPath KisPixelSelection::simplifiedOutlineCache(int levelOfDetail) const
+{
+    QMutexLocker locker(&m_d->outlineCacheMutex);
+
+    return levelOfDetail > 0 && levelOfDetail <= m_d->simplifiedOutlineCaches.size() ?
+        m_d->simplifiedOutlineCaches[levelOfDetail - 1] : m_d->outlineCache;
+}
+
 void KisPixelSelection::setOutlineCache(const QPainterPath &cache)
 {
     QMutexLocker locker(&m_d->outlineCacheMutex);
     m_d->outlineCache = cache;
     m_d->outlineCacheValid = true;
+    m_d->outlineCacheChanged();
     m_d->thumbnailImageValid = false;
 }
 
@@ -421,30 +483,29 @@ void KisPixelSelection::invalidateOutlineCache()
 {
     QMutexLocker locker(&m_d->outlineCacheMutex);
     m_d->outlineCacheValid = false;
+    m_d->outlineCacheChanged();
     m_d->thumbnailImageValid = false;
 }
 
 void KisPixelSelection::recalculateOutlineCache()
 {
-    QMutexLocker locker(&m_d->outlineCacheMutex);
+    /**
+     * The outline is generated without holding the lock, so that the
+     * GUI could still read the old cache. If the selection is changed
+     * in the meantime, the result is just dropped, the cache stays
+     * invalid and will be requested again.
+     */
+    const int revision = m_d->outlineCacheRevision.load();
 
-    m_d->outlineCache = QPainterPath();
+    const QVector<QPainterPath> paths =
+        KisSelectionOutlineGenerator::levelsOfDetail(outline());
 
-    Q_FOREACH (const QPolygon &polygon, outline()) {
-        m_d->outlineCache.addPolygon(polygon);
-
-        /**
-         * The outline generation algorithm has a small bug, which
-         * results in the starting point be repeated twice in the
-         * beginning of the path, instead of being put to the
-         * end. Here we just explicitly close the path to workaround
-         * it.
-         *
-         * \see KisSelectionTest::testOutlineGeneration()
-         */
-        m_d->outlineCache.closeSubpath();
-    }
+    QMutexLocker locker(&m_d->outlineCacheMutex);
+
+    if (revision != m_d->outlineCacheRevision.load()) return;
 
+    m_d->outlineCache = paths.first();
+    m_d->simplifiedOutlineCaches = paths.mid(1);
     m_d->outlineCacheValid = true;
 }
 
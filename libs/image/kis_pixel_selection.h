@@ -55,7 +55,7 @@ public:
 
     const KoColorSpace* compositionSourceColorSpace() const;
 
-    bool read(QIODevice *stream);
+    bool read(QIODevice *stream, bool lazyLoading = false);
 
     /**
      * Fill the specified rect with the specified selectedness.
@@ -120,8 +120,22 @@ public:
     bool isEmpty() const;
     QPainterPath outlineCache() const;
     bool outlineCacheValid() const;
+
+    /**
+     * Regenerates the outline cache and its simplified versions. The
+     * outline is generated in parallel without locking the cache, so
+     * the function is safe to be called from a background job.
+     */
     void recalculateOutlineCache();
 
+    /**
+     * \return the outline cache simplified for painting on a canvas
+     * scaled down by 2^levelOfDetail (see KisSelectionOutlineGenerator).
+     * If the simplified outlines are not available (e.g. the cache
+     * has been updated incrementally), the exact outline is returned.
+     */
+    QPainterPath simplifiedOutlineCache(int levelOfDetail) const;
+
     void setOutlineCache(const QPainterPath &cache);
     void invalidateOutlineCache();
 
@@ -138,6 +152,11 @@ public:
     virtual void renderToProjection(KisPaintDeviceSP projection, const QRect& r);
 
 private:
+    /**
+     * Makes the uniform tiles in \p rc share their data
+     */
+    void shareUniformTiles(const QRect &rc);
+
     /**
      * Add a selection
      */
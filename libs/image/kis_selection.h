@@ -98,6 +98,15 @@ public:
     QPainterPath outlineCache() const;
     void recalculateOutlineCache();
 
+    /**
+     * \return the outline cache simplified for painting on a canvas
+     * scaled down by 2^levelOfDetail. Only the outline of the pixel
+     * selection is simplified.
+     *
+     * \see KisPixelSelection::simplifiedOutlineCache()
+     */
+    QPainterPath simplifiedOutlineCache(int levelOfDetail) const;
+
 
     /**
      * Tells whether the cached thumbnail of the selection is still valid
@@ -26,8 +26,8 @@
 #include "kis_convolution_kernel.h"
 #include "kis_pixel_selection.h"
 
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#include <QtConcurrentMap>
+
 #define RINT(x) floor ((x) + 0.5)
 
 KisSelectionFilter::~KisSelectionFilter()
@@ -72,394 +72,677 @@ void KisSelectionFilter::rotatePointers(quint8** p, quint32 n)
     p[i] = p0;
 }
 
-void KisSelectionFilter::computeTransition(quint8* transition, quint8** buf, qint32 width)
+namespace {
+
+/**
+ * All the morphological filters below are processed in square blocks
+ * aligned to the tiles, so that the threads would not fight for the
+ * same tile. Every block reads a window with the margins needed by
+ * the filter from a copy of the source selection, so the result
+ * doesn't depend on the order the blocks are processed in.
+ */
+
+enum BoundaryMode {
+    /// the pixels outside the processed rect are unselected
+    ZeroBoundary,
+    /// the pixels outside the processed rect are equal to the edge pixels
+    ClampBoundary
+};
+
+inline int nextBlockBorder(int value, int blockSize)
 {
-    qint32 x = 0;
+    const int blockIndex = value >= 0 ?
+        value / blockSize :
+        -((-value + blockSize - 1) / blockSize);
 
-    if (width == 1) {
-        if (buf[1][x] > 127 && (buf[0][x] < 128 || buf[2][x] < 128))
-            transition[x] = 255;
-        else
-            transition[x] = 0;
+    return (blockIndex + 1) * blockSize;
+}
+
+/**
+ * Reads \p window of \p src into \p buf. The pixels of the window
+ * lying outside \p rect are filled according to \p mode
+ */
+void readWindow(KisPaintDeviceSP src, const QRect &rect, const QRect &window,
+                BoundaryMode mode, quint8 *buf)
+{
+    const QRect readRect = window & rect;
+    const int stride = window.width();
+
+    if (readRect == window) {
+        src->readBytes(buf, window);
         return;
     }
-    if (buf[1][x] > 127) {
-        if (buf[0][x] < 128 || buf[0][x + 1] < 128 ||
-            buf[1][x + 1] < 128 ||
-            buf[2][x] < 128 || buf[2][x + 1] < 128)
-            transition[x] = 255;
-        else
-            transition[x] = 0;
-    } else
-        transition[x] = 0;
-    for (qint32 x = 1; x < width - 1; x++) {
-        if (buf[1][x] >= 128) {
-            if (buf[0][x - 1] < 128 || buf[0][x] < 128 || buf[0][x + 1] < 128 ||
-                buf[1][x - 1] < 128           ||          buf[1][x + 1] < 128 ||
-                buf[2][x - 1] < 128 || buf[2][x] < 128 || buf[2][x + 1] < 128)
-                transition[x] = 255;
-            else
-                transition[x] = 0;
-        } else
-            transition[x] = 0;
+
+    if (mode == ZeroBoundary) {
+        memset(buf, 0, window.width() * window.height());
     }
-    if (buf[1][x] >= 128) {
-        if (buf[0][x - 1] < 128 || buf[0][x] < 128 ||
-            buf[1][x - 1] < 128 ||
-            buf[2][x - 1] < 128 || buf[2][x] < 128)
-            transition[x] = 255;
-        else
-            transition[x] = 0;
-    } else
-        transition[x] = 0;
-}
 
+    QVector<quint8> pixels(readRect.width() * readRect.height());
+    src->readBytes(pixels.data(), readRect);
 
-KUndo2MagicString KisErodeSelectionFilter::name()
-{
-    return kundo2_i18n("Erode Selection");
-}
+    const int left = readRect.x() - window.x();
+    const int top = readRect.y() - window.y();
+    const int right = left + readRect.width() - 1;
+    const int bottom = top + readRect.height() - 1;
 
-QRect KisErodeSelectionFilter::changeRect(const QRect& rect)
-{
-    const qint32 radius = 1;
-    return rect.adjusted(-radius, -radius, radius, radius);
+    for (int row = 0; row < readRect.height(); row++) {
+        quint8 *dstRow = buf + (top + row) * stride;
+
+        memcpy(dstRow + left,
+               pixels.constData() + row * readRect.width(),
+               readRect.width());
+
+        if (mode == ClampBoundary) {
+            memset(dstRow, dstRow[left], left);
+            memset(dstRow + right + 1, dstRow[right], stride - right - 1);
+        }
+    }
+
+    if (mode == ClampBoundary) {
+        for (int row = 0; row < top; row++) {
+            memcpy(buf + row * stride, buf + top * stride, stride);
+        }
+
+        for (int row = bottom + 1; row < window.height(); row++) {
+            memcpy(buf + row * stride, buf + bottom * stride, stride);
+        }
+    }
 }
 
-void KisErodeSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
+template <class BlockOp>
+struct BlockProcessor
 {
-    // Erode (radius 1 pixel) a mask (1bpp)
-    quint8* buf[3];
+    BlockProcessor(KisPaintDeviceSP _src, KisPixelSelectionSP _dst,
+                   const QRect &_rect, int _xMargin, int _yMargin,
+                   BoundaryMode _mode, const BlockOp &_op)
+        : src(_src), dst(_dst), rect(_rect),
+          xMargin(_xMargin), yMargin(_yMargin),
+          mode(_mode), op(_op)
+    {
+    }
 
-    qint32 width = rect.width();
-    qint32 height = rect.height();
+    void operator() (const QRect &block) const {
+        const QRect window = block.adjusted(-xMargin, -yMargin, xMargin, yMargin);
 
-    quint8* out = new quint8[width];
-    for (qint32 i = 0; i < 3; i++)
-        buf[i] = new quint8[width + 2];
+        QVector<quint8> srcPixels(window.width() * window.height());
+        readWindow(src, rect, window, mode, srcPixels.data());
 
+        QVector<quint8> dstPixels(block.width() * block.height());
+        op(srcPixels.data(), window, dstPixels.data(), block);
 
-    // load top of image
-    pixelSelection->readBytes(buf[0] + 1, rect.x(), rect.y(), width, 1);
-
-    buf[0][0]         = buf[0][1];
-    buf[0][width + 1] = buf[0][width];
+        dst->writeBytes(dstPixels.constData(), block);
+    }
 
-    memcpy(buf[1], buf[0], width + 2);
+    KisPaintDeviceSP src;
+    KisPixelSelectionSP dst;
+    QRect rect;
+    int xMargin;
+    int yMargin;
+    BoundaryMode mode;
+    BlockOp op;
+};
 
-    for (qint32 y = 0; y < height; y++) {
-        if (y + 1 < height) {
-            pixelSelection->readBytes(buf[2] + 1, rect.x(), rect.y() + y + 1, width, 1);
+template <class BlockOp>
+void processInBlocks(KisPixelSelectionSP pixelSelection, const QRect &rect,
+                     int xMargin, int yMargin, BoundaryMode mode,
+                     const BlockOp &op)
+{
+    if (rect.isEmpty()) return;
 
-            buf[2][0]         = buf[2][1];
-            buf[2][width + 1] = buf[2][width];
-        } else {
-            memcpy(buf[2], buf[1], width + 2);
-        }
+    /**
+     * The blocks are at least twice as big as the margins, so
+     * the overhead of reading the margins stays constant for
+     * any radius
+     */
+    const int blockSize = qMax(256, (2 * qMax(xMargin, yMargin) + 63) / 64 * 64);
 
-        for (qint32 x = 0 ; x < width; x++) {
-            qint32 min = 255;
+    QVector<QRect> blocks;
 
-            if (buf[0][x+1] < min) min = buf[0][x+1];
-            if (buf[1][x]   < min) min = buf[1][x];
-            if (buf[1][x+1] < min) min = buf[1][x+1];
-            if (buf[1][x+2] < min) min = buf[1][x+2];
-            if (buf[2][x+1] < min) min = buf[2][x+1];
+    for (int y = rect.top(); y <= rect.bottom();) {
+        const int nextY = qMin(nextBlockBorder(y, blockSize), rect.bottom() + 1);
 
-            out[x] = min;
+        for (int x = rect.left(); x <= rect.right();) {
+            const int nextX = qMin(nextBlockBorder(x, blockSize), rect.right() + 1);
+            blocks << QRect(x, y, nextX - x, nextY - y);
+            x = nextX;
         }
 
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, width, 1);
-        rotatePointers(buf, 3);
+        y = nextY;
     }
 
-    for (qint32 i = 0; i < 3; i++)
-        delete[] buf[i];
-    delete[] out;
+    KisPaintDeviceSP src = new KisPixelSelection(*pixelSelection);
+    BlockProcessor<BlockOp> processor(src, pixelSelection, rect, xMargin, yMargin, mode, op);
+
+    /**
+     * The filters get only the pixel selection, not the image, so the
+     * pool of the updater context is out of reach. They are usually
+     * applied by a stroke job, whose thread waits here and processes
+     * the blocks as well, so the global pool is used (KisAutoBrush
+     * does the same for its dabs).
+     */
+    if (blocks.size() > 1) {
+        QtConcurrent::blockingMap(blocks, processor);
+    } else {
+        processor(blocks.first());
+    }
 }
 
+/**
+ * Erodes or dilates the block with a 3x3 cross
+ */
+struct CrossOp
+{
+    CrossOp(bool _isDilate) : isDilate(_isDilate) {}
 
-KUndo2MagicString KisDilateSelectionFilter::name()
+    void operator() (quint8 *src, const QRect &window, quint8 *dst, const QRect &block) const {
+        const int stride = window.width();
+
+        for (int y = 0; y < block.height(); y++) {
+            const quint8 *center = src + (y + 1) * stride + 1;
+
+            for (int x = 0; x < block.width(); x++, center++) {
+                const quint8 top = center[-stride];
+                const quint8 left = center[-1];
+                const quint8 right = center[1];
+                const quint8 bottom = center[stride];
+
+                *dst++ = isDilate ?
+                    qMax(qMax(qMax(top, left), qMax(right, bottom)), *center) :
+                    qMin(qMin(qMin(top, left), qMin(right, bottom)), *center);
+            }
+        }
+    }
+
+    bool isDilate;
+};
+
+/**
+ * Converts the border of the elliptic structuring element calculated
+ * by KisSelectionFilter::computeBorder() into the half-widths of its
+ * rows: the element covers offset (dx, dy) iff |dx| <= halfWidths[|dy|]
+ */
+QVector<int> halfWidthsFromBorder(const QVector<qint32> &circ, int xRadius, int yRadius)
 {
-    return kundo2_i18n("Dilate Selection");
+    QVector<int> halfWidths(yRadius + 1, -1);
+
+    for (int dy = 0; dy <= yRadius; dy++) {
+        for (int dx = xRadius; dx >= 0; dx--) {
+            if (circ[xRadius + dx] >= dy) {
+                halfWidths[dy] = dx;
+                break;
+            }
+        }
+    }
+
+    return halfWidths;
 }
 
-QRect KisDilateSelectionFilter::changeRect(const QRect& rect)
+/**
+ * Grayscale dilation (or erosion if \p invert is true) with an
+ * elliptic structuring element.
+ *
+ * The cost doesn't depend on the radius. For every column we find
+ * the chains of "next bigger pixel" above and below every pixel
+ * (a monotonic stack pass). Walking the chains gives a staircase of
+ * values: the maximum of the column within any vertical distance.
+ * Every step of the staircase (distance d, value v) paints value v
+ * into the interval of the row, where the structuring element's
+ * height is at least d. The intervals are painted in order of
+ * decreasing value, every pixel is painted only once.
+ *
+ * For a mask consisting of mostly opaque and transparent pixels the
+ * staircases have one or two steps only. In the worst case (e.g. a
+ * smooth gradient) a staircase is limited by the number of gray
+ * levels.
+ */
+struct MorphologyOp
 {
-    const qint32 radius = 1;
-    return rect.adjusted(-radius, -radius, radius, radius);
-}
+    MorphologyOp(const QVector<int> &_halfWidths, bool _invert)
+        : halfWidths(_halfWidths),
+          yRadius(_halfWidths.size() - 1),
+          invert(_invert)
+    {
+    }
 
-void KisDilateSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
- {
-    // dilate (radius 1 pixel) a mask (1bpp)
-    quint8* buf[3];
+    struct Interval {
+        int left;
+        int right;
+        quint8 value;
+    };
 
-    qint32 width = rect.width();
-    qint32 height = rect.height();
+    void operator() (quint8 *src, const QRect &window, quint8 *dst, const QRect &block) const {
+        const int width = window.width();
+        const int height = window.height();
+        const int numPixels = width * height;
 
-    quint8* out = new quint8[width];
-    for (qint32 i = 0; i < 3; i++)
-        buf[i] = new quint8[width + 2];
+        if (invert) {
+            for (int i = 0; i < numPixels; i++) {
+                src[i] = 255 - src[i];
+            }
+        }
 
+        /**
+         * up[i] and down[i] point to the closest pixel of the same
+         * column which is bigger than src[i], or -1
+         */
+        QVector<int> up(numPixels);
+        QVector<int> down(numPixels);
+        QVector<int> stack(height);
 
-    // load top of image
-    pixelSelection->readBytes(buf[0] + 1, rect.x(), rect.y(), width, 1);
+        for (int x = 0; x < width; x++) {
+            int stackSize = 0;
 
-    buf[0][0]         = buf[0][1];
-    buf[0][width + 1] = buf[0][width];
+            for (int y = 0; y < height; y++) {
+                const int idx = y * width + x;
 
-    memcpy(buf[1], buf[0], width + 2);
+                while (stackSize && src[stack[stackSize - 1]] <= src[idx]) stackSize--;
+                up[idx] = stackSize ? stack[stackSize - 1] : -1;
+                stack[stackSize++] = idx;
+            }
 
-    for (qint32 y = 0; y < height; y++) {
-        if (y + 1 < height) {
-            pixelSelection->readBytes(buf[2] + 1, rect.x(), rect.y() + y + 1, width, 1);
+            stackSize = 0;
 
-            buf[2][0]         = buf[2][1];
-            buf[2][width + 1] = buf[2][width];
-        } else {
-            memcpy(buf[2], buf[1], width + 2);
+            for (int y = height - 1; y >= 0; y--) {
+                const int idx = y * width + x;
+
+                while (stackSize && src[stack[stackSize - 1]] <= src[idx]) stackSize--;
+                down[idx] = stackSize ? stack[stackSize - 1] : -1;
+                stack[stackSize++] = idx;
+            }
         }
 
-        for (qint32 x = 0 ; x < width; x++) {
-            qint32 max = 0;
+        const int xMargin = block.x() - window.x();
+        const int yMargin = block.y() - window.y();
+        const int blockWidth = block.width();
 
-            if (buf[0][x+1] > max) max = buf[0][x+1];
-            if (buf[1][x]   > max) max = buf[1][x];
-            if (buf[1][x+1] > max) max = buf[1][x+1];
-            if (buf[1][x+2] > max) max = buf[1][x+2];
-            if (buf[2][x+1] > max) max = buf[2][x+1];
+        QVector<Interval> intervals;
+        QVector<int> bucketSizes(256);
+        QVector<int> sortedIntervals;
+        QVector<int> nextFree(blockWidth + 1);
 
-            out[x] = max;
-        }
+        for (int row = 0; row < block.height(); row++) {
+            const int y = row + yMargin;
 
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, width, 1);
-        rotatePointers(buf, 3);
-    }
+            intervals.clear();
+            bucketSizes.fill(0);
 
-    for (qint32 i = 0; i < 3; i++)
-        delete[] buf[i];
-    delete[] out;
-}
+            for (int x = 0; x < width; x++) {
+                const int idx = y * width + x;
 
+                int value = src[idx];
+                int upIdx = up[idx];
+                int downIdx = down[idx];
+                int distance = 0;
 
-KisBorderSelectionFilter::KisBorderSelectionFilter(qint32 xRadius, qint32 yRadius)
-  : m_xRadius(xRadius),
-    m_yRadius(yRadius)
-{
-}
+                Q_FOREVER {
+                    const int halfWidth = halfWidths[distance];
+                    const int left = qMax(x - halfWidth - xMargin, 0);
+                    const int right = qMin(x + halfWidth - xMargin, blockWidth - 1);
 
-KUndo2MagicString KisBorderSelectionFilter::name()
-{
-    return kundo2_i18n("Border Selection");
-}
+                    if (value > 0 && left <= right) {
+                        Interval interval = {left, right, quint8(value)};
+                        intervals.append(interval);
+                        bucketSizes[value]++;
+                    }
 
-QRect KisBorderSelectionFilter::changeRect(const QRect& rect)
-{
-    return rect.adjusted(-m_xRadius, -m_yRadius, m_xRadius, m_yRadius);
-}
+                    if (value == 255) break;
 
-void KisBorderSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
-{
-    if (m_xRadius <= 0 || m_yRadius <= 0) return;
+                    // pick the closest bigger pixel from both chains
+                    while (upIdx >= 0 && src[upIdx] <= value) upIdx = up[upIdx];
+                    while (downIdx >= 0 && src[downIdx] <= value) downIdx = down[downIdx];
 
-    quint8  *buf[3];
-    quint8 **density;
-    quint8 **transition;
+                    const int upDistance = upIdx >= 0 ? y - upIdx / width : yRadius + 1;
+                    const int downDistance = downIdx >= 0 ? downIdx / width - y : yRadius + 1;
 
-    if (m_xRadius == 1 && m_yRadius == 1) {
-        // optimize this case specifically
-        quint8* source[3];
+                    distance = qMin(upDistance, downDistance);
+                    if (distance > yRadius) break;
 
-        for (qint32 i = 0; i < 3; i++)
-            source[i] = new quint8[rect.width()];
+                    value = upDistance == distance ? src[upIdx] : 0;
+                    if (downDistance == distance) {
+                        value = qMax(value, int(src[downIdx]));
+                    }
+                }
+            }
 
-        quint8* transition = new quint8[rect.width()];
+            // counting sort of the intervals by decreasing value
+            sortedIntervals.resize(intervals.size());
 
-        pixelSelection->readBytes(source[0], rect.x(), rect.y(), rect.width(), 1);
-        memcpy(source[1], source[0], rect.width());
-        if (rect.height() > 1)
-            pixelSelection->readBytes(source[2], rect.x(), rect.y() + 1, rect.width(), 1);
-        else
-            memcpy(source[2], source[1], rect.width());
-
-        computeTransition(transition, source, rect.width());
-        pixelSelection->writeBytes(transition, rect.x(), rect.y(), rect.width(), 1);
-
-        for (qint32 y = 1; y < rect.height(); y++) {
-            rotatePointers(source, 3);
-            if (y + 1 < rect.height())
-                pixelSelection->readBytes(source[2], rect.x(), rect.y() + y + 1, rect.width(), 1);
-            else
-                memcpy(source[2], source[1], rect.width());
-            computeTransition(transition, source, rect.width());
-            pixelSelection->writeBytes(transition, rect.x(), rect.y() + y, rect.width(), 1);
-        }
+            int offset = 0;
+            for (int v = 255; v > 0; v--) {
+                const int size = bucketSizes[v];
+                bucketSizes[v] = offset;
+                offset += size;
+            }
 
-        for (qint32 i = 0; i < 3; i++)
-            delete[] source[i];
-        delete[] transition;
-        return;
-    }
+            for (int i = 0; i < intervals.size(); i++) {
+                sortedIntervals[bucketSizes[intervals[i].value]++] = i;
+            }
 
-    qint32* max = new qint32[rect.width() + 2 * m_xRadius];
-    for (qint32 i = 0; i < (rect.width() + 2 * m_xRadius); i++)
-        max[i] = m_yRadius + 2;
-    max += m_xRadius;
+            quint8 *dstRow = dst + row * blockWidth;
+            memset(dstRow, 0, blockWidth);
 
-    for (qint32 i = 0; i < 3; i++)
-        buf[i] = new quint8[rect.width()];
+            for (int i = 0; i <= blockWidth; i++) {
+                nextFree[i] = i;
+            }
+
+            Q_FOREACH (int i, sortedIntervals) {
+                const Interval &interval = intervals[i];
+
+                int x = findNextFree(nextFree, interval.left);
+                while (x <= interval.right) {
+                    dstRow[x] = interval.value;
+                    nextFree[x] = x + 1;
+                    x = findNextFree(nextFree, x + 1);
+                }
+            }
 
-    transition = new quint8*[m_yRadius + 1];
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        transition[i] = new quint8[rect.width() + 2 * m_xRadius];
-        memset(transition[i], 0, rect.width() + 2 * m_xRadius);
-        transition[i] += m_xRadius;
+            if (invert) {
+                for (int x = 0; x < blockWidth; x++) {
+                    dstRow[x] = 255 - dstRow[x];
+                }
+            }
+        }
     }
-    quint8* out = new quint8[rect.width()];
-    density = new quint8*[2 * m_xRadius + 1];
-    density += m_xRadius;
-
-    for (qint32 x = 0; x < (m_xRadius + 1); x++) { // allocate density[][]
-        density[ x]  = new quint8[2 * m_yRadius + 1];
-        density[ x] += m_yRadius;
-        density[-x]  = density[x];
+
+    static inline int findNextFree(QVector<int> &nextFree, int x) {
+        while (nextFree[x] != x) {
+            nextFree[x] = nextFree[nextFree[x]];
+            x = nextFree[x];
+        }
+        return x;
     }
-    for (qint32 x = 0; x < (m_xRadius + 1); x++) { // compute density[][]
-        double tmpx, tmpy, dist;
-        quint8 a;
-
-        if (x > 0)
-            tmpx = x - 0.5;
-        else if (x < 0)
-            tmpx = x + 0.5;
-        else
-            tmpx = 0.0;
-
-        for (qint32 y = 0; y < (m_yRadius + 1); y++) {
-            if (y > 0)
-                tmpy = y - 0.5;
-            else if (y < 0)
-                tmpy = y + 0.5;
-            else
-                tmpy = 0.0;
-            dist = ((tmpy * tmpy) / (m_yRadius * m_yRadius) +
-                    (tmpx * tmpx) / (m_xRadius * m_xRadius));
-            if (dist < 1.0)
-                a = (quint8)(255 * (1.0 - sqrt(dist)));
-            else
-                a = 0;
-            density[ x][ y] = a;
-            density[ x][-y] = a;
-            density[-x][ y] = a;
-            density[-x][-y] = a;
+
+    QVector<int> halfWidths;
+    int yRadius;
+    bool invert;
+};
+
+/**
+ * Renders a soft border around the edge of the selection (the
+ * "transition" pixels, i.e. selected pixels with an unselected
+ * neighbour). The value of a pixel depends on the elliptic distance
+ * to the closest transition pixel.
+ *
+ * For every column we find the vertical distance to the closest
+ * transition pixel with two linear passes. The elliptic distance to
+ * the pixels of a column grows with the horizontal offset as a convex
+ * function, so the closest column for every pixel of a row is found
+ * with the lower envelope of these functions in linear time
+ * (Felzenszwalb-Huttenlocher style).
+ */
+struct BorderOp
+{
+    BorderOp(int _xRadius, int _yRadius, const QRect &_rect)
+        : xRadius(_xRadius), yRadius(_yRadius), rect(_rect),
+          transitionOnly(_xRadius == 1 && _yRadius == 1)
+    {
+        density.resize((xRadius + 1) * (yRadius + 1));
+
+        for (int x = 0; x <= xRadius; x++) {
+            const double tmpx = x > 0 ? x - 0.5 : 0.0;
+
+            for (int y = 0; y <= yRadius; y++) {
+                const double tmpy = y > 0 ? y - 0.5 : 0.0;
+
+                const double dist = ((tmpy * tmpy) / (yRadius * yRadius) +
+                                     (tmpx * tmpx) / (xRadius * xRadius));
+
+                density[x * (yRadius + 1) + y] =
+                    dist < 1.0 ? quint8(255 * (1.0 - sqrt(dist))) : 0;
+            }
         }
     }
-    pixelSelection->readBytes(buf[0], rect.x(), rect.y(), rect.width(), 1);
-    memcpy(buf[1], buf[0], rect.width());
-    if (rect.height() > 1)
-        pixelSelection->readBytes(buf[2], rect.x(), rect.y() + 1, rect.width(), 1);
-    else
-        memcpy(buf[2], buf[1], rect.width());
-    computeTransition(transition[1], buf, rect.width());
-
-    for (qint32 y = 1; y < m_yRadius && y + 1 < rect.height(); y++) { // set up top of image
-        rotatePointers(buf, 3);
-        pixelSelection->readBytes(buf[2], rect.x(), rect.y() + y + 1, rect.width(), 1);
-        computeTransition(transition[y + 1], buf, rect.width());
+
+    static inline bool isSelected(quint8 value) {
+        return value > 127;
     }
-    for (qint32 x = 0; x < rect.width(); x++) { // set up max[] for top of image
-        max[x] = -(m_yRadius + 7);
-        for (qint32 j = 1; j < m_yRadius + 1; j++)
-            if (transition[j][x]) {
-                max[x] = j;
-                break;
+
+    bool isTransition(const quint8 *pixel, int stride) const {
+        if (!isSelected(*pixel)) return false;
+
+        for (int dy = -1; dy <= 1; dy++) {
+            const quint8 *row = pixel + dy * stride;
+
+            if (!isSelected(row[-1]) || !isSelected(row[0]) || !isSelected(row[1])) {
+                return true;
             }
+        }
+
+        return false;
     }
-    for (qint32 y = 0; y < rect.height(); y++) { // main calculation loop
-        rotatePointers(buf, 3);
-        rotatePointers(transition, m_yRadius + 1);
-        if (y < rect.height() - (m_yRadius + 1)) {
-            pixelSelection->readBytes(buf[2], rect.x(), rect.y() + y + m_yRadius + 1, rect.width(), 1);
-            computeTransition(transition[m_yRadius], buf, rect.width());
-        } else
-            memcpy(transition[m_yRadius], transition[m_yRadius - 1], rect.width());
-
-        for (qint32 x = 0; x < rect.width(); x++) { // update max array
-            if (max[x] < 1) {
-                if (max[x] <= -m_yRadius) {
-                    if (transition[m_yRadius][x])
-                        max[x] = m_yRadius;
-                    else
-                        max[x]--;
-                } else if (transition[-max[x]][x])
-                    max[x] = -max[x];
-                else if (transition[-max[x] + 1][x])
-                    max[x] = -max[x] + 1;
-                else
-                    max[x]--;
-            } else
-                max[x]--;
-            if (max[x] < -m_yRadius - 1)
-                max[x] = -m_yRadius - 1;
+
+    void operator() (quint8 *src, const QRect &window, quint8 *dst, const QRect &block) const {
+        const int width = window.width();
+        const int height = window.height();
+
+        /**
+         * The transition of the last row is taken from the row above
+         * it, the same way the original line-buffer algorithm did
+         */
+        const int lastRow = rect.bottom() - window.y();
+        const bool replaceLastRow = !transitionOnly && rect.height() > 1;
+
+        QVector<quint8> transitions(width * height, 0);
+
+        for (int y = 1; y < height - 1; y++) {
+            if (y + window.y() < rect.top() || y + window.y() > rect.bottom()) continue;
+
+            const int srcY = replaceLastRow && y == lastRow ? y - 1 : y;
+
+            for (int x = 1; x < width - 1; x++) {
+                if (x + window.x() < rect.left() || x + window.x() > rect.right()) continue;
+
+                transitions[y * width + x] = isTransition(src + srcY * width + x, width);
+            }
         }
-        quint8 last_max =  max[0][density[-1]];
-        qint32 last_index = 1;
-        for (qint32 x = 0 ; x < rect.width(); x++) { // render scan line
-            last_index--;
-            if (last_index >= 0) {
-                last_max = 0;
-                for (qint32 i = m_xRadius; i >= 0; i--)
-                    if (max[x + i] <= m_yRadius && max[x + i] >= -m_yRadius && density[i][max[x+i]] > last_max) {
-                        last_max = density[i][max[x + i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
-            } else {
-                last_max = 0;
-                for (qint32 i = m_xRadius; i >= -m_xRadius; i--)
-                    if (max[x + i] <= m_yRadius && max[x + i] >= -m_yRadius && density[i][max[x + i]] > last_max) {
-                        last_max = density[i][max[x + i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
+
+        const int xMargin = block.x() - window.x();
+        const int yMargin = block.y() - window.y();
+
+        if (transitionOnly) {
+            for (int row = 0; row < block.height(); row++) {
+                const quint8 *transitionRow = transitions.constData() + (row + yMargin) * width + xMargin;
+
+                for (int x = 0; x < block.width(); x++) {
+                    *dst++ = transitionRow[x] ? 255 : 0;
+                }
+            }
+            return;
+        }
+
+        /**
+         * Vertical distance to the closest transition pixel of the
+         * column, for the rows of the block only
+         */
+        const int noTransition = yRadius + 1;
+        QVector<int> distances(width * block.height(), noTransition);
+
+        for (int x = 0; x < width; x++) {
+            int distance = noTransition;
+
+            for (int y = 0; y < height; y++) {
+                distance = transitions[y * width + x] ? 0 : qMin(distance + 1, noTransition);
+
+                const int row = y - yMargin;
+                if (row >= 0 && row < block.height()) {
+                    distances[row * width + x] = distance;
+                }
+            }
+
+            distance = noTransition;
+
+            for (int y = height - 1; y >= 0; y--) {
+                distance = transitions[y * width + x] ? 0 : qMin(distance + 1, noTransition);
+
+                const int row = y - yMargin;
+                if (row >= 0 && row < block.height()) {
+                    int &value = distances[row * width + x];
+                    value = qMin(value, distance);
+                }
+            }
+        }
+
+        /**
+         * The elliptic distance multiplied by 4 * xRadius^2 * yRadius^2,
+         * so that it could be compared in integers:
+         *
+         *  key(dx, dy) = (2 * dx - 1)^2 * yRadius^2 + (2 * dy - 1)^2 * xRadius^2
+         */
+        const qint64 xFactor = qint64(yRadius) * yRadius;
+        const qint64 yFactor = qint64(xRadius) * xRadius;
+
+        QVector<qint64> columnKeys(width);
+        QVector<int> envelopeColumns(width);
+        QVector<int> envelopeStarts(width);
+
+        for (int row = 0; row < block.height(); row++) {
+            const int *distanceRow = distances.constData() + row * width;
+
+            for (int x = 0; x < width; x++) {
+                const qint64 dy = distanceRow[x];
+                columnKeys[x] = dy ? (2 * dy - 1) * (2 * dy - 1) * yFactor : 0;
             }
-            if (last_max == 0) {
-                qint32 i;
-                for (i = x + 1; i < rect.width(); i++) {
-                    if (max[i] >= -m_yRadius)
+
+            auto key = [&columnKeys, xFactor] (int column, int x) {
+                const qint64 dx = qAbs(x - column);
+                return columnKeys[column] + (dx ? (2 * dx - 1) * (2 * dx - 1) * xFactor : 0);
+            };
+
+            const int firstX = xMargin;
+            const int lastX = xMargin + block.width() - 1;
+
+            int envelopeSize = 0;
+
+            for (int column = 0; column < width; column++) {
+                if (distanceRow[column] > yRadius) continue;
+
+                while (envelopeSize) {
+                    const int top = envelopeColumns[envelopeSize - 1];
+                    const int start = envelopeStarts[envelopeSize - 1];
+
+                    if (key(column, start) <= key(top, start)) {
+                        envelopeSize--;
+                    } else {
                         break;
+                    }
+                }
+
+                int start = firstX;
+
+                if (envelopeSize) {
+                    const int top = envelopeColumns[envelopeSize - 1];
+
+                    // the first x where the new column is not worse than the top one
+                    int lo = envelopeStarts[envelopeSize - 1] + 1;
+                    int hi = lastX + 1;
+
+                    while (lo < hi) {
+                        const int mid = (lo + hi) / 2;
+                        if (key(column, mid) <= key(top, mid)) {
+                            hi = mid;
+                        } else {
+                            lo = mid + 1;
+                        }
+                    }
+
+                    start = lo;
+                }
+
+                if (start <= lastX) {
+                    envelopeColumns[envelopeSize] = column;
+                    envelopeStarts[envelopeSize] = start;
+                    envelopeSize++;
                 }
-                if (i - x > m_xRadius) {
-                    for (; x < i - m_xRadius; x++)
-                        out[x] = 0;
-                    x--;
+            }
+
+            quint8 *dstRow = dst + row * block.width();
+            memset(dstRow, 0, block.width());
+
+            for (int i = 0; i < envelopeSize; i++) {
+                const int column = envelopeColumns[i];
+                const int end = i < envelopeSize - 1 ? envelopeStarts[i + 1] : lastX + 1;
+                const int dy = distanceRow[column];
+
+                for (int x = envelopeStarts[i]; x < end; x++) {
+                    const int dx = qAbs(x - column);
+
+                    if (dx <= xRadius) {
+                        dstRow[x - xMargin] = density[dx * (yRadius + 1) + dy];
+                    }
                 }
-                last_index = m_xRadius;
             }
         }
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
     }
-    delete [] out;
 
-    for (qint32 i = 0; i < 3; i++)
-        delete[] buf[i];
+    int xRadius;
+    int yRadius;
+    QRect rect;
+    bool transitionOnly;
+    QVector<quint8> density;
+};
 
-    max -= m_xRadius;
-    delete[] max;
+}
 
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        transition[i] -= m_xRadius;
-        delete transition[i];
-    }
-    delete[] transition;
 
-    for (qint32 i = 0; i < m_xRadius + 1 ; i++) {
-        density[i] -= m_yRadius;
-        delete density[i];
-    }
-    density -= m_xRadius;
-    delete[] density;
+KUndo2MagicString KisErodeSelectionFilter::name()
+{
+    return kundo2_i18n("Erode Selection");
+}
+
+QRect KisErodeSelectionFilter::changeRect(const QRect& rect)
+{
+    const qint32 radius = 1;
+    return rect.adjusted(-radius, -radius, radius, radius);
+}
+
+void KisErodeSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
+{
+    // Erode (radius 1 pixel) a mask (1bpp)
+    processInBlocks(pixelSelection, rect, 1, 1, ClampBoundary, CrossOp(false));
+}
+
+
+KUndo2MagicString KisDilateSelectionFilter::name()
+{
+    return kundo2_i18n("Dilate Selection");
+}
+
+QRect KisDilateSelectionFilter::changeRect(const QRect& rect)
+{
+    const qint32 radius = 1;
+    return rect.adjusted(-radius, -radius, radius, radius);
+}
+
+void KisDilateSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
+{
+    // dilate (radius 1 pixel) a mask (1bpp)
+    processInBlocks(pixelSelection, rect, 1, 1, ClampBoundary, CrossOp(true));
+}
+
+
+KisBorderSelectionFilter::KisBorderSelectionFilter(qint32 xRadius, qint32 yRadius)
+  : m_xRadius(xRadius),
+    m_yRadius(yRadius)
+{
+}
+
+KUndo2MagicString KisBorderSelectionFilter::name()
+{
+    return kundo2_i18n("Border Selection");
+}
+
+QRect KisBorderSelectionFilter::changeRect(const QRect& rect)
+{
+    return rect.adjusted(-m_xRadius, -m_yRadius, m_xRadius, m_yRadius);
+}
+
+void KisBorderSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
+{
+    if (m_xRadius <= 0 || m_yRadius <= 0) return;
+
+    // the transitions need one more pixel around
+    processInBlocks(pixelSelection, rect, m_xRadius + 1, m_yRadius + 1,
+                    ClampBoundary, BorderOp(m_xRadius, m_yRadius, rect));
 }
 
 
@@ -530,108 +813,15 @@ void KisGrowSelectionFilter::process(KisPixelSelectionSP pixelSelection, const Q
     if (m_xRadius <= 0 || m_yRadius <= 0) return;
 
     /**
-        * Much code resembles Shrink filter, so please fix bugs
-        * in both filters
-        */
-
-    quint8  **buf;  // caches the region's pixel data
-    quint8  **max;  // caches the largest values for each column
-
-    max = new quint8* [rect.width() + 2 * m_xRadius];
-    buf = new quint8* [m_yRadius + 1];
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        buf[i] = new quint8[rect.width()];
-    }
-    quint8* buffer = new quint8[(rect.width() + 2 * m_xRadius) *(m_yRadius + 1)];
-    for (qint32 i = 0; i < rect.width() + 2 * m_xRadius; i++) {
-        if (i < m_xRadius)
-            max[i] = buffer;
-        else if (i < rect.width() + m_xRadius)
-            max[i] = &buffer[(m_yRadius + 1) * (i - m_xRadius)];
-        else
-            max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius - 1)];
-
-        for (qint32 j = 0; j < m_xRadius + 1; j++)
-            max[i][j] = 0;
-    }
-    /* offset the max pointer by m_xRadius so the range of the array
-        is [-m_xRadius] to [region->w + m_xRadius] */
-    max += m_xRadius;
-
-    quint8* out = new quint8[ rect.width()];  // holds the new scan line we are computing
-
-    qint32* circ = new qint32[ 2 * m_xRadius + 1 ]; // holds the y coords of the filter's mask
-    computeBorder(circ, m_xRadius, m_yRadius);
-
-    /* offset the circ pointer by m_xRadius so the range of the array
-        is [-m_xRadius] to [m_xRadius] */
-    circ += m_xRadius;
+     * Much code resembles Shrink filter, so please fix bugs
+     * in both filters
+     */
 
-    memset(buf[0], 0, rect.width());
-    for (qint32 i = 0; i < m_yRadius && i < rect.height(); i++) { // load top of image
-        pixelSelection->readBytes(buf[i + 1], rect.x(), rect.y() + i, rect.width(), 1);
-    }
-
-    for (qint32 x = 0; x < rect.width() ; x++) { // set up max for top of image
-        max[x][0] = 0;         // buf[0][x] is always 0
-        max[x][1] = buf[1][x]; // MAX (buf[1][x], max[x][0]) always = buf[1][x]
-        for (qint32 j = 2; j < m_yRadius + 1; j++) {
-            max[x][j] = MAX(buf[j][x], max[x][j-1]);
-        }
-    }
+    QVector<qint32> circ(2 * m_xRadius + 1); // holds the y coords of the filter's mask
+    computeBorder(circ.data(), m_xRadius, m_yRadius);
 
-    for (qint32 y = 0; y < rect.height(); y++) {
-        rotatePointers(buf, m_yRadius + 1);
-        if (y < rect.height() - (m_yRadius))
-            pixelSelection->readBytes(buf[m_yRadius], rect.x(), rect.y() + y + m_yRadius, rect.width(), 1);
-        else
-            memset(buf[m_yRadius], 0, rect.width());
-        for (qint32 x = 0; x < rect.width(); x++) { /* update max array */
-            for (qint32 i = m_yRadius; i > 0; i--) {
-                max[x][i] = MAX(MAX(max[x][i - 1], buf[i - 1][x]), buf[i][x]);
-            }
-            max[x][0] = buf[0][x];
-        }
-        qint32 last_max = max[0][circ[-1]];
-        qint32 last_index = 1;
-        for (qint32 x = 0; x < rect.width(); x++) { /* render scan line */
-            last_index--;
-            if (last_index >= 0) {
-                if (last_max == 255)
-                    out[x] = 255;
-                else {
-                    last_max = 0;
-                    for (qint32 i = m_xRadius; i >= 0; i--)
-                        if (last_max < max[x + i][circ[i]]) {
-                            last_max = max[x + i][circ[i]];
-                            last_index = i;
-                        }
-                    out[x] = last_max;
-                }
-            } else {
-                last_index = m_xRadius;
-                last_max = max[x + m_xRadius][circ[m_xRadius]];
-                for (qint32 i = m_xRadius - 1; i >= -m_xRadius; i--)
-                    if (last_max < max[x + i][circ[i]]) {
-                        last_max = max[x + i][circ[i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
-            }
-        }
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
-    }
-    /* undo the offsets to the pointers so we can free the malloced memmory */
-    circ -= m_xRadius;
-    max -= m_xRadius;
-
-    delete[] circ;
-    delete[] buffer;
-    delete[] max;
-    for (qint32 i = 0; i < m_yRadius + 1; i++)
-        delete[] buf[i];
-    delete[] buf;
-    delete[] out;
+    processInBlocks(pixelSelection, rect, m_xRadius, m_yRadius, ZeroBoundary,
+                    MorphologyOp(halfWidthsFromBorder(circ, m_xRadius, m_yRadius), false));
 }
 
 
@@ -656,132 +846,18 @@ void KisShrinkSelectionFilter::process(KisPixelSelectionSP pixelSelection, const
 {
     if (m_xRadius <= 0 || m_yRadius <= 0) return;
 
-    /*
-        pretty much the same as fatten_region only different
-        blame all bugs in this function on jaycox@gimp.org
-    */
-    /* If edge_lock is true  we assume that pixels outside the region
-        we are passed are identical to the edge pixels.
-        If edge_lock is false, we assume that pixels outside the region are 0
-    */
-    quint8  **buf;  // caches the region's pixels
-    quint8  **max;  // caches the smallest values for each column
-    qint32    last_max, last_index;
-
-    max = new quint8* [rect.width() + 2 * m_xRadius];
-    buf = new quint8* [m_yRadius + 1];
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        buf[i] = new quint8[rect.width()];
-    }
-
-    qint32 buffer_size = (rect.width() + 2 * m_xRadius + 1) * (m_yRadius + 1);
-    quint8* buffer = new quint8[buffer_size];
-
-    if (m_edgeLock)
-        memset(buffer, 255, buffer_size);
-    else
-        memset(buffer, 0, buffer_size);
-
-    for (qint32 i = 0; i < rect.width() + 2 * m_xRadius; i++) {
-        if (i < m_xRadius)
-            if (m_edgeLock)
-                max[i] = buffer;
-            else
-                max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius)];
-        else if (i < rect.width() + m_xRadius)
-            max[i] = &buffer[(m_yRadius + 1) * (i - m_xRadius)];
-        else if (m_edgeLock)
-            max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius - 1)];
-        else
-            max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius)];
-    }
-    if (!m_edgeLock)
-        for (qint32 j = 0 ; j < m_xRadius + 1; j++) max[0][j] = 0;
-
-    // offset the max pointer by m_xRadius so the range of the array is [-m_xRadius] to [region->w + m_xRadius]
-    max += m_xRadius;
-
-    quint8* out = new quint8[rect.width()]; // holds the new scan line we are computing
-
-    qint32* circ = new qint32[2 * m_xRadius + 1]; // holds the y coords of the filter's mask
-
-    computeBorder(circ, m_xRadius, m_yRadius);
-
-    // offset the circ pointer by m_xRadius so the range of the array is [-m_xRadius] to [m_xRadius]
-    circ += m_xRadius;
-
-    for (qint32 i = 0; i < m_yRadius && i < rect.height(); i++) // load top of image
-        pixelSelection->readBytes(buf[i + 1], rect.x(), rect.y() + i, rect.width(), 1);
-
-    if (m_edgeLock)
-        memcpy(buf[0], buf[1], rect.width());
-    else
-        memset(buf[0], 0, rect.width());
-
-
-    for (qint32 x = 0; x < rect.width(); x++) { // set up max for top of image
-        max[x][0] = buf[0][x];
-        for (qint32 j = 1; j < m_yRadius + 1; j++)
-            max[x][j] = MIN(buf[j][x], max[x][j-1]);
-    }
-
-    for (qint32 y = 0; y < rect.height(); y++) {
-        rotatePointers(buf, m_yRadius + 1);
-        if (y < rect.height() - m_yRadius)
-            pixelSelection->readBytes(buf[m_yRadius], rect.x(), rect.y() + y + m_yRadius, rect.width(), 1);
-        else if (m_edgeLock)
-            memcpy(buf[m_yRadius], buf[m_yRadius - 1], rect.width());
-        else
-            memset(buf[m_yRadius], 0, rect.width());
-
-        for (qint32 x = 0 ; x < rect.width(); x++) { // update max array
-            for (qint32 i = m_yRadius; i > 0; i--) {
-                max[x][i] = MIN(MIN(max[x][i - 1], buf[i - 1][x]), buf[i][x]);
-            }
-            max[x][0] = buf[0][x];
-        }
-        last_max =  max[0][circ[-1]];
-        last_index = 0;
-
-        for (qint32 x = 0 ; x < rect.width(); x++) { // render scan line
-            last_index--;
-            if (last_index >= 0) {
-                if (last_max == 0)
-                    out[x] = 0;
-                else {
-                    last_max = 255;
-                    for (qint32 i = m_xRadius; i >= 0; i--)
-                        if (last_max > max[x + i][circ[i]]) {
-                            last_max = max[x + i][circ[i]];
-                            last_index = i;
-                        }
-                    out[x] = last_max;
-                }
-            } else {
-                last_index = m_xRadius;
-                last_max = max[x + m_xRadius][circ[m_xRadius]];
-                for (qint32 i = m_xRadius - 1; i >= -m_xRadius; i--)
-                    if (last_max > max[x + i][circ[i]]) {
-                        last_max = max[x + i][circ[i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
-            }
-        }
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
-    }
+    /**
+     * If edge_lock is true we assume that pixels outside the region
+     * we are passed are identical to the edge pixels.  If edge_lock
+     * is false, we assume that pixels outside the region are 0
+     */
 
-    // undo the offsets to the pointers so we can free the malloced memmory
-    circ -= m_xRadius;
-    max -= m_xRadius;
+    QVector<qint32> circ(2 * m_xRadius + 1); // holds the y coords of the filter's mask
+    computeBorder(circ.data(), m_xRadius, m_yRadius);
 
-    delete[] circ;
-    delete[] buffer;
-    delete[] max;
-    for (qint32 i = 0; i < m_yRadius + 1; i++)
-        delete[] buf[i];
-    delete[] buf;
-    delete[] out;
+    processInBlocks(pixelSelection, rect, m_xRadius, m_yRadius,
+                    m_edgeLock ? ClampBoundary : ZeroBoundary,
+                    MorphologyOp(halfWidthsFromBorder(circ, m_xRadius, m_yRadius), true));
 }
 
 
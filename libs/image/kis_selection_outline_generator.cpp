@@ -0,0 +1,463 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_selection_outline_generator.h"
+
+#include <QPair>
+#include <QRect>
+#include <QtConcurrentMap>
+
+#include "kis_global.h"
+#include "kis_paint_device.h"
+
+
+const int KisSelectionOutlineGenerator::numLevelsOfDetail = 6;
+
+namespace {
+
+const int stripeSize = 64;
+
+inline int nextStripeBorder(int value)
+{
+    const int stripeIndex = value >= 0 ?
+        value / stripeSize :
+        -((-value + stripeSize - 1) / stripeSize);
+
+    return (stripeIndex + 1) * stripeSize;
+}
+
+enum CornerFlags {
+    // the vertical segment of the corner goes up, otherwise down
+    UpVertical = 0x1,
+    // the horizontal segment of the corner goes left, otherwise right
+    LeftHorizontal = 0x2,
+    // the clockwise walk leaves the corner along its horizontal segment
+    HorizontalOut = 0x4
+};
+
+/**
+ * A point where the outline turns. Every corner is connected with
+ * exactly one horizontal and one vertical segment. The grid points
+ * where two selected pixels touch diagonally are represented by two
+ * separate corners.
+ */
+struct Corner {
+    int x;
+    int y;
+    int horizontalLink;
+    int verticalLink;
+    quint8 flags;
+};
+
+/**
+ * The corners on the grid lines [top, bottom] of the selection rect.
+ * The corners are sorted by y, then by x, a corner with the left
+ * horizontal segment goes before the one with the right segment.
+ */
+struct StripeCorners {
+    StripeCorners() : top(0), bottom(0) {}
+    StripeCorners(int _top, int _bottom) : top(_top), bottom(_bottom) {}
+
+    int top;
+    int bottom;
+    QVector<Corner> corners;
+};
+
+struct FindCornersJob
+{
+    FindCornersJob(const KisPaintDevice *_selection, const QRect &_rect)
+        : selection(_selection), rect(_rect)
+    {
+    }
+
+    void operator() (StripeCorners &stripe) const {
+        const int width = rect.width();
+
+        const int rowsTop = qMax(stripe.top - 1, rect.top());
+        const int rowsBottom = qMin(stripe.bottom, rect.bottom());
+        const int numRows = rowsBottom - rowsTop + 1;
+
+        QVector<quint8> bytes(width * numRows);
+        selection->readBytes(bytes.data(), rect.left(), rowsTop, width, numRows);
+
+        // the rows are padded with unselected pixels on both sides
+        const int stride = width + 2;
+        QVector<quint8> rows(stride * numRows, 0);
+        const QVector<quint8> emptyRow(stride, 0);
+
+        for (int row = 0; row < numRows; row++) {
+            const quint8 *src = bytes.constData() + row * width;
+            quint8 *dst = rows.data() + row * stride + 1;
+
+            for (int i = 0; i < width; i++) {
+                dst[i] = src[i] != MIN_SELECTED;
+            }
+        }
+
+        auto rowPtr = [&] (int y) {
+            return y >= rowsTop && y <= rowsBottom ?
+                rows.constData() + (y - rowsTop) * stride :
+                emptyRow.constData();
+        };
+
+        for (int y = stripe.top; y <= stripe.bottom; y++) {
+            const quint8 *above = rowPtr(y - 1);
+            const quint8 *below = rowPtr(y);
+
+            int openHorizontal = -1;
+
+            for (int i = 0; i <= width; i++) {
+                const quint8 a = above[i];
+                const quint8 b = above[i + 1];
+                const quint8 c = below[i];
+                const quint8 d = below[i + 1];
+
+                // no vertical or no horizontal segments, not a corner
+                if ((a == b && c == d) || (a == c && b == d)) continue;
+
+                const int x = rect.left() + i;
+
+                if (a == d && b == c) {
+                    /**
+                     * Diagonally touching pixels are not connected,
+                     * so the upper corner belongs to the upper
+                     * selected pixel and the lower one to the lower
+                     */
+                    const quint8 upperFlags = UpVertical | (a ? LeftHorizontal : 0);
+                    const quint8 lowerFlags = a ? 0 : LeftHorizontal;
+
+                    if (a) {
+                        addCorner(stripe.corners, x, y, upperFlags, a, d, &openHorizontal);
+                        addCorner(stripe.corners, x, y, lowerFlags, a, d, &openHorizontal);
+                    } else {
+                        addCorner(stripe.corners, x, y, lowerFlags, a, d, &openHorizontal);
+                        addCorner(stripe.corners, x, y, upperFlags, a, d, &openHorizontal);
+                    }
+                } else {
+                    const quint8 flags =
+                        (a != b ? UpVertical : 0) |
+                        (a != c ? LeftHorizontal : 0);
+
+                    addCorner(stripe.corners, x, y, flags, a, d, &openHorizontal);
+                }
+            }
+
+            Q_ASSERT(openHorizontal < 0);
+        }
+    }
+
+    static inline void addCorner(QVector<Corner> &corners, int x, int y, quint8 flags,
+                                 bool topLeftSelected, bool bottomRightSelected,
+                                 int *openHorizontal) {
+        Corner corner;
+        corner.x = x;
+        corner.y = y;
+        corner.horizontalLink = -1;
+        corner.verticalLink = -1;
+
+        const int index = corners.size();
+
+        /**
+         * The walk keeps the selected pixels on the right side, so it
+         * goes left above the selected pixels and right below them
+         */
+        if (flags & LeftHorizontal) {
+            if (topLeftSelected) {
+                flags |= HorizontalOut;
+            }
+
+            Q_ASSERT(*openHorizontal >= 0);
+            corner.horizontalLink = *openHorizontal;
+            corners[*openHorizontal].horizontalLink = index;
+            *openHorizontal = -1;
+        } else {
+            if (bottomRightSelected) {
+                flags |= HorizontalOut;
+            }
+
+            *openHorizontal = index;
+        }
+
+        corner.flags = flags;
+        corners.append(corner);
+    }
+
+    const KisPaintDevice *selection;
+    QRect rect;
+};
+
+inline qreal squaredDistanceToSegment(const QPointF &pt, const QPointF &p0, const QPointF &p1)
+{
+    const QPointF segment = p1 - p0;
+    const QPointF diff = pt - p0;
+    const qreal squaredLength = segment.x() * segment.x() + segment.y() * segment.y();
+
+    qreal t = 0.0;
+
+    if (squaredLength > 0.0) {
+        t = qBound(0.0, (diff.x() * segment.x() + diff.y() * segment.y()) / squaredLength, 1.0);
+    }
+
+    const QPointF projectionDiff = diff - t * segment;
+    return projectionDiff.x() * projectionDiff.x() + projectionDiff.y() * projectionDiff.y();
+}
+
+struct SimplifyJob
+{
+    SimplifyJob(qreal _tolerance) : tolerance(_tolerance) {}
+
+    void operator() (QPolygon &polygon) const {
+        const QRect rc = polygon.boundingRect();
+        const int extent = qMax(rc.right() - rc.left(), rc.bottom() - rc.top());
+
+        if (extent < tolerance) {
+            polygon = QPolygon();
+        } else {
+            polygon = KisSelectionOutlineGenerator::simplify(polygon, tolerance);
+        }
+    }
+
+    qreal tolerance;
+};
+
+QPainterPath polygonsToPath(const QVector<QPolygon> &polygons)
+{
+    QPainterPath path;
+
+    Q_FOREACH (const QPolygon &polygon, polygons) {
+        if (polygon.isEmpty()) continue;
+
+        path.addPolygon(polygon);
+        path.closeSubpath();
+    }
+
+    return path;
+}
+
+}
+
+QVector<QPolygon> KisSelectionOutlineGenerator::outline(const KisPaintDevice *selection, const QRect &rect)
+{
+    if (rect.isEmpty()) return QVector<QPolygon>();
+
+    KIS_ASSERT_RECOVER_NOOP(selection->pixelSize() == 1);
+
+    QVector<StripeCorners> stripes;
+
+    const int lastLine = rect.bottom() + 1;
+    for (int y = rect.top(); y <= lastLine;) {
+        const int nextY = qMin(nextStripeBorder(y), lastLine + 1);
+        stripes << StripeCorners(y, nextY - 1);
+        y = nextY;
+    }
+
+    FindCornersJob job(selection, rect);
+
+    if (stripes.size() > 1) {
+        QtConcurrent::blockingMap(stripes, job);
+    } else {
+        job(stripes.first());
+    }
+
+    QVector<Corner> corners;
+
+    {
+        int numCorners = 0;
+        Q_FOREACH (const StripeCorners &stripe, stripes) {
+            numCorners += stripe.corners.size();
+        }
+        corners.reserve(numCorners);
+    }
+
+    Q_FOREACH (const StripeCorners &stripe, stripes) {
+        const int base = corners.size();
+
+        Q_FOREACH (Corner corner, stripe.corners) {
+            corner.horizontalLink += base;
+            corners.append(corner);
+        }
+    }
+
+    /**
+     * Link the vertical segments. The corners ending a segment
+     * should be processed before the ones starting a new one on the
+     * same grid line, because diagonal grid points have both.
+     */
+    QVector<int> openVertical(rect.width() + 1, -1);
+
+    for (int i = 0; i < corners.size();) {
+        int end = i;
+        while (end < corners.size() && corners[end].y == corners[i].y) end++;
+
+        for (int j = i; j < end; j++) {
+            Corner &corner = corners[j];
+            if (!(corner.flags & UpVertical)) continue;
+
+            int &open = openVertical[corner.x - rect.left()];
+            Q_ASSERT(open >= 0);
+
+            corner.verticalLink = open;
+            corners[open].verticalLink = j;
+            open = -1;
+        }
+
+        for (int j = i; j < end; j++) {
+            const Corner &corner = corners[j];
+            if (corner.flags & UpVertical) continue;
+
+            openVertical[corner.x - rect.left()] = j;
+        }
+
+        i = end;
+    }
+
+    QVector<QPolygon> polygons;
+    QVector<bool> visited(corners.size(), false);
+
+    for (int i = 0; i < corners.size(); i++) {
+        if (visited[i]) continue;
+
+        QPolygon polygon;
+
+        bool horizontal = corners[i].flags & HorizontalOut;
+        int current = i;
+
+        do {
+            const Corner &corner = corners[current];
+
+            visited[current] = true;
+            polygon << QPoint(corner.x, corner.y);
+
+            current = horizontal ? corner.horizontalLink : corner.verticalLink;
+            horizontal = !horizontal;
+        } while (current != i);
+
+        polygons.append(polygon);
+    }
+
+    return polygons;
+}
+
+QPolygon KisSelectionOutlineGenerator::simplify(const QPolygon &polygon, qreal tolerance)
+{
+    const int size = polygon.size();
+    if (size <= 3 || tolerance <= 0.0) return polygon;
+
+    /**
+     * The polygon is closed, so split it into two chains at the
+     * point farthest from the first one
+     */
+    int farthest = 0;
+    qint64 maxSquaredDistance = -1;
+
+    for (int i = 1; i < size; i++) {
+        const QPoint diff = polygon[i] - polygon[0];
+        const qint64 squaredDistance = qint64(diff.x()) * diff.x() + qint64(diff.y()) * diff.y();
+
+        if (squaredDistance > maxSquaredDistance) {
+            maxSquaredDistance = squaredDistance;
+            farthest = i;
+        }
+    }
+
+    QVector<bool> keep(size, false);
+    keep[0] = true;
+    keep[farthest] = true;
+
+    // the index equal to the size means the first point
+    QVector<QPair<int, int> > chains;
+    chains << qMakePair(0, farthest) << qMakePair(farthest, size);
+
+    const qreal squaredTolerance = tolerance * tolerance;
+
+    while (!chains.isEmpty()) {
+        const QPair<int, int> chain = chains.takeLast();
+        if (chain.second - chain.first < 2) continue;
+
+        const QPointF p0 = polygon[chain.first];
+        const QPointF p1 = polygon[chain.second % size];
+
+        int index = -1;
+        qreal maxDistance = squaredTolerance;
+
+        for (int i = chain.first + 1; i < chain.second; i++) {
+            const qreal distance = squaredDistanceToSegment(polygon[i], p0, p1);
+
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                index = i;
+            }
+        }
+
+        if (index >= 0) {
+            keep[index] = true;
+            chains << qMakePair(chain.first, index) << qMakePair(index, chain.second);
+        }
+    }
+
+    QPolygon result;
+
+    for (int i = 0; i < size; i++) {
+        if (keep[i]) {
+            result << polygon[i];
+        }
+    }
+
+    return result;
+}
+
+qreal KisSelectionOutlineGenerator::tolerance(int levelOfDetail)
+{
+    return levelOfDetail > 0 ? qreal(1 << (levelOfDetail - 1)) : 0.0;
+}
+
+QVector<QPainterPath> KisSelectionOutlineGenerator::levelsOfDetail(const QVector<QPolygon> &polygons)
+{
+    QVector<QPainterPath> paths;
+    paths << polygonsToPath(polygons);
+
+    for (int lod = 1; lod < numLevelsOfDetail; lod++) {
+        QVector<QPolygon> simplified = polygons;
+        SimplifyJob job(tolerance(lod));
+
+        if (simplified.size() > 1) {
+            QtConcurrent::blockingMap(simplified, job);
+        } else if (!simplified.isEmpty()) {
+            job(simplified.first());
+        }
+
+        paths << polygonsToPath(simplified);
+    }
+
+    return paths;
+}
+
+int KisSelectionOutlineGenerator::levelOfDetailForScale(qreal scale)
+{
+    if (scale <= 0.0) return 0;
+
+    // the error should not exceed half of a screen pixel
+    const qreal maxError = 0.5 / scale;
+
+    int lod = 0;
+    while (lod + 1 < numLevelsOfDetail && tolerance(lod + 1) <= maxError) {
+        lod++;
+    }
+
+    return lod;
+}
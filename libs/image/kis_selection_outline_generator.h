@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_SELECTION_OUTLINE_GENERATOR_H
+#define __KIS_SELECTION_OUTLINE_GENERATOR_H
+
+#include <QVector>
+#include <QPolygon>
+#include <QPainterPath>
+
+#include "kritaimage_export.h"
+
+class QRect;
+class KisPaintDevice;
+
+
+/**
+ * Generates outlines (marching ants) of pixel selections.
+ *
+ * The outline is built from the corners of the pixel boundaries. The
+ * corners are found in tile-aligned stripes in parallel, which is the
+ * only part of the algorithm depending on the area of the selection.
+ * Then the corners are linked into polygons in a single pass, which is
+ * linear in the length of the outline.
+ *
+ * Diagonally touching pixels are considered disconnected, so the
+ * generated polygons never cross themselves, though they may touch
+ * themselves in the diagonal grid points. Outer boundaries are
+ * clockwise and holes are counterclockwise (in screen coordinates).
+ *
+ * Outlines of noisy selections (e.g. created by the magic wand on a
+ * photo) contain millions of points, so the generator can also build
+ * a set of simplified paths for showing on a zoomed out canvas.
+ */
+class KRITAIMAGE_EXPORT KisSelectionOutlineGenerator
+{
+public:
+    /**
+     * The number of levels of detail built by levelsOfDetail(). Level
+     * zero is the exact outline, every next level is meant for twice
+     * smaller zoom than the previous one.
+     */
+    static const int numLevelsOfDetail;
+
+    /**
+     * \return the polygons around the selected pixels of \p selection
+     * in \p rect. Pixels having MIN_SELECTED value and all the pixels
+     * outside \p rect are considered unselected.
+     */
+    static QVector<QPolygon> outline(const KisPaintDevice *selection, const QRect &rect);
+
+    /**
+     * Simplifies a closed polygon with Douglas-Peucker algorithm. The
+     * points of the result never deviate from the original polygon
+     * more than by \p tolerance.
+     */
+    static QPolygon simplify(const QPolygon &polygon, qreal tolerance);
+
+    /**
+     * The maximum deviation (in image pixels) of the paths of level
+     * \p levelOfDetail from the exact outline
+     */
+    static qreal tolerance(int levelOfDetail);
+
+    /**
+     * Builds numLevelsOfDetail paths from \p polygons. Level zero
+     * contains all the polygons as they are, the other levels contain
+     * the polygons simplified with tolerance(level). The polygons
+     * smaller than the tolerance are skipped.
+     */
+    static QVector<QPainterPath> levelsOfDetail(const QVector<QPolygon> &polygons);
+
+    /**
+     * \return the coarsest level of detail whose error is invisible
+     * on a canvas showing the image with \p scale
+     */
+    static int levelOfDetailForScale(qreal scale);
+};
+
+#endif /* __KIS_SELECTION_OUTLINE_GENERATOR_H */
@@ -26,6 +26,9 @@
 #include <klocalizedstring.h>
 
 #include <QTransform>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtConcurrentMap>
 
 #include <KoColorSpace.h>
 #include <KoCompositeOpRegistry.h>
@@ -195,6 +198,77 @@ void updateBounds<KisVLineIteratorSP>(QRect &boundRect, const KisFilterWeightsAp
     boundRect.setHeight(newBounds.size());
 }
 
+struct TransformPassStripe
+{
+    TransformPassStripe(int _firstLine = 0, int _numLines = 0)
+        : firstLine(_firstLine), numLines(_numLines) {}
+
+    int firstLine;
+    int numLines;
+};
+
+/**
+ * Processes a stripe of lines of a transform pass. Every line is read
+ * from and written into the same line of the device, so the stripes
+ * are independent of each other and can be processed in parallel.
+ */
+template <class T>
+struct TransformPassStripeProcessor
+{
+    TransformPassStripeProcessor(KisPaintDeviceSP _src, KisPaintDeviceSP _dst,
+                                 double _floatscale, double _shear, double _dx,
+                                 bool _clampToEdge,
+                                 KisFilterWeightsBuffer *_buffer,
+                                 qreal _filterSupport,
+                                 qint32 _srcStart, qint32 _srcLen,
+                                 qint32 _firstLine,
+                                 QVector<KisFilterWeightsApplicator::LinePos> *_linePositions,
+                                 KisProgressUpdateHelper *_progressHelper,
+                                 QMutex *_progressLock)
+        : src(_src), dst(_dst),
+          floatscale(_floatscale), shear(_shear), dx(_dx),
+          clampToEdge(_clampToEdge),
+          buffer(_buffer),
+          filterSupport(_filterSupport),
+          srcStart(_srcStart), srcLen(_srcLen),
+          firstLine(_firstLine),
+          linePositions(_linePositions),
+          progressHelper(_progressHelper),
+          progressLock(_progressLock)
+    {
+    }
+
+    void operator() (const TransformPassStripe &stripe) {
+        KisFilterWeightsApplicator applicator(src, dst, floatscale, shear, dx, clampToEdge);
+
+        for (int i = stripe.firstLine; i < stripe.firstLine + stripe.numLines; i++) {
+            KisFilterWeightsApplicator::LinePos srcPos(srcStart, srcLen);
+            (*linePositions)[i - firstLine] =
+                applicator.processLine<T>(srcPos, i, buffer, filterSupport);
+        }
+
+        QMutexLocker l(progressLock);
+        for (int i = 0; i < stripe.numLines; i++) {
+            progressHelper->step();
+        }
+    }
+
+    KisPaintDeviceSP src;
+    KisPaintDeviceSP dst;
+    double floatscale;
+    double shear;
+    double dx;
+    bool clampToEdge;
+    KisFilterWeightsBuffer *buffer;
+    qreal filterSupport;
+    qint32 srcStart;
+    qint32 srcLen;
+    qint32 firstLine;
+    QVector<KisFilterWeightsApplicator::LinePos> *linePositions;
+    KisProgressUpdateHelper *progressHelper;
+    QMutex *progressLock;
+};
+
 template <class T>
 void KisTransformWorker::transformPass(KisPaintDevice *src, KisPaintDevice *dst,
                                        double floatscale, double shear, double dx,
@@ -208,18 +282,57 @@ void KisTransformWorker::transformPass(KisPaintDevice *src, KisPaintDevice *dst,
 
     KisProgressUpdateHelper progressHelper(m_progressUpdater, portion, numLines);
     KisFilterWeightsBuffer buf(filterStrategy, qAbs(floatscale));
-    KisFilterWeightsApplicator applicator(src, dst, floatscale, shear, dx, clampToEdge);
 
-    KisFilterWeightsApplicator::LinePos dstBounds;
+    /**
+     * The lines are split into tile-aligned stripes, so that the
+     * threads would not share the tiles.
+     */
+    const int stripeSize = 64;
 
-    for (int i = firstLine; i < firstLine + numLines; i++) {
-        KisFilterWeightsApplicator::LinePos dstPos;
-        KisFilterWeightsApplicator::LinePos srcPos(srcStart, srcLen);
+    QVector<TransformPassStripe> stripes;
+    for (int i = firstLine; i < firstLine + numLines;) {
+        int nextStripe = (i >= 0 ? i / stripeSize + 1 : -((-i - 1) / stripeSize)) * stripeSize;
+        nextStripe = qMin(nextStripe, firstLine + numLines);
 
-        dstPos = applicator.processLine<T>(srcPos, i, &buf, filterStrategy->support());
-        dstBounds.unite(dstPos);
+        stripes << TransformPassStripe(i, nextStripe - i);
+        i = nextStripe;
+    }
 
-        progressHelper.step();
+    QVector<KisFilterWeightsApplicator::LinePos> linePositions(numLines);
+    QMutex progressLock;
+
+    TransformPassStripeProcessor<T> processor(src, dst,
+                                              floatscale, shear, dx,
+                                              clampToEdge,
+                                              &buf, filterStrategy->support(),
+                                              srcStart, srcLen,
+                                              firstLine,
+                                              &linePositions,
+                                              &progressHelper,
+                                              &progressLock);
+
+    /**
+     * The worker has no access to the updater context of the image, and
+     * it is usually run by one of the updater threads itself, which is
+     * blocked until the stripes are done and processes some of them.
+     * So the stripes go to the global pool, like the dabs of
+     * KisAutoBrush do.
+     */
+    if (stripes.size() > 1) {
+        QtConcurrent::blockingMap(stripes, processor);
+    } else {
+        Q_FOREACH (const TransformPassStripe &stripe, stripes) {
+            processor(stripe);
+        }
+    }
+
+    /**
+     * Unite the bounds in the order of the lines, exactly the way the
+     * sequential processing does it
+     */
+    KisFilterWeightsApplicator::LinePos dstBounds;
+    Q_FOREACH (const KisFilterWeightsApplicator::LinePos &dstPos, linePositions) {
+        dstBounds.unite(dstPos);
     }
 
     updateBounds<T>(m_boundRect, dstBounds);
@@ -257,9 +257,11 @@ void KisWarpTransformWorker::run()
     const int pixelPrecision = 8;
 
     FunctionTransformOp functionOp(m_warpMathFunction, m_origPoint, m_transfPoint, m_alpha);
-    GridIterationTools::PaintDevicePolygonOp polygonOp(srcdev, m_dev);
-    GridIterationTools::processGrid(polygonOp, functionOp,
+    GridIterationTools::ParallelRasterizationOp<GridIterationTools::PaintDevicePolygonOp>
+        rasterizationOp(GridIterationTools::PaintDevicePolygonOp(srcdev, m_dev));
+    GridIterationTools::processGrid(rasterizationOp, functionOp,
                                     srcBounds, pixelPrecision);
+    rasterizationOp.finish();
 }
 
 #include "krita_utils.h"
@@ -359,7 +361,9 @@ QImage KisWarpTransformWorker::transformQImage(WarpType warpType,
 
     const int pixelPrecision = 32;
     GridIterationTools::QImagePolygonOp polygonOp(srcImage, dstImage, srcQImageOffset, dstQImageOffset);
-    GridIterationTools::processGrid(polygonOp, functionOp, srcBounds.toAlignedRect(), pixelPrecision);
+    GridIterationTools::ParallelRasterizationOp<GridIterationTools::QImagePolygonOp> rasterizationOp(polygonOp);
+    GridIterationTools::processGrid(rasterizationOp, functionOp, srcBounds.toAlignedRect(), pixelPrecision);
+    rasterizationOp.finish();
 
     return dstImage;
 }
@@ -19,12 +19,19 @@
 #include "kis_layer_style_filter_environment.h"
 
 #include <QBitArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegion>
+
+#include <KoColor.h>
 
 #include "kis_layer.h"
 #include "kis_ls_utils.h"
 
 #include "kis_selection.h"
 #include "kis_pixel_selection.h"
+#include "kis_default_bounds.h"
+#include "kis_datamanager.h"
 #include "kis_painter.h"
 #include "kis_image.h"
 
@@ -36,14 +43,175 @@
 #include "kis_pixel_selection.h"
 
 
+struct AlphaCacheEntry
+{
+    AlphaCacheEntry()
+        : invert(false), preciseEdge(false), spreadSize(0), blurSize(0)
+    {
+    }
+
+    bool invert;
+    bool preciseEdge;
+    int spreadSize;
+    int blurSize;
+
+    KisPixelSelectionSP device;
+    QRegion validRegion;
+
+    bool hasKey(bool _invert, bool _preciseEdge, int _spreadSize, int _blurSize) const {
+        return invert == _invert &&
+            preciseEdge == _preciseEdge &&
+            spreadSize == _spreadSize &&
+            blurSize == _blurSize;
+    }
+
+    /**
+     * The rect of the layer's alpha channel the result in \p rc
+     * depends on
+     */
+    QRect dependencyRect(const QRect &rc) const {
+        QRect result = blurSize ? KisLsUtils::growRectFromRadius(rc, blurSize) : rc;
+        return spreadSize ? KisLsUtils::growRectFromRadius(result, spreadSize) : result;
+    }
+};
+
 struct Q_DECL_HIDDEN KisLayerStyleFilterEnvironment::Private
 {
+    Private()
+        : sourceLayer(0),
+          cacheLevelOfDetail(-1),
+          cacheSequenceNumber(0)
+    {
+    }
+
     KisLayer *sourceLayer;
     KisPixelSelectionSP cachedRandomSelection;
 
+    QMutex cacheLock;
+    int cacheLevelOfDetail;
+    int cacheSequenceNumber;
+    KisPixelSelectionSP alphaSnapshot;
+    QRegion alphaSnapshotRegion;
+
+    // the most recently used entry goes first
+    QList<AlphaCacheEntry> cacheEntries;
+    static const int maxCacheEntries = 8;
+
     static KisPixelSelectionSP generateRandomSelection(const QRect &rc);
+
+    void resetCacheUnlocked(int levelOfDetail);
+    static QRect compareWithSnapshot(KisPixelSelectionSP alpha,
+                                     KisPixelSelectionSP snapshot,
+                                     const QRegion &comparedRegion);
+    void invalidateCacheUnlocked(const QRect &changedRect);
+    AlphaCacheEntry* fetchCacheEntryUnlocked(bool invert, bool preciseEdge,
+                                             int spreadSize, int blurSize,
+                                             bool create);
+    static void spreadAndBlur(KisPixelSelectionSP selection, const QRect &rc,
+                              bool preciseEdge, int spreadSize, int blurSize);
 };
 
+void KisLayerStyleFilterEnvironment::Private::resetCacheUnlocked(int levelOfDetail)
+{
+    cacheLevelOfDetail = levelOfDetail;
+    cacheSequenceNumber++;
+    alphaSnapshot = new KisPixelSelection();
+    alphaSnapshotRegion = QRegion();
+    cacheEntries.clear();
+}
+
+QRect KisLayerStyleFilterEnvironment::Private::compareWithSnapshot(KisPixelSelectionSP alpha,
+                                                                  KisPixelSelectionSP snapshot,
+                                                                  const QRegion &comparedRegion)
+{
+    QRect changedRect;
+
+    Q_FOREACH (const QRect &compareRect, comparedRegion.rects()) {
+        changedRect |= alpha->dataManager()->differingRect(snapshot->dataManager().data(), compareRect);
+    }
+
+    return changedRect;
+}
+
+void KisLayerStyleFilterEnvironment::Private::invalidateCacheUnlocked(const QRect &changedRect)
+{
+    if (changedRect.isEmpty()) return;
+
+    for (QList<AlphaCacheEntry>::iterator it = cacheEntries.begin();
+         it != cacheEntries.end(); ++it) {
+
+        it->validRegion -= it->dependencyRect(changedRect);
+    }
+    cacheSequenceNumber++;
+}
+
+AlphaCacheEntry*
+KisLayerStyleFilterEnvironment::Private::
+fetchCacheEntryUnlocked(bool invert, bool preciseEdge,
+                        int spreadSize, int blurSize,
+                        bool create)
+{
+    for (int i = 0; i < cacheEntries.size(); i++) {
+        if (cacheEntries[i].hasKey(invert, preciseEdge, spreadSize, blurSize)) {
+            if (i > 0) {
+                cacheEntries.move(i, 0);
+            }
+            return &cacheEntries.first();
+        }
+    }
+
+    if (!create) return 0;
+
+    AlphaCacheEntry entry;
+    entry.invert = invert;
+    entry.preciseEdge = preciseEdge;
+    entry.spreadSize = spreadSize;
+    entry.blurSize = blurSize;
+    entry.device = new KisPixelSelection();
+
+    cacheEntries.prepend(entry);
+
+    while (cacheEntries.size() > maxCacheEntries) {
+        cacheEntries.removeLast();
+    }
+
+    return &cacheEntries.first();
+}
+
+void KisLayerStyleFilterEnvironment::Private::spreadAndBlur(KisPixelSelectionSP selection,
+                                                            const QRect &rc,
+                                                            bool preciseEdge,
+                                                            int spreadSize,
+                                                            int blurSize)
+{
+    const QRect blurNeedRect = blurSize ?
+        KisLsUtils::growRectFromRadius(rc, blurSize) : rc;
+
+    const QRect spreadNeedRect = spreadSize ?
+        KisLsUtils::growRectFromRadius(blurNeedRect, spreadSize) : blurNeedRect;
+
+    /**
+     * NOTE: the edge is searched in the entire dependency area,
+     * otherwise the result would depend on the size of the
+     * requested rect and couldn't be reused in other requests
+     */
+    if (preciseEdge) {
+        KisLsUtils::findEdge(selection, spreadNeedRect, true);
+    }
+
+    if (spreadSize) {
+        KisLsUtils::applyGaussian(selection, blurNeedRect, spreadSize);
+
+        // TODO: find out why in libpsd we pass false here. If we do so,
+        //       the result is fully black, which is not expected
+        KisLsUtils::findEdge(selection, blurNeedRect, true);
+    }
+
+    if (blurSize) {
+        KisLsUtils::applyGaussian(selection, rc, blurSize);
+    }
+}
+
 
 KisPixelSelectionSP
 KisLayerStyleFilterEnvironment::Private::
@@ -82,6 +250,7 @@ KisLayerStyleFilterEnvironment::KisLayerStyleFilterEnvironment(KisLayer *sourceL
 {
     Q_ASSERT(sourceLayer);
     m_d->sourceLayer = sourceLayer;
+    m_d->resetCacheUnlocked(0);
 }
 
 KisLayerStyleFilterEnvironment::~KisLayerStyleFilterEnvironment()
@@ -105,24 +274,6 @@ int KisLayerStyleFilterEnvironment::currentLevelOfDetail() const
         m_d->sourceLayer->original()->defaultBounds()->currentLevelOfDetail() : 0;
 }
 
-QPainterPath KisLayerStyleFilterEnvironment::layerOutlineCache() const
-{
-    // TODO: make it really cachable!
-    Q_ASSERT(m_d->sourceLayer);
-    KisPaintDeviceSP srcDevice = m_d->sourceLayer->projection();
-    QRect srcRect = srcDevice->exactBounds();
-    if (srcRect.isEmpty()) return QPainterPath();
-
-    KisSelectionSP baseSelection =
-        KisLsUtils::selectionFromAlphaChannel(srcDevice, srcRect);
-    KisPixelSelectionSP selection = baseSelection->pixelSelection();
-
-    // needs no 'invalidate' call
-    selection->recalculateOutlineCache();
-
-    return selection->outlineCache();
-}
-
 void KisLayerStyleFilterEnvironment::setupFinalPainter(KisPainter *gc,
                                                        quint8 opacity,
                                                        const QBitArray &channelFlags) const
@@ -135,6 +286,8 @@ void KisLayerStyleFilterEnvironment::setupFinalPainter(KisPainter *gc,
 
 KisPixelSelectionSP KisLayerStyleFilterEnvironment::cachedRandomSelection(const QRect &requestedRect) const
 {
+    QMutexLocker l(&m_d->cacheLock);
+
     KisPixelSelectionSP selection = m_d->cachedRandomSelection;
 
     QRect existingRect;
@@ -150,3 +303,119 @@ KisPixelSelectionSP KisLayerStyleFilterEnvironment::cachedRandomSelection(const
 
     return m_d->cachedRandomSelection;
 }
+
+KisSelectionSP
+KisLayerStyleFilterEnvironment::cachedSpreadAndBlurredAlpha(KisPaintDeviceSP srcDevice,
+                                                            const QRect &applyRect,
+                                                            bool invert,
+                                                            bool preciseEdge,
+                                                            int spreadSize,
+                                                            int blurSize) const
+{
+    KisSelectionSP baseSelection = new KisSelection(new KisSelectionEmptyBounds(0));
+    KisPixelSelectionSP selection = baseSelection->pixelSelection();
+
+    if (invert) {
+        const quint8 defPixel = MAX_SELECTED;
+        selection->setDefaultPixel(KoColor(&defPixel, selection->colorSpace()));
+    }
+
+    if (applyRect.isEmpty()) return baseSelection;
+
+    const int levelOfDetail = currentLevelOfDetail();
+
+    AlphaCacheEntry keyEntry;
+    keyEntry.spreadSize = spreadSize;
+    keyEntry.blurSize = blurSize;
+    const QRect alphaRect = keyEntry.dependencyRect(applyRect);
+
+    KisPixelSelectionSP alpha =
+        KisLsUtils::selectionFromAlphaChannel(srcDevice, alphaRect)->pixelSelection();
+
+    QRect missingRect;
+    int sequenceNumber = 0;
+
+    /**
+     * The alpha channel is compared with the snapshot outside the lock.
+     * A published snapshot is never modified, instead an updated copy
+     * of it is swapped in, so if some other thread has replaced the
+     * snapshot meanwhile, we just repeat the comparison with the newer
+     * one.
+     */
+    forever {
+        KisPixelSelectionSP snapshot;
+        QRegion snapshotRegion;
+
+        {
+            QMutexLocker l(&m_d->cacheLock);
+
+            if (m_d->cacheLevelOfDetail != levelOfDetail) {
+                m_d->resetCacheUnlocked(levelOfDetail);
+            }
+
+            snapshot = m_d->alphaSnapshot;
+            snapshotRegion = m_d->alphaSnapshotRegion;
+        }
+
+        const QRect changedRect =
+            Private::compareWithSnapshot(alpha, snapshot, snapshotRegion & alphaRect);
+
+        // the copy shares all the tiles with the original one
+        KisPixelSelectionSP newSnapshot = new KisPixelSelection(*snapshot);
+        KisPainter::copyAreaOptimized(alphaRect.topLeft(), alpha, newSnapshot, alphaRect);
+
+        QMutexLocker l(&m_d->cacheLock);
+
+        if (m_d->alphaSnapshot != snapshot) continue;
+
+        m_d->invalidateCacheUnlocked(changedRect);
+        m_d->alphaSnapshot = newSnapshot;
+        m_d->alphaSnapshotRegion = snapshotRegion + alphaRect;
+
+        AlphaCacheEntry *entry =
+            m_d->fetchCacheEntryUnlocked(invert, preciseEdge, spreadSize, blurSize, true);
+
+        const QRegion availableRegion = entry->validRegion & applyRect;
+        Q_FOREACH (const QRect &rc, availableRegion.rects()) {
+            KisPainter::copyAreaOptimized(rc.topLeft(), entry->device, selection, rc);
+        }
+
+        missingRect = (QRegion(applyRect) - availableRegion).boundingRect();
+        sequenceNumber = m_d->cacheSequenceNumber;
+        break;
+    }
+
+    if (missingRect.isEmpty()) return baseSelection;
+
+    /**
+     * The calculation is done outside the lock, the source is the
+     * alpha snapshot we have just compared with the cache, so the
+     * result is consistent with it.
+     */
+    if (invert) {
+        alpha->invert();
+    }
+
+    Private::spreadAndBlur(alpha, missingRect, preciseEdge, spreadSize, blurSize);
+    KisPainter::copyAreaOptimized(missingRect.topLeft(), alpha, selection, missingRect);
+
+    {
+        QMutexLocker l(&m_d->cacheLock);
+
+        /**
+         * If some other thread has found changes in the alpha channel
+         * meanwhile, our data might be outdated, so just don't store it.
+         */
+        if (m_d->cacheSequenceNumber == sequenceNumber) {
+            AlphaCacheEntry *entry =
+                m_d->fetchCacheEntryUnlocked(invert, preciseEdge, spreadSize, blurSize, false);
+
+            if (entry) {
+                KisPainter::copyAreaOptimized(missingRect.topLeft(), alpha, entry->device, missingRect);
+                entry->validRegion += missingRect;
+            }
+        }
+    }
+
+    return baseSelection;
+}
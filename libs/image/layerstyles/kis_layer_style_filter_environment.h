@@ -27,7 +27,6 @@
 
 class KisPainter;
 class KisLayer;
-class QPainterPath;
 class QBitArray;
 
 
@@ -41,14 +40,32 @@ public:
     QRect defaultBounds() const;
     int currentLevelOfDetail() const;
 
-    QPainterPath layerOutlineCache() const;
-
     void setupFinalPainter(KisPainter *gc,
                            quint8 opacity,
                            const QBitArray &channelFlags) const;
 
     KisPixelSelectionSP cachedRandomSelection(const QRect &requestedRect) const;
 
+    /**
+     * Returns the alpha channel of \p srcDevice prepared the way
+     * shadows, glows and satin need it: optionally inverted, with the
+     * edge found (precise technique), spread by \p spreadSize and
+     * blurred by \p blurSize. The result is valid in \p applyRect only.
+     *
+     * The results are memoized. The environment is shared by all the
+     * effects of the layer, so the effects having the same parameters
+     * reuse the data of each other. The cache keeps a snapshot of the
+     * layer's alpha channel and on every request compares it with the
+     * actual one, so only the areas that really changed since the
+     * previous request are recalculated.
+     */
+    KisSelectionSP cachedSpreadAndBlurredAlpha(KisPaintDeviceSP srcDevice,
+                                               const QRect &applyRect,
+                                               bool invert,
+                                               bool preciseEdge,
+                                               int spreadSize,
+                                               int blurSize) const;
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
@@ -36,7 +36,7 @@ struct KisLayerStyleFilterProjectionPlane::Private
 
     QScopedPointer<KisLayerStyleFilter> filter;
     KisPSDLayerStyleSP style;
-    QScopedPointer<KisLayerStyleFilterEnvironment> environment;
+    QSharedPointer<KisLayerStyleFilterEnvironment> environment;
 
     KisMultipleProjection projection;
 };
@@ -50,6 +50,17 @@ KisLayerStyleFilterProjectionPlane(KisLayer *sourceLayer)
     m_d->environment.reset(new KisLayerStyleFilterEnvironment(sourceLayer));
 }
 
+KisLayerStyleFilterProjectionPlane::
+KisLayerStyleFilterProjectionPlane(KisLayer *sourceLayer,
+                                   QSharedPointer<KisLayerStyleFilterEnvironment> environment)
+    : m_d(new Private)
+{
+    Q_ASSERT(sourceLayer);
+    Q_ASSERT(environment);
+    m_d->sourceLayer = sourceLayer;
+    m_d->environment = environment;
+}
+
 KisLayerStyleFilterProjectionPlane::~KisLayerStyleFilterProjectionPlane()
 {
 }
@@ -22,14 +22,23 @@
 #include "kis_abstract_projection_plane.h"
 
 #include <QScopedPointer>
+#include <QSharedPointer>
 
 #include "kis_types.h"
 
+class KisLayerStyleFilterEnvironment;
 
 class KisLayerStyleFilterProjectionPlane : public KisAbstractProjectionPlane
 {
 public:
     KisLayerStyleFilterProjectionPlane(KisLayer *sourceLayer);
+
+    /**
+     * Creates a plane that uses \p environment shared with the other
+     * effects of the same layer, so that they could share the caches
+     */
+    KisLayerStyleFilterProjectionPlane(KisLayer *sourceLayer,
+                                       QSharedPointer<KisLayerStyleFilterEnvironment> environment);
     ~KisLayerStyleFilterProjectionPlane();
 
     void setStyle(KisLayerStyleFilter *filter, KisPSDLayerStyleSP style);
@@ -20,6 +20,7 @@
 
 #include "kis_global.h"
 #include "kis_layer_style_filter_projection_plane.h"
+#include "kis_layer_style_filter_environment.h"
 #include "kis_psd_layer_style.h"
 
 #include "kis_ls_drop_shadow_filter.h"
@@ -64,72 +65,79 @@ void KisLayerStyleProjectionPlane::init(KisLayer *sourceLayer, KisPSDLayerStyleS
     m_d->sourceProjectionPlane = sourceLayer->internalProjectionPlane();
     m_d->style = style;
 
+    /**
+     * All the effects share the same environment, so they can reuse
+     * the intermediate results of each other
+     */
+    QSharedPointer<KisLayerStyleFilterEnvironment> environment(
+        new KisLayerStyleFilterEnvironment(sourceLayer));
+
     {
         KisLayerStyleFilterProjectionPlane *dropShadow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         dropShadow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::DropShadow), style);
         m_d->stylesBefore << toQShared(dropShadow);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *innerShadow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         innerShadow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::InnerShadow), style);
         m_d->stylesAfter << toQShared(innerShadow);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *outerGlow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         outerGlow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::OuterGlow), style);
         m_d->stylesAfter << toQShared(outerGlow);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *innerGlow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         innerGlow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::InnerGlow), style);
         m_d->stylesAfter << toQShared(innerGlow);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *satin =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         satin->setStyle(new KisLsSatinFilter(), style);
         m_d->stylesAfter << toQShared(satin);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *colorOverlay =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         colorOverlay->setStyle(new KisLsOverlayFilter(KisLsOverlayFilter::Color), style);
         m_d->stylesAfter << toQShared(colorOverlay);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *gradientOverlay =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         gradientOverlay->setStyle(new KisLsOverlayFilter(KisLsOverlayFilter::Gradient), style);
         m_d->stylesAfter << toQShared(gradientOverlay);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *patternOverlay =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         patternOverlay->setStyle(new KisLsOverlayFilter(KisLsOverlayFilter::Pattern), style);
         m_d->stylesAfter << toQShared(patternOverlay);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *stroke =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         stroke->setStyle(new KisLsStrokeFilter(), style);
         m_d->stylesAfter << toQShared(stroke);
     }
 
     {
         KisLayerStyleFilterProjectionPlane *bevelEmboss =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
+            new KisLayerStyleFilterProjectionPlane(sourceLayer, environment);
         bevelEmboss->setStyle(new KisLsBevelEmbossFilter(), style);
         m_d->stylesAfter << toQShared(bevelEmboss);
     }
@@ -37,6 +37,7 @@
 #include "kis_gaussian_kernel.h"
 
 #include "kis_pixel_selection.h"
+#include "kis_distance_transform.h"
 #include "kis_fill_painter.h"
 #include "kis_gradient_painter.h"
 #include "kis_iterator_ng.h"
@@ -57,38 +58,56 @@ KisLsBevelEmbossFilter::KisLsBevelEmbossFilter()
 {
 }
 
-void paintBevelSelection(KisPixelSelectionSP srcSelection,
-                         KisPixelSelectionSP dstSelection,
-                         const QRect &applyRect,
-                         int size,
-                         int initialSize,
-                         bool invert)
+void KisLsBevelEmbossFilter::paintBevelSelection(KisPixelSelectionSP srcSelection,
+                                                 KisPixelSelectionSP dstSelection,
+                                                 const QRect &applyRect,
+                                                 int size,
+                                                 int initialSize,
+                                                 bool invert)
 {
-    KisSelectionSP tmpBaseSelection = new KisSelection(new KisSelectionEmptyBounds(0));
-    KisPixelSelectionSP tmpSelection = tmpBaseSelection->pixelSelection();
+    /**
+     * Instead of growing the selection \p size times we find the last
+     * step covering the pixel directly from its distance to the edge
+     */
+    if (size <= 0 || applyRect.isEmpty()) return;
 
-    // NOTE: we are not using createCompositionSourceDevice() intentionally,
-    //       because the source device doesn't have alpha channel
-    KisPixelSelectionSP fillDevice = new KisPixelSelection();
+    const int maxDistance = qMax(initialSize, size - initialSize) + 1;
 
-    KisPainter gc(dstSelection);
-    gc.setCompositeOp(COMPOSITE_COPY);
+    const QVector<quint32> outsideDistances =
+        KisDistanceTransform::squaredDistances(srcSelection, applyRect, maxDistance, false);
+    const QVector<quint32> insideDistances =
+        KisDistanceTransform::squaredDistances(srcSelection, applyRect, maxDistance, true);
 
-    for (int i = 0; i < size; i++) {
-        const int growSize = initialSize - i - 1;
+    QVector<quint8> srcPixels(applyRect.width() * applyRect.height());
+    srcSelection->readBytes(srcPixels.data(), applyRect);
 
-        quint8 selectedness = invert ?
-            qRound(qreal(size - i - 1) / size * 255.0) :
-            qRound(qreal(i + 1) / size * 255.0);
-        fillDevice->setDefaultPixel(KoColor(&selectedness, fillDevice->colorSpace()));
+    QVector<quint8> dstPixels(srcPixels.size());
+    dstSelection->readBytes(dstPixels.data(), applyRect);
 
-        tmpSelection->makeCloneFromRough(srcSelection, srcSelection->selectedRect());
+    for (int i = 0; i < srcPixels.size(); i++) {
+        int step = size - 1;
 
-        QRect changeRect = KisLsUtils::growSelectionUniform(tmpSelection, growSize, applyRect);
+        if (srcPixels[i] > 127) {
+            // growing by -k pixels covers the pixels farther than k from the outside
+            if (insideDistances[i] != KisDistanceTransform::infinity) {
+                const qreal distance = std::sqrt(qreal(insideDistances[i]));
+                step = qMin(step, int(std::ceil(initialSize - 1 + distance)) - 1);
+            }
+        } else {
+            if (outsideDistances[i] == KisDistanceTransform::infinity) continue;
+
+            const qreal distance = std::sqrt(qreal(outsideDistances[i]));
+            step = qMin(step, int(std::floor(initialSize - 1 - distance)));
+        }
 
-        gc.setSelection(tmpBaseSelection);
-        gc.bitBlt(changeRect.topLeft(), fillDevice, changeRect);
+        if (step < 0) continue;
+
+        dstPixels[i] = invert ?
+            qRound(qreal(size - step - 1) / size * 255.0) :
+            qRound(qreal(step + 1) / size * 255.0);
     }
+
+    dstSelection->writeBytes(dstPixels.constData(), applyRect);
 }
 
 struct ContrastOp {
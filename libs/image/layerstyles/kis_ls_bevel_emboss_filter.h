@@ -41,6 +41,22 @@ public:
     QRect neededRect(const QRect & rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const;
     QRect changedRect(const QRect & rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const;
 
+    /**
+     * Paints the steps of the bevel: step i is the source selection grown
+     * by (initialSize - i - 1) pixels (or shrunk, if the value is
+     * negative), filled with the selectedness of the step. The grown
+     * areas are nested, so every pixel gets the value of the last step
+     * covering it.
+     *
+     * Public for the sake of unit tests only.
+     */
+    static void paintBevelSelection(KisPixelSelectionSP srcSelection,
+                                    KisPixelSelectionSP dstSelection,
+                                    const QRect &applyRect,
+                                    int size,
+                                    int initialSize,
+                                    bool invert);
+
 private:
     void applyBevelEmboss(KisPaintDeviceSP srcDevice,
                           KisMultipleProjection *dst,
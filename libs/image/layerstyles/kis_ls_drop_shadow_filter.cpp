@@ -120,47 +120,33 @@ void applyDropShadow(KisPaintDeviceSP srcDevice,
 
     ShadowRectsData d(applyRect, context, shadow, ShadowRectsData::NEED_RECT);
 
+    /**
+     * Spread and blur the selection. The alpha-derived intermediates
+     * are shared between all the effects of the layer.
+     */
     KisSelectionSP baseSelection =
-        KisLsUtils::selectionFromAlphaChannel(srcDevice, d.spreadNeedRect);
+        env->cachedSpreadAndBlurredAlpha(srcDevice, d.noiseNeedRect,
+                                         shadow->invertsSelection(),
+                                         shadow->technique() == psd_technique_precise,
+                                         d.spread_size, d.blur_size);
 
     KisPixelSelectionSP selection = baseSelection->pixelSelection();
 
-    //selection->convertToQImage(0, QRect(0,0,300,300)).save("0_selection_initial.png");
-
-    if (shadow->invertsSelection()) {
-        selection->invert();
-    }
+    //selection->convertToQImage(0, QRect(0,0,300,300)).save("2_selection_blur.png");
 
     /**
      * Copy selection which will be erased from the original later
      */
     KisPixelSelectionSP knockOutSelection;
     if (shadow->knocksOut()) {
-        knockOutSelection = new KisPixelSelection(*selection);
-    }
-
-    if (shadow->technique() == psd_technique_precise) {
-        KisLsUtils::findEdge(selection, d.blurNeedRect, true);
-    }
-
-    /**
-     * Spread and blur the selection
-     */
-    if (d.spread_size) {
-        KisLsUtils::applyGaussian(selection, d.blurNeedRect, d.spread_size);
+        knockOutSelection =
+            KisLsUtils::selectionFromAlphaChannel(srcDevice, d.spreadNeedRect)->pixelSelection();
 
-        // TODO: find out why in libpsd we pass false here. If we do so,
-        //       the result is fully black, which is not expected
-        KisLsUtils::findEdge(selection, d.blurNeedRect, true /*shadow->edgeHidden()*/);
+        if (shadow->invertsSelection()) {
+            knockOutSelection->invert();
+        }
     }
 
-    //selection->convertToQImage(0, QRect(0,0,300,300)).save("1_selection_spread.png");
-
-    if (d.blur_size) {
-        KisLsUtils::applyGaussian(selection, d.noiseNeedRect, d.blur_size);
-    }
-    //selection->convertToQImage(0, QRect(0,0,300,300)).save("2_selection_blur.png");
-
     if (shadow->range() != KisLsUtils::FULL_PERCENT_RANGE) {
         KisLsUtils::adjustRange(selection, d.noiseNeedRect, shadow->range());
     }
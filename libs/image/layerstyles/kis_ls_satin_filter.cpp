@@ -144,9 +144,9 @@ void applySatin(KisPaintDeviceSP srcDevice,
 
     //knockOutSelection->convertToQImage(0, QRect(0,0,300,300)).save("1_saved_knockout_selection.png");
 
-    KisPixelSelectionSP tempSelection = new KisPixelSelection(*selection);
-
-    KisLsUtils::applyGaussian(tempSelection, d.satinNeedRect, d.blur_size);
+    KisPixelSelectionSP tempSelection =
+        env->cachedSpreadAndBlurredAlpha(srcDevice, d.satinNeedRect,
+                                         false, false, 0, d.blur_size)->pixelSelection();
 
     //tempSelection->convertToQImage(0, QRect(0,0,300,300)).save("2_selection_blurred.png");
 
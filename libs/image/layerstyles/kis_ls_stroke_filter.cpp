@@ -19,6 +19,7 @@
 #include "kis_ls_stroke_filter.h"
 
 #include <cstdlib>
+#include <cmath>
 
 #include <QBitArray>
 
@@ -33,6 +34,7 @@
 #include "kis_gaussian_kernel.h"
 
 #include "kis_pixel_selection.h"
+#include "kis_distance_transform.h"
 #include "kis_fill_painter.h"
 #include "kis_gradient_painter.h"
 #include "kis_iterator_ng.h"
@@ -50,16 +52,18 @@ KisLsStrokeFilter::KisLsStrokeFilter()
 {
 }
 
-void paintPathOnSelection(KisPixelSelectionSP selection,
-                          const QPainterPath &path,
-                          const QRect &applyRect,
-                          int size)
+/**
+ * \return the part of the pixel covered by a stroke of \p strokeWidth
+ * running along the edge of the layer, where \p squaredDistance is the
+ * distance from the pixel to the closest pixel on the other side of
+ * the edge. The edge lies half a pixel from the center of the closest
+ * pixel.
+ */
+inline qreal strokeCoverage(quint32 squaredDistance, qreal strokeWidth)
 {
-    QPen pen(Qt::white, size);
-    KisPainter gc(selection);
-    gc.setPaintColor(KoColor(Qt::white, selection->colorSpace()));
-    gc.drawPainterPath(path, pen, applyRect);
-    gc.end();
+    if (squaredDistance == KisDistanceTransform::infinity) return 0.0;
+
+    return qBound(0.0, strokeWidth + 1.0 - std::sqrt(qreal(squaredDistance)), 1.0);
 }
 
 void KisLsStrokeFilter::applyStroke(KisPaintDeviceSP srcDevice,
@@ -70,39 +74,59 @@ void KisLsStrokeFilter::applyStroke(KisPaintDeviceSP srcDevice,
 {
     if (applyRect.isEmpty()) return;
 
-    KisSelectionSP baseSelection = new KisSelection(new KisSelectionEmptyBounds(0));
-    KisPixelSelectionSP selection = baseSelection->pixelSelection();
-
-    //selection->convertToQImage(0, QRect(0,0,300,300)).save("0_selection_initial.png");
+    const psd_stroke_position position = config->position();
 
-    QPainterPath strokePath = env->layerOutlineCache();
-    if (strokePath.isEmpty()) return;
+    // the center stroke spreads to both sides of the edge
+    const qreal strokeWidth =
+        position == psd_stroke_center ? 0.5 * config->size() : config->size();
+    const int maxDistance = std::ceil(strokeWidth) + 1;
 
-    if (config->position() == psd_stroke_center) {
-        paintPathOnSelection(selection, strokePath,
-                             applyRect, config->size());
-    } else if (config->position() == psd_stroke_outside ||
-               config->position() == psd_stroke_inside) {
+    KisSelectionSP layerSelection =
+        KisLsUtils::selectionFromAlphaChannel(srcDevice, kisGrowRect(applyRect, maxDistance));
+    KisPixelSelectionSP layerPixelSelection = layerSelection->pixelSelection();
 
-        paintPathOnSelection(selection, strokePath,
-                                         applyRect, 2 * config->size());
+    /**
+     * The stroke is built from the exact distances to the edge of the
+     * layer, so its cost doesn't depend on the size of the stroke
+     */
+    QVector<quint32> outsideDistances;
+    QVector<quint32> insideDistances;
 
-        KisSelectionSP knockOutSelection =
-            KisLsUtils::selectionFromAlphaChannel(srcDevice, applyRect);
+    if (position != psd_stroke_inside) {
+        outsideDistances =
+            KisDistanceTransform::squaredDistances(layerPixelSelection, applyRect, maxDistance, false);
+    }
 
-        // disabled intentionally, because it creates artifacts on smooth lines
-        // KisLsUtils::findEdge(knockOutSelection->pixelSelection(), applyRect, true);
+    if (position != psd_stroke_outside) {
+        insideDistances =
+            KisDistanceTransform::squaredDistances(layerPixelSelection, applyRect, maxDistance, true);
+    }
 
-        if (config->position() == psd_stroke_inside) {
-            knockOutSelection->pixelSelection()->invert();
+    QVector<quint8> pixels(applyRect.width() * applyRect.height());
+    layerPixelSelection->readBytes(pixels.data(), applyRect);
+
+    for (int i = 0; i < pixels.size(); i++) {
+        const quint8 opacity = pixels[i];
+        qreal value = 0.0;
+
+        if (position == psd_stroke_outside) {
+            // the soft edge of the layer knocks out the stroke
+            value = strokeCoverage(outsideDistances[i], strokeWidth) * (255 - opacity);
+        } else if (position == psd_stroke_inside) {
+            value = strokeCoverage(insideDistances[i], strokeWidth) * opacity;
+        } else {
+            value = 255.0 * (opacity > 127 ?
+                             strokeCoverage(insideDistances[i], strokeWidth) :
+                             strokeCoverage(outsideDistances[i], strokeWidth));
         }
 
-        KisPainter gc(selection);
-        gc.setCompositeOp(COMPOSITE_ERASE);
-        gc.bitBlt(applyRect.topLeft(), knockOutSelection->pixelSelection(), applyRect);
-        gc.end();
+        pixels[i] = qRound(value);
     }
 
+    KisSelectionSP baseSelection = new KisSelection(new KisSelectionEmptyBounds(0));
+    KisPixelSelectionSP selection = baseSelection->pixelSelection();
+    selection->writeBytes(pixels.constData(), applyRect);
+
     //selection->convertToQImage(0, QRect(0,0,300,300)).save("1_selection_stroke.png");
 
     KisPaintDeviceSP fillDevice = new KisPaintDevice(srcDevice->colorSpace());
@@ -138,10 +162,16 @@ void KisLsStrokeFilter::processDirectly(KisPaintDeviceSP src,
     applyStroke(src, dst, applyRect, w.config, env);
 }
 
-QRect KisLsStrokeFilter::neededRect(const QRect &rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment */*env*/) const
+QRect KisLsStrokeFilter::neededRect(const QRect &rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const
 {
-    Q_UNUSED(style);
-    return rect;
+    const psd_layer_effects_stroke *config = style->stroke();
+    if (!config->effectEnabled()) return rect;
+
+    KisLsUtils::LodWrapper<psd_layer_effects_stroke> w(env->currentLevelOfDetail(), config);
+
+    // the distances to the edge are searched in this area
+    const int borderSize = w.config->size() + 1;
+    return kisGrowRect(rect, borderSize);
 }
 
 QRect KisLsStrokeFilter::changedRect(const QRect &rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const
@@ -57,7 +57,8 @@ struct KisColorizeMask::Private
           showColoring(true),
           needsUpdate(true),
           originalSequenceNumber(-1),
-          updateCompressor(1, KisSignalCompressor::POSTPONE)
+          updateCompressor(1, KisSignalCompressor::POSTPONE),
+          cutResultsCache(KisMultiwayCut::createResultsCache())
     {
     }
 
@@ -70,7 +71,8 @@ struct KisColorizeMask::Private
           needsUpdate(false),
           originalSequenceNumber(-1),
           updateCompressor(1000, KisSignalCompressor::POSTPONE),
-          offset(rhs.offset)
+          offset(rhs.offset),
+          cutResultsCache(KisMultiwayCut::createResultsCache())
     {
         Q_FOREACH (const KeyStroke &stroke, rhs.keyStrokes) {
             keyStrokes << KeyStroke(new KisPaintDevice(*stroke.dev), stroke.color, stroke.isTransparent);
@@ -97,6 +99,8 @@ struct KisColorizeMask::Private
 
     KisSignalCompressor updateCompressor;
     QPoint offset;
+
+    KisMultiwayCut::ResultsCacheSP cutResultsCache;
 };
 
 KisColorizeMask::KisColorizeMask()
@@ -272,6 +276,8 @@ void KisColorizeMask::slotUpdateRegenerateFilling()
                                           image->bounds(),
                                           this);
 
+        strategy->setResultsCache(m_d->cutResultsCache);
+
         Q_FOREACH (const KeyStroke &stroke, m_d->keyStrokes) {
             const KoColor color =
                 !stroke.isTransparent ?
@@ -43,7 +43,8 @@ struct KisColorizeStrokeStrategy::Private
           filteredSourceValid(rhs.filteredSourceValid),
           boundingRect(rhs.boundingRect),
           keyStrokes(rhs.keyStrokes),
-          dirtyNode(rhs.dirtyNode)
+          dirtyNode(rhs.dirtyNode),
+          resultsCache(rhs.resultsCache)
     {}
 
     KisPaintDeviceSP src;
@@ -55,6 +56,7 @@ struct KisColorizeStrokeStrategy::Private
 
     QVector<KeyStroke> keyStrokes;
     KisNodeSP dirtyNode;
+    KisMultiwayCut::ResultsCacheSP resultsCache;
 };
 
 KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(KisPaintDeviceSP src,
@@ -81,6 +83,10 @@ KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(const KisColorizeStrokeStra
 {
     KisLodTransform t(levelOfDetail);
     m_d->boundingRect = t.map(rhs.m_d->boundingRect);
+
+    // the cache keeps the results of a single cut only, so
+    // don't let the preview flush the results of the original
+    m_d->resultsCache.clear();
 }
 
 KisColorizeStrokeStrategy::~KisColorizeStrokeStrategy()
@@ -95,6 +101,11 @@ void KisColorizeStrokeStrategy::addKeyStroke(KisPaintDeviceSP dev, const KoColor
     m_d->keyStrokes << KeyStroke(dev, convertedColor);
 }
 
+void KisColorizeStrokeStrategy::setResultsCache(KisMultiwayCut::ResultsCacheSP cache)
+{
+    m_d->resultsCache = cache;
+}
+
 void KisColorizeStrokeStrategy::initStrokeCallback()
 {
     if (!m_d->filteredSourceValid) {
@@ -114,6 +125,7 @@ void KisColorizeStrokeStrategy::initStrokeCallback()
     }
 
     KisMultiwayCut cut(m_d->filteredSource, m_d->dst, m_d->boundingRect);
+    cut.setResultsCache(m_d->resultsCache);
 
     Q_FOREACH (const KeyStroke &stroke, m_d->keyStrokes) {
         cut.addKeyStroke(new KisPaintDevice(*stroke.dev), stroke.color);
@@ -24,6 +24,7 @@
 
 #include "kis_types.h"
 #include <kis_simple_stroke_strategy.h>
+#include "kis_multiway_cut.h"
 
 class KoColor;
 
@@ -43,6 +44,13 @@ public:
 
     void addKeyStroke(KisPaintDeviceSP dev, const KoColor &color);
 
+    /**
+     * Sets the cache of the cut regions, which lets the strategy to
+     * skip solving the regions that have not changed since the
+     * previous regeneration of the mask
+     */
+    void setResultsCache(KisMultiwayCut::ResultsCacheSP cache);
+
     void initStrokeCallback();
 
     KisStrokeStrategy *createLodClone(int levelOfDetail);
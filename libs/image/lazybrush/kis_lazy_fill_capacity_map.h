@@ -29,6 +29,18 @@
 #include "kis_global.h"
 
 
+/**
+ * Capacities of the edges of KisLazyFillGraph. The values are
+ * calculated on the fly, so the map itself doesn't allocate any
+ * per-pixel data.
+ *
+ * All the capacities are guaranteed to be not bigger than
+ * maxEdgeCapacity, so that the residual capacity of an edge (which
+ * never exceeds the sum of the capacities of the edge and its
+ * reverse) fits into 16 bits. For small images the capacities are
+ * exactly the same as before, for big images all of them are scaled
+ * down uniformly, which doesn't change the shape of the cut.
+ */
 class KisLazyFillCapacityMap
 {
     typedef KisLazyFillCapacityMap type;
@@ -41,6 +53,8 @@ public:
     typedef const int& reference;
     typedef boost::readable_property_map_tag category;
 
+    static const int maxEdgeCapacity = 32767;
+
     KisLazyFillCapacityMap(KisPaintDeviceSP mainImage,
                            KisPaintDeviceSP aLabelImage,
                            KisPaintDeviceSP bLabelImage,
@@ -55,6 +69,8 @@ public:
           m_bLabelRect(m_bLabelImage->exactBounds() & boundingRect),
           m_colorSpace(mainImage->colorSpace()),
           m_pixelSize(m_colorSpace->pixelSize()),
+          m_k(2 * (m_mainRect.width() + m_mainRect.height())),
+          m_unitValue(qMin(256.0, qreal(maxEdgeCapacity) / (m_k + 1))),
           m_graph(m_mainRect,
                   m_aLabelImage->regionExact() & boundingRect,
                   m_bLabelImage->regionExact() & boundingRect)
@@ -74,8 +90,7 @@ public:
     }
 
     int maxCapacity() const {
-        const int k  = 2 * (m_mainRect.width() + m_mainRect.height());
-        return k + 1;
+        return m_k + 1;
     }
 
     friend value_type get(type &map,
@@ -111,11 +126,7 @@ public:
 
             Q_ASSERT(!srcLabelA && !srcLabelB);
 
-
-            // TODO: precalculate!
-            const int k  = 2 * (map.m_mainRect.width() + map.m_mainRect.height());
-
-            static const int unitValue = 256;
+            const int k = map.m_k;
 
             qreal value = 0.0;
 
@@ -149,9 +160,12 @@ public:
                 const qreal totalPenalty = qMax(0.0 * diffPenalty, intensityPenalty);
 
                 value = 1.0 + k * (1.0 - pow2(totalPenalty));
+
+                // the edges between pixels should never be free
+                return qMax(1, int(value * map.m_unitValue));
             }
 
-            return value * unitValue;
+            return value * map.m_unitValue;
         }
 
     KisLazyFillGraph& graph() {
@@ -170,6 +184,8 @@ private:
 
     const KoColorSpace *m_colorSpace;
     int m_pixelSize;
+    int m_k;
+    qreal m_unitValue;
     KisRandomConstAccessorSP m_mainAccessor;
     KisRandomConstAccessorSP m_aAccessor;
     KisRandomConstAccessorSP m_bAccessor;
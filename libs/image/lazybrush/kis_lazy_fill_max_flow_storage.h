@@ -0,0 +1,273 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_LAZY_FILL_MAX_FLOW_STORAGE_H
+#define __KIS_LAZY_FILL_MAX_FLOW_STORAGE_H
+
+#include <vector>
+
+#include <boost/graph/properties.hpp>
+#include <boost/property_map/property_map.hpp>
+
+#include "kis_lazy_fill_graph.h"
+
+
+/**
+ * Compact per-vertex and per-edge storage for running
+ * boykov_kolmogorov_max_flow() on KisLazyFillGraph.
+ *
+ * Generic boost property maps need 48 bytes per vertex just for the
+ * predecessor edges, because KisLazyFillGraph's edge descriptor is a
+ * pair of full vertex descriptors. Here all the data is packed using
+ * the regular structure of the graph:
+ *
+ * - a predecessor edge always connects a pixel either with one of its
+ *   four neighbours or with one of the two terminals, so it is stored
+ *   as a 4-bit neighbour code (plus the direction bit) in one byte;
+ *
+ * - tree colors take one byte instead of a 4-byte enum;
+ *
+ * - distances are 32-bit;
+ *
+ * - residual capacities are 16-bit, KisLazyFillCapacityMap guarantees
+ *   they never overflow.
+ *
+ * Together with the solver's own per-vertex data (32-bit timestamps
+ * and two bit vectors) the memory needed for a cut is:
+ *
+ *     10.25 bytes * vertices + 2 bytes * edges
+ *
+ * Every pixel has up to 4 edges to its neighbours plus 2 edges for
+ * every label it is covered by, so the total is about 18.3 MB per
+ * megapixel for sparse scribbles and never exceeds 26.3 MB per
+ * megapixel (the generic maps needed about 84--100 MB). The queues
+ * of active nodes and orphans are not included, they depend on the
+ * front of the search trees only.
+ */
+class KisLazyFillMaxFlowStorage
+{
+public:
+    typedef KisLazyFillGraph::vertex_descriptor VertexDescriptor;
+    typedef KisLazyFillGraph::edge_descriptor EdgeDescriptor;
+    typedef KisLazyFillGraph::vertices_size_type VertexIndex;
+
+    enum NeighbourCode {
+        NO_NEIGHBOUR = 0,
+        LEFT,
+        TOP,
+        RIGHT,
+        BOTTOM,
+        TERMINAL_A,
+        TERMINAL_B,
+
+        // the vertex is the source of the stored edge
+        OUTGOING_FLAG = 0x8
+    };
+
+    struct ColorMap {
+        typedef VertexDescriptor key_type;
+        typedef boost::default_color_type value_type;
+        typedef value_type reference;
+        typedef boost::read_write_property_map_tag category;
+
+        ColorMap(KisLazyFillMaxFlowStorage *_storage = 0) : storage(_storage) {}
+
+        friend inline value_type get(const ColorMap &map, const key_type &v) {
+            return map.storage->color(map.storage->graph()->index_of(v));
+        }
+
+        friend inline void put(const ColorMap &map, const key_type &v, value_type value) {
+            map.storage->setColor(map.storage->graph()->index_of(v), value);
+        }
+
+        KisLazyFillMaxFlowStorage *storage;
+    };
+
+    struct PredecessorMap {
+        typedef VertexDescriptor key_type;
+        typedef EdgeDescriptor value_type;
+        typedef value_type reference;
+        typedef boost::read_write_property_map_tag category;
+
+        PredecessorMap(KisLazyFillMaxFlowStorage *_storage = 0) : storage(_storage) {}
+
+        friend inline value_type get(const PredecessorMap &map, const key_type &v) {
+            return map.storage->predecessor(v);
+        }
+
+        friend inline void put(const PredecessorMap &map, const key_type &v, const value_type &edge) {
+            map.storage->setPredecessor(v, edge);
+        }
+
+        KisLazyFillMaxFlowStorage *storage;
+    };
+
+    typedef boost::property_map<KisLazyFillGraph, boost::vertex_index_t>::type VertexIndexMap;
+    typedef boost::property_map<KisLazyFillGraph, boost::edge_index_t>::type EdgeIndexMap;
+
+    typedef boost::iterator_property_map<quint32*, VertexIndexMap> DistanceMap;
+    typedef boost::iterator_property_map<quint16*, EdgeIndexMap> ResidualCapacityMap;
+
+public:
+    KisLazyFillMaxFlowStorage(const KisLazyFillGraph &graph)
+        : m_graph(&graph),
+          m_colors(num_vertices(graph), 0),
+          m_predecessors(num_vertices(graph), NO_NEIGHBOUR),
+          m_distances(num_vertices(graph), 0),
+          m_residualCapacities(num_edges(graph), 0)
+    {
+    }
+
+    ColorMap colorMap() {
+        return ColorMap(this);
+    }
+
+    PredecessorMap predecessorMap() {
+        return PredecessorMap(this);
+    }
+
+    DistanceMap distanceMap() {
+        return DistanceMap(&m_distances[0], get(boost::vertex_index, *m_graph));
+    }
+
+    ResidualCapacityMap residualCapacityMap() {
+        return ResidualCapacityMap(&m_residualCapacities[0], get(boost::edge_index, *m_graph));
+    }
+
+    const KisLazyFillGraph* graph() const {
+        return m_graph;
+    }
+
+    /**
+     * \return the tree of the vertex with index \p index. Reading
+     * the result of the cut this way avoids building vertex
+     * descriptors.
+     */
+    inline boost::default_color_type color(VertexIndex index) const {
+        return boost::default_color_type(m_colors[index]);
+    }
+
+    inline void setColor(VertexIndex index, boost::default_color_type value) {
+        m_colors[index] = quint8(value);
+    }
+
+    /**
+     * Bytes allocated by the solver itself for every vertex: 32-bit
+     * timestamp plus two std::vector<bool> flags
+     */
+    static qreal solverBytesPerVertex() {
+        return sizeof(quint32) + 2.0 / 8.0;
+    }
+
+    static qreal bytesPerVertex() {
+        return sizeof(quint8) + sizeof(quint8) + sizeof(quint32) + solverBytesPerVertex();
+    }
+
+    static qreal bytesPerEdge() {
+        return sizeof(quint16);
+    }
+
+    /**
+     * \return the memory needed for running the cut on \p graph
+     */
+    static qint64 estimateMemoryUsage(const KisLazyFillGraph &graph) {
+        return qint64(bytesPerVertex() * num_vertices(graph) +
+                      bytesPerEdge() * num_edges(graph));
+    }
+
+    EdgeDescriptor predecessor(const VertexDescriptor &v) const {
+        if (v.type != VertexDescriptor::NORMAL) {
+            return m_terminalPredecessors[v.type == VertexDescriptor::LABEL_A ? 0 : 1];
+        }
+
+        const quint8 code = m_predecessors[m_graph->index_of(v)];
+
+        VertexDescriptor other(v);
+
+        switch (code & ~OUTGOING_FLAG) {
+        case LEFT:
+            other.x--;
+            break;
+        case TOP:
+            other.y--;
+            break;
+        case RIGHT:
+            other.x++;
+            break;
+        case BOTTOM:
+            other.y++;
+            break;
+        case TERMINAL_A:
+            other = VertexDescriptor(VertexDescriptor::LABEL_A);
+            break;
+        case TERMINAL_B:
+            other = VertexDescriptor(VertexDescriptor::LABEL_B);
+            break;
+        default:
+            return EdgeDescriptor();
+        }
+
+        return code & OUTGOING_FLAG ?
+            std::make_pair(v, other) :
+            std::make_pair(other, v);
+    }
+
+    void setPredecessor(const VertexDescriptor &v, const EdgeDescriptor &edge) {
+        if (v.type != VertexDescriptor::NORMAL) {
+            m_terminalPredecessors[v.type == VertexDescriptor::LABEL_A ? 0 : 1] = edge;
+            return;
+        }
+
+        const bool isOutgoing = edge.first == v;
+        const VertexDescriptor &other = isOutgoing ? edge.second : edge.first;
+
+        quint8 code = NO_NEIGHBOUR;
+
+        if (other.type == VertexDescriptor::LABEL_A) {
+            code = TERMINAL_A;
+        } else if (other.type == VertexDescriptor::LABEL_B) {
+            code = TERMINAL_B;
+        } else if (other.x < v.x) {
+            code = LEFT;
+        } else if (other.y < v.y) {
+            code = TOP;
+        } else if (other.x > v.x) {
+            code = RIGHT;
+        } else {
+            code = BOTTOM;
+        }
+
+        if (isOutgoing) {
+            code |= OUTGOING_FLAG;
+        }
+
+        m_predecessors[m_graph->index_of(v)] = code;
+    }
+
+private:
+    const KisLazyFillGraph *m_graph;
+
+    std::vector<quint8> m_colors;
+    std::vector<quint8> m_predecessors;
+    std::vector<quint32> m_distances;
+    std::vector<quint16> m_residualCapacities;
+
+    EdgeDescriptor m_terminalPredecessors[2];
+};
+
+#endif /* __KIS_LAZY_FILL_MAX_FLOW_STORAGE_H */
@@ -38,6 +38,7 @@
 
 #include "lazybrush/kis_lazy_fill_graph.h"
 #include "lazybrush/kis_lazy_fill_capacity_map.h"
+#include "lazybrush/kis_lazy_fill_max_flow_storage.h"
 
 #include "kis_sequential_iterator.h"
 #include <floodfill/kis_scanline_fill.h>
@@ -86,11 +87,7 @@ void cutOneWay(const KoColor &color,
     KisLazyFillCapacityMap capacityMap(src, colorScribble, backgroundScribble, maskDevice, boundingRect);
     KisLazyFillGraph &graph = capacityMap.graph();
 
-    std::vector<default_color_type> groups(num_vertices(graph));
-    std::vector<int> residual_capacity(num_edges(graph), 0);
-
-    std::vector<typename graph_traits<KisLazyFillGraph>::vertices_size_type> distance_vec(num_vertices(graph), 0);
-    std::vector<typename graph_traits<KisLazyFillGraph>::edge_descriptor> predecessor_vec(num_vertices(graph));
+    KisLazyFillMaxFlowStorage storage(graph);
 
     auto vertexIndexMap = get(boost::vertex_index, graph);
 
@@ -102,11 +99,11 @@ void cutOneWay(const KoColor &color,
     float maxFlow =
         boykov_kolmogorov_max_flow(graph,
                                    capacityMap,
-                                   make_iterator_property_map(&residual_capacity[0], get(boost::edge_index, graph)),
+                                   storage.residualCapacityMap(),
                                    get(boost::edge_reverse, graph),
-                                   make_iterator_property_map(&predecessor_vec[0], vertexIndexMap),
-                                   make_iterator_property_map(&groups[0], vertexIndexMap),
-                                   make_iterator_property_map(&distance_vec[0], vertexIndexMap),
+                                   storage.predecessorMap(),
+                                   storage.colorMap(),
+                                   storage.distanceMap(),
                                    vertexIndexMap,
                                    s,
                                    t);
@@ -117,10 +114,14 @@ void cutOneWay(const KoColor &color,
 
     const int pixelSize = resultDevice->pixelSize();
 
+    /**
+     * Normal vertices are indexed in the row-major order of the graph's
+     * rect, the same order the sequential iterator walks in
+     */
+    long vertex_idx = 0;
+
     do {
-        KisLazyFillGraph::vertex_descriptor v(dstIt.x(), dstIt.y());
-        long vertex_idx = get(boost::vertex_index, graph, v);
-        default_color_type label = groups[vertex_idx];
+        default_color_type label = storage.color(vertex_idx++);
 
         if (label == black_color) {
             memcpy(dstIt.rawData(), color.data(), pixelSize);
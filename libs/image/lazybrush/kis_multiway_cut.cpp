@@ -18,6 +18,15 @@
 
 #include "kis_multiway_cut.h"
 
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <vector>
+
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 #include <KoColor.h>
@@ -31,18 +40,36 @@
 
 using namespace KisLazyFillTools;
 
+struct KisMultiwayCut::ResultsCache
+{
+    QMutex lock;
+    QHash<QByteArray, KisPaintDeviceSP> results;
+};
+
 struct KisMultiwayCut::Private
 {
+    Private()
+        : numRegions(0),
+          numReusedRegions(0)
+    {
+    }
+
     KisPaintDeviceSP src;
     KisPaintDeviceSP dst;
-    KisPaintDeviceSP mask;
     QRect boundingRect;
 
     QVector<KeyStroke> keyStrokes;
 
-    static void maskOutKeyStroke(KisPaintDeviceSP keyStrokeDevice, KisPaintDeviceSP mask, const QRect &boundingRect);
+    ResultsCacheSP resultsCache;
+    int numRegions;
+    int numReusedRegions;
 };
 
+KisMultiwayCut::ResultsCacheSP KisMultiwayCut::createResultsCache()
+{
+    return ResultsCacheSP(new ResultsCache());
+}
+
 KisMultiwayCut::KisMultiwayCut(KisPaintDeviceSP src,
                                KisPaintDeviceSP dst,
                                const QRect &boundingRect)
@@ -50,7 +77,6 @@ KisMultiwayCut::KisMultiwayCut(KisPaintDeviceSP src,
 {
     m_d->src = src;
     m_d->dst = dst;
-    m_d->mask = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
     m_d->boundingRect = boundingRect;
 }
 
@@ -63,8 +89,24 @@ void KisMultiwayCut::addKeyStroke(KisPaintDeviceSP dev, const KoColor &color)
     m_d->keyStrokes << KeyStroke(dev, color);
 }
 
+void KisMultiwayCut::setResultsCache(ResultsCacheSP cache)
+{
+    m_d->resultsCache = cache;
+}
+
+int KisMultiwayCut::numRegions() const
+{
+    return m_d->numRegions;
+}
+
+int KisMultiwayCut::numReusedRegions() const
+{
+    return m_d->numReusedRegions;
+}
+
+namespace {
 
-void KisMultiwayCut::Private::maskOutKeyStroke(KisPaintDeviceSP keyStrokeDevice, KisPaintDeviceSP mask, const QRect &boundingRect)
+void maskOutKeyStroke(KisPaintDeviceSP keyStrokeDevice, KisPaintDeviceSP mask, const QRect &boundingRect)
 {
     KIS_ASSERT_RECOVER_RETURN(keyStrokeDevice->pixelSize() == 1);
     KIS_ASSERT_RECOVER_RETURN(mask->pixelSize() == 1);
@@ -102,7 +144,15 @@ bool keyStrokesOrder(const KeyStroke &a, const KeyStroke &b)
     return aArea > bArea;
 }
 
-void KisMultiwayCut::run()
+/**
+ * Runs the greedy multiway cut on a single region. All the pixels
+ * outside the region should be marked as non-zero in \p mask.
+ */
+void runOnRegion(KisPaintDeviceSP src,
+                 KisPaintDeviceSP dst,
+                 KisPaintDeviceSP mask,
+                 const QRect &boundingRect,
+                 QVector<KeyStroke> keyStrokes)
 {
     KisPaintDeviceSP other = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
 
@@ -116,57 +166,505 @@ void KisMultiwayCut::run()
      * as fast as possible.
      */
 
-    std::stable_sort(m_d->keyStrokes.begin(), m_d->keyStrokes.end(), keyStrokesOrder);
+    std::stable_sort(keyStrokes.begin(), keyStrokes.end(), keyStrokesOrder);
 
-    while (m_d->keyStrokes.size() > 1) {
-        KeyStroke current = m_d->keyStrokes.takeFirst();
+    while (keyStrokes.size() > 1) {
+        KeyStroke current = keyStrokes.takeFirst();
 
         // if current scribble is empty, it just has no effect
         if (current.dev->exactBounds().isEmpty()) continue;
 
         KisPainter gc(other);
 
-        Q_FOREACH (const KeyStroke &s, m_d->keyStrokes) {
-            const QRect rc = s.dev->extent() & m_d->boundingRect;
+        Q_FOREACH (const KeyStroke &s, keyStrokes) {
+            const QRect rc = s.dev->extent() & boundingRect;
             gc.bitBlt(rc.topLeft(), s.dev, rc);
         }
 
         // if other is empty, it means that *all* other strokes are
         // empty, so there is no reason to continue the process
         if (other->exactBounds().isEmpty()) {
-            m_d->keyStrokes.clear();
-            m_d->keyStrokes << current;
+            keyStrokes.clear();
+            keyStrokes << current;
             break;
         }
 
         KisLazyFillTools::cutOneWay(current.color,
-                                    m_d->src,
+                                    src,
                                     current.dev,
                                     other,
-                                    m_d->dst,
-                                    m_d->mask,
-                                    m_d->boundingRect);
+                                    dst,
+                                    mask,
+                                    boundingRect);
 
         other->clear();
     }
 
     // TODO: check if one can use the last cut for this purpose!
 
-    if (m_d->keyStrokes.size() == 1) {
-        KeyStroke current = m_d->keyStrokes.takeLast();
+    if (keyStrokes.size() == 1) {
+        KeyStroke current = keyStrokes.takeLast();
 
-        m_d->maskOutKeyStroke(current.dev, m_d->mask, m_d->boundingRect);
+        maskOutKeyStroke(current.dev, mask, boundingRect);
 
         QVector<QPoint> points =
-            KisLazyFillTools::splitIntoConnectedComponents(current.dev, m_d->boundingRect);
+            KisLazyFillTools::splitIntoConnectedComponents(current.dev, boundingRect);
 
         Q_FOREACH (const QPoint &pt, points) {
-            KisScanlineFill fill(m_d->mask, pt, m_d->boundingRect);
-            fill.fillColor(current.color, m_d->dst);
+            KisScanlineFill fill(mask, pt, boundingRect);
+            fill.fillColor(current.color, dst);
         }
     }
 }
 
+/**
+ * The pixels of the filtered source with the value lower than this
+ * threshold are considered to be the line art separating the regions.
+ * The filtered source is inverted, so the line art is dark.
+ */
+const quint8 lineArtThreshold = 64;
+
+struct KeyStrokeData {
+    KeyStroke stroke;
+    QRect rect;
+    QVector<quint8> bytes;
+
+    quint8 value(int x, int y) const {
+        return bytes[(y - rect.y()) * rect.width() + x - rect.x()];
+    }
+};
+
+struct Region {
+    Region() : label(0), reused(false) {}
+
+    int label;
+    QRect rect;
+    QVector<int> keyStrokes;
+    KisPaintDeviceSP dst;
+    QByteArray cacheKey;
+    bool reused;
+};
+
+/**
+ * The biggest bounding rect (in pixels) that is split into the
+ * regions. The splitting keeps a label (4 bytes) and a copy of the
+ * source (1 byte) for every pixel of the rect, which is 80 MiB for
+ * 4096x4096. Bigger rects are solved as a single region, without
+ * allocating any of these arrays.
+ */
+const qint64 maxSplitArea = 4096 * 4096;
+
+int findRoot(QVector<int> &parents, int i)
+{
+    while (parents[i] != i) {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+/**
+ * Labels connected components of the non-line-art pixels in \p
+ * labels. Then the labels are spread over the line art, so every pixel
+ * of the line art belongs to the nearest component.
+ *
+ * The components without key strokes are not assigned to any region
+ * directly. Instead, they are merged with all the components they
+ * touch through the line art, so the cut decides where they go,
+ * exactly as if the image was not split at all. Only the components
+ * that have key strokes and are separated by the line art alone become
+ * separate regions.
+ *
+ * \return the number of the regions. The labels start with 1.
+ */
+int calculateRegions(const QVector<quint8> &srcBytes,
+                     const QVector<KeyStrokeData> &strokes,
+                     const QRect &rc,
+                     QVector<int> *labelsPtr)
+{
+    QVector<int> &labels = *labelsPtr;
+
+    const int w = rc.width();
+    const int h = rc.height();
+    const int numPixels = w * h;
+
+    labels.fill(0, numPixels);
+
+    std::vector<int> queue;
+
+    int numComponents = 0;
+
+    for (int i = 0; i < numPixels; i++) {
+        if (labels[i] || srcBytes[i] < lineArtThreshold) continue;
+
+        numComponents++;
+        labels[i] = numComponents;
+
+        queue.clear();
+        queue.push_back(i);
+
+        for (size_t head = 0; head < queue.size(); head++) {
+            const int idx = queue[head];
+            const int x = idx % w;
+            const int y = idx / w;
+
+            auto visit = [&] (int neighbour) {
+                if (!labels[neighbour] && srcBytes[neighbour] >= lineArtThreshold) {
+                    labels[neighbour] = numComponents;
+                    queue.push_back(neighbour);
+                }
+            };
+
+            if (x > 0) visit(idx - 1);
+            if (x < w - 1) visit(idx + 1);
+            if (y > 0) visit(idx - w);
+            if (y < h - 1) visit(idx + w);
+        }
+    }
+
+    // find the components that have any key strokes
+
+    QVector<bool> stroked(numComponents + 1, false);
+    bool hasStrokedComponents = false;
+
+    Q_FOREACH (const KeyStrokeData &stroke, strokes) {
+        for (int y = stroke.rect.top(); y <= stroke.rect.bottom(); y++) {
+            for (int x = stroke.rect.left(); x <= stroke.rect.right(); x++) {
+                if (!stroke.value(x, y)) continue;
+
+                const int label = labels[(y - rc.y()) * w + x - rc.x()];
+                if (label) {
+                    stroked[label] = true;
+                    hasStrokedComponents = true;
+                }
+            }
+        }
+    }
+
+    /**
+     * All the key strokes lie on the line art, so just solve the
+     * whole image as a single region
+     */
+    if (!hasStrokedComponents) {
+        labels.fill(1);
+        return strokes.isEmpty() ? 0 : 1;
+    }
+
+    /**
+     * Spread the labels over the line art. When the fronts of two
+     * components meet and any of them has no key strokes, the
+     * components are merged into a single region.
+     */
+
+    QVector<int> parents(numComponents + 1);
+    for (int i = 0; i <= numComponents; i++) {
+        parents[i] = i;
+    }
+
+    queue.clear();
+
+    for (int i = 0; i < numPixels; i++) {
+        if (labels[i]) {
+            queue.push_back(i);
+        }
+    }
+
+    for (size_t head = 0; head < queue.size(); head++) {
+        const int idx = queue[head];
+        const int x = idx % w;
+        const int y = idx / w;
+        const int label = labels[idx];
+
+        auto visit = [&] (int neighbour) {
+            const int neighbourLabel = labels[neighbour];
+
+            if (!neighbourLabel) {
+                labels[neighbour] = label;
+                queue.push_back(neighbour);
+            } else if (neighbourLabel != label &&
+                       (!stroked[label] || !stroked[neighbourLabel])) {
+
+                const int root = findRoot(parents, label);
+                const int neighbourRoot = findRoot(parents, neighbourLabel);
+
+                if (root != neighbourRoot) {
+                    parents[neighbourRoot] = root;
+                }
+            }
+        };
+
+        if (x > 0) visit(idx - 1);
+        if (x < w - 1) visit(idx + 1);
+        if (y > 0) visit(idx - w);
+        if (y < h - 1) visit(idx + w);
+    }
+
+    QVector<int> regionLabels(numComponents + 1, 0);
+    int numRegions = 0;
+
+    for (int i = 1; i <= numComponents; i++) {
+        const int root = findRoot(parents, i);
+
+        if (!regionLabels[root]) {
+            regionLabels[root] = ++numRegions;
+        }
+        regionLabels[i] = regionLabels[root];
+    }
+
+    for (int i = 0; i < numPixels; i++) {
+        labels[i] = regionLabels[labels[i]];
+    }
+
+    return numRegions;
+}
+
+struct RegionSolver
+{
+    RegionSolver(KisPaintDeviceSP _src,
+                 const KoColorSpace *_dstColorSpace,
+                 const QRect &_boundingRect,
+                 const QVector<quint8> &_srcBytes,
+                 const QVector<int> &_labels,
+                 const QVector<KeyStrokeData> &_strokes,
+                 KisMultiwayCut::ResultsCacheSP _resultsCache)
+        : src(_src),
+          dstColorSpace(_dstColorSpace),
+          boundingRect(_boundingRect),
+          srcBytes(_srcBytes),
+          labels(_labels),
+          strokes(_strokes),
+          resultsCache(_resultsCache)
+    {
+    }
+
+    void operator() (Region &region) {
+        const QRect &rc = region.rect;
+        const int regionLabel = region.label;
+
+        const int numPixels = rc.width() * rc.height();
+
+        QVector<quint8> maskBytes(numPixels);
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+
+        hash.addData(reinterpret_cast<const char*>(&rc), sizeof(QRect));
+
+        for (int y = rc.top(); y <= rc.bottom(); y++) {
+            quint8 *maskPtr = maskBytes.data() + (y - rc.y()) * rc.width();
+            const int baseIndex = pixelIndex(rc.x(), y);
+
+            for (int x = 0; x < rc.width(); x++) {
+                maskPtr[x] = labels[baseIndex + x] == regionLabel ? 0 : 255;
+            }
+
+            hash.addData(reinterpret_cast<const char*>(maskPtr), rc.width());
+            hash.addData(reinterpret_cast<const char*>(srcBytes.constData() + baseIndex), rc.width());
+        }
+
+        QVector<KeyStroke> regionKeyStrokes;
+
+        Q_FOREACH (int strokeIndex, region.keyStrokes) {
+            const KeyStrokeData &data = strokes[strokeIndex];
+            const QRect strokeRect = data.rect & rc;
+
+            QVector<quint8> strokeBytes(strokeRect.width() * strokeRect.height());
+            quint8 *dstPtr = strokeBytes.data();
+
+            for (int y = strokeRect.top(); y <= strokeRect.bottom(); y++) {
+                for (int x = strokeRect.left(); x <= strokeRect.right(); x++) {
+                    const bool owned = !maskBytes[(y - rc.y()) * rc.width() + x - rc.x()];
+                    *dstPtr++ = owned ? data.value(x, y) : 0;
+                }
+            }
+
+            hash.addData(reinterpret_cast<const char*>(data.stroke.color.data()),
+                         data.stroke.color.colorSpace()->pixelSize());
+            hash.addData(reinterpret_cast<const char*>(&strokeRect), sizeof(QRect));
+            hash.addData(reinterpret_cast<const char*>(strokeBytes.constData()), strokeBytes.size());
+
+            KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+            dev->writeBytes(strokeBytes.constData(), strokeRect);
+
+            regionKeyStrokes << KeyStroke(dev, data.stroke.color, data.stroke.isTransparent);
+        }
+
+        region.cacheKey = hash.result();
+
+        if (resultsCache) {
+            QMutexLocker l(&resultsCache->lock);
+            KisPaintDeviceSP cachedDevice = resultsCache->results.value(region.cacheKey);
+
+            if (cachedDevice) {
+                region.dst = cachedDevice;
+                region.reused = true;
+                return;
+            }
+        }
+
+        KisPaintDeviceSP mask = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+        mask->writeBytes(maskBytes.constData(), rc);
+
+        region.dst = new KisPaintDevice(dstColorSpace);
+        runOnRegion(src, region.dst, mask, rc, regionKeyStrokes);
+    }
+
+    inline int pixelIndex(int x, int y) const {
+        return (y - boundingRect.y()) * boundingRect.width() + x - boundingRect.x();
+    }
+
+    KisPaintDeviceSP src;
+    const KoColorSpace *dstColorSpace;
+    QRect boundingRect;
+    const QVector<quint8> &srcBytes;
+    const QVector<int> &labels;
+    const QVector<KeyStrokeData> &strokes;
+    KisMultiwayCut::ResultsCacheSP resultsCache;
+};
+
+}
+
+void KisMultiwayCut::run()
+{
+    const QRect &rc = m_d->boundingRect;
+
+    m_d->numRegions = 0;
+    m_d->numReusedRegions = 0;
+
+    if (rc.isEmpty() || m_d->keyStrokes.isEmpty()) return;
+
+    if (qint64(rc.width()) * rc.height() > maxSplitArea) {
+        if (m_d->resultsCache) {
+            QMutexLocker l(&m_d->resultsCache->lock);
+            m_d->resultsCache->results.clear();
+        }
+
+        KisPaintDeviceSP mask = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+        runOnRegion(m_d->src, m_d->dst, mask, rc, m_d->keyStrokes);
+
+        m_d->numRegions = 1;
+        return;
+    }
+
+    QVector<quint8> srcBytes(rc.width() * rc.height());
+    m_d->src->readBytes(srcBytes.data(), rc);
+
+    QVector<KeyStrokeData> strokes;
+
+    Q_FOREACH (const KeyStroke &stroke, m_d->keyStrokes) {
+        KIS_ASSERT_RECOVER(stroke.dev->pixelSize() == 1) { continue; }
+
+        KeyStrokeData data;
+        data.stroke = stroke;
+        data.rect = stroke.dev->exactBounds() & rc;
+
+        // if current scribble is empty, it just has no effect
+        if (data.rect.isEmpty()) continue;
+
+        data.bytes.resize(data.rect.width() * data.rect.height());
+        stroke.dev->readBytes(data.bytes.data(), data.rect);
+
+        strokes << data;
+    }
+
+    QVector<int> labels;
+    const int numRegions = calculateRegions(srcBytes, strokes, rc, &labels);
+    if (!numRegions) return;
+
+    QVector<Region> regions(numRegions);
+    for (int i = 0; i < numRegions; i++) {
+        regions[i].label = i + 1;
+    }
+
+    {
+        QVector<QPoint> topLeft(numRegions, QPoint(rc.right(), rc.bottom()));
+        QVector<QPoint> bottomRight(numRegions, rc.topLeft());
+
+        for (int y = 0; y < rc.height(); y++) {
+            const int *labelPtr = labels.constData() + y * rc.width();
+
+            for (int x = 0; x < rc.width(); x++) {
+                const int index = labelPtr[x] - 1;
+
+                QPoint &tl = topLeft[index];
+                QPoint &br = bottomRight[index];
+
+                tl.rx() = qMin(tl.x(), rc.x() + x);
+                tl.ry() = qMin(tl.y(), rc.y() + y);
+                br.rx() = qMax(br.x(), rc.x() + x);
+                br.ry() = qMax(br.y(), rc.y() + y);
+            }
+        }
+
+        for (int i = 0; i < numRegions; i++) {
+            regions[i].rect = QRect(topLeft[i], bottomRight[i]);
+        }
+    }
+
+    for (int i = 0; i < strokes.size(); i++) {
+        const KeyStrokeData &stroke = strokes[i];
+
+        for (int y = stroke.rect.top(); y <= stroke.rect.bottom(); y++) {
+            for (int x = stroke.rect.left(); x <= stroke.rect.right(); x++) {
+                if (!stroke.value(x, y)) continue;
+
+                Region &region = regions[labels[(y - rc.y()) * rc.width() + x - rc.x()] - 1];
+                if (region.keyStrokes.isEmpty() || region.keyStrokes.last() != i) {
+                    region.keyStrokes << i;
+                }
+            }
+        }
+    }
+
+    RegionSolver solver(m_d->src, m_d->dst->colorSpace(), rc,
+                        srcBytes, labels, strokes, m_d->resultsCache);
+
+    /**
+     * The cut is run by the colorize stroke inside an updater job, and
+     * the updater context is not reachable from here. The calling
+     * thread waits for the regions and solves some of them itself, so
+     * the global pool is used, the same way KisAutoBrush does for dabs.
+     */
+    QtConcurrent::blockingMap(regions, solver);
+
+    const int pixelSize = m_d->dst->pixelSize();
+    const KoColorSpace *dstCs = m_d->dst->colorSpace();
+
+    for (int i = 0; i < regions.size(); i++) {
+        const Region &region = regions[i];
+        const QRect copyRect = region.dst->exactBounds() & region.rect;
+        if (copyRect.isEmpty()) continue;
+
+        KisSequentialConstIterator srcIt(region.dst, copyRect);
+        KisSequentialIterator dstIt(m_d->dst, copyRect);
+
+        do {
+            const int label = labels[(srcIt.y() - rc.y()) * rc.width() + srcIt.x() - rc.x()];
+
+            if (label == region.label && dstCs->opacityU8(srcIt.rawDataConst()) > 0) {
+                memcpy(dstIt.rawData(), srcIt.rawDataConst(), pixelSize);
+            }
+        } while (srcIt.nextPixel() && dstIt.nextPixel());
+    }
+
+    if (m_d->resultsCache) {
+        QMutexLocker l(&m_d->resultsCache->lock);
+
+        /**
+         * Keep only the results of the current cut. The results of
+         * the older cuts are not likely to be needed again.
+         */
+        m_d->resultsCache->results.clear();
+
+        Q_FOREACH (const Region &region, regions) {
+            m_d->resultsCache->results.insert(region.cacheKey, region.dst);
+        }
+    }
+
+    m_d->numRegions = regions.size();
+    m_d->numReusedRegions =
+        std::count_if(regions.begin(), regions.end(),
+                      [] (const Region &region) { return region.reused; });
+}
+
 KisPaintDeviceSP KisMultiwayCut::srcDevice() const
 {
     return m_d->src;
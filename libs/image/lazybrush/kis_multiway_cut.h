@@ -20,14 +20,40 @@
 #define __KIS_MULTIWAY_CUT_H
 
 #include <QScopedPointer>
+#include <QSharedPointer>
 
 #include "kis_types.h"
 #include "kritaimage_export.h"
 
 class KoColor;
 
+/**
+ * Splits the image into the areas defined by the key strokes.
+ *
+ * Before running the max-flow solver the image is split into
+ * independent regions bounded by the line art. Every region gets all
+ * the key strokes lying inside it and is solved separately, in
+ * parallel with the other ones. The areas without any key strokes
+ * are merged with all the regions they touch, so the solver decides
+ * how to fill them, the same way as it would do for the whole image.
+ *
+ * Splitting needs about 5 bytes per pixel of the bounding rect, so
+ * rects bigger than 4096x4096 are solved as a single region.
+ */
 class KRITAIMAGE_EXPORT KisMultiwayCut
 {
+public:
+    struct ResultsCache;
+    typedef QSharedPointer<ResultsCache> ResultsCacheSP;
+
+    /**
+     * Creates a cache for the results of the regions. If the same
+     * cache is passed to the consequent cuts of the same image, the
+     * regions which have not changed since the previous cut (neither
+     * the source, nor the key strokes) are not solved again.
+     */
+    static ResultsCacheSP createResultsCache();
+
 public:
     KisMultiwayCut(KisPaintDeviceSP src,
                    KisPaintDeviceSP dst,
@@ -35,9 +61,21 @@ public:
     ~KisMultiwayCut();
 
     void addKeyStroke(KisPaintDeviceSP dev, const KoColor &color);
+    void setResultsCache(ResultsCacheSP cache);
 
     void run();
 
+    /**
+     * \return the number of independent regions found by the last run()
+     */
+    int numRegions() const;
+
+    /**
+     * \return the number of regions whose results were taken from the
+     *         cache during the last run()
+     */
+    int numReusedRegions() const;
+
     KisPaintDeviceSP srcDevice() const;
     KisPaintDeviceSP dstDevice() const;
 
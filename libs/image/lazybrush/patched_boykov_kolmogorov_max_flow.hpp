@@ -86,6 +86,12 @@ class bk_max_flow {
   typedef color_traits<tColorValue> tColorTraits;
   typedef typename property_traits<DistanceMap>::value_type tDistanceVal;
 
+  /**
+   * Krita: the timestamps are used for the distance heuristics only,
+   * so a 32-bit value is enough and saves 4 bytes per vertex.
+   */
+  typedef unsigned int tTimeVal;
+
     public:
       bk_max_flow(Graph& g,
                   EdgeCapacityMap cap,
@@ -718,10 +724,10 @@ class bk_max_flow {
       std::vector<bool> m_has_parent_vec;
       iterator_property_map<std::vector<bool>::iterator, IndexMap> m_has_parent_map;
 
-      std::vector<long> m_time_vec; //timestamp of each node, used for sink/source-path calculations
-      iterator_property_map<std::vector<long>::iterator, IndexMap> m_time_map;
+      std::vector<tTimeVal> m_time_vec; //timestamp of each node, used for sink/source-path calculations
+      iterator_property_map<typename std::vector<tTimeVal>::iterator, IndexMap> m_time_map;
       tEdgeVal m_flow;
-      long m_time;
+      tTimeVal m_time;
       vertex_descriptor m_last_grow_vertex;
       out_edge_iterator m_last_grow_edge_it;
       out_edge_iterator m_last_grow_edge_end;
@@ -32,6 +32,7 @@
 #include "kis_adjustment_layer.h"
 #include "kis_filter_mask.h"
 #include "kis_selection.h"
+#include "kis_group_projection_cache.h"
 
 #include "filter/kis_filter.h"
 #include "filter/kis_filter_configuration.h"
@@ -287,5 +288,80 @@ void KisAsyncMergerTest::testSubgraphingWithoutUpdatingParent()
     }
 }
 
+    /*
+      +--------------+
+      |root          |
+      | paint 4      |
+      | paint 3      |
+      | paint 2      |
+      | paint 1      |
+      +--------------+
+     */
+
+void KisAsyncMergerTest::testGroupProjectionCache()
+{
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 128, 128, colorSpace, "group cache test");
+
+    KisPaintDeviceSP device1 = new KisPaintDevice(colorSpace);
+    device1->fill(image->bounds(), KoColor(Qt::white, colorSpace));
+    KisLayerSP paintLayer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8, device1);
+
+    KisPaintDeviceSP device2 = new KisPaintDevice(colorSpace);
+    device2->fill(QRect(10, 10, 80, 80), KoColor(Qt::red, colorSpace));
+    KisLayerSP paintLayer2 = new KisPaintLayer(image, "paint2", 128, device2);
+
+    KisPaintDeviceSP device3 = new KisPaintDevice(colorSpace);
+    device3->fill(QRect(40, 40, 80, 80), KoColor(Qt::blue, colorSpace));
+    KisLayerSP paintLayer3 = new KisPaintLayer(image, "paint3", 200, device3);
+
+    KisPaintDeviceSP device4 = new KisPaintDevice(colorSpace);
+    device4->fill(QRect(20, 60, 40, 40), KoColor(Qt::green, colorSpace));
+    KisLayerSP paintLayer4 = new KisPaintLayer(image, "paint4", 100, device4);
+
+    image->addNode(paintLayer1, image->rootLayer());
+    image->addNode(paintLayer2, image->rootLayer());
+    image->addNode(paintLayer3, image->rootLayer());
+    image->addNode(paintLayer4, image->rootLayer());
+
+    image->initialRefreshGraph();
+
+    KisGroupProjectionCache *cache = image->rootLayer()->projectionCache();
+    QRect cropRect(image->bounds());
+
+    KisMergeWalker walker(cropRect);
+    KisAsyncMerger merger;
+
+    // the first merge fills the cache
+    walker.collectRects(paintLayer4, image->bounds());
+    merger.startMerge(walker);
+    QVERIFY(cache->keyNode().data() == paintLayer4.data());
+
+    // the second one takes the layers below paint4 from the cache
+    device4->fill(QRect(20, 60, 40, 40), KoColor(Qt::black, colorSpace));
+    walker.collectRects(paintLayer4, image->bounds());
+    merger.startMerge(walker);
+
+    QImage cachedResult = image->projection()->convertToQImage(0);
+    image->refreshGraph();
+    QCOMPARE(cachedResult, image->projection()->convertToQImage(0));
+
+    // fill the cache again and change a layer lying below the key node
+    walker.collectRects(paintLayer4, image->bounds());
+    merger.startMerge(walker);
+    QVERIFY(cache->keyNode().data() == paintLayer4.data());
+
+    device2->fill(QRect(10, 10, 80, 80), KoColor(Qt::yellow, colorSpace));
+    walker.collectRects(paintLayer2, image->bounds());
+    merger.startMerge(walker);
+
+    walker.collectRects(paintLayer4, image->bounds());
+    merger.startMerge(walker);
+
+    cachedResult = image->projection()->convertToQImage(0);
+    image->refreshGraph();
+    QCOMPARE(cachedResult, image->projection()->convertToQImage(0));
+}
+
 QTEST_MAIN(KisAsyncMergerTest)
 
@@ -31,6 +31,7 @@
 #include "kis_paint_device.h"
 #include "kis_convolution_painter.h"
 #include "kis_convolution_kernel.h"
+#include "kis_iterator_ng.h"
 #include <kis_gaussian_kernel.h>
 #include <kis_mask_generator.h>
 #include "testutil.h"
@@ -437,4 +438,88 @@ void KisConvolutionPainterTest::testGaussianDetailsFFTW()
     testGaussianDetails(true);
 }
 
+void KisConvolutionPainterTest::testGaussianRecursiveBase(KisPaintDeviceSP dev, const QString &prefix)
+{
+    const QRect applyRect = dev->exactBounds().adjusted(-20, -20, 20, 20);
+    const QBitArray channelFlags = dev->colorSpace()->channelFlags(true, true);
+
+    const qreal radii[] = {25.0, 60.0, 200.0, 500.0};
+    const int numRadii = sizeof(radii) / sizeof(radii[0]);
+
+    for (int i = 0; i < numRadii; i++) {
+        const qreal radius = radii[i];
+
+        KisPaintDeviceSP refDev = new KisPaintDevice(*dev);
+        KisGaussianKernel::applyGaussianConvolution(refDev, applyRect,
+                                                    radius, radius,
+                                                    channelFlags, 0);
+
+        KisPaintDeviceSP recursiveDev = new KisPaintDevice(*dev);
+        KisGaussianKernel::applyGaussianRecursive(recursiveDev, applyRect,
+                                                  radius, radius,
+                                                  channelFlags, 0);
+
+        QImage refImage = refDev->convertToQImage(0, applyRect);
+        QImage recursiveImage = recursiveDev->convertToQImage(0, applyRect);
+
+        /**
+         * The recursive filter is an approximation with an infinite
+         * support, so allow small deviations from the convolution
+         */
+        QPoint errpoint;
+        if (!TestUtil::compareQImages(errpoint, refImage, recursiveImage,
+                                      4, 4, applyRect.width() * applyRect.height() / 100)) {
+
+            refImage.save(QString("recursive_gaussian_%1_%2_ref.png").arg(prefix).arg(radius));
+            recursiveImage.save(QString("recursive_gaussian_%1_%2_result.png").arg(prefix).arg(radius));
+            QFAIL(QString("Recursive gaussian differs from the convolution, radius %1, first pixel at %2,%3")
+                  .arg(radius).arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+        }
+
+        /**
+         * The gain of the filter must be 1.0, that is a flat field
+         * must stay unchanged however big the radius is
+         */
+        KisPaintDeviceSP flatDev = new KisPaintDevice(dev->colorSpace());
+        const KoColor flatColor(QColor(200, 150, 100, 180), dev->colorSpace());
+        flatDev->fill(applyRect, flatColor);
+
+        KisGaussianKernel::applyGaussianRecursive(flatDev, applyRect,
+                                                  radius, radius,
+                                                  channelFlags, 0);
+
+        const int pixelSize = dev->pixelSize();
+        KisSequentialConstIterator it(flatDev, applyRect);
+        do {
+            for (int j = 0; j < pixelSize; j++) {
+                if (qAbs(int(it.rawDataConst()[j]) - int(flatColor.data()[j])) > 1) {
+                    QFAIL(QString("Recursive gaussian changes a flat field, radius %1, pixel %2,%3, byte %4: %5 instead of %6")
+                          .arg(radius).arg(it.x()).arg(it.y()).arg(j)
+                          .arg(it.rawDataConst()[j]).arg(flatColor.data()[j]).toLatin1());
+                }
+            }
+        } while (it.nextPixel());
+    }
+}
+
+void KisConvolutionPainterTest::testGaussianRecursive()
+{
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    testGaussianRecursiveBase(dev, "rgb8");
+}
+
+void KisConvolutionPainterTest::testGaussianRecursiveAlpha()
+{
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+
+    const quint8 opaque = OPACITY_OPAQUE_U8;
+    dev->fill(QRect(50, 50, 120, 80), KoColor(&opaque, dev->colorSpace()));
+    dev->fill(QRect(200, 100, 40, 150), KoColor(&opaque, dev->colorSpace()));
+
+    testGaussianRecursiveBase(dev, "alpha8");
+}
+
 QTEST_MAIN(KisConvolutionPainterTest)
@@ -35,6 +35,7 @@ private:
     void testGaussian(bool useFftw);
     void testGaussianSmall(bool useFftw);
     void testGaussianDetails(bool useFftw);
+    void testGaussianRecursiveBase(KisPaintDeviceSP dev, const QString &prefix);
 
 private Q_SLOTS:
 
@@ -56,6 +57,9 @@ private Q_SLOTS:
 
     void testGaussianDetailsSpatial();
     void testGaussianDetailsFFTW();
+
+    void testGaussianRecursive();
+    void testGaussianRecursiveAlpha();
 };
 
 #endif
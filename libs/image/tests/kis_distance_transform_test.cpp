@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_distance_transform_test.h"
+
+#include <QTest>
+
+#include "kis_distance_transform.h"
+#include "kis_pixel_selection.h"
+
+
+KisPixelSelectionSP createRandomSelection(const QRect &rect, int density)
+{
+    KisPixelSelectionSP selection = new KisPixelSelection();
+    QVector<quint8> pixels(rect.width() * rect.height());
+
+    qsrand(1);
+
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = qrand() % density ? qrand() % 128 : 128 + qrand() % 128;
+    }
+
+    selection->writeBytes(pixels.constData(), rect);
+    return selection;
+}
+
+QVector<quint32> referenceSquaredDistances(KisPixelSelectionSP selection,
+                                           const QRect &rect,
+                                           int maxDistance,
+                                           bool inverted)
+{
+    const QRect window = rect.adjusted(-maxDistance, -maxDistance, maxDistance, maxDistance);
+
+    QVector<quint8> pixels(window.width() * window.height());
+    selection->readBytes(pixels.data(), window);
+
+    QVector<quint32> result(rect.width() * rect.height(), KisDistanceTransform::infinity);
+
+    for (int y = 0; y < rect.height(); y++) {
+        for (int x = 0; x < rect.width(); x++) {
+            quint32 &value = result[y * rect.width() + x];
+
+            for (int j = -maxDistance; j <= maxDistance; j++) {
+                for (int i = -maxDistance; i <= maxDistance; i++) {
+                    const quint8 pixel =
+                        pixels[(y + j + maxDistance) * window.width() + x + i + maxDistance];
+
+                    const quint32 distance = i * i + j * j;
+
+                    if ((pixel > 127) != inverted &&
+                        distance <= quint32(maxDistance * maxDistance) &&
+                        (value == KisDistanceTransform::infinity || distance < value)) {
+
+                        value = distance;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void KisDistanceTransformTest::testSquaredDistances()
+{
+    KisPixelSelectionSP selection = createRandomSelection(QRect(-100, -100, 500, 400), 300);
+
+    const QRect rect(-20, 10, 300, 200);
+
+    for (int maxDistance = 0; maxDistance < 40; maxDistance += 7) {
+        QVector<quint32> result = KisDistanceTransform::squaredDistances(selection, rect, maxDistance);
+        QVector<quint32> expected = referenceSquaredDistances(selection, rect, maxDistance, false);
+
+        QVERIFY2(result == expected, QString("maxDistance: %1").arg(maxDistance).toLatin1());
+    }
+}
+
+void KisDistanceTransformTest::testInverted()
+{
+    KisPixelSelectionSP selection = createRandomSelection(QRect(-100, -100, 500, 400), 300);
+    selection->invert();
+
+    const QRect rect(-20, 10, 300, 200);
+    const int maxDistance = 30;
+
+    QVector<quint32> result = KisDistanceTransform::squaredDistances(selection, rect, maxDistance, true);
+    QVector<quint32> expected = referenceSquaredDistances(selection, rect, maxDistance, true);
+
+    QVERIFY(result == expected);
+}
+
+void KisDistanceTransformTest::testNoFeatures()
+{
+    KisPixelSelectionSP selection = new KisPixelSelection();
+
+    const QRect rect(0, 0, 100, 100);
+
+    QVector<quint32> result = KisDistanceTransform::squaredDistances(selection, rect, 10);
+    QCOMPARE(result, QVector<quint32>(rect.width() * rect.height(), KisDistanceTransform::infinity));
+
+    result = KisDistanceTransform::squaredDistances(selection, rect, 10, true);
+    QCOMPARE(result, QVector<quint32>(rect.width() * rect.height(), 0));
+}
+
+void KisDistanceTransformTest::benchmarkSquaredDistances()
+{
+    const QRect rect(0, 0, 4000, 3000);
+    KisPixelSelectionSP selection = createRandomSelection(rect, 10000);
+
+    QBENCHMARK_ONCE {
+        KisDistanceTransform::squaredDistances(selection, rect, 250);
+    }
+}
+
+QTEST_MAIN(KisDistanceTransformTest)
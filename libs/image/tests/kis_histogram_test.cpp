@@ -22,6 +22,8 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoHistogramProducer.h>
+#include <KoBasicHistogramProducers.h>
+#include <KoColor.h>
 #include "kis_paint_device.h"
 #include "kis_histogram.h"
 #include "kis_paint_layer.h"
@@ -45,5 +47,46 @@ void KisHistogramTest::testCreation()
     }
 }
 
+void KisHistogramTest::testU16Producer()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb16();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect opaqueRect(0, 0, 100, 50);
+    dev->fill(opaqueRect, KoColor(Qt::white, cs));
+
+    KoHistogramProducer *producer = new KoBasicU16HistogramProducer(KoID("RGB16HISTO", "RGB16"), cs);
+
+    // transparent pixels are skipped by default
+    KisHistogram histogram(dev, QRect(0, 0, 100, 100), producer, LINEAR);
+
+    const int numPixels = opaqueRect.width() * opaqueRect.height();
+    QCOMPARE(producer->count(), numPixels);
+
+    for (int i = 0; i < producer->channels().size(); i++) {
+        QCOMPARE(producer->getBinAt(i, 255), numPixels);
+        QCOMPARE(producer->getBinAt(i, 0), 0);
+    }
+}
+
+void KisHistogramTest::benchmarkRgba16Histogram()
+{
+    /**
+     * A 16k-wide RGBA16 device. Full 16k x 16k doesn't fit into
+     * the memory of a usual test machine, so we use a band of it.
+     */
+    const QRect rc(0, 0, 16384, 2048);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb16();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rc, KoColor(QColor(200, 100, 50), cs));
+
+    KoHistogramProducer *producer = new KoBasicU16HistogramProducer(KoID("RGB16HISTO", "RGB16"), cs);
+    KisHistogram histogram(dev, rc, producer, LINEAR);
+
+    QBENCHMARK {
+        histogram.updateHistogram();
+    }
+}
 
 QTEST_MAIN(KisHistogramTest)
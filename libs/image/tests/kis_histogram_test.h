@@ -27,6 +27,9 @@ class KisHistogramTest : public QObject
 private Q_SLOTS:
 
     void testCreation();
+    void testU16Producer();
+
+    void benchmarkRgba16Histogram();
 
 };
 
@@ -275,6 +275,44 @@ void KisImageTest::testLayerComposition()
     QVERIFY(!layer2->visible());
 }
 
+void KisImageTest::testCloneImage()
+{
+    KisImageSP image = new KisImage(0, IMAGE_WIDTH, IMAGE_WIDTH, 0, "layer tests");
+    image->setResolution(2.0, 3.0);
+
+    KisLayerSP layer = new KisPaintLayer(image, "layer 1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+    KisLayerSP layer2 = new KisPaintLayer(image, "layer 2", OPACITY_OPAQUE_U8);
+    image->addNode(layer2);
+
+    layer->paintDevice()->fill(QRect(10, 10, 100, 100), KoColor(Qt::red, image->colorSpace()));
+
+    KisLayerCompositionSP comp(new KisLayerComposition(image, "comp 1"));
+    comp->store();
+    image->addComposition(comp);
+
+    KisImageSP clone = image->clone(true);
+
+    QCOMPARE(clone->xRes(), 2.0);
+    QCOMPARE(clone->yRes(), 3.0);
+    QCOMPARE(clone->compositions().size(), 1);
+    QCOMPARE(int(clone->root()->childCount()), 2);
+
+    KisNodeSP newLayer = clone->root()->firstChild();
+    QVERIFY(newLayer != layer);
+    QCOMPARE(newLayer->uuid(), layer->uuid());
+    QCOMPARE(newLayer->name(), layer->name());
+    QCOMPARE(clone->root()->lastChild()->uuid(), layer2->uuid());
+    QCOMPARE(newLayer->paintDevice()->exactBounds(), QRect(10, 10, 100, 100));
+
+    // the clone doesn't depend on the original
+    layer->paintDevice()->clear();
+    QCOMPARE(newLayer->paintDevice()->exactBounds(), QRect(10, 10, 100, 100));
+
+    KisImageSP nonExactClone = image->clone();
+    QVERIFY(nonExactClone->root()->firstChild()->uuid() != layer->uuid());
+}
+
 #include "testutil.h"
 #include "kis_group_layer.h"
 #include "kis_transparency_mask.h"
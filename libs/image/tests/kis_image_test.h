@@ -34,6 +34,7 @@ private Q_SLOTS:
     void testConvertImageColorSpace();
     void testGlobalSelection();
     void testLayerComposition();
+    void testCloneImage();
 
     void testFlattenLayer();
     void testMergeDown();
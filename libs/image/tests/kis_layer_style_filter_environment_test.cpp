@@ -20,6 +20,8 @@
 
 #include "layerstyles/kis_layer_style_filter_environment.h"
 #include "kis_pixel_selection.h"
+#include "kis_painter.h"
+#include <KoColor.h>
 #include "testutil.h"
 
 
@@ -58,4 +60,41 @@ void KisLayerStyleFilterEnvironmentTest::benchmarkRandomSelectionGeneration()
     }
 }
 
+void KisLayerStyleFilterEnvironmentTest::testSpreadAndBlurredAlphaCaching()
+{
+    TestUtil::MaskParent p;
+    KisPaintDeviceSP dev = p.layer->paintDevice();
+    const KoColorSpace *cs = dev->colorSpace();
+
+    {
+        KisPainter gc(dev);
+        gc.setPaintColor(KoColor(Qt::red, cs));
+        gc.setFillStyle(KisPainter::FillStyleForegroundColor);
+        gc.paintEllipse(QRect(100, 100, 300, 300));
+    }
+
+    KisLayerStyleFilterEnvironment env(p.layer.data());
+
+    const QRect applyRect(50, 50, 400, 400);
+
+    for (int i = 0; i < 2; i++) {
+        const bool invert = i > 0;
+
+        env.cachedSpreadAndBlurredAlpha(dev, applyRect, invert, true, 5, 10);
+
+        // change a part of the layer, the cache must notice that
+        dev->fill(QRect(200 + 20 * i, 100, 30, 30), KoColor(Qt::blue, cs));
+
+        KisSelectionSP cached =
+            env.cachedSpreadAndBlurredAlpha(dev, applyRect, invert, true, 5, 10);
+
+        KisLayerStyleFilterEnvironment freshEnv(p.layer.data());
+        KisSelectionSP reference =
+            freshEnv.cachedSpreadAndBlurredAlpha(dev, applyRect, invert, true, 5, 10);
+
+        QCOMPARE(cached->pixelSelection()->convertToQImage(0, applyRect),
+                 reference->pixelSelection()->convertToQImage(0, applyRect));
+    }
+}
+
 QTEST_MAIN(KisLayerStyleFilterEnvironmentTest)
@@ -27,6 +27,7 @@ class KisLayerStyleFilterEnvironmentTest : public QObject
 private Q_SLOTS:
     void testRandomSelectionCaching();
     void benchmarkRandomSelectionGeneration();
+    void testSpreadAndBlurredAlphaCaching();
 };
 
 #endif /* __KIS_LAYER_STYLE_FILTER_ENVIRONMENT_TEST_H */
@@ -20,6 +20,9 @@
 
 #include <QTest>
 
+#include <cmath>
+#include <limits>
+
 #include "testutil.h"
 
 #include <KoColor.h>
@@ -36,10 +39,59 @@
 #include "kis_pixel_selection.h"
 
 #include "layerstyles/kis_layer_style_projection_plane.h"
+#include "layerstyles/kis_layer_style_filter_environment.h"
+#include "layerstyles/kis_multiple_projection.h"
+#include "layerstyles/kis_ls_stroke_filter.h"
+#include "layerstyles/kis_ls_bevel_emboss_filter.h"
 #include "kis_psd_layer_style.h"
 #include "kis_paint_device_debug_utils.h"
 
 
+/**
+ * An L-shaped selection with hard edges: it has straight edges, convex
+ * and concave corners
+ */
+KisPixelSelectionSP createLShapeSelection()
+{
+    KisPixelSelectionSP selection = new KisPixelSelection();
+    selection->select(QRect(20, 20, 30, 16), OPACITY_OPAQUE_U8);
+    selection->select(QRect(20, 20, 14, 40), OPACITY_OPAQUE_U8);
+    return selection;
+}
+
+/**
+ * Brute-force squared distances from every pixel of \p rect to the
+ * closest selected (or unselected, if \p inverted) pixel of \p
+ * selection. Only the pixels of \p window are checked.
+ */
+QVector<quint32> bruteForceSquaredDistances(KisPixelSelectionSP selection,
+                                            const QRect &rect,
+                                            const QRect &window,
+                                            bool inverted)
+{
+    QVector<quint8> pixels(window.width() * window.height());
+    selection->readBytes(pixels.data(), window);
+
+    QVector<quint32> result(rect.width() * rect.height(), std::numeric_limits<quint32>::max());
+
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        for (int x = rect.left(); x <= rect.right(); x++) {
+            quint32 &value = result[(y - rect.y()) * rect.width() + x - rect.x()];
+
+            for (int j = window.top(); j <= window.bottom(); j++) {
+                for (int i = window.left(); i <= window.right(); i++) {
+                    const quint8 pixel = pixels[(j - window.y()) * window.width() + i - window.x()];
+                    if ((pixel > 127) == inverted) continue;
+
+                    value = qMin(value, quint32((i - x) * (i - x) + (j - y) * (j - y)));
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
 void KisLayerStyleProjectionPlaneTest::test(KisPSDLayerStyleSP style, const QString testName)
 {
     const QRect imageRect(0, 0, 200, 200);
@@ -162,6 +214,11 @@ void KisLayerStyleProjectionPlaneTest::test(KisPSDLayerStyleSP style, const QStr
 
         KIS_DUMP_DEVICE_2(projection, imageRect, "10P_apply_half2", testName);
     }
+
+    QVERIFY(TestUtil::checkQImageExternal(projection->convertToQImage(0, imageRect),
+                                          "layer_style_projection_plane",
+                                          testName,
+                                          "final", 1, 1, 0));
 }
 
 void KisLayerStyleProjectionPlaneTest::testShadow()
@@ -392,6 +449,117 @@ void KisLayerStyleProjectionPlaneTest::testStroke()
 
 }
 
+void KisLayerStyleProjectionPlaneTest::testStrokeCoverage()
+{
+    const QRect applyRect(10, 10, 50, 60);
+    const QRect window = kisGrowRect(applyRect, 6);
+
+    KisPixelSelectionSP shape = createLShapeSelection();
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 100, 100, cs, "stroke coverage test");
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    // the same shape as createLShapeSelection()
+    layer->paintDevice()->fill(QRect(20, 20, 30, 16), KoColor(Qt::red, cs));
+    layer->paintDevice()->fill(QRect(20, 20, 14, 40), KoColor(Qt::red, cs));
+
+    const QVector<quint32> outsideDistances =
+        bruteForceSquaredDistances(shape, applyRect, window, false);
+    const QVector<quint32> insideDistances =
+        bruteForceSquaredDistances(shape, applyRect, window, true);
+
+    QVector<quint8> shapePixels(applyRect.width() * applyRect.height());
+    shape->readBytes(shapePixels.data(), applyRect);
+
+    KisPSDLayerStyleSP style(new KisPSDLayerStyle());
+    style->stroke()->setColor(Qt::blue);
+    style->stroke()->setOpacity(100);
+    style->stroke()->setEffectEnabled(true);
+    style->stroke()->setBlendMode(COMPOSITE_OVER);
+    style->stroke()->setSize(3);
+
+    QList<psd_stroke_position> positions;
+    positions << psd_stroke_outside << psd_stroke_inside << psd_stroke_center;
+
+    Q_FOREACH (psd_stroke_position position, positions) {
+        style->stroke()->setPosition(position);
+
+        const qreal strokeWidth = position == psd_stroke_center ? 1.5 : 3.0;
+
+        KisLsStrokeFilter filter;
+        KisLayerStyleFilterEnvironment env(layer.data());
+        KisMultipleProjection projection;
+
+        filter.processDirectly(layer->paintDevice(), &projection, applyRect, style, &env);
+
+        KisPaintDeviceSP result = new KisPaintDevice(cs);
+        projection.apply(result, applyRect);
+
+        QVector<quint8> resultPixels(applyRect.width() * applyRect.height() * cs->pixelSize());
+        result->readBytes(resultPixels.data(), applyRect);
+
+        for (int i = 0; i < shapePixels.size(); i++) {
+            const bool selected = shapePixels[i] > 127;
+            const quint32 distance = selected ? insideDistances[i] : outsideDistances[i];
+
+            qreal coverage = qBound(0.0, strokeWidth + 1.0 - std::sqrt(qreal(distance)), 1.0);
+
+            if ((position == psd_stroke_outside && selected) ||
+                (position == psd_stroke_inside && !selected)) {
+
+                coverage = 0.0;
+            }
+
+            const int expected = qRound(255.0 * coverage);
+            const int actual = cs->opacityU8(resultPixels.constData() + i * cs->pixelSize());
+
+            if (qAbs(expected - actual) > 1) {
+                const QPoint pt(applyRect.x() + i % applyRect.width(),
+                                applyRect.y() + i / applyRect.width());
+
+                qWarning() << "Wrong stroke coverage" << ppVar(position) << ppVar(pt)
+                           << ppVar(distance) << ppVar(expected) << ppVar(actual);
+                QFAIL("stroke coverage doesn't match the distances to the edge");
+            }
+        }
+    }
+
+    /**
+     * Check a few values at the known distances from the left edge
+     * (x = 20) of the shape for the outside stroke of size 3
+     */
+    style->stroke()->setPosition(psd_stroke_outside);
+
+    KisLsStrokeFilter filter;
+    KisLayerStyleFilterEnvironment env(layer.data());
+    KisMultipleProjection projection;
+    filter.processDirectly(layer->paintDevice(), &projection, applyRect, style, &env);
+
+    KisPaintDeviceSP result = new KisPaintDevice(cs);
+    projection.apply(result, applyRect);
+
+    KoColor c;
+
+    result->pixel(QPoint(19, 30), &c);
+    QCOMPARE(c.opacityU8(), OPACITY_OPAQUE_U8);
+
+    result->pixel(QPoint(17, 30), &c);
+    QCOMPARE(c.opacityU8(), OPACITY_OPAQUE_U8);
+
+    result->pixel(QPoint(16, 30), &c);
+    QCOMPARE(c.opacityU8(), OPACITY_TRANSPARENT_U8);
+
+    // sqrt(3^2 + 2^2) = 3.61 from the corner, so 0.39 coverage
+    result->pixel(QPoint(17, 18), &c);
+    QVERIFY(qAbs(int(c.opacityU8()) - 100) <= 1);
+
+    result->pixel(QPoint(25, 30), &c);
+    QCOMPARE(c.opacityU8(), OPACITY_TRANSPARENT_U8);
+}
+
 #include "layerstyles/gimp_bump_map.h"
 
 void KisLayerStyleProjectionPlaneTest::testBumpmap()
@@ -496,4 +664,145 @@ void KisLayerStyleProjectionPlaneTest::testBevel()
     style->bevelAndEmboss()->setSoften(3);
     test(style, "bevel_pillow_up_soft");
 }
+void KisLayerStyleProjectionPlaneTest::testBevelSelection()
+{
+    const QRect applyRect(10, 10, 50, 60);
+    const QRect window = kisGrowRect(applyRect, 8);
+
+    KisPixelSelectionSP shape = createLShapeSelection();
+
+    const QVector<quint32> outsideDistances =
+        bruteForceSquaredDistances(shape, applyRect, window, false);
+    const QVector<quint32> insideDistances =
+        bruteForceSquaredDistances(shape, applyRect, window, true);
+
+    QVector<quint8> shapePixels(applyRect.width() * applyRect.height());
+    shape->readBytes(shapePixels.data(), applyRect);
+
+    struct BevelParams {
+        int size;
+        int initialSize;
+        bool invert;
+    };
+
+    // outer bevel, inner bevel, emboss and both passes of the pillow emboss
+    const BevelParams params[] = {
+        {5, 5, false},
+        {5, 0, false},
+        {5, 3, false},
+        {3, 3, false},
+        {2, 0, true}
+    };
+
+    for (const BevelParams &p : params) {
+        KisPixelSelectionSP bevel = new KisPixelSelection();
+        KisLsBevelEmbossFilter::paintBevelSelection(shape, bevel, applyRect,
+                                                    p.size, p.initialSize, p.invert);
+
+        QVector<quint8> bevelPixels(applyRect.width() * applyRect.height());
+        bevel->readBytes(bevelPixels.data(), applyRect);
+
+        for (int i = 0; i < shapePixels.size(); i++) {
+            const bool selected = shapePixels[i] > 127;
+
+            /**
+             * Step s is the shape grown by k = initialSize - s - 1
+             * pixels. Growing covers the outside pixels not farther
+             * than k from the shape, shrinking by -k covers the inside
+             * pixels farther than -k from the outside.
+             */
+            quint8 expected = 0;
+
+            for (int step = 0; step < p.size; step++) {
+                const int k = p.initialSize - step - 1;
+
+                const bool covered = selected ?
+                    k >= 0 || insideDistances[i] > quint32(k * k) :
+                    k > 0 && outsideDistances[i] <= quint32(k * k);
+
+                if (covered) {
+                    expected = p.invert ?
+                        qRound(qreal(p.size - step - 1) / p.size * 255.0) :
+                        qRound(qreal(step + 1) / p.size * 255.0);
+                }
+            }
+
+            if (bevelPixels[i] != expected) {
+                const QPoint pt(applyRect.x() + i % applyRect.width(),
+                                applyRect.y() + i / applyRect.width());
+
+                qWarning() << "Wrong bevel step" << ppVar(p.size) << ppVar(p.initialSize)
+                           << ppVar(pt) << ppVar(expected) << ppVar(bevelPixels[i]);
+                QFAIL("bevel steps don't match the grown selections");
+            }
+        }
+    }
+}
+
+void KisLayerStyleProjectionPlaneTest::benchmarkStylesImpl(bool changeAlpha)
+{
+    KisPSDLayerStyleSP style(new KisPSDLayerStyle());
+
+    style->dropShadow()->setSize(15);
+    style->dropShadow()->setDistance(15);
+    style->dropShadow()->setEffectEnabled(true);
+
+    style->innerShadow()->setSize(10);
+    style->innerShadow()->setSpread(10);
+    style->innerShadow()->setDistance(5);
+    style->innerShadow()->setEffectEnabled(true);
+
+    style->outerGlow()->setSize(15);
+    style->outerGlow()->setSpread(10);
+    style->outerGlow()->setEffectEnabled(true);
+
+    style->innerGlow()->setSize(15);
+    style->innerGlow()->setEffectEnabled(true);
+
+    style->satin()->setSize(15);
+    style->satin()->setEffectEnabled(true);
+
+    const QRect imageRect(0, 0, 2000, 2000);
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "styles benchmark");
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    layer->paintDevice()->fill(QRect(100, 100, 1800, 1800), KoColor(Qt::red, cs));
+
+    KisLayerStyleProjectionPlane plane(layer.data(), style);
+    plane.recalculate(imageRect, layer);
+
+    KisPainter gc(layer->paintDevice());
+    gc.setPaintColor(KoColor(Qt::blue, cs));
+    gc.setFillStyle(KisPainter::FillStyleForegroundColor);
+
+    if (changeAlpha) {
+        gc.setCompositeOp(COMPOSITE_ERASE);
+    }
+
+    /**
+     * Emulate a stroke: every dab is followed by an update of the
+     * styles in the area around it
+     */
+    QBENCHMARK {
+        for (int i = 0; i < 50; i++) {
+            const QRect dabRect(200 + i * 30, 1000 + (i % 5) * 10, 40, 40);
+            gc.paintEllipse(dabRect);
+            plane.recalculate(plane.changeRect(dabRect, KisLayer::N_FILTHY), layer);
+        }
+    }
+}
+
+void KisLayerStyleProjectionPlaneTest::benchmarkStylesWhilePainting()
+{
+    benchmarkStylesImpl(false);
+}
+
+void KisLayerStyleProjectionPlaneTest::benchmarkStylesWhileErasing()
+{
+    benchmarkStylesImpl(true);
+}
+
 QTEST_MAIN(KisLayerStyleProjectionPlaneTest)
@@ -41,13 +41,19 @@ private Q_SLOTS:
     void testPatternOverlay();
 
     void testStroke();
+    void testStrokeCoverage();
 
     void testBumpmap();
 
     void testBevel();
+    void testBevelSelection();
+
+    void benchmarkStylesWhilePainting();
+    void benchmarkStylesWhileErasing();
 
 private:
     void test(KisPSDLayerStyleSP style, const QString testName);
+    void benchmarkStylesImpl(bool changeAlpha);
 };
 
 #endif /* __KIS_LAYER_STYLE_PROJECTION_PLANE_TEST_H */
@@ -1398,6 +1398,375 @@ void KisLazyBrushTest::multiwayCutBenchmark()
     // KIS_DUMP_DEVICE_2(filteredMainDev, mainRect, "2filtered", "dd");
 }
 
+/**
+ * Draws a grid of closed boxes with two key strokes in every box and
+ * a transparent (background) stroke outside them
+ */
+void prepareBoxesScene(int numBoxes,
+                       KisPaintDeviceSP *filteredMainDev,
+                       QVector<KisPaintDeviceSP> *strokes,
+                       QRect *mainRect)
+{
+    const KoColorSpace *alphaCs = KoColorSpaceRegistry::instance()->alpha8();
+    const KoColorSpace *rgbCs = KoColorSpaceRegistry::instance()->rgb8();
+
+    const KoColor lineColor(Qt::black, rgbCs);
+    const KoColor strokeColor(Qt::black, alphaCs);
+
+    const int boxSize = 200;
+    const int spacing = 40;
+    const int lineWidth = 6;
+
+    *mainRect = QRect(0, 0,
+                      numBoxes * (boxSize + spacing) + spacing,
+                      numBoxes * (boxSize + spacing) + spacing);
+
+    KisPaintDeviceSP mainDev = new KisPaintDevice(rgbCs);
+    KisFillPainter gc(mainDev);
+
+    KisPaintDeviceSP backgroundStroke = new KisPaintDevice(alphaCs);
+    backgroundStroke->fill(QRect(0, 0, mainRect->width(), spacing / 2), strokeColor);
+    *strokes << backgroundStroke;
+
+    for (int row = 0; row < numBoxes; row++) {
+        for (int col = 0; col < numBoxes; col++) {
+            const QRect box(spacing + col * (boxSize + spacing),
+                            spacing + row * (boxSize + spacing),
+                            boxSize, boxSize);
+
+            gc.fillRect(QRect(box.left(), box.top(), box.width(), lineWidth), lineColor);
+            gc.fillRect(QRect(box.left(), box.bottom() - lineWidth + 1, box.width(), lineWidth), lineColor);
+            gc.fillRect(QRect(box.left(), box.top(), lineWidth, box.height()), lineColor);
+            gc.fillRect(QRect(box.right() - lineWidth + 1, box.top(), lineWidth, box.height()), lineColor);
+
+            // an open partition inside the box
+            gc.fillRect(QRect(box.center().x(), box.top(), lineWidth, box.height() * 2 / 3), lineColor);
+
+            KisPaintDeviceSP leftStroke = new KisPaintDevice(alphaCs);
+            leftStroke->fill(QRect(box.left() + 30, box.top() + 30, 20, 20), strokeColor);
+            *strokes << leftStroke;
+
+            KisPaintDeviceSP rightStroke = new KisPaintDevice(alphaCs);
+            rightStroke->fill(QRect(box.right() - 50, box.top() + 30, 20, 20), strokeColor);
+            *strokes << rightStroke;
+        }
+    }
+
+    *filteredMainDev = KisPainter::convertToAlphaAsAlpha(mainDev);
+    KisLazyFillTools::normalizeAndInvertAlpha8Device(*filteredMainDev, *mainRect);
+}
+
+KoColor boxesStrokeColor(int index)
+{
+    const KoColorSpace *rgbCs = KoColorSpaceRegistry::instance()->rgb8();
+    return !index ?
+        KoColor(Qt::transparent, rgbCs) :
+        KoColor(index % 2 ? Qt::red : Qt::green, rgbCs);
+}
+
+void KisLazyBrushTest::testMultiwayCutRegions()
+{
+    KisPaintDeviceSP filteredMainDev;
+    QVector<KisPaintDeviceSP> strokes;
+    QRect mainRect;
+
+    const int numBoxes = 2;
+    prepareBoxesScene(numBoxes, &filteredMainDev, &strokes, &mainRect);
+
+    KisMultiwayCut::ResultsCacheSP cache = KisMultiwayCut::createResultsCache();
+
+    KisPaintDeviceSP firstResult = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    {
+        KisMultiwayCut cut(filteredMainDev, firstResult, mainRect);
+        cut.setResultsCache(cache);
+
+        for (int i = 0; i < strokes.size(); i++) {
+            cut.addKeyStroke(new KisPaintDevice(*strokes[i]), boxesStrokeColor(i));
+        }
+
+        cut.run();
+
+        // the background and the boxes
+        QCOMPARE(cut.numRegions(), numBoxes * numBoxes + 1);
+        QCOMPARE(cut.numReusedRegions(), 0);
+    }
+
+    {
+        KoColor c;
+        firstResult->pixel(QPoint(80, 80), &c);
+        QCOMPARE(c, boxesStrokeColor(1));
+
+        firstResult->pixel(QPoint(200, 80), &c);
+        QCOMPARE(c, boxesStrokeColor(2));
+    }
+
+    // move the right stroke in the last box
+    strokes.last()->moveTo(QPoint(0, 100));
+
+    KisPaintDeviceSP secondResult = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    {
+        KisMultiwayCut cut(filteredMainDev, secondResult, mainRect);
+        cut.setResultsCache(cache);
+
+        for (int i = 0; i < strokes.size(); i++) {
+            cut.addKeyStroke(new KisPaintDevice(*strokes[i]), boxesStrokeColor(i));
+        }
+
+        cut.run();
+
+        QCOMPARE(cut.numRegions(), numBoxes * numBoxes + 1);
+        QCOMPARE(cut.numReusedRegions(), numBoxes * numBoxes);
+    }
+
+    // the unchanged boxes should have exactly the same coloring
+    const QRect firstBox(0, 0, mainRect.width() / 2, mainRect.height() / 2);
+
+    QImage firstImage = firstResult->convertToQImage(0, firstBox);
+    QImage secondImage = secondResult->convertToQImage(0, firstBox);
+    QCOMPARE(firstImage, secondImage);
+}
+
+void KisLazyBrushTest::multiwayCutRegionsBenchmark()
+{
+    KisPaintDeviceSP filteredMainDev;
+    QVector<KisPaintDeviceSP> strokes;
+    QRect mainRect;
+
+    prepareBoxesScene(8, &filteredMainDev, &strokes, &mainRect);
+
+    KisPaintDeviceSP resultColoring = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    KisMultiwayCut cut(filteredMainDev, resultColoring, mainRect);
+
+    for (int i = 0; i < strokes.size(); i++) {
+        cut.addKeyStroke(strokes[i], boxesStrokeColor(i));
+    }
+
+    QBENCHMARK_ONCE {
+        cut.run();
+    }
+}
+
+void KisLazyBrushTest::multiwayCutRegionsReuseBenchmark()
+{
+    KisPaintDeviceSP filteredMainDev;
+    QVector<KisPaintDeviceSP> strokes;
+    QRect mainRect;
+
+    prepareBoxesScene(8, &filteredMainDev, &strokes, &mainRect);
+
+    KisMultiwayCut::ResultsCacheSP cache = KisMultiwayCut::createResultsCache();
+
+    {
+        KisPaintDeviceSP resultColoring = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+        KisMultiwayCut cut(filteredMainDev, resultColoring, mainRect);
+        cut.setResultsCache(cache);
+
+        for (int i = 0; i < strokes.size(); i++) {
+            cut.addKeyStroke(new KisPaintDevice(*strokes[i]), boxesStrokeColor(i));
+        }
+
+        cut.run();
+    }
+
+    // edit a single key stroke
+    strokes.last()->moveTo(QPoint(0, 100));
+
+    KisPaintDeviceSP resultColoring = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    KisMultiwayCut cut(filteredMainDev, resultColoring, mainRect);
+    cut.setResultsCache(cache);
+
+    for (int i = 0; i < strokes.size(); i++) {
+        cut.addKeyStroke(new KisPaintDevice(*strokes[i]), boxesStrokeColor(i));
+    }
+
+    QBENCHMARK_ONCE {
+        cut.run();
+    }
+
+    QCOMPARE(cut.numReusedRegions(), cut.numRegions() - 1);
+}
+
+void KisLazyBrushTest::testMultiwayCutUnstrokedRegions()
+{
+    const KoColorSpace *alphaCs = KoColorSpaceRegistry::instance()->alpha8();
+    const KoColorSpace *rgbCs = KoColorSpaceRegistry::instance()->rgb8();
+
+    const KoColor lineColor(Qt::black, rgbCs);
+    const KoColor strokeColor(Qt::black, alphaCs);
+
+    const int lineWidth = 6;
+    const QRect mainRect(0, 0, 700, 200);
+
+    KisPaintDeviceSP mainDev = new KisPaintDevice(rgbCs);
+    KisFillPainter gc(mainDev);
+
+    auto drawBox = [&] (const QRect &box) {
+        gc.fillRect(QRect(box.left(), box.top(), box.width(), lineWidth), lineColor);
+        gc.fillRect(QRect(box.left(), box.bottom() - lineWidth + 1, box.width(), lineWidth), lineColor);
+        gc.fillRect(QRect(box.left(), box.top(), lineWidth, box.height()), lineColor);
+        gc.fillRect(QRect(box.right() - lineWidth + 1, box.top(), lineWidth, box.height()), lineColor);
+    };
+
+    // a box split into three parts, the middle one has no key strokes
+    drawBox(QRect(20, 20, 360, 160));
+    gc.fillRect(QRect(140, 20, lineWidth, 160), lineColor);
+    gc.fillRect(QRect(260, 20, lineWidth, 160), lineColor);
+
+    // a box with a closed unstroked box inside
+    drawBox(QRect(420, 20, 260, 160));
+    drawBox(QRect(500, 60, 100, 80));
+
+    KisPaintDeviceSP filteredMainDev = KisPainter::convertToAlphaAsAlpha(mainDev);
+    KisLazyFillTools::normalizeAndInvertAlpha8Device(filteredMainDev, mainRect);
+
+    const KoColor transparent(Qt::transparent, rgbCs);
+    const KoColor red(Qt::red, rgbCs);
+    const KoColor green(Qt::green, rgbCs);
+
+    KisPaintDeviceSP backgroundStroke = new KisPaintDevice(alphaCs);
+    backgroundStroke->fill(QRect(0, 0, mainRect.width(), 10), strokeColor);
+
+    KisPaintDeviceSP leftStroke = new KisPaintDevice(alphaCs);
+    leftStroke->fill(QRect(40, 80, 20, 20), strokeColor);
+
+    KisPaintDeviceSP rightStroke = new KisPaintDevice(alphaCs);
+    rightStroke->fill(QRect(320, 80, 20, 20), strokeColor);
+
+    KisPaintDeviceSP outerStroke = new KisPaintDevice(alphaCs);
+    outerStroke->fill(QRect(440, 40, 20, 20), strokeColor);
+
+    KisPaintDeviceSP resultColoring = new KisPaintDevice(rgbCs);
+    KisMultiwayCut cut(filteredMainDev, resultColoring, mainRect);
+
+    cut.addKeyStroke(backgroundStroke, transparent);
+    cut.addKeyStroke(leftStroke, red);
+    cut.addKeyStroke(rightStroke, green);
+    cut.addKeyStroke(outerStroke, red);
+
+    cut.run();
+
+    /**
+     * The middle part touches the background and both stroked parts,
+     * so all of them are solved together. The inner box touches the
+     * outer one only.
+     */
+    QCOMPARE(cut.numRegions(), 2);
+
+    KoColor c;
+
+    resultColoring->pixel(QPoint(50, 60), &c);
+    QCOMPARE(c, red);
+
+    resultColoring->pixel(QPoint(330, 60), &c);
+    QCOMPARE(c, green);
+
+    // the middle part is given to a single side of the cut as a whole
+    KoColor middleLeft;
+    KoColor middleRight;
+    resultColoring->pixel(QPoint(150, 100), &middleLeft);
+    resultColoring->pixel(QPoint(255, 100), &middleRight);
+    QCOMPARE(middleLeft, middleRight);
+
+    resultColoring->pixel(QPoint(550, 100), &c);
+    QCOMPARE(c, red);
+}
 
+#include "lazybrush/kis_lazy_fill_max_flow_storage.h"
+
+void KisLazyBrushTest::testMaxFlowStoragePredecessors()
+{
+    typedef KisLazyFillGraph::vertex_descriptor VertexDescriptor;
+    typedef KisLazyFillGraph::edge_descriptor EdgeDescriptor;
+
+    KisLazyFillGraph graph(QRect(0, 0, 10, 10),
+                           QRegion(QRect(2, 2, 3, 3)),
+                           QRegion(QRect(6, 6, 2, 2)));
+
+    KisLazyFillMaxFlowStorage storage(graph);
+    KisLazyFillMaxFlowStorage::PredecessorMap predecessors = storage.predecessorMap();
+
+    BGL_FORALL_EDGES(e, graph, KisLazyFillGraph) {
+        const EdgeDescriptor reversed = get(boost::edge_reverse, graph)[e];
+
+        Q_FOREACH (const VertexDescriptor &v, QVector<VertexDescriptor>() << e.first << e.second) {
+            put(predecessors, v, e);
+            QCOMPARE(get(predecessors, v), e);
+
+            put(predecessors, v, reversed);
+            QCOMPARE(get(predecessors, v), reversed);
+        }
+    }
+
+    KisLazyFillMaxFlowStorage::ColorMap colors = storage.colorMap();
+
+    BGL_FORALL_VERTICES(v, graph, KisLazyFillGraph) {
+        put(colors, v, black_color);
+        QCOMPARE(get(colors, v), black_color);
+        QCOMPARE(storage.color(get(boost::vertex_index, graph, v)), black_color);
+    }
+}
+
+void KisLazyBrushTest::maxFlowMemoryBenchmark()
+{
+    // A3 page scanned at 600 dpi with a few small scribbles
+    const QRect a3Rect(0, 0, 7016, 9921);
+
+    QRegion aRegion;
+    QRegion bRegion;
+
+    for (int i = 0; i < 10; i++) {
+        aRegion += QRect(100 + i * 600, 100 + i * 900, 300, 50);
+        bRegion += QRect(200 + i * 600, 400 + i * 900, 50, 300);
+    }
+
+    KisLazyFillGraph a3Graph(a3Rect, aRegion, bRegion);
+
+    const qreal megapixels = a3Rect.width() * a3Rect.height() / 1e6;
+    const qreal bytesPerMegapixel = KisLazyFillMaxFlowStorage::estimateMemoryUsage(a3Graph) / megapixels;
+
+    qDebug() << "A3 @ 600 dpi:" << megapixels << "MPx,"
+             << KisLazyFillMaxFlowStorage::estimateMemoryUsage(a3Graph) / 1e6 << "MB,"
+             << bytesPerMegapixel / 1e6 << "MB/MPx";
+
+    // the bound documented in KisLazyFillMaxFlowStorage
+    QVERIFY(bytesPerMegapixel < 26.3e6);
+
+    // the worst case: both labels cover the whole image
+    KisLazyFillGraph fullLabelsGraph(a3Rect, QRegion(a3Rect), QRegion(a3Rect));
+    QVERIFY(KisLazyFillMaxFlowStorage::estimateMemoryUsage(fullLabelsGraph) / megapixels < 26.3e6);
+
+    // the real allocation for a moderately big image
+    KisPaintDeviceSP filteredMainDev;
+    QVector<KisPaintDeviceSP> strokes;
+    QRect mainRect;
+
+    prepareBoxesScene(10, &filteredMainDev, &strokes, &mainRect);
+
+    QBENCHMARK_ONCE {
+        KisLazyFillGraph graph(mainRect,
+                               strokes[1]->regionExact(),
+                               strokes[0]->regionExact());
+        KisLazyFillMaxFlowStorage storage(graph);
+
+        qDebug() << ppVar(mainRect.size())
+                 << "allocated:" << KisLazyFillMaxFlowStorage::estimateMemoryUsage(graph) / 1e6 << "MB";
+    }
+
+    KoColor color(Qt::red, KoColorSpaceRegistry::instance()->rgb8());
+    KisPaintDeviceSP resultColoring = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    KisPaintDeviceSP maskDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+
+    QBENCHMARK_ONCE {
+        KisLazyFillTools::cutOneWay(color,
+                                    filteredMainDev,
+                                    strokes[1],
+                                    strokes[0],
+                                    resultColoring,
+                                    maskDevice,
+                                    mainRect);
+    }
+}
 
 QTEST_MAIN(KisLazyBrushTest)
@@ -40,6 +40,14 @@ private Q_SLOTS:
     void testEstimateTransparentPixels();
 
     void multiwayCutBenchmark();
+
+    void testMultiwayCutRegions();
+    void testMultiwayCutUnstrokedRegions();
+    void multiwayCutRegionsBenchmark();
+    void multiwayCutRegionsReuseBenchmark();
+
+    void testMaxFlowStoragePredecessors();
+    void maxFlowMemoryBenchmark();
 };
 
 #endif /* __KIS_LAZY_BRUSH_TEST_H */
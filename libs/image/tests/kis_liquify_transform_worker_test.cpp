@@ -154,4 +154,54 @@ void KisLiquifyTransformWorkerTest::testIdentityTransform()
     TestUtil::checkQImage(result, "liquify_transform_test", "liquify_dev", "identity");
 }
 
+void KisLiquifyTransformWorkerTest::testIncrementalQImage()
+{
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    const QRect srcBounds = image.rect();
+    const int pixelPrecision = 8;
+
+    KisLiquifyTransformWorker worker(srcBounds, 0, pixelPrecision);
+    KisLiquifyTransformWorker refWorker(srcBounds, 0, pixelPrecision);
+
+    worker.translatePoints(QPointF(100,100), QPointF(50, 0), 50, false, 0.2);
+    refWorker.translatePoints(QPointF(100,100), QPointF(50, 0), 50, false, 0.2);
+
+    QPointF newOffset;
+    QPointF refOffset;
+
+    // fills the preview cache
+    worker.runOnQImage(image, QPointF(), QTransform(), &newOffset);
+
+    worker.translatePoints(QPointF(300,200), QPointF(0, 30), 40, false, 0.2);
+    refWorker.translatePoints(QPointF(300,200), QPointF(0, 30), 40, false, 0.2);
+
+    // only the cells around the second stroke are rasterized
+    QImage result = worker.runOnQImage(image, QPointF(), QTransform(), &newOffset);
+    QImage refResult = refWorker.runOnQImage(image, QPointF(), QTransform(), &refOffset);
+
+    QCOMPARE(newOffset, refOffset);
+    QVERIFY(result == refResult);
+}
+
+void KisLiquifyTransformWorkerTest::benchmarkIncrementalQImage()
+{
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    KisLiquifyTransformWorker worker(image.rect(), 0, 8);
+
+    QPointF newOffset;
+    worker.runOnQImage(image, QPointF(), QTransform(), &newOffset);
+
+    QPointF pos(100, 100);
+
+    QBENCHMARK {
+        worker.translatePoints(pos, QPointF(2, 1), 30, false, 0.2);
+        worker.runOnQImage(image, QPointF(), QTransform(), &newOffset);
+        pos += QPointF(2, 1);
+    }
+}
+
 QTEST_MAIN(KisLiquifyTransformWorkerTest)
@@ -22,6 +22,7 @@
 
 #include <kis_debug.h>
 #include <QRect>
+#include <cmath>
 
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
@@ -36,6 +37,9 @@
 #include "kis_transaction.h"
 #include "kis_surrogate_undo_adapter.h"
 #include "commands/kis_selection_commands.h"
+#include "kis_selection_filters.h"
+#include "kis_selection_outline_generator.h"
+#include "kis_datamanager.h"
 
 
 void KisPixelSelectionTest::testCreation()
@@ -378,5 +382,311 @@ void KisPixelSelectionTest::testOutlineCacheTransactions()
     }
 }
 
+/**
+ * Fills the selection with a few solid figures and some semi-transparent
+ * noise, so that the filters would have both long flat areas and
+ * random gray levels
+ */
+KisPixelSelectionSP createFilterTestSelection(const QRect &rect)
+{
+    KisPixelSelectionSP selection = new KisPixelSelection();
+    QVector<quint8> pixels(rect.width() * rect.height());
+
+    qsrand(1);
+
+    for (int y = 0; y < rect.height(); y++) {
+        for (int x = 0; x < rect.width(); x++) {
+            const QPoint pt(x - rect.width() / 3, y - rect.height() / 2);
+
+            quint8 value = 0;
+
+            if (pt.x() * pt.x() + pt.y() * pt.y() < rect.width() * rect.width() / 16 ||
+                (x > rect.width() / 2 && y > rect.height() / 3 && (x / 7 + y / 5) % 3)) {
+
+                value = MAX_SELECTED;
+            } else if (qrand() % 20 == 0) {
+                value = qrand() % 256;
+            }
+
+            pixels[y * rect.width() + x] = value;
+        }
+    }
+
+    selection->writeBytes(pixels.constData(), rect);
+    return selection;
+}
+
+/**
+ * A straightforward O(radius^2) version of the grow/shrink filters
+ */
+QVector<quint8> referenceGrowShrink(KisPixelSelectionSP selection, const QRect &rect,
+                                    int xRadius, int yRadius, bool shrink, bool edgeLock)
+{
+    QVector<quint8> src(rect.width() * rect.height());
+    selection->readBytes(src.data(), rect);
+
+    QVector<quint8> dst(src.size());
+
+    // the same ellipse as KisSelectionFilter::computeBorder() builds
+    QVector<int> heights(xRadius + 1);
+    for (int i = 0; i <= xRadius; i++) {
+        const qreal tmp = i > 0 ? i - 0.5 : 0.0;
+        heights[i] = int(std::floor(qreal(yRadius) / xRadius * std::sqrt(xRadius * xRadius - tmp * tmp) + 0.5));
+    }
+
+    for (int y = 0; y < rect.height(); y++) {
+        for (int x = 0; x < rect.width(); x++) {
+            int result = shrink ? MAX_SELECTED : MIN_SELECTED;
+
+            for (int i = -xRadius; i <= xRadius; i++) {
+                const int height = heights[qAbs(i)];
+
+                for (int j = -height; j <= height; j++) {
+                    int srcX = x + i;
+                    int srcY = y + j;
+                    int value = MIN_SELECTED;
+
+                    if (edgeLock) {
+                        srcX = qBound(0, srcX, rect.width() - 1);
+                        srcY = qBound(0, srcY, rect.height() - 1);
+                    }
+
+                    if (srcX >= 0 && srcX < rect.width() &&
+                        srcY >= 0 && srcY < rect.height()) {
+
+                        value = src[srcY * rect.width() + srcX];
+                    }
+
+                    result = shrink ? qMin(result, value) : qMax(result, value);
+                }
+            }
+
+            dst[y * rect.width() + x] = result;
+        }
+    }
+
+    return dst;
+}
+
+void KisPixelSelectionTest::testOutlineLevelsOfDetail()
+{
+    // not aligned to the stripes of the generator
+    const QRect rect(13, 7, 120, 150);
+    KisPixelSelectionSP selection = createFilterTestSelection(rect);
+
+    selection->invalidateOutlineCache();
+    selection->recalculateOutlineCache();
+    QVERIFY(selection->outlineCacheValid());
+
+    const QPainterPath outline = selection->outlineCache();
+    QCOMPARE(selection->simplifiedOutlineCache(0), outline);
+
+    QVector<quint8> pixels(rect.width() * rect.height());
+    selection->readBytes(pixels.data(), rect);
+
+    for (int y = 0; y < rect.height(); y++) {
+        for (int x = 0; x < rect.width(); x++) {
+            const QPointF center(rect.x() + x + 0.5, rect.y() + y + 0.5);
+            const bool isSelected = pixels[y * rect.width() + x] != MIN_SELECTED;
+
+            if (outline.contains(center) != isSelected) {
+                dbgKrita << "Wrong outline at" << center;
+                QFAIL("The outline doesn't match the selection");
+            }
+        }
+    }
+
+    int lastNumElements = outline.elementCount();
+
+    for (int lod = 1; lod < KisSelectionOutlineGenerator::numLevelsOfDetail; lod++) {
+        const QPainterPath path = selection->simplifiedOutlineCache(lod);
+
+        // the simplified polygons consist of the points of the original ones
+        QVERIFY(path.elementCount() <= lastNumElements);
+        QVERIFY(outline.boundingRect().contains(path.boundingRect()));
+
+        lastNumElements = path.elementCount();
+    }
+
+    QVERIFY(lastNumElements < outline.elementCount());
+
+    // incremental updates drop the simplified outlines
+    selection->select(QRect(0, 0, 10, 10));
+    QCOMPARE(selection->simplifiedOutlineCache(3), selection->outlineCache());
+}
+
+void KisPixelSelectionTest::testUniformTilesSharing()
+{
+    const qint64 tileSize = 64 * 64;
+
+    KisPixelSelectionSP psel1 = new KisPixelSelection();
+    KisPixelSelectionSP psel2 = new KisPixelSelection();
+    KisPixelSelectionSP psel3 = new KisPixelSelection();
+
+    psel1->select(QRect(0, 0, 640, 640));
+    psel2->select(QRect(320, 320, 640, 640));
+    psel3->select(QRect(400, 400, 10, 10));
+
+    QSet<const KisTileData*> countedTileData;
+
+    // the unselected tiles are removed, the selected ones share the data
+    psel1->applySelection(psel2, SELECTION_INTERSECT);
+    QCOMPARE(psel1->selectedExactRect(), QRect(320, 320, 320, 320));
+    QCOMPARE(psel1->dataManager()->numTiles(), 25);
+    QCOMPARE(psel1->dataManager()->tileDataMemoryUsage(&countedTileData), tileSize);
+
+    psel1->applySelection(psel2, SELECTION_ADD);
+    QCOMPARE(psel1->selectedExactRect(), QRect(320, 320, 640, 640));
+    QCOMPARE(psel1->dataManager()->numTiles(), 100);
+
+    countedTileData.clear();
+    QCOMPARE(psel1->dataManager()->tileDataMemoryUsage(&countedTileData), tileSize);
+
+    // only the tile with the hole gets its own data
+    psel1->applySelection(psel3, SELECTION_SUBTRACT);
+    QCOMPARE(psel1->dataManager()->numTiles(), 100);
+
+    countedTileData.clear();
+    QCOMPARE(psel1->dataManager()->tileDataMemoryUsage(&countedTileData), 2 * tileSize);
+
+    QCOMPARE(TestUtil::alphaDevicePixel(psel1, 399, 405), MAX_SELECTED);
+    QCOMPARE(TestUtil::alphaDevicePixel(psel1, 405, 405), MIN_SELECTED);
+    QCOMPARE(TestUtil::alphaDevicePixel(psel1, 900, 900), MAX_SELECTED);
+    QCOMPARE(TestUtil::alphaDevicePixel(psel1, 100, 100), MIN_SELECTED);
+}
+
+void KisPixelSelectionTest::testGrowShrinkFilters()
+{
+    const QRect rect(-30, 20, 300, 200);
+
+    QVector<QSize> radii;
+    radii << QSize(1, 1) << QSize(10, 5) << QSize(3, 17) << QSize(40, 40);
+
+    Q_FOREACH (const QSize &radius, radii) {
+        for (int mode = 0; mode < 3; mode++) {
+            const bool shrink = mode > 0;
+            const bool edgeLock = mode > 1;
+
+            KisPixelSelectionSP selection = createFilterTestSelection(rect);
+            QVector<quint8> expected =
+                referenceGrowShrink(selection, rect,
+                                    radius.width(), radius.height(),
+                                    shrink, edgeLock);
+
+            QScopedPointer<KisSelectionFilter> filter;
+
+            if (shrink) {
+                filter.reset(new KisShrinkSelectionFilter(radius.width(), radius.height(), edgeLock));
+            } else {
+                filter.reset(new KisGrowSelectionFilter(radius.width(), radius.height()));
+            }
+
+            filter->process(selection, rect);
+
+            QVector<quint8> result(rect.width() * rect.height());
+            selection->readBytes(result.data(), rect);
+
+            QVERIFY2(result == expected,
+                     QString("radius: %1x%2 mode: %3")
+                     .arg(radius.width()).arg(radius.height()).arg(mode).toLatin1());
+        }
+    }
+}
+
+void KisPixelSelectionTest::testBorderFilter()
+{
+    const QRect rect(-30, 20, 300, 200);
+    const int xRadius = 10;
+    const int yRadius = 5;
+
+    KisPixelSelectionSP selection = createFilterTestSelection(rect);
+
+    QVector<quint8> src(rect.width() * rect.height());
+    selection->readBytes(src.data(), rect);
+
+    // transition pixels are the selected ones with unselected neighbours
+    QVector<bool> transitions(src.size());
+    for (int y = 0; y < rect.height(); y++) {
+        // the bottom row takes the transitions from the row above it
+        const int srcY = y == rect.height() - 1 ? y - 1 : y;
+
+        for (int x = 0; x < rect.width(); x++) {
+            bool isTransition = false;
+
+            if (src[srcY * rect.width() + x] > 127) {
+                for (int j = -1; j <= 1; j++) {
+                    for (int i = -1; i <= 1; i++) {
+                        const int nx = qBound(0, x + i, rect.width() - 1);
+                        const int ny = qBound(0, srcY + j, rect.height() - 1);
+                        isTransition |= src[ny * rect.width() + nx] < 128;
+                    }
+                }
+            }
+
+            transitions[y * rect.width() + x] = isTransition;
+        }
+    }
+
+    QVector<quint8> expected(src.size());
+    for (int y = 0; y < rect.height(); y++) {
+        for (int x = 0; x < rect.width(); x++) {
+            int result = 0;
+
+            for (int j = -yRadius; j <= yRadius; j++) {
+                for (int i = -xRadius; i <= xRadius; i++) {
+                    const int nx = x + i;
+                    const int ny = y + j;
+
+                    if (nx < 0 || nx >= rect.width() ||
+                        ny < 0 || ny >= rect.height() ||
+                        !transitions[ny * rect.width() + nx]) continue;
+
+                    const qreal tmpx = i ? qAbs(i) - 0.5 : 0.0;
+                    const qreal tmpy = j ? qAbs(j) - 0.5 : 0.0;
+                    const qreal dist = tmpy * tmpy / (yRadius * yRadius) +
+                        tmpx * tmpx / (xRadius * xRadius);
+
+                    if (dist < 1.0) {
+                        result = qMax(result, int(quint8(255 * (1.0 - std::sqrt(dist)))));
+                    }
+                }
+            }
+
+            expected[y * rect.width() + x] = result;
+        }
+    }
+
+    KisBorderSelectionFilter filter(xRadius, yRadius);
+    filter.process(selection, rect);
+
+    QVector<quint8> result(src.size());
+    selection->readBytes(result.data(), rect);
+
+    QVERIFY(result == expected);
+}
+
+void KisPixelSelectionTest::benchmarkGrowFilter()
+{
+    const QRect rect(0, 0, 4000, 3000);
+    KisPixelSelectionSP selection = createFilterTestSelection(rect);
+
+    KisGrowSelectionFilter filter(200, 200);
+
+    QBENCHMARK_ONCE {
+        filter.process(selection, rect);
+    }
+}
+
+void KisPixelSelectionTest::benchmarkOutline()
+{
+    const QRect rect(0, 0, 4000, 3000);
+    KisPixelSelectionSP selection = createFilterTestSelection(rect);
+
+    QBENCHMARK_ONCE {
+        selection->invalidateOutlineCache();
+        selection->recalculateOutlineCache();
+    }
+}
+
 QTEST_MAIN(KisPixelSelectionTest)
 
@@ -45,6 +45,14 @@ private Q_SLOTS:
     void testOutlineCache();
 
     void testOutlineCacheTransactions();
+    void testOutlineLevelsOfDetail();
+    void testUniformTilesSharing();
+
+    void testGrowShrinkFilters();
+    void testBorderFilter();
+
+    void benchmarkGrowFilter();
+    void benchmarkOutline();
 };
 
 #endif
@@ -24,12 +24,14 @@
 #include <floodfill/kis_scanline_fill.h>
 #include <floodfill/kis_fill_interval.h>
 #include <floodfill/kis_fill_interval_map.h>
+#include <floodfill/kis_fill_similarity_cache.h>
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include "kis_types.h"
 #include "kis_paint_device.h"
+#include "kis_pixel_selection.h"
 
 
 void KisScanlineFillTest::testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
@@ -295,4 +297,169 @@ void KisScanlineFillTest::testExternalFill()
     QCOMPARE(c, QColor(Qt::blue));
 }
 
+void KisScanlineFillTest::testExternalFillCached()
+{
+    const QRect rc1(10, 10, 10, 10);
+    const QRect rc2(30, 10, 10, 10);
+    const QRect boundingRect(0,0,100,100);
+
+    KisFillSimilarityCache::instance()->clear();
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    dev->fill(rc1, KoColor(Qt::red, dev->colorSpace()));
+    dev->fill(rc2, KoColor(Qt::red, dev->colorSpace()));
+
+    {
+        KisPaintDeviceSP other = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+        KisScanlineFill fill(dev, QPoint(10,10), boundingRect);
+        fill.setUseSimilarityCache(true);
+        fill.fillColor(KoColor(Qt::blue, dev->colorSpace()), other);
+
+        QCOMPARE(other->exactBounds(), rc1);
+    }
+
+    {
+        KisPaintDeviceSP other = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+        // the map of the first fill is reused
+        KisScanlineFill fill(dev, QPoint(30,10), boundingRect);
+        fill.setUseSimilarityCache(true);
+        fill.fillColor(KoColor(Qt::blue, dev->colorSpace()), other);
+
+        QCOMPARE(other->exactBounds(), rc2);
+    }
+
+    // connect the rects, the cached map should be dropped
+    dev->fill(QRect(20, 10, 10, 1), KoColor(Qt::red, dev->colorSpace()));
+
+    {
+        KisPaintDeviceSP other = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+        KisScanlineFill fill(dev, QPoint(10,10), boundingRect);
+        fill.setUseSimilarityCache(true);
+        fill.fillColor(KoColor(Qt::blue, dev->colorSpace()), other);
+
+        QCOMPARE(other->exactBounds(), rc1 | rc2);
+    }
+}
+
+void KisScanlineFillTest::testFillSelectionCached()
+{
+    const QRect boundingRect(0,0,300,200);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    qsrand(1);
+
+    for (int i = 0; i < 300; i++) {
+        const QRect rc(qrand() % 300, qrand() % 200, 1 + qrand() % 40, 1 + qrand() % 40);
+        const QColor color(qrand() % 256, qrand() % 256, qrand() % 256);
+
+        dev->fill(rc, KoColor(color, dev->colorSpace()));
+    }
+
+    KisFillSimilarityCache::instance()->clear();
+
+    for (int i = 0; i < 10; i++) {
+        const QPoint startPoint(qrand() % 300, qrand() % 200);
+        const int threshold = qrand() % 100;
+
+        KisPixelSelectionSP expected = new KisPixelSelection();
+        KisPixelSelectionSP result = new KisPixelSelection();
+
+        {
+            KisScanlineFill fill(dev, startPoint, boundingRect);
+            fill.setThreshold(threshold);
+            fill.fillSelection(expected);
+        }
+
+        {
+            KisScanlineFill fill(dev, startPoint, boundingRect);
+            fill.setThreshold(threshold);
+            fill.setUseSimilarityCache(true);
+            fill.fillSelection(result);
+        }
+
+        QPoint errorPoint;
+        QVERIFY(TestUtil::comparePaintDevices(errorPoint, expected, result));
+    }
+}
+
+void KisScanlineFillTest::testSimilarityMapBlocks()
+{
+    const QRect rc1(10, 10, 10, 10);
+    const QRect rc2(300, 10, 10, 10);
+    const QRect boundingRect(0,0,600,100);
+
+    KisFillSimilarityCache::instance()->clear();
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    const KoColor red(Qt::red, dev->colorSpace());
+
+    dev->fill(rc1, red);
+    dev->fill(rc2, red);
+
+    KisFillSimilarityMapSP map = KisFillSimilarityCache::instance()->differenceMap(dev, red);
+    QCOMPARE(map->numBlocks(), 0);
+
+    {
+        KisPaintDeviceSP other = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+        KisScanlineFill fill(dev, QPoint(10,10), boundingRect);
+        fill.setUseSimilarityCache(true);
+        fill.fillColor(KoColor(Qt::blue, dev->colorSpace()), other);
+
+        QCOMPARE(other->exactBounds(), rc1);
+    }
+
+    // only the block the fill has reached is calculated
+    QCOMPARE(map->numBlocks(), 1);
+
+    /**
+     * Change the device without using a painter, the change must
+     * be noticed anyway
+     */
+    const QRect rc3(20, 10, 5, 10);
+    QVector<quint8> redPixels(rc3.width() * rc3.height() * dev->pixelSize());
+    for (int i = 0; i < redPixels.size(); i += dev->pixelSize()) {
+        memcpy(redPixels.data() + i, red.data(), dev->pixelSize());
+    }
+    dev->writeBytes(redPixels.data(), rc3);
+
+    {
+        KisPaintDeviceSP other = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+        KisScanlineFill fill(dev, QPoint(10,10), boundingRect);
+        fill.setUseSimilarityCache(true);
+        fill.fillColor(KoColor(Qt::blue, dev->colorSpace()), other);
+
+        QCOMPARE(other->exactBounds(), rc1 | rc3);
+    }
+
+    {
+        KisPaintDeviceSP other = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+        KisScanlineFill fill(dev, QPoint(300,10), boundingRect);
+        fill.setUseSimilarityCache(true);
+        fill.fillColor(KoColor(Qt::blue, dev->colorSpace()), other);
+
+        QCOMPARE(other->exactBounds(), rc2);
+    }
+
+    QCOMPARE(map->numBlocks(), 2);
+    QVERIFY(KisFillSimilarityCache::instance()->differenceMap(dev, red) == map);
+
+    // the least recently used block is dropped
+    map->trim(1);
+    QCOMPARE(map->numBlocks(), 1);
+
+    map->trim(0);
+    QCOMPARE(map->numBlocks(), 0);
+
+    // another seed color needs another map
+    QVERIFY(KisFillSimilarityCache::instance()->differenceMap(dev, KoColor(Qt::blue, dev->colorSpace())) != map);
+}
+
 QTEST_MAIN(KisScanlineFillTest)
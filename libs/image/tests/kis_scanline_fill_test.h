@@ -38,6 +38,9 @@ private Q_SLOTS:
 
     void testClearNonZeroComponent();
     void testExternalFill();
+    void testExternalFillCached();
+    void testFillSelectionCached();
+    void testSimilarityMapBlocks();
 
 private:
     void testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
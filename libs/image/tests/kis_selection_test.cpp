@@ -324,11 +324,8 @@ void KisSelectionTest::testOutlineGeneration()
     closedSubPath.closeSubpath();
 
     /**
-     * Our outline generation code has a small problem: it can
-     * generate a polygon, which isn't closed (it'll repeat the first
-     * point instead). There is a special workaround for it in
-     * KisPixelSelection::recalculateOutlineCache(), which explicitly
-     * closes the path, so here we just check it.
+     * The outline should consist of closed polygons, otherwise the
+     * marching ants will have a gap in the starting point
      */
 
     bool isClosed = closedSubPath == calculatedOutline;
@@ -931,6 +931,31 @@ void KisTransformWorkerTest::benchmarkScaleRotateShear()
     }
 }
 
+void KisTransformWorkerTest::benchmarkRotateScaleLarge()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    QImage image(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    for (int y = 0; y < 4096; y += image.height()) {
+        for (int x = 0; x < 4096; x += image.width()) {
+            dev->convertFromQImage(image, 0, x, y);
+        }
+    }
+
+    KisFilterStrategy *filter = new KisBicubicFilterStrategy();
+
+    QBENCHMARK_ONCE {
+        KisTransformWorker tw(dev, 0.837, 0.837,
+                              0.0, 0.0, 0.0, 0.0,
+                              M_PI / 6.0,
+                              0, 0, 0, filter);
+        tw.run();
+    }
+
+    delete filter;
+}
+
 void KisTransformWorkerTest::generateTestImages()
 {
     QList<KisFilterStrategy*> filters;
@@ -61,6 +61,7 @@ private Q_SLOTS:
     void benchmarkRotate1Q();
     void benchmarkShear();
     void benchmarkScaleRotateShear();
+    void benchmarkRotateScaleLarge();
 
     void testPartialProcessing();
 
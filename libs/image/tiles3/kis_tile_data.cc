@@ -81,6 +81,19 @@ KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
 }
 
 
+KisTileData::KisTileData(qint32 pixelSize, KisTileDataStore *store)
+    : m_state(NORMAL),
+      m_mementoFlag(0),
+      m_age(0),
+      m_data(0),
+      m_usersCount(0),
+      m_refCount(0),
+      m_pixelSize(pixelSize),
+      m_store(store)
+{
+}
+
+
 KisTileData::~KisTileData()
 {
     releaseMemory();
@@ -52,6 +52,13 @@ public:
 private:
     KisTileData(const KisTileData& rhs, bool checkFreeMemory = true);
 
+    /**
+     * Creates a tile data without any memory allocated for it. Used
+     * by KisTileDataStore for the tile data, which is placed directly
+     * into the swap file.
+     */
+    KisTileData(qint32 pixelSize, KisTileDataStore *store);
+
 public:
     ~KisTileData();
 
@@ -153,6 +153,22 @@ KisTileData *KisTileDataStore::allocTileData(qint32 pixelSize, const quint8 *def
     return td;
 }
 
+KisTileData *KisTileDataStore::createSwappedTileData(qint32 pixelSize, const quint8 *buffer, qint32 bufferSize)
+{
+    KisTileData *td = new KisTileData(pixelSize, this);
+
+    /**
+     * The tile data is not registered in the list, because it is not
+     * in memory. It will be registered by ensureTileDataLoaded().
+     */
+    if (!m_swappedStore.storeCompressedTileData(td, buffer, bufferSize)) {
+        delete td;
+        td = 0;
+    }
+
+    return td;
+}
+
 KisTileData *KisTileDataStore::duplicateTileData(KisTileData *rhs)
 {
     KisTileData *td = 0;
@@ -94,6 +94,16 @@ public:
         return allocTileData(pixelSize, defPixel);
     }
 
+    /**
+     * Creates a tile data with its pixels stored in the swap file.
+     * The pixels are passed in \p buffer already compressed in the
+     * format of KisTileCompressor2 and are decompressed only when the
+     * tile data is accessed for the first time.
+     *
+     * Returns null if the swap file has no space for the data.
+     */
+    KisTileData* createSwappedTileData(qint32 pixelSize, const quint8 *buffer, qint32 bufferSize);
+
     // Called by The Memento Manager after every commit
     inline void kickPooler() {
         m_pooler.kick();
@@ -20,6 +20,8 @@
 
 #include <QRect>
 #include <QVector>
+#include <QHash>
+#include <QByteArray>
 
 #include "kis_tile.h"
 #include "kis_tiled_data_manager.h"
@@ -147,7 +149,7 @@ bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
 
     return retval;
 }
-bool KisTiledDataManager::read(QIODevice *stream)
+bool KisTiledDataManager::read(QIODevice *stream, bool lazyLoading)
 {
     if (!stream) return false;
     clear();
@@ -184,6 +186,7 @@ bool KisTiledDataManager::read(QIODevice *stream)
 
     KisAbstractTileCompressorSP compressor =
         KisTileCompressorFactory::create(tilesVersion);
+    compressor->setLazyLoading(lazyLoading);
 
     bool readSuccess = true;
     for (quint32 i = 0; i < numTiles; i++) {
@@ -312,6 +315,216 @@ void KisTiledDataManager::purge(const QRect& area)
     recalculateExtent();
 }
 
+void KisTiledDataManager::shareUniformTiles(const QRect &area)
+{
+    QWriteLocker locker(&m_lock);
+
+    const qint32 pixelSize = this->pixelSize();
+    const qint32 tileDataSize = KisTileData::HEIGHT * KisTileData::WIDTH * pixelSize;
+
+    QList<KisTileSP> uniformTiles;
+    {
+        KisTileHashTableIterator iter(m_hashTable);
+        KisTileSP tile;
+
+        while ((tile = iter.tile())) {
+            if (tile->extent().intersects(area)) {
+                tile->lockForRead();
+                const quint8 *data = tile->data();
+
+                // every pixel is equal to the next one
+                if (memcmp(data, data + pixelSize, tileDataSize - pixelSize) == 0) {
+                    uniformTiles.push_back(tile);
+                }
+                tile->unlock();
+            }
+            ++iter;
+        }
+    }
+
+    /**
+     * The data of the first tile with every value becomes the shared
+     * one, so calling the function again doesn't change anything
+     */
+    QHash<QByteArray, KisTileData*> sharedTileData;
+    bool needsRecalculateExtent = false;
+
+    Q_FOREACH (KisTileSP tile, uniformTiles) {
+        tile->lockForRead();
+        const QByteArray pixel(reinterpret_cast<const char*>(tile->data()), pixelSize);
+        tile->unlock();
+
+        if (memcmp(pixel.constData(), m_defaultPixel, pixelSize) == 0) {
+            m_hashTable->deleteTile(tile);
+            needsRecalculateExtent = true;
+            continue;
+        }
+
+        KisTileData *td = sharedTileData.value(pixel, 0);
+
+        if (!td) {
+            sharedTileData.insert(pixel, tile->tileData());
+        } else if (td != tile->tileData()) {
+            const qint32 column = tile->col();
+            const qint32 row = tile->row();
+
+            m_hashTable->deleteTile(tile);
+            m_hashTable->addTile(new KisTile(column, row, td, m_mementoManager));
+        }
+    }
+
+    if (needsRecalculateExtent) {
+        recalculateExtent();
+    }
+}
+
+bool KisTiledDataManager::addSwappedTile(qint32 col, qint32 row, const quint8 *buffer, qint32 bufferSize)
+{
+    KisTileData *td = KisTileDataStore::instance()->createSwappedTileData(pixelSize(), buffer, bufferSize);
+    if (!td) return false;
+
+    m_hashTable->addTile(new KisTile(col, row, td, m_mementoManager));
+    updateExtent(col, row);
+
+    return true;
+}
+
+qint64 KisTiledDataManager::tileDataMemoryUsage(QSet<const KisTileData*> *countedTileData) const
+{
+    QReadLocker locker(&m_lock);
+
+    const qint64 tileDataSize = KisTileData::HEIGHT * KisTileData::WIDTH * pixelSize();
+    qint64 result = 0;
+
+    KisTileHashTableIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        const KisTileData *td = tile->tileData();
+
+        if (!countedTileData->contains(td)) {
+            countedTileData->insert(td);
+            result += tileDataSize;
+        }
+        ++iter;
+    }
+
+    return result;
+}
+
+bool KisTiledDataManager::sharesAllTileData(KisTiledDataManager *other) const
+{
+    if (other == this) return true;
+    if (other->pixelSize() != pixelSize()) return false;
+
+    QReadLocker locker(&m_lock);
+    QReadLocker otherLocker(&other->m_lock);
+
+    if (other->m_hashTable->numTiles() != m_hashTable->numTiles()) return false;
+
+    KisTileHashTableIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        KisTileSP otherTile = other->m_hashTable->getExistedTile(tile->col(), tile->row());
+
+        if (!otherTile || otherTile->tileData() != tile->tileData()) {
+            return false;
+        }
+        ++iter;
+    }
+
+    return true;
+}
+
+QRect KisTiledDataManager::differingRect(KisTiledDataManager *other, const QRect &rect) const
+{
+    QRect result;
+
+    if (other == this || rect.isEmpty()) return result;
+    if (other->pixelSize() != pixelSize()) return rect;
+
+    QReadLocker locker(&m_lock);
+    QReadLocker otherLocker(&other->m_lock);
+
+    const qint32 pixelSize = this->pixelSize();
+    const qint32 rowStride = KisTileData::WIDTH * pixelSize;
+
+    const qint32 firstColumn = xToCol(rect.left());
+    const qint32 lastColumn = xToCol(rect.right());
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    for (qint32 row = firstRow; row <= lastRow; row++) {
+        for (qint32 column = firstColumn; column <= lastColumn; column++) {
+            KisTileSP tile = m_hashTable->getReadOnlyTileLazy(column, row);
+            KisTileSP otherTile = other->m_hashTable->getReadOnlyTileLazy(column, row);
+
+            if (tile->tileData() == otherTile->tileData()) continue;
+
+            const QRect tileRect = tile->extent() & rect;
+
+            // the area of interest in the tile's own coordinates
+            const qint32 left = tileRect.left() - tile->extent().left();
+            const qint32 right = tileRect.right() - tile->extent().left();
+            const qint32 top = tileRect.top() - tile->extent().top();
+            const qint32 bottom = tileRect.bottom() - tile->extent().top();
+            const qint32 rowBytes = (right - left + 1) * pixelSize;
+
+            tile->lockForRead();
+            otherTile->lockForRead();
+
+            const quint8 *data = tile->data();
+            const quint8 *otherData = otherTile->data();
+
+            qint32 minX = right + 1;
+            qint32 maxX = left - 1;
+            qint32 minY = -1;
+            qint32 maxY = -1;
+
+            for (qint32 y = top; y <= bottom; y++) {
+                const quint8 *ptr = data + y * rowStride + left * pixelSize;
+                const quint8 *otherPtr = otherData + y * rowStride + left * pixelSize;
+
+                if (!memcmp(ptr, otherPtr, rowBytes)) continue;
+
+                if (minY < 0) minY = y;
+                maxY = y;
+
+                /**
+                 * Only the part of the row outside the already found
+                 * columns range should be examined pixel by pixel
+                 */
+                for (qint32 x = left; x < minX; x++) {
+                    if (memcmp(ptr + (x - left) * pixelSize,
+                               otherPtr + (x - left) * pixelSize, pixelSize)) {
+                        minX = x;
+                        break;
+                    }
+                }
+
+                for (qint32 x = right; x > maxX; x--) {
+                    if (memcmp(ptr + (x - left) * pixelSize,
+                               otherPtr + (x - left) * pixelSize, pixelSize)) {
+                        maxX = x;
+                        break;
+                    }
+                }
+            }
+
+            otherTile->unlock();
+            tile->unlock();
+
+            if (minY >= 0) {
+                result |= QRect(minX, minY, maxX - minX + 1, maxY - minY + 1)
+                    .translated(tile->extent().topLeft());
+            }
+        }
+    }
+
+    return result;
+}
+
 quint8* KisTiledDataManager::duplicatePixel(qint32 num, const quint8 *pixel)
 {
     const qint32 pixelSize = this->pixelSize();
@@ -22,6 +22,7 @@
 #include <QtGlobal>
 #include <QVector>
 #include <QRegion>
+#include <QSet>
 
 #include <kis_shared.h>
 #include <kis_shared_ptr.h>
@@ -173,7 +174,7 @@ protected:
      * Reads and writes the tiles 
      */
     bool write(KisPaintDeviceWriter &store);
-    bool read(QIODevice *stream);
+    bool read(QIODevice *stream, bool lazyLoading = false);
 
     void purge(const QRect& area);
 
@@ -198,6 +199,48 @@ public:
     void clear(qint32 x, qint32 y,  qint32 w, qint32 h, const quint8 *clearPixel);
     void clear();
 
+    /**
+     * Makes all the uniform tiles in \p area, i.e. the tiles filled
+     * with a single pixel value, share one tile data per value. The
+     * uniform tiles filled with the default pixel are removed, like
+     * purge() does. The shared data is copied on write, so writing
+     * into such a tile gives it its own data back.
+     *
+     * Masks and selections usually consist of fully selected and
+     * fully unselected areas, so they take memory only for the tiles
+     * at the borders.
+     */
+    void shareUniformTiles(const QRect &area);
+
+    /**
+     * \return the memory taken by the data of the tiles, which is not
+     * present in \p countedTileData yet. The newly counted data is
+     * added to the set, so the data shared between tiles (or data
+     * managers) is counted only once.
+     */
+    qint64 tileDataMemoryUsage(QSet<const KisTileData*> *countedTileData) const;
+
+    /**
+     * \return true if \p other has exactly the same set of tiles as
+     * this data manager and every pair of them shares the same tile
+     * data. Shared data is copied on write, so as long as both data
+     * managers are alive, it means that their content is the same.
+     */
+    bool sharesAllTileData(KisTiledDataManager *other) const;
+
+    /**
+     * \return the bounding rect of the pixels in \p rect that differ
+     * between this data manager and \p other. The comparison goes tile
+     * by tile: the tiles sharing the same tile data are skipped without
+     * reading them, the others are compared with memcmp() row by row.
+     * Both data managers must have the same pixel size.
+     */
+    QRect differingRect(KisTiledDataManager *other, const QRect &rect) const;
+
+    inline qint32 numTiles() const {
+        return m_hashTable->numTiles();
+    }
+
     /**
      * Clones rect from another datamanager. The cloned area will be
      * shared between both datamanagers as much as possible using
@@ -321,6 +364,12 @@ private:
     qint32 xToCol(qint32 x) const;
     qint32 yToRow(qint32 y) const;
 
+    /**
+     * Adds a tile, whose data is kept compressed in the swap file
+     * till the first access. Returns false if the swap is full.
+     */
+    bool addSwappedTile(qint32 col, qint32 row, const quint8 *buffer, qint32 bufferSize);
+
 private:
     void setDefaultPixelImpl(const quint8 *defPixel);
 
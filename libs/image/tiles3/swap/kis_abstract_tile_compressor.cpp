@@ -19,6 +19,7 @@
 #include "kis_abstract_tile_compressor.h"
 
 KisAbstractTileCompressor::KisAbstractTileCompressor()
+    : m_lazyLoading(false)
 {
 }
 
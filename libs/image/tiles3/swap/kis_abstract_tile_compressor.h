@@ -85,6 +85,20 @@ public:
      */
     virtual qint32 tileDataBufferSize(KisTileData *tileData) = 0;
 
+    /**
+     * When lazy loading is enabled, readTile() may put the tiles into
+     * the swap file without decompressing them. They are decompressed
+     * on the first access then. Compressors, whose format differs from
+     * the one of the swap file, ignore the option.
+     */
+    void setLazyLoading(bool value) {
+        m_lazyLoading = value;
+    }
+
+    bool lazyLoading() const {
+        return m_lazyLoading;
+    }
+
 protected:
     inline qint32 xToCol(KisTiledDataManager *dm, qint32 x) {
         return dm->xToCol(x);
@@ -97,6 +111,14 @@ protected:
     inline qint32 pixelSize(KisTiledDataManager *dm) {
         return dm->pixelSize();
     }
+
+    inline bool addSwappedTile(KisTiledDataManager *dm, qint32 col, qint32 row,
+                               const quint8 *buffer, qint32 bufferSize) {
+        return dm->addSwappedTile(col, row, buffer, bufferSize);
+    }
+
+private:
+    bool m_lazyLoading;
 };
 
 #endif /* __KIS_ABSTRACT_TILE_COMPRESSOR_H */
@@ -26,7 +26,8 @@
 //#define COMPRESSOR_VERSION 2
 
 KisSwappedDataStore::KisSwappedDataStore()
-    : m_memoryMetric(0)
+    : m_memoryMetric(0),
+      m_usedSpace(0)
 {
     KisImageConfig config;
     const quint64 maxSwapSize = config.maxSwapSize() * MiB;
@@ -36,6 +37,8 @@ KisSwappedDataStore::KisSwappedDataStore()
     m_allocator = new KisChunkAllocator(swapSlabSize, maxSwapSize);
     m_swapSpace = new KisMemoryWindow(config.swapDir(), swapWindowSize);
 
+    m_maxStoredSpace = maxSwapSize / 2;
+
     // FIXME: use a factory after the patch is committed
     m_compressor = new KisTileCompressor2();
 }
@@ -81,6 +84,28 @@ void KisSwappedDataStore::swapOutTileData(KisTileData *td)
     td->setSwapChunk(chunk);
 
     m_memoryMetric += td->pixelSize();
+    m_usedSpace += chunk.size();
+}
+
+bool KisSwappedDataStore::storeCompressedTileData(KisTileData *td, const quint8 *buffer, qint32 bufferSize)
+{
+    Q_ASSERT(!td->data());
+    QMutexLocker locker(&m_lock);
+
+    if (m_usedSpace + bufferSize > m_maxStoredSpace) {
+        return false;
+    }
+
+    KisChunk chunk = m_allocator->getChunk(bufferSize);
+    quint8 *ptr = m_swapSpace->getWriteChunkPtr(chunk);
+    memcpy(ptr, buffer, bufferSize);
+
+    td->setSwapChunk(chunk);
+
+    m_memoryMetric += td->pixelSize();
+    m_usedSpace += chunk.size();
+
+    return true;
 }
 
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
@@ -97,6 +122,8 @@ void KisSwappedDataStore::swapInTileData(KisTileData *td)
 
     quint8 *ptr = m_swapSpace->getReadChunkPtr(chunk);
     m_compressor->decompressTileData(ptr, chunk.size(), td);
+
+    m_usedSpace -= chunk.size();
     m_allocator->freeChunk(chunk);
 
     m_memoryMetric -= td->pixelSize();
@@ -106,6 +133,8 @@ void KisSwappedDataStore::forgetTileData(KisTileData *td)
 {
     QMutexLocker locker(&m_lock);
 
+    m_usedSpace -= td->swapChunk().size();
+
     m_allocator->freeChunk(td->swapChunk());
     td->setSwapChunk(KisChunk());
 
@@ -58,6 +58,17 @@ public:
      */
     void swapInTileData(KisTileData *td);
 
+    /**
+     * Put the data of \a td, which has already been compressed in
+     * the format of KisTileCompressor2, directly to the swap file.
+     * The memory of the tile data must not be allocated.
+     *
+     * Returns false if the swap file hasn't got enough free space
+     * for the data, then the \a td is left untouched.
+     * LOCKING: the tile data must not be accessible by anyone else
+     */
+    bool storeCompressedTileData(KisTileData *td, const quint8 *buffer, qint32 bufferSize);
+
     /**
      * Forget all the information linked with the tile data.
      * This should be done before deleting of the tile data,
@@ -86,6 +97,14 @@ private:
     QMutex m_lock;
 
     qint64 m_memoryMetric;
+
+    /**
+     * The number of bytes occupied in the swap file and the limit for
+     * the data put there by storeCompressedTileData(). The rest of the
+     * swap is left for the swapper.
+     */
+    quint64 m_usedSpace;
+    quint64 m_maxStoredSpace;
 };
 
 #endif /* __KIS_SWAPPED_DATA_STORE_H */
@@ -80,9 +80,20 @@ bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
         qint32 row = yToRow(dm, y);
         qint32 col = xToCol(dm, x);
 
-        KisTileSP tile = dm->getTile(col, row, true);
+        const qint64 bytesRead = stream->read(m_streamingBuffer.data(), dataSize);
+
+        /**
+         * The tile data in the file is stored in the same format as
+         * in the swap file, so it can be put there as it is and be
+         * decompressed only when someone accesses the tile
+         */
+        if (lazyLoading() && bytesRead == dataSize &&
+            addSwappedTile(dm, col, row, (quint8*)m_streamingBuffer.data(), dataSize)) {
+
+            return true;
+        }
 
-        stream->read(m_streamingBuffer.data(), dataSize);
+        KisTileSP tile = dm->getTile(col, row, true);
 
         tile->lockForWrite();
         bool res = decompressTileData((quint8*)m_streamingBuffer.data(), dataSize, tile->tileData());
@@ -22,6 +22,7 @@
 #include "tiles3/kis_tiled_data_manager.h"
 #include "tiles3/swap/kis_legacy_tile_compressor.h"
 #include "tiles3/swap/kis_tile_compressor_2.h"
+#include "tiles3/kis_tile_data_store.h"
 
 #include "tiles_test_utils.h"
 
@@ -180,5 +181,46 @@ void KisTileCompressorsTest::testLowLevelRoundTripIncompressible2()
 }
 
 
+void KisTileCompressorsTest::testLazyLoading2()
+{
+    KisAbstractTileCompressor *compressor = new KisTileCompressor2();
+
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    dm.clear(64, 64, 64, 64, &oddPixel1);
+
+    KoStoreFake fakeStore;
+    KisFakePaintDeviceWriter writer(&fakeStore);
+
+    KisTileSP tile11 = dm.getTile(1, 1, false);
+    QVERIFY(compressor->writeTile(tile11, writer));
+    tile11 = 0;
+
+    fakeStore.startReading();
+    dm.clear();
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    const qint32 tilesInMemory = store->numTilesInMemory();
+
+    compressor->setLazyLoading(true);
+    QVERIFY(compressor->readTile(fakeStore.device(), &dm));
+
+    // the tile is kept in the swap till the first access
+    QCOMPARE(store->numTilesInMemory(), tilesInMemory);
+    QCOMPARE(dm.extent(), QRect(64, 64, 64, 64));
+
+    tile11 = dm.getTile(1, 1, false);
+    tile11->lockForRead();
+    QVERIFY(memoryIsFilled(oddPixel1, tile11->data(), TILESIZE));
+    tile11->unlock();
+    tile11 = 0;
+
+    QCOMPARE(store->numTilesInMemory(), tilesInMemory + 1);
+
+    delete compressor;
+}
+
 QTEST_MAIN(KisTileCompressorsTest)
 
@@ -807,5 +807,97 @@ void KisTiledDataManagerTest::stressTest()
     pool.waitForDone();
 }
 
+void KisTiledDataManagerTest::testShareUniformTiles()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 255;
+    quint8 oddPixel2 = 128;
+
+    const QRect rect(0, 0, 512, 512);
+    const QRect fillRect(0, 0, 256, 256);
+
+    // write the data pixel by pixel, so that every tile gets its own data
+    QVector<quint8> buffer(rect.width() * rect.height(), defaultPixel);
+    for (int y = fillRect.top(); y <= fillRect.bottom(); y++) {
+        for (int x = fillRect.left(); x <= fillRect.right(); x++) {
+            buffer[y * rect.width() + x] = oddPixel1;
+        }
+    }
+    buffer[300 * rect.width() + 300] = oddPixel2;
+
+    dm.writeBytes(buffer.data(), rect.x(), rect.y(), rect.width(), rect.height());
+
+    QCOMPARE(dm.numTiles(), 64);
+
+    QSet<const KisTileData*> countedTileData;
+    QCOMPARE(dm.tileDataMemoryUsage(&countedTileData), qint64(64 * TILESIZE));
+
+    dm.shareUniformTiles(rect);
+
+    // the default tiles are removed
+    QCOMPARE(dm.numTiles(), 17);
+    QCOMPARE(dm.extent(), QRect(0, 0, 320, 320));
+
+    // the filled tiles share one data
+    countedTileData.clear();
+    QCOMPARE(dm.tileDataMemoryUsage(&countedTileData), qint64(2 * TILESIZE));
+
+    QVector<quint8> result(buffer.size());
+    dm.readBytes(result.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(result == buffer);
+
+    // the shared data is copied on write
+    dm.clear(QRect(0, 0, 10, 10), &oddPixel2);
+
+    KisTileSP tile00 = dm.getTile(0, 0, false);
+    KisTileSP tile10 = dm.getTile(1, 0, false);
+    QVERIFY(memoryIsFilled(oddPixel1, tile10->data(), TILESIZE));
+    QVERIFY(!memoryIsFilled(oddPixel1, tile00->data(), TILESIZE));
+    tile00 = tile10 = 0;
+
+    countedTileData.clear();
+    QCOMPARE(dm.tileDataMemoryUsage(&countedTileData), qint64(3 * TILESIZE));
+
+    // sharing again changes nothing
+    dm.shareUniformTiles(rect);
+    countedTileData.clear();
+    QCOMPARE(dm.tileDataMemoryUsage(&countedTileData), qint64(3 * TILESIZE));
+}
+
+void KisTiledDataManagerTest::testDifferingRect()
+{
+    quint8 defaultPixel = 0;
+    quint8 oddPixel = 128;
+
+    KisTiledDataManager dm(1, &defaultPixel);
+    dm.clear(QRect(0, 0, 200, 200), &oddPixel);
+
+    // the copy shares all the tiles
+    KisTiledDataManager copy(dm);
+    QCOMPARE(dm.differingRect(&copy, QRect(0, 0, 300, 300)), QRect());
+
+    // two separate changes in different tiles
+    copy.clear(QRect(10, 20, 3, 2), &defaultPixel);
+    copy.clear(QRect(150, 70, 1, 1), &defaultPixel);
+
+    QCOMPARE(dm.differingRect(&copy, QRect(0, 0, 300, 300)), QRect(10, 20, 141, 51));
+    QCOMPARE(copy.differingRect(&dm, QRect(0, 0, 300, 300)), QRect(10, 20, 141, 51));
+
+    // only the requested area is compared
+    QCOMPARE(dm.differingRect(&copy, QRect(0, 0, 100, 100)), QRect(10, 20, 3, 2));
+    QCOMPARE(dm.differingRect(&copy, QRect(11, 0, 100, 100)), QRect(11, 20, 2, 2));
+    QCOMPARE(dm.differingRect(&copy, QRect(100, 100, 100, 100)), QRect());
+
+    // the data is compared, not the tiles themselves
+    KisTiledDataManager other(1, &defaultPixel);
+    other.clear(QRect(0, 0, 200, 200), &oddPixel);
+    QCOMPARE(dm.differingRect(&other, QRect(0, 0, 300, 300)), QRect());
+
+    other.clear(QRect(199, 199, 1, 1), &defaultPixel);
+    QCOMPARE(dm.differingRect(&other, QRect(0, 0, 300, 300)), QRect(199, 199, 1, 1));
+}
+
 QTEST_MAIN(KisTiledDataManagerTest)
 
@@ -52,6 +52,8 @@ private Q_SLOTS:
     void testTransactions();
     void testPurgeHistory();
     void testUndoSetDefaultPixel();
+    void testShareUniformTiles();
+    void testDifferingRect();
 
     void benchmarkReadOnlyTileLazy();
     void benchmarkSharedPointers();
@@ -25,9 +25,11 @@
 
 #include <KoStore.h>
 #include <KoXmlReader.h>
+#include <KoXmlNS.h>
 
 #include "KoOdfStylesReader.h"
 
+#include <QBuffer>
 #include <QXmlStreamReader>
 
 class Q_DECL_HIDDEN KoOdfReadStore::Private
@@ -44,6 +46,8 @@ public:
     KoXmlDocument stylesDoc;
     KoXmlDocument contentDoc;
     KoXmlDocument settingsDoc;
+    // the raw content.xml read by loadAndParseUntilBody()
+    QBuffer contentBuffer;
 };
 
 KoOdfReadStore::KoOdfReadStore(KoStore *store)
@@ -98,6 +102,67 @@ bool KoOdfReadStore::loadAndParse(QString &errorMessage)
     return true;
 }
 
+bool KoOdfReadStore::loadAndParseUntilBody(QXmlStreamReader &reader, QString &errorMessage)
+{
+    if (d->store->hasFile("styles.xml")) {
+        if (!loadAndParse("styles.xml", d->stylesDoc, errorMessage)) {
+            return false;
+        }
+    }
+    d->stylesReader.createStyleMap(d->stylesDoc, true);
+
+    // settings.xml has to be read before content.xml is opened,
+    // the store can have only one file open at a time
+    if (d->store->hasFile("settings.xml")) {
+        loadAndParse("settings.xml", d->settingsDoc, errorMessage);
+    }
+
+    if (!d->store->open("content.xml")) {
+        debugOdf << "Entry content.xml not found!";
+        errorMessage = i18n("Could not find %1", QString("content.xml"));
+        return false;
+    }
+
+    /**
+     * The body is parsed while the shapes are being loaded, and they
+     * open their own files in the store. The store can have only one
+     * file open at a time, so the text of content.xml is read into
+     * memory and the store is closed right away.
+     */
+    d->contentBuffer.close();
+    d->contentBuffer.setData(d->store->read(d->store->size()));
+    d->store->close();
+    d->contentBuffer.open(QIODevice::ReadOnly);
+
+    reader.setDevice(&d->contentBuffer);
+    reader.setNamespaceProcessing(true);
+
+    QString errorMsg;
+    int errorLine, errorColumn;
+
+    bool ok = d->contentDoc.setContentUntil(&reader, KoXmlNS::office, "body",
+                                            &errorMsg, &errorLine, &errorColumn);
+    if (!ok) {
+        errorOdf << "Parsing error in content.xml! Aborting!" << endl
+        << " In line: " << errorLine << ", column: " << errorColumn << endl
+        << " Error message: " << errorMsg << endl;
+        errorMessage = i18n("Parsing error in the main document at line %1, column %2\nError message: %3"
+                            , errorLine , errorColumn , errorMsg);
+    } else if (!reader.isStartElement()) {
+        errorMessage = i18n("Invalid OASIS document. No office:body tag found.");
+        ok = false;
+    }
+
+    if (!ok) {
+        return false;
+    }
+
+    // styles of content.xml are stored in front of the body
+    d->stylesReader.createStyleMap(d->contentDoc, false);
+
+    return true;
+}
+
 bool KoOdfReadStore::loadAndParse(const QString &fileName, KoXmlDocument &doc, QString &errorMessage)
 {
     if (!d->store) {
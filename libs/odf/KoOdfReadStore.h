@@ -25,6 +25,7 @@
 
 class QString;
 class QIODevice;
+class QXmlStreamReader;
 class KoStore;
 class KoOdfStylesReader;
 
@@ -92,6 +93,24 @@ public:
      */
     bool loadAndParse(QString &errorMessage);
 
+    /**
+     * Streaming variant of loadAndParse() for documents with a huge body
+     *
+     * styles.xml and settings.xml are loaded as usual, but content.xml is
+     * parsed only up to office:body, so contentDoc() contains everything
+     * but the body, and the styles of content.xml are available in styles().
+     * \p reader is left positioned at the start of office:body, so that the
+     * body can be pulled from it element by element. The reader reads from
+     * a copy of content.xml owned by this object, which should outlive
+     * \p reader. No file of the store is kept open.
+     *
+     * @param reader The reader to read content.xml with
+     * @param errorMessage The errorMessage is set in case an error is encounted.
+     * @return true if loading and parsing was successful and office:body
+     * was found, false otherwise.
+     */
+    bool loadAndParseUntilBody(QXmlStreamReader &reader, QString &errorMessage);
+
     /**
      * Load a file from an odf store
      */
@@ -6,6 +6,7 @@
 #include <QProcess>
 #include <QString>
 #include <QTextStream>
+#include <QXmlStreamReader>
 
 #include <KoXmlReader.h>
 
@@ -38,6 +39,10 @@ private Q_SLOTS:
     void testSimpleOpenDocumentFormula();
     void testLargeOpenDocumentSpreadsheet();
     void testExternalOpenDocumentSpreadsheet(const QString& filename);
+    void testSetContentUntil();
+    void testSetContentFromCurrentElement();
+    void benchmarkLargeDrawingWholeDocument();
+    void benchmarkLargeDrawingStreaming();
 };
 
 void TestXmlReader::testNode()
@@ -2782,6 +2787,247 @@ void TestXmlReader::testExternalOpenDocumentSpreadsheet(const QString& filename)
     xmlfile.remove();
 }
 
+void TestXmlReader::testSetContentUntil()
+{
+    QString errorMsg;
+    int errorLine = 0;
+    int errorColumn = 0;
+
+    QBuffer xmldevice;
+    xmldevice.open(QIODevice::WriteOnly);
+    QTextStream xmlstream(&xmldevice);
+    xmlstream.setCodec("UTF-8");
+    xmlstream << "<office:document-content ";
+    xmlstream << "xmlns:office=\"urn:oasis:names:tc:opendocument:xmlns:office:1.0\" ";
+    xmlstream << "xmlns:draw=\"urn:oasis:names:tc:opendocument:xmlns:drawing:1.0\">";
+    xmlstream << "<office:automatic-styles>";
+    xmlstream << "<draw:body/>";
+    xmlstream << "</office:automatic-styles>";
+    xmlstream << "<office:body>";
+    xmlstream << "<office:drawing/>";
+    xmlstream << "</office:body>";
+    xmlstream << "</office:document-content>";
+    xmldevice.close();
+
+    QString officeNS = "urn:oasis:names:tc:opendocument:xmlns:office:1.0";
+
+    xmldevice.open(QIODevice::ReadOnly);
+    QXmlStreamReader reader(&xmldevice);
+    reader.setNamespaceProcessing(true);
+
+    KoXmlDocument doc;
+
+    // <draw:body> in the styles has a different namespace, so it doesn't stop parsing
+    QCOMPARE(doc.setContentUntil(&reader, officeNS, "body",
+                                 &errorMsg, &errorLine, &errorColumn), true);
+    QCOMPARE(errorMsg.isEmpty(), true);
+
+    // the reader waits at the start of the first body
+    QCOMPARE(reader.isStartElement(), true);
+    QCOMPARE(reader.name().toString(), QString("body"));
+    QCOMPARE(reader.namespaceUri().toString(), officeNS);
+    QCOMPARE(reader.readNextStartElement(), true);
+    QCOMPARE(reader.name().toString(), QString("drawing"));
+
+    // <office:document-content>
+    KoXmlElement contentElement = doc.documentElement();
+    QCOMPARE(contentElement.isNull(), false);
+    QCOMPARE(contentElement.localName(), QString("document-content"));
+    QCOMPARE(KoXml::childNodesCount(contentElement), 1);
+
+    // <office:automatic-styles> is complete
+    KoXmlElement stylesElement = contentElement.firstChildElement();
+    QCOMPARE(stylesElement.isNull(), false);
+    QCOMPARE(stylesElement.localName(), QString("automatic-styles"));
+    QCOMPARE(KoXml::childNodesCount(stylesElement), 1);
+    QCOMPARE(stylesElement.firstChildElement().localName(), QString("body"));
+    QCOMPARE(stylesElement.firstChildElement().namespaceURI(),
+             QString("urn:oasis:names:tc:opendocument:xmlns:drawing:1.0"));
+
+    // <office:body> is left out
+    QCOMPARE(KoXml::namedItemNS(contentElement, officeNS, "body").isNull(), true);
+}
+
+void TestXmlReader::testSetContentFromCurrentElement()
+{
+    QString errorMsg;
+    int errorLine = 0;
+    int errorColumn = 0;
+
+    QBuffer xmldevice;
+    xmldevice.open(QIODevice::WriteOnly);
+    QTextStream xmlstream(&xmldevice);
+    xmlstream.setCodec("UTF-8");
+    xmlstream << "<solarsystem xmlns:moons=\"http://www.example.org/moons\">";
+    xmlstream << "<earth size=\"1\"><moons:moon name=\"Moon\"/></earth>";
+    xmlstream << "<mars size=\"0.5\"><moons:moon name=\"Phobos\"/><moons:moon name=\"Deimos\"/></mars>";
+    xmlstream << "<jupiter size=\"11\"><moons:moon name=\"Io\"></jupiter>";
+    xmlstream << "</solarsystem>";
+    xmldevice.close();
+
+    xmldevice.open(QIODevice::ReadOnly);
+    QXmlStreamReader reader(&xmldevice);
+    reader.setNamespaceProcessing(true);
+
+    QCOMPARE(reader.readNextStartElement(), true);
+    QCOMPARE(reader.name().toString(), QString("solarsystem"));
+
+    KoXmlDocument doc;
+
+    // <earth>
+    QCOMPARE(reader.readNextStartElement(), true);
+    QCOMPARE(doc.setContentFromCurrentElement(&reader, &errorMsg, &errorLine, &errorColumn), true);
+    QCOMPARE(errorMsg.isEmpty(), true);
+    QCOMPARE(reader.isEndElement(), true);
+    QCOMPARE(reader.name().toString(), QString("earth"));
+
+    KoXmlElement planetElement = doc.documentElement();
+    QCOMPARE(planetElement.isNull(), false);
+    QCOMPARE(planetElement.tagName(), QString("earth"));
+    QCOMPARE(planetElement.attribute("size"), QString("1"));
+    QCOMPARE(KoXml::childNodesCount(planetElement), 1);
+
+    // the namespace declared in the parent element is still known
+    KoXmlElement moonElement = planetElement.firstChildElement();
+    QCOMPARE(moonElement.localName(), QString("moon"));
+    QCOMPARE(moonElement.namespaceURI(), QString("http://www.example.org/moons"));
+    QCOMPARE(moonElement.attribute("name"), QString("Moon"));
+
+    // <mars>
+    QCOMPARE(reader.readNextStartElement(), true);
+    QCOMPARE(doc.setContentFromCurrentElement(&reader, &errorMsg, &errorLine, &errorColumn), true);
+    QCOMPARE(errorMsg.isEmpty(), true);
+
+    planetElement = doc.documentElement();
+    QCOMPARE(planetElement.tagName(), QString("mars"));
+    QCOMPARE(KoXml::childNodesCount(planetElement), 2);
+    QCOMPARE(planetElement.lastChild().toElement().attribute("name"), QString("Deimos"));
+
+    // <jupiter> is broken
+    QCOMPARE(reader.readNextStartElement(), true);
+    QCOMPARE(doc.setContentFromCurrentElement(&reader, &errorMsg, &errorLine, &errorColumn), false);
+    QCOMPARE(errorMsg, QString("Opening and ending tag mismatch."));
+    QCOMPARE(reader.hasError(), true);
+}
+
+static void createLargeDrawing(QBuffer &xmldevice, int numPaths)
+{
+    xmldevice.open(QIODevice::WriteOnly);
+    QTextStream xmlstream(&xmldevice);
+    xmlstream.setCodec("UTF-8");
+
+    xmlstream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    xmlstream << "<office:document-content ";
+    xmlstream << "xmlns:office=\"urn:oasis:names:tc:opendocument:xmlns:office:1.0\" ";
+    xmlstream << "xmlns:style=\"urn:oasis:names:tc:opendocument:xmlns:style:1.0\" ";
+    xmlstream << "xmlns:draw=\"urn:oasis:names:tc:opendocument:xmlns:drawing:1.0\" ";
+    xmlstream << "xmlns:svg=\"urn:oasis:names:tc:opendocument:xmlns:svg-compatible:1.0\">\n";
+    xmlstream << "<office:automatic-styles>\n";
+    xmlstream << "<style:style style:name=\"gr1\" style:family=\"graphic\">";
+    xmlstream << "<style:graphic-properties draw:stroke=\"solid\" svg:stroke-width=\"1pt\"/>";
+    xmlstream << "</style:style>\n";
+    xmlstream << "</office:automatic-styles>\n";
+    xmlstream << "<office:body>\n";
+    xmlstream << "<office:drawing>\n";
+    xmlstream << "<draw:page draw:name=\"page1\">\n";
+
+    for (int i = 0; i < numPaths; i++) {
+        xmlstream << "<draw:path draw:style-name=\"gr1\" draw:z-index=\"" << i << "\" ";
+        xmlstream << "svg:width=\"100pt\" svg:height=\"100pt\" svg:x=\"" << i % 1000 << "pt\" svg:y=\"0pt\" ";
+        xmlstream << "svg:viewBox=\"0 0 100 100\" svg:d=\"M0 0";
+        for (int j = 0; j < 32; j++) {
+            xmlstream << "C" << j << " " << j + 1 << " " << j + 2 << " " << j + 3 << " " << j + 4 << " " << j + 5;
+        }
+        xmlstream << "Z\"/>\n";
+    }
+
+    xmlstream << "</draw:page>\n";
+    xmlstream << "</office:drawing>\n";
+    xmlstream << "</office:body>\n";
+    xmlstream << "</office:document-content>\n";
+    xmlstream.flush();
+    xmldevice.close();
+}
+
+void TestXmlReader::benchmarkLargeDrawingWholeDocument()
+{
+    const int numPaths = 20000;
+
+    QBuffer xmldevice;
+    createLargeDrawing(xmldevice, numPaths);
+    QString officeNS = "urn:oasis:names:tc:opendocument:xmlns:office:1.0";
+    QString drawNS = "urn:oasis:names:tc:opendocument:xmlns:drawing:1.0";
+    QString svgNS = "urn:oasis:names:tc:opendocument:xmlns:svg-compatible:1.0";
+
+    int numLoaded = 0;
+
+    QBENCHMARK_ONCE {
+        KoXmlDocument doc;
+        QCOMPARE(doc.setContent(&xmldevice, true), true);
+
+        KoXmlElement body = KoXml::namedItemNS(doc.documentElement(), officeNS, "body");
+        KoXmlElement drawing = KoXml::namedItemNS(body, officeNS, "drawing");
+        KoXmlElement page = KoXml::namedItemNS(drawing, drawNS, "page");
+        QCOMPARE(page.isNull(), false);
+
+        KoXmlElement path;
+        forEachElement(path, page) {
+            if (path.localName() == "path" && path.namespaceURI() == drawNS &&
+                !path.attributeNS(svgNS, "d").isEmpty()) {
+
+                numLoaded++;
+            }
+        }
+    }
+
+    QCOMPARE(numLoaded, numPaths);
+}
+
+void TestXmlReader::benchmarkLargeDrawingStreaming()
+{
+    const int numPaths = 20000;
+
+    QBuffer xmldevice;
+    createLargeDrawing(xmldevice, numPaths);
+    QString officeNS = "urn:oasis:names:tc:opendocument:xmlns:office:1.0";
+    QString drawNS = "urn:oasis:names:tc:opendocument:xmlns:drawing:1.0";
+    QString svgNS = "urn:oasis:names:tc:opendocument:xmlns:svg-compatible:1.0";
+
+    int numLoaded = 0;
+
+    QBENCHMARK_ONCE {
+        xmldevice.open(QIODevice::ReadOnly);
+        QXmlStreamReader reader(&xmldevice);
+        reader.setNamespaceProcessing(true);
+
+        KoXmlDocument headDoc;
+        QCOMPARE(headDoc.setContentUntil(&reader, officeNS, "body"), true);
+        QCOMPARE(reader.isStartElement(), true);
+
+        // <office:drawing> and <draw:page>
+        QCOMPARE(reader.readNextStartElement(), true);
+        QCOMPARE(reader.readNextStartElement(), true);
+        QCOMPARE(reader.name().toString(), QString("page"));
+
+        while (reader.readNextStartElement()) {
+            KoXmlDocument pathDoc;
+            QCOMPARE(pathDoc.setContentFromCurrentElement(&reader), true);
+
+            KoXmlElement path = pathDoc.documentElement();
+            if (path.localName() == "path" && path.namespaceURI() == drawNS &&
+                !path.attributeNS(svgNS, "d").isEmpty()) {
+
+                numLoaded++;
+            }
+        }
+
+        QCOMPARE(reader.hasError(), false);
+        xmldevice.close();
+    }
+
+    QCOMPARE(numLoaded, numPaths);
+}
+
 QTEST_GUILESS_MAIN(TestXmlReader)
 #include <TestXmlReader.moc>
 
@@ -19,6 +19,7 @@
 #include "KoBasicHistogramProducers.h"
 
 #include <QString>
+#include <QVarLengthArray>
 #include <klocalizedstring.h>
 
 #include <KoConfig.h>
@@ -100,6 +101,19 @@ void KoBasicHistogramProducer::makeExternalToInternal()
     }
 }
 
+const quint8* KoBasicHistogramProducer::convertToProducerSpace(const quint8 *pixels, quint32 nPixels, const KoColorSpace *cs)
+{
+    if (*cs == *m_colorSpace) return pixels;
+
+    const int bufferSize = nPixels * m_colorSpace->pixelSize();
+    if (m_conversionBuffer.size() < bufferSize) {
+        m_conversionBuffer.resize(bufferSize);
+    }
+
+    cs->convertPixelsTo(pixels, m_conversionBuffer.data(), m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
+    return m_conversionBuffer.constData();
+}
+
 // ------------ U8 ---------------------
 
 KoBasicU8HistogramProducer::KoBasicU8HistogramProducer(const KoID& id, const KoColorSpace *cs)
@@ -114,37 +128,45 @@ QString KoBasicU8HistogramProducer::positionToString(qreal pos) const
 
 void KoBasicU8HistogramProducer::addRegionToBin(const quint8 * pixels, const quint8 * selectionMask, quint32 nPixels, const KoColorSpace *cs)
 {
-    quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
+    const quint32 srcPixelSize = cs->pixelSize();
+    const quint32 dstPixelSize = m_colorSpace->pixelSize();
+    const int channelCount = m_colorSpace->channelCount();
+    const quint8 *dst = convertToProducerSpace(pixels, nPixels, cs);
+
+    /**
+     * Fetch the raw bins pointers in advance to avoid QVector's
+     * detach checks in the inner loop
+     */
+    QVarLengthArray<quint32*, 8> bins(channelCount);
+    for (int i = 0; i < channelCount; i++) {
+        bins[i] = m_bins[i].data();
+    }
 
-    if (selectionMask) {
-        quint8 *dst = dstPixels;
-        while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
+    /**
+     * All the color spaces handled by this producer are 8-bit, so in
+     * a common case the channel value is the bin index itself
+     */
+    const bool isPlainU8 = dstPixelSize == quint32(channelCount);
 
-                for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
-                    m_bins[i][m_colorSpace->scaleToU8(dst,i)]++;
-                }
-                m_count++;
-            }
-            dst += dstPixelSize;
-            selectionMask++;
-            nPixels--;
-        }
-    } else {
-        quint8 *dst = dstPixels;
-        while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
+    while (nPixels > 0) {
+        if (!((selectionMask && m_skipUnselected && *selectionMask == 0) ||
+              (m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8))) {
 
-                for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
-                    m_bins[i][m_colorSpace->scaleToU8(dst,i)]++;
+            if (isPlainU8) {
+                for (int i = 0; i < channelCount; i++) {
+                    bins[i][dst[i]]++;
+                }
+            } else {
+                for (int i = 0; i < channelCount; i++) {
+                    bins[i][m_colorSpace->scaleToU8(dst, i)]++;
                 }
-                m_count++;
             }
-            dst += dstPixelSize;
-            nPixels--;
+            m_count++;
         }
+        pixels += srcPixelSize;
+        dst += dstPixelSize;
+        if (selectionMask) selectionMask++;
+        nPixels--;
     }
 }
 
@@ -173,50 +195,52 @@ void KoBasicU16HistogramProducer::addRegionToBin(const quint8 * pixels, const qu
     quint16 to = from + width;
     qreal factor = 255.0 / width;
 
-    quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
-    quint8 *dst = dstPixels;
-    QVector<float> channels(m_colorSpace->channelCount());
-
-    if (selectionMask) {
-        while (nPixels > 0) {
-            if (!((m_skipUnselected && *selectionMask == 0) || (m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8))) {
-                m_colorSpace->normalisedChannelsValue(dst,channels);
-                for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
-                    quint16 value = channels[i]*UINT16_MAX;
-                    if (value > to)
-                        m_outRight[i]++;
-                    else if (value < from)
-                        m_outLeft[i]++;
-                    else
-                        m_bins[i][static_cast<quint8>((value - from) * factor)]++;
+    const quint32 srcPixelSize = cs->pixelSize();
+    const quint32 dstPixelSize = m_colorSpace->pixelSize();
+    const int channelCount = m_colorSpace->channelCount();
+    const quint8 *dst = convertToProducerSpace(pixels, nPixels, cs);
+    QVector<float> channels(channelCount);
+    QVarLengthArray<quint16, 8> values(channelCount);
+
+    /**
+     * All the color spaces handled by this producer are 16-bit, so in
+     * a common case we can read the values directly, without
+     * normalizing them through the color space
+     */
+    const bool isPlainU16 = dstPixelSize == quint32(channelCount) * sizeof(quint16);
+
+    while (nPixels > 0) {
+        if (!((selectionMask && m_skipUnselected && *selectionMask == 0) ||
+              (m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8))) {
+
+            if (isPlainU16) {
+                const quint16 *nativeValues = reinterpret_cast<const quint16*>(dst);
+                for (int i = 0; i < channelCount; i++) {
+                    values[i] = nativeValues[i];
+                }
+            } else {
+                m_colorSpace->normalisedChannelsValue(dst, channels);
+                for (int i = 0; i < channelCount; i++) {
+                    values[i] = channels[i] * UINT16_MAX;
                 }
-                m_count++;
             }
-            dst += dstPixelSize;
-            selectionMask++;
-            nPixels--;
-        }
-    } else {
-        while (nPixels > 0) {
-            if (!(m_skipTransparent && cs->opacityU8(pixels) == OPACITY_TRANSPARENT_U8)) {
-                m_colorSpace->normalisedChannelsValue(dst,channels);
-                for (int i = 0; i < (int)m_colorSpace->channelCount(); i++) {
-                    quint16 value = channels[i]*UINT16_MAX;
 
-                    if (value > to)
-                        m_outRight[i]++;
-                    else if (value < from)
-                        m_outLeft[i]++;
-                    else
-                        m_bins[i][static_cast<quint8>((value - from) * factor)]++;
-                }
-                m_count++;
+            for (int i = 0; i < channelCount; i++) {
+                const quint16 value = values[i];
+
+                if (value > to)
+                    m_outRight[i]++;
+                else if (value < from)
+                    m_outLeft[i]++;
+                else
+                    m_bins[i][static_cast<quint8>((value - from) * factor)]++;
             }
-            dst += dstPixelSize;
-            nPixels--;
+            m_count++;
         }
+        pixels += srcPixelSize;
+        dst += dstPixelSize;
+        if (selectionMask) selectionMask++;
+        nPixels--;
     }
 }
 
@@ -246,9 +270,7 @@ void KoBasicF32HistogramProducer::addRegionToBin(const quint8 * pixels, const qu
     float factor = 255.0 / width;
 
     quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
-    quint8 *dst = dstPixels;
+    const quint8 *dst = convertToProducerSpace(pixels, nPixels, cs);
     QVector<float> channels(m_colorSpace->channelCount());
 
     if (selectionMask) {
@@ -321,9 +343,7 @@ void KoBasicF16HalfHistogramProducer::addRegionToBin(const quint8 * pixels, cons
     float factor = 255.0 / width;
 
     quint32 dstPixelSize = m_colorSpace->pixelSize();
-    quint8 *dstPixels = new quint8[nPixels * dstPixelSize];
-    cs->convertPixelsTo(pixels, dstPixels, m_colorSpace, nPixels, KoColorConversionTransformation::IntentAbsoluteColorimetric, KoColorConversionTransformation::Empty);
-    quint8 *dst = dstPixels;
+    const quint8 *dst = convertToProducerSpace(pixels, nPixels, cs);
     QVector<float> channels(m_colorSpace->channelCount());
 
     if (selectionMask) {
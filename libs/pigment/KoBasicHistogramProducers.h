@@ -90,6 +90,15 @@ protected:
     }
     // not virtual since that is useless: we call it from constructor
     void makeExternalToInternal();
+
+    /**
+     * Converts \p nPixels pixels into the color space of the producer.
+     * If the color spaces are the same, \p pixels is returned as it is,
+     * otherwise the data is converted into an internal buffer, which
+     * is reused between the calls.
+     */
+    const quint8* convertToProducerSpace(const quint8 *pixels, quint32 nPixels, const KoColorSpace *cs);
+
     typedef QVector<quint32> vBins;
     QVector<vBins> m_bins;
     vBins m_outLeft, m_outRight;
@@ -99,6 +108,7 @@ protected:
     const KoColorSpace *m_colorSpace;
     KoID m_id;
     QVector<qint32> m_external;
+    QVector<quint8> m_conversionBuffer;
 };
 
 class KRITAPIGMENT_EXPORT KoBasicU8HistogramProducer : public KoBasicHistogramProducer
@@ -291,6 +291,22 @@ class KoXmlPackedDocument
 {
 public:
     bool processNamespace;
+
+    // parsing is interrupted at the first element with this name,
+    // see KoXmlDocument::setContentUntil()
+    QString stopNamespaceURI;
+    QString stopLocalName;
+    bool stopped;
+
+    bool checkStopElement(const QXmlStreamReader &xml) {
+        if (!stopLocalName.isEmpty() &&
+            xml.name() == stopLocalName &&
+            xml.namespaceUri() == stopNamespaceURI) {
+
+            stopped = true;
+        }
+        return stopped;
+    }
 #ifdef KOXML_COMPACT
     // map given depth to the list of items
     QHash<int, KoXmlPackedGroup> groups;
@@ -390,6 +406,7 @@ public:
 
     void clear() {
         currentDepth = 0;
+        stopped = false;
         qnameHash.clear();
         qnameList.clear();
         valueHash.clear();
@@ -458,7 +475,7 @@ public:
     }
 
 public:
-    KoXmlPackedDocument(): processNamespace(false), currentDepth(0) {
+    KoXmlPackedDocument(): processNamespace(false), stopped(false), currentDepth(0) {
         clear();
     }
 
@@ -556,6 +573,7 @@ public:
         valueList.clear();
         items.clear();
         elementDepth = 0;
+        stopped = false;
 
         KoXmlPackedItem& rootItem = newItem();
         rootItem.attr = false;
@@ -571,7 +589,7 @@ public:
         items.squeeze();
     }
 
-    KoXmlPackedDocument(): processNamespace(false), elementDepth(0) {
+    KoXmlPackedDocument(): processNamespace(false), stopped(false), elementDepth(0) {
     }
 
 #endif
@@ -601,7 +619,9 @@ namespace {
         while (!xml.atEnd() && xml.tokenType() != QXmlStreamReader::EndDocument && !xml.hasError()) {
             switch (xml.tokenType()) {
             case QXmlStreamReader::StartElement:
-                parseElement(xml, doc, stripSpaces);
+                if (!doc.checkStopElement(xml)) {
+                    parseElement(xml, doc, stripSpaces);
+                }
                 break;
             case QXmlStreamReader::DTD:
                 doc.addDTD(xml.dtdName().toString());
@@ -617,6 +637,10 @@ namespace {
             default:
                 break;
             }
+            if (doc.stopped) {
+                // leave the reader at the start of the stop element
+                break;
+            }
             xml.readNext();
         }
         if (xml.hasError()) {
@@ -630,6 +654,28 @@ namespace {
         return error;
     }
 
+    // parse the element the reader is positioned at as if it were a
+    // standalone xml document, the reader is left at its end element
+    ParseError parseCurrentElement(QXmlStreamReader &xml, KoXmlPackedDocument &doc, bool stripSpaces = true)
+    {
+        doc.clear();
+        ParseError error;
+        if (xml.tokenType() == QXmlStreamReader::StartElement) {
+            parseElement(xml, doc, stripSpaces);
+        } else if (!xml.hasError()) {
+            xml.raiseError(QLatin1String("Expected start of an element."));
+        }
+        if (xml.hasError()) {
+            error.error = true;
+            error.errorMsg = xml.errorString();
+            error.errorColumn = xml.columnNumber();
+            error.errorLine = xml.lineNumber();
+        } else {
+            doc.finish();
+        }
+        return error;
+    }
+
     void parseElementContents(QXmlStreamReader &xml, KoXmlPackedDocument &doc)
     {
         xml.readNext();
@@ -648,8 +694,14 @@ namespace {
                     doc.addText(ws);
                     ws.clear();
                 }
+                if (doc.checkStopElement(xml)) {
+                    return;
+                }
                 // Do not strip spaces
                 parseElement(xml, doc, false);
+                if (doc.stopped) {
+                    return;
+                }
                 break;
             case QXmlStreamReader::Characters:
                 if (xml.isCDATA()) {
@@ -684,9 +736,15 @@ namespace {
                 }
                 return;
             case QXmlStreamReader::StartElement:
+                if (doc.checkStopElement(xml)) {
+                    return;
+                }
                 sawElement = true;
                 // Do strip spaces
                 parseElement(xml, doc, true);
+                if (doc.stopped) {
+                    return;
+                }
                 break;
             case QXmlStreamReader::Characters:
                 if (xml.isCDATA()) {
@@ -1451,8 +1509,17 @@ public:
     KoXmlDocumentData(unsigned long initialRefCount = 1);
     ~KoXmlDocumentData();
 
+    enum ParseMode {
+        ParseWholeDocument,
+        ParseUntilStopElement,
+        ParseCurrentElement
+    };
+
     bool setContent(QXmlStreamReader *reader,
-                    QString* errorMsg = 0, int* errorLine = 0, int* errorColumn = 0);
+                    QString* errorMsg = 0, int* errorLine = 0, int* errorColumn = 0,
+                    ParseMode mode = ParseWholeDocument,
+                    const QString &stopNamespaceURI = QString(),
+                    const QString &stopLocalName = QString());
 
     KoXmlDocumentType dt;
 
@@ -1475,7 +1542,8 @@ KoXmlDocumentData::~KoXmlDocumentData()
 {
 }
 
-bool KoXmlDocumentData::setContent(QXmlStreamReader* reader, QString* errorMsg, int* errorLine, int* errorColumn)
+bool KoXmlDocumentData::setContent(QXmlStreamReader* reader, QString* errorMsg, int* errorLine, int* errorColumn,
+                                   ParseMode mode, const QString &stopNamespaceURI, const QString &stopLocalName)
 {
     // sanity checks
     if (!reader) return false;
@@ -1489,7 +1557,16 @@ bool KoXmlDocumentData::setContent(QXmlStreamReader* reader, QString* errorMsg,
     packedDoc = new KoXmlPackedDocument;
     packedDoc->processNamespace = reader->namespaceProcessing();
 
-    ParseError error = parseDocument(*reader, *packedDoc, stripSpaces);
+    ParseError error;
+    if (mode == ParseCurrentElement) {
+        error = parseCurrentElement(*reader, *packedDoc, stripSpaces);
+    } else {
+        if (mode == ParseUntilStopElement) {
+            packedDoc->stopNamespaceURI = stopNamespaceURI;
+            packedDoc->stopLocalName = stopLocalName;
+        }
+        error = parseDocument(*reader, *packedDoc, stripSpaces);
+    }
     if (error.error) {
         // parsing error has occurred
         if (errorMsg) *errorMsg = error.errorMsg;
@@ -2152,6 +2229,40 @@ bool KoXmlDocument::setContent(QXmlStreamReader *reader,
     return result;
 }
 
+bool KoXmlDocument::setContentUntil(QXmlStreamReader *reader,
+                                    const QString &nsURI, const QString &localName,
+                                    QString* errorMsg, int* errorLine, int* errorColumn)
+{
+    if (d->nodeType != KoXmlNode::DocumentNode) {
+        const bool stripSpaces = KOXMLDOCDATA(d)->stripSpaces;
+        d->unref();
+        KoXmlDocumentData *dat = new KoXmlDocumentData;
+        dat->nodeType = KoXmlNode::DocumentNode;
+        dat->stripSpaces = stripSpaces;
+        d = dat;
+    }
+
+    return KOXMLDOCDATA(d)->setContent(reader, errorMsg, errorLine, errorColumn,
+                                       KoXmlDocumentData::ParseUntilStopElement,
+                                       nsURI, localName);
+}
+
+bool KoXmlDocument::setContentFromCurrentElement(QXmlStreamReader *reader,
+                                                 QString* errorMsg, int* errorLine, int* errorColumn)
+{
+    if (d->nodeType != KoXmlNode::DocumentNode) {
+        const bool stripSpaces = KOXMLDOCDATA(d)->stripSpaces;
+        d->unref();
+        KoXmlDocumentData *dat = new KoXmlDocumentData;
+        dat->nodeType = KoXmlNode::DocumentNode;
+        dat->stripSpaces = stripSpaces;
+        d = dat;
+    }
+
+    return KOXMLDOCDATA(d)->setContent(reader, errorMsg, errorLine, errorColumn,
+                                       KoXmlDocumentData::ParseCurrentElement);
+}
+
 // no namespace processing
 bool KoXmlDocument::setContent(QIODevice* device, QString* errorMsg,
                                int* errorLine, int* errorColumn)
@@ -286,6 +286,28 @@ public:
                     QString* errorMsg = 0, int* errorLine = 0, int* errorColumn = 0);
     bool setContent(QXmlStreamReader *reader,
                     QString* errorMsg = 0, int* errorLine = 0, int* errorColumn = 0);
+
+    /**
+     * Parses the document from \p reader up to the first element named
+     * \p localName in the namespace \p nsURI. The element itself is not
+     * added to the document and \p reader is left positioned at its start
+     * tag, so that the caller can pull the rest of the stream, e.g. with
+     * setContentFromCurrentElement(). If there is no such element, the
+     * whole document is parsed.
+     */
+    bool setContentUntil(QXmlStreamReader *reader,
+                         const QString &nsURI, const QString &localName,
+                         QString* errorMsg = 0, int* errorLine = 0, int* errorColumn = 0);
+
+    /**
+     * Parses the element \p reader is positioned at (its start tag) as
+     * if it were a standalone document. \p reader is left positioned at
+     * the end tag of the element. This way a huge document can be loaded
+     * piece by piece without ever keeping the whole tree in memory.
+     */
+    bool setContentFromCurrentElement(QXmlStreamReader *reader,
+                                      QString* errorMsg = 0, int* errorLine = 0, int* errorColumn = 0);
+
     bool setContent(const QByteArray& text, bool namespaceProcessing,
                     QString *errorMsg = 0, int *errorLine = 0, int *errorColumn = 0);
     bool setContent(const QString& text, bool namespaceProcessing,
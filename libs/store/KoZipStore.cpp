@@ -23,6 +23,7 @@
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QFile>
 #include <QTemporaryFile>
 
 #include <kzip.h>
@@ -102,6 +103,7 @@ void KoZipStore::init(const QByteArray& appIdentification)
     Q_D(KoStore);
 
     m_currentDir = 0;
+    m_mappedData = 0;
     d->good = m_pZip->open(d->mode == Write ? QIODevice::WriteOnly : QIODevice::ReadOnly);
 
     if (!d->good)
@@ -160,11 +162,49 @@ bool KoZipStore::openRead(const QString& name)
     // Must cast to KZipFileEntry, not only KArchiveFile, because device() isn't virtual!
     const KZipFileEntry * f = static_cast<const KZipFileEntry *>(entry);
     delete d->stream;
-    d->stream = f->createDevice();
+    d->stream = 0;
+    closeRead();
+
+    /**
+     * The files stored without compression (e.g. the layers' tile
+     * data, which is compressed by Krita itself) are read directly
+     * from the memory mapped archive. It avoids a syscall per read()
+     * and makes seeking within the file free.
+     */
+    QFile *archiveFile = qobject_cast<QFile*>(m_pZip->device());
+    if (archiveFile && f->encoding() == 0 && f->size() > 0) {
+        m_mappedData = archiveFile->map(f->position(), f->size());
+    }
+
+    if (m_mappedData) {
+        QBuffer *buffer = new QBuffer();
+        buffer->setData(QByteArray::fromRawData(reinterpret_cast<const char*>(m_mappedData), f->size()));
+        buffer->open(QIODevice::ReadOnly);
+        d->stream = buffer;
+    } else {
+        d->stream = f->createDevice();
+    }
+
     d->size = f->size();
     return true;
 }
 
+bool KoZipStore::closeRead()
+{
+    Q_D(KoStore);
+
+    if (m_mappedData) {
+        // the buffer must not outlive the mapped data
+        delete d->stream;
+        d->stream = 0;
+
+        qobject_cast<QFile*>(m_pZip->device())->unmap(m_mappedData);
+        m_mappedData = 0;
+    }
+
+    return true;
+}
+
 qint64 KoZipStore::write(const char* _data, qint64 _len)
 {
     Q_D(KoStore);
@@ -52,9 +52,7 @@ protected:
     virtual bool openWrite(const QString& name);
     virtual bool openRead(const QString& name);
     virtual bool closeWrite();
-    virtual bool closeRead() {
-        return true;
-    }
+    virtual bool closeRead();
     virtual bool enterRelativeDirectory(const QString& dirName);
     virtual bool enterAbsoluteDirectory(const QString& path);
     virtual bool fileExists(const QString& absPath) const;
@@ -68,6 +66,10 @@ private:
     current directory in the archive to speed up the verification process */
     const KArchiveDirectory* m_currentDir;
 
+    /** In "Read" mode this pointer is pointing to the memory mapped
+    data of the currently opened uncompressed file, if any */
+    uchar *m_mappedData;
+
     Q_DECLARE_PRIVATE(KoStore)
 };
 
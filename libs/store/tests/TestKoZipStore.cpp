@@ -0,0 +1,177 @@
+/* This file is part of the KDE project
+ * Copyright 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoZipStore.h"
+
+#include <KoStore.h>
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QScopedPointer>
+
+namespace {
+
+QByteArray testData(int size)
+{
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; i++) {
+        data[i] = char((i * 7) ^ (i >> 9));
+    }
+    return data;
+}
+
+bool writeTestStore(const QString &fileName, const QByteArray &data)
+{
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Write, "application/x-krita-test", KoStore::Zip));
+    if (!store || store->bad()) return false;
+
+    store->setCompressionEnabled(false);
+    if (!store->open("stored.bin")) return false;
+    store->setCompressionEnabled(true);
+    if (store->write(data) != data.size()) return false;
+    if (!store->close()) return false;
+
+    if (!store->open("compressed.bin")) return false;
+    if (store->write(data) != data.size()) return false;
+    if (!store->close()) return false;
+
+    return store->finalize();
+}
+
+void readInChunks(KoStore *store, const QString &name, const QByteArray &data)
+{
+    QVERIFY(store->open(name));
+    QCOMPARE(store->size(), qint64(data.size()));
+
+    const int chunkSize = 4096;
+    QByteArray chunk(chunkSize, 0);
+    qint64 totalRead = 0;
+
+    while (totalRead < data.size()) {
+        const qint64 bytesRead = store->read(chunk.data(), chunkSize);
+        QVERIFY(bytesRead > 0);
+        totalRead += bytesRead;
+    }
+
+    QCOMPARE(totalRead, qint64(data.size()));
+    QVERIFY(store->close());
+}
+
+}
+
+void TestKoZipStore::testStoredEntry()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/test.zip";
+    const QByteArray data = testData(1000000);
+
+    QVERIFY(writeTestStore(fileName, data));
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+    QVERIFY(store && !store->bad());
+
+    QVERIFY(store->open("stored.bin"));
+    QCOMPARE(store->size(), qint64(data.size()));
+
+    QIODevice *device = store->device();
+    QVERIFY(!device->isSequential());
+
+    // random access
+    QVERIFY(device->seek(500000));
+    QCOMPARE(device->read(100), data.mid(500000, 100));
+    QVERIFY(device->seek(10));
+    QCOMPARE(device->read(100), data.mid(10, 100));
+
+    QVERIFY(device->seek(0));
+    QCOMPARE(store->read(data.size()), data);
+    QVERIFY(device->atEnd());
+
+    QVERIFY(store->close());
+}
+
+void TestKoZipStore::testCompressedEntry()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/test.zip";
+    const QByteArray data = testData(1000000);
+
+    QVERIFY(writeTestStore(fileName, data));
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+    QVERIFY(store && !store->bad());
+
+    QVERIFY(store->open("compressed.bin"));
+    QCOMPARE(store->size(), qint64(data.size()));
+    QCOMPARE(store->read(data.size()), data);
+    QVERIFY(store->close());
+}
+
+void TestKoZipStore::testReopenStoredEntry()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/test.zip";
+    const QByteArray data = testData(100000);
+
+    QVERIFY(writeTestStore(fileName, data));
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+    QVERIFY(store && !store->bad());
+
+    for (int i = 0; i < 3; i++) {
+        QVERIFY(store->open("stored.bin"));
+        QCOMPARE(store->read(data.size()), data);
+        QVERIFY(store->close());
+
+        QVERIFY(store->open("compressed.bin"));
+        QCOMPARE(store->read(data.size()), data);
+        QVERIFY(store->close());
+    }
+}
+
+void TestKoZipStore::benchmarkReadStoredEntry()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/test.zip";
+    const QByteArray data = testData(64 * 1024 * 1024);
+
+    QVERIFY(writeTestStore(fileName, data));
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+
+    QBENCHMARK {
+        readInChunks(store.data(), "stored.bin", data);
+    }
+}
+
+void TestKoZipStore::benchmarkReadCompressedEntry()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/test.zip";
+    const QByteArray data = testData(64 * 1024 * 1024);
+
+    QVERIFY(writeTestStore(fileName, data));
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+
+    QBENCHMARK {
+        readInChunks(store.data(), "compressed.bin", data);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestKoZipStore)
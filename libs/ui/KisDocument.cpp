@@ -60,10 +60,13 @@
 #include <QDir>
 #include <QDomDocument>
 #include <QDomElement>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QList>
 #include <QPainter>
+#include <QPointer>
 #include <QRect>
 #include <QScopedPointer>
 #include <QSize>
@@ -71,6 +74,7 @@
 #include <QtGlobal>
 #include <QTimer>
 #include <QWidget>
+#include <QtConcurrent>
 
 // Krita Image
 #include <kis_config.h>
@@ -98,6 +102,7 @@
 #include "flake/kis_shape_controller.h"
 #include "kra/kis_kra_loader.h"
 #include "kra/kis_kra_saver.h"
+#include "kra/kis_kra_layer_data_cache.h"
 #include "kis_statusbar.h"
 #include "widgets/kis_progress_widget.h"
 #include "kis_canvas_resource_provider.h"
@@ -343,6 +348,37 @@ public:
     QEventLoop m_eventLoop;
     QMutex savingMutex;
 
+    /**
+     * A snapshot of the image taken for saving. It shares all the
+     * tiles with the image in copy-on-write manner, so the image is
+     * locked only while the snapshot is being taken.
+     */
+    KisImageSP savingImage;
+    QElapsedTimer savingTimer;
+
+    /**
+     * The parts of the saved file which are not a part of the image
+     * snapshot. They are collected in the GUI thread before the
+     * snapshot is written, the writing thread doesn't touch the
+     * document itself.
+     */
+    struct SavingData {
+        QByteArray mainDocument;
+        QByteArray documentInfo;
+        QString uri;
+        bool external = false;
+        bool autosave = false;
+
+        // set by the writing thread
+        QString errorMessage;
+    };
+    SavingData savingData;
+
+    QFutureWatcher<bool> autoSaveWatcher;
+    QPointer<KisMainWindow> autoSaveProgressWindow;
+    bool backgroundAutoSaving = false;
+    bool modifiedDuringAutosave = false;
+
     bool modified;
     bool readwrite;
 
@@ -365,6 +401,13 @@ public:
     KisKraLoader* kraLoader;
     KisKraSaver* kraSaver;
 
+    /**
+     * The pixel data written by the previous save. Autosaves usually
+     * happen after a few strokes on a single layer, so the data of all
+     * the other layers is reused instead of being compressed again.
+     */
+    KisKraLayerDataCache layerDataCache;
+
     bool suppressProgress;
     KoProgressProxy* fileProgressProxy;
 
@@ -416,6 +459,10 @@ public:
         }
     }
 
+    KisImageSP imageForSaving() const {
+        return savingImage ? savingImage : image;
+    }
+
     void setImageAndInitIdleWatcher(KisImageSP _image) {
         image = _image;
 
@@ -437,6 +484,7 @@ public:
     SafeSavingLocker(KisDocument::Private *_d)
         : d(_d),
           m_locked(false),
+          m_imageLocked(false),
           m_imageLock(d->image, true),
           m_savingLock(&d->savingMutex)
     {
@@ -470,13 +518,14 @@ public:
         }
 
         if (m_locked) {
+            m_imageLocked = true;
             d->disregardAutosaveFailure = false;
         }
     }
 
     ~SafeSavingLocker() {
          if (m_locked) {
-             m_imageLock.unlock();
+             releaseImageLock();
              m_savingLock.unlock();
 
              const int realAutoSaveInterval = KisConfig().autoSaveInterval();
@@ -488,9 +537,21 @@ public:
         return m_locked;
     }
 
+    /**
+     * Unlocks the image, but keeps the saving lock held, so that
+     * nobody else could enter the saving code
+     */
+    void releaseImageLock() {
+        if (m_imageLocked) {
+            m_imageLock.unlock();
+            m_imageLocked = false;
+        }
+    }
+
 private:
     KisDocument::Private *d;
     bool m_locked;
+    bool m_imageLocked;
 
     KisImageBarrierLockAdapter m_imageLock;
     StdLockableWrapper<QMutex> m_savingLock;
@@ -507,6 +568,7 @@ KisDocument::KisDocument()
     d->importExportManager->setProgresUpdater(d->progressUpdater);
 
     connect(&d->autoSaveTimer, SIGNAL(timeout()), this, SLOT(slotAutoSave()));
+    connect(&d->autoSaveWatcher, SIGNAL(finished()), this, SLOT(slotAutoSaveFinished()));
     setAutoSave(defaultAutoSave());
 
     setObjectName(newObjectName());
@@ -535,6 +597,14 @@ KisDocument::KisDocument()
 
 KisDocument::~KisDocument()
 {
+    /**
+     * The autosave may still be writing the snapshot in background,
+     * it uses the document, so wait for it
+     */
+    d->autoSaveWatcher.disconnect(this);
+    d->autoSaveWatcher.waitForFinished();
+    d->savingImage.clear();
+
     /**
      * Push a timebomb, which will try to release the memory after
      * the document has been deleted
@@ -655,6 +725,8 @@ bool KisDocument::exportDocument(const QUrl &_url, KisPropertiesConfigurationSP
 
 bool KisDocument::saveFile(KisPropertiesConfigurationSP exportConfiguration)
 {
+    waitForBackgroundAutoSave();
+
     // Unset the error message
     setErrorMessage("");
 
@@ -877,31 +949,79 @@ bool KisDocument::isAutoErrorHandlingEnabled() const
 
 void KisDocument::slotAutoSave()
 {
+    // the previous autosave is still being written
+    if (d->backgroundAutoSaving) return;
+
     if (d->modified && d->modifiedAfterAutosave && !d->isLoading) {
         // Give a warning when trying to autosave an encrypted file when no password is known (should not happen)
         if (d->specialOutputFlag == SaveEncrypted && d->password.isNull()) {
             // That advice should also fix this error from occurring again
             emit statusBarMessage(i18n("The password of this encrypted document is not known. Autosave aborted! Please save your work manually."));
         } else {
-            connect(this, SIGNAL(sigProgress(int)), KisPart::instance()->currentMainwindow(), SLOT(slotProgress(int)));
+            d->autoSaveProgressWindow = KisPart::instance()->currentMainwindow();
+            connect(this, SIGNAL(sigProgress(int)), d->autoSaveProgressWindow, SLOT(slotProgress(int)));
             emit statusBarMessage(i18n("Autosaving..."));
             d->isAutosaving = true;
+
+            /**
+             * If the snapshot has been taken successfully, the
+             * document is written in background and the autosave is
+             * completed in slotAutoSaveFinished()
+             */
             bool ret = saveNativeFormat(autoSaveFile(localFilePath()));
-            setModified(true);
-            if (ret) {
-                d->modifiedAfterAutosave = false;
-                d->autoSaveTimer.stop(); // until the next change
-            }
-            d->isAutosaving = false;
-            emit clearStatusBarMessage();
-            disconnect(this, SIGNAL(sigProgress(int)), KisPart::instance()->currentMainwindow(), SLOT(slotProgress(int)));
-            if (!ret && !d->disregardAutosaveFailure) {
-                emit statusBarMessage(i18n("Error during autosave! Partition full?"));
+            if (!ret || !d->backgroundAutoSaving) {
+                completeAutoSaving(ret);
             }
         }
     }
 }
 
+void KisDocument::slotAutoSaveFinished()
+{
+    if (!d->backgroundAutoSaving) return;
+
+    d->backgroundAutoSaving = false;
+    completeAutoSaving(finishNativeFormatSaving(d->autoSaveWatcher.result()));
+}
+
+void KisDocument::waitForBackgroundAutoSave()
+{
+    if (!d->backgroundAutoSaving) return;
+
+    d->autoSaveWatcher.waitForFinished();
+    slotAutoSaveFinished();
+}
+
+void KisDocument::completeAutoSaving(bool ret)
+{
+    d->savingImage.clear();
+
+    setModified(true);
+    if (ret) {
+        d->modifiedAfterAutosave = false;
+        d->autoSaveTimer.stop(); // until the next change
+    }
+    d->isAutosaving = false;
+
+    // the user could continue painting while the snapshot was being written
+    if (d->modifiedDuringAutosave) {
+        d->modifiedDuringAutosave = false;
+        setModified(true);
+    }
+
+    emit clearStatusBarMessage();
+    disconnect(this, SIGNAL(sigProgress(int)), d->autoSaveProgressWindow, SLOT(slotProgress(int)));
+    d->autoSaveProgressWindow.clear();
+
+    if (!ret && !d->disregardAutosaveFailure) {
+        emit statusBarMessage(i18n("Error during autosave! Partition full?"));
+    }
+
+    if (ret) {
+        infoFile << "Autosave completed in" << d->savingTimer.elapsed() << "ms";
+    }
+}
+
 void KisDocument::setReadWrite(bool readwrite)
 {
     d->readwrite = readwrite;
@@ -934,9 +1054,23 @@ bool KisDocument::isModified() const
 
 bool KisDocument::saveNativeFormat(const QString & file)
 {
+    d->savingTimer.start();
+
     Private::SafeSavingLocker locker(d);
     if (!locker.successfullyLocked()) return false;
 
+    /**
+     * Writing a big image may take a lot of time, so we don't keep
+     * the image locked while doing that. Instead, we take a snapshot
+     * of it (all the tiles are shared in copy-on-write manner, so it
+     * is cheap) and serialize the snapshot, while the user can
+     * continue painting.
+     */
+    d->savingImage = d->image->clone(true);
+    locker.releaseImageLock();
+
+    infoFile << "The image has been locked for saving for" << d->savingTimer.elapsed() << "ms";
+
     d->lastErrorMessage.clear();
     //dbgUI <<"Saving to store";
 
@@ -948,12 +1082,13 @@ bool KisDocument::saveNativeFormat(const QString & file)
     else if (d->specialOutputFlag == SaveAsFlatXML) {
         dbgUI << "Saving as a flat XML file.";
         QFile f(file);
+        bool success = false;
         if (f.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            bool success = saveToStream(&f);
+            success = saveToStream(&f);
             f.close();
-            return success;
-        } else
-            return false;
+        }
+        d->savingImage.clear();
+        return success;
     }
 
     dbgUI << "KisDocument::saveNativeFormat nativeFormatMimeType=" << nativeFormatMimeType();
@@ -967,59 +1102,122 @@ bool KisDocument::saveNativeFormat(const QString & file)
     if (store->bad()) {
         d->lastErrorMessage = i18n("Could not create the file for saving");   // more details needed?
         delete store;
+        d->savingImage.clear();
         return false;
     }
 
     bool result = false;
 
+    // the layer data of the snapshot cannot change, so it may be cached
+    prepareNativeFormatSaving(true);
+
     if (!d->isAutosaving) {
         KisAsyncActionFeedback f(i18n("Saving document..."), 0);
-        result = f.runAction(std::bind(&KisDocument::saveNativeFormatCalligra, this, store));
+        result = finishNativeFormatSaving(
+            f.runAction(std::bind(&KisDocument::writeNativeFormat, this, store)));
+        d->savingImage.clear();
+
+        infoFile << "The document has been saved in" << d->savingTimer.elapsed() << "ms";
     } else {
-        result = saveNativeFormatCalligra(store);
+        /**
+         * Autosave should not disturb the user at all, so it is
+         * written in background. The saving lock is released on
+         * return, further saves wait for the autosave in
+         * waitForBackgroundAutoSave().
+         */
+        d->backgroundAutoSaving = true;
+        d->modifiedDuringAutosave = false;
+        d->autoSaveWatcher.setFuture(
+            QtConcurrent::run(std::bind(&KisDocument::writeNativeFormat, this, store)));
+        result = true;
     }
     return result;
 }
 
 bool KisDocument::saveNativeFormatCalligra(KoStore *store)
 {
+    // the live image is written here, not a snapshot
+    prepareNativeFormatSaving(false);
+    return finishNativeFormatSaving(writeNativeFormat(store));
+}
+
+void KisDocument::prepareNativeFormatSaving(bool useLayerDataCache)
+{
+    d->savingData = Private::SavingData();
+
+    d->savingData.mainDocument = saveXML().toByteArray(); // utf8 already
+
+    QDomDocument doc = KisDocument::createDomDocument("document-info"
+                                                      /*DTD name*/, "document-info" /*tag name*/, "1.1");
+    doc = d->docInfo->save(doc);
+    d->savingData.documentInfo = doc.toByteArray(); // this is already Utf8!
+
+    d->savingData.uri = url().url();
+    d->savingData.external = isStoredExtern();
+    d->savingData.autosave = d->isAutosaving;
+
+    if (useLayerDataCache) {
+        d->kraSaver->setLayerDataCache(&d->layerDataCache);
+    } else {
+        d->kraSaver->setLayerDataCache(0);
+        clearLayerDataCache();
+    }
+}
+
+void KisDocument::clearLayerDataCache()
+{
+    /**
+     * The background autosave may still be writing with the cache,
+     * it will be cleaned by the next save anyway
+     */
+    if (!d->backgroundAutoSaving) {
+        d->layerDataCache.clear();
+    }
+}
+
+bool KisDocument::writeNativeFormat(KoStore *store)
+{
+    const Private::SavingData &data = d->savingData;
+
     dbgUI << "Saving root";
     if (store->open("root")) {
         KoStoreDevice dev(store);
-        if (!saveToStream(&dev) || !store->close()) {
-            dbgUI << "saveToStream failed";
+        dev.open(QIODevice::WriteOnly);
+        int nwritten = dev.write(data.mainDocument.data(), data.mainDocument.size());
+        if (nwritten != data.mainDocument.size() || !store->close()) {
+            dbgUI << "writing the main document failed";
             delete store;
             return false;
         }
     } else {
-        d->lastErrorMessage = i18n("Not able to write '%1'. Partition full?", QString("maindoc.xml"));
+        d->savingData.errorMessage = i18n("Not able to write '%1'. Partition full?", QString("maindoc.xml"));
         delete store;
         return false;
     }
     if (store->open("documentinfo.xml")) {
-        QDomDocument doc = KisDocument::createDomDocument("document-info"
-                                                          /*DTD name*/, "document-info" /*tag name*/, "1.1");
-
-
-        doc = d->docInfo->save(doc);
         KoStoreDevice dev(store);
-
-        QByteArray s = doc.toByteArray(); // this is already Utf8!
-        (void)dev.write(s.data(), s.size());
+        (void)dev.write(data.documentInfo.data(), data.documentInfo.size());
         (void)store->close();
     }
 
-    if (store->open("preview.png")) {
+    // the PNG is already compressed, deflating it once more only wastes time
+    store->setCompressionEnabled(false);
+    const bool previewOpened = store->open("preview.png");
+    store->setCompressionEnabled(true);
+
+    if (previewOpened) {
         // ### TODO: missing error checking (The partition could be full!)
         savePreview(store);
         (void)store->close();
     }
 
-    if (!completeSaving(store)) {
+    d->kraSaver->saveKeyframes(store, data.uri, data.external);
+    d->kraSaver->saveBinaryData(store, d->imageForSaving(), data.uri, data.external, data.autosave);
+    if (!d->kraSaver->errorMessages().isEmpty()) {
         delete store;
         return false;
     }
-    dbgUI << "Saving done of url:" << url().url();
+    dbgUI << "Saving done of url:" << data.uri;
     if (!store->finalize()) {
         delete store;
         return false;
@@ -1029,6 +1227,29 @@ bool KisDocument::saveNativeFormatCalligra(KoStore *store)
     return true;
 }
 
+bool KisDocument::finishNativeFormatSaving(bool result)
+{
+    if (!d->savingData.errorMessage.isEmpty()) {
+        setErrorMessage(d->savingData.errorMessage);
+    }
+
+    if (d->kraSaver) {
+        if (!d->kraSaver->errorMessages().isEmpty()) {
+            setErrorMessage(d->kraSaver->errorMessages().join(".\n"));
+            result = false;
+        }
+
+        delete d->kraSaver;
+        d->kraSaver = 0;
+
+        emit sigSavingFinished();
+    }
+
+    d->savingData = Private::SavingData();
+
+    return result;
+}
+
 bool KisDocument::saveToStream(QIODevice *dev)
 {
     QDomDocument doc = saveXML();
@@ -1077,8 +1298,15 @@ bool KisDocument::saveToStore(KoStore *_store, const QString & _path)
 
 bool KisDocument::savePreview(KoStore *store)
 {
-    QPixmap pix = generatePreview(QSize(256, 256));
-    const QImage preview(pix.toImage().convertToFormat(QImage::Format_ARGB32, Qt::ColorOnly));
+    /**
+     * The preview may be generated in a background thread, so we
+     * cannot use QPixmap here
+     */
+    KisImageSP image = d->imageForSaving();
+    QSize previewSize = image->bounds().size();
+    previewSize.scale(QSize(256, 256), Qt::KeepAspectRatio);
+
+    const QImage preview(image->convertToQImage(previewSize, 0).convertToFormat(QImage::Format_ARGB32, Qt::ColorOnly));
     KoStoreDevice io(store);
     if (!io.open(QIODevice::WriteOnly))
         return false;
@@ -1639,8 +1867,16 @@ void KisDocument::setModified(bool mod)
         updateEditingTime(false);
     }
 
-    if (d->isAutosaving)   // ignore setModified calls due to autosaving
+    if (d->isAutosaving) { // ignore setModified calls due to autosaving
+        /**
+         * ...but remember the changes the user made while the
+         * autosave was being written in background
+         */
+        if (mod && d->backgroundAutoSaving) {
+            d->modifiedDuringAutosave = true;
+        }
         return;
+    }
 
     if ( !d->readwrite && d->modified ) {
         errKrita << "Can't set a read-only document to 'modified' !" << endl;
@@ -1770,7 +2006,12 @@ bool KisDocument::completeLoading(KoStore* store)
 bool KisDocument::completeSaving(KoStore* store)
 {
     d->kraSaver->saveKeyframes(store, url().url(), isStoredExtern());
-    d->kraSaver->saveBinaryData(store, d->image, url().url(), isStoredExtern(), d->isAutosaving);
+
+    // saveToStore() writes the live image, so its layer data is not cached
+    d->kraSaver->setLayerDataCache(0);
+    clearLayerDataCache();
+
+    d->kraSaver->saveBinaryData(store, d->imageForSaving(), url().url(), isStoredExtern(), d->isAutosaving);
     bool retval = true;
     if (!d->kraSaver->errorMessages().isEmpty()) {
         setErrorMessage(d->kraSaver->errorMessages().join(".\n"));
@@ -1884,7 +2125,7 @@ QDomDocument KisDocument::saveXML()
     if (d->kraSaver) delete d->kraSaver;
     d->kraSaver = new KisKraSaver(this);
 
-    root.appendChild(d->kraSaver->saveXML(doc, d->image));
+    root.appendChild(d->kraSaver->saveXML(doc, d->imageForSaving()));
     if (!d->kraSaver->errorMessages().isEmpty()) {
         setErrorMessage(d->kraSaver->errorMessages().join(".\n"));
     }
@@ -2391,6 +2632,11 @@ QList<KisPaintingAssistantSP> KisDocument::assistants() const
     return d->assistants;
 }
 
+KisKraLayerDataCache* KisDocument::layerDataCache() const
+{
+    return &d->layerDataCache;
+}
+
 void KisDocument::setAssistants(const QList<KisPaintingAssistantSP> value)
 {
     d->assistants = value;
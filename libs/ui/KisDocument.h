@@ -59,6 +59,7 @@ class KisPaintingAssistant;
 class KisPart;
 class KisGridConfig;
 class KisGuidesConfig;
+class KisKraLayerDataCache;
 class QDomDocument;
 
 class KisPart;
@@ -350,6 +351,11 @@ public:
      *  Saves the document in native format, to a given file
      *  You should never have to reimplement.
      *  Made public for writing templates.
+     *
+     *  The image is locked only while its snapshot is being taken,
+     *  then the snapshot is written. When autosaving, the snapshot is
+     *  written in a background thread and the function returns right
+     *  after starting it.
      */
     bool saveNativeFormat(const QString & file);
 
@@ -716,6 +722,8 @@ private Q_SLOTS:
 
     void slotAutoSave();
 
+    void slotAutoSaveFinished();
+
     /// Called by the undo stack when undo or redo is called
     void slotUndoStackIndexChanged(int idx);
 
@@ -804,6 +812,11 @@ public:
     QList<KisPaintingAssistantSP> assistants() const;
     void setAssistants(const QList<KisPaintingAssistantSP> value);
 
+    /**
+     * @return the pixel data kept from the previous save of the document
+     */
+    KisKraLayerDataCache* layerDataCache() const;
+
 private:
 
     void init();
@@ -814,6 +827,45 @@ private:
 
     bool savePreview(KoStore *store);
 
+    /**
+     * Serializes all the document state which is not a part of the
+     * image snapshot. Should be called in the GUI thread before
+     * writeNativeFormat().
+     *
+     * \p useLayerDataCache should be true only when the image being
+     * written is a snapshot, which cannot change while it is written.
+     * Otherwise the layer data cache is not used and gets cleared.
+     */
+    void prepareNativeFormatSaving(bool useLayerDataCache);
+
+    /**
+     * Writes the prepared data and the image snapshot into \p store
+     * and deletes it. Doesn't access the document state, so it may be
+     * run in a background thread.
+     */
+    bool writeNativeFormat(KoStore *store);
+
+    /**
+     * Reports the errors of writeNativeFormat() and releases the saving
+     * data. Should be called in the GUI thread.
+     */
+    bool finishNativeFormatSaving(bool result);
+
+    /**
+     * Drops the cached layer data, unless a background autosave is
+     * still using it
+     */
+    void clearLayerDataCache();
+
+    /**
+     * Waits until the autosave running in background is written and
+     * completes it. Should be called before any other saving and
+     * before the destruction of the document.
+     */
+    void waitForBackgroundAutoSave();
+
+    void completeAutoSaving(bool ret);
+
     QString prettyPathOrUrl() const;
 
     bool saveToUrl();
@@ -35,6 +35,7 @@
 #include <QMimeData>
 
 #include <QTemporaryFile>
+#include <QXmlStreamReader>
 #include <kis_debug.h>
 
 #include <kis_icon.h>
@@ -483,40 +484,45 @@ bool KisShapeLayer::saveLayer(KoStore * store) const
     return true;
 }
 
+/**
+ * Moves \p reader to the start tag of the first child element of the
+ * current element named \p localName in \p nsURI, skipping its siblings
+ */
+static bool findChildElementNS(QXmlStreamReader &reader, const QString &nsURI, const QString &localName)
+{
+    while (reader.readNextStartElement()) {
+        if (reader.name() == localName && reader.namespaceUri() == nsURI) {
+            return true;
+        }
+        reader.skipCurrentElement();
+    }
+    return false;
+}
+
 bool KisShapeLayer::loadLayer(KoStore* store)
 {
     KoOdfReadStore odfStore(store);
     QString errorMessage;
 
-    odfStore.loadAndParse(errorMessage);
+    /**
+     * Vector layers may contain thousands of shapes, so we don't build a DOM
+     * for the whole content.xml. Only the styles in front of the body are
+     * kept in memory, the shapes are pulled from the stream one by one.
+     */
+    QXmlStreamReader reader;
 
-    if (!errorMessage.isEmpty()) {
+    if (!odfStore.loadAndParseUntilBody(reader, errorMessage)) {
         warnKrita << errorMessage;
         return false;
     }
 
-    KoXmlElement contents = odfStore.contentDoc().documentElement();
-
-    //    dbgKrita <<"Start loading OASIS document..." << contents.text();
-    //    dbgKrita <<"Start loading OASIS contents..." << contents.lastChild().localName();
-    //    dbgKrita <<"Start loading OASIS contents..." << contents.lastChild().namespaceURI();
-    //    dbgKrita <<"Start loading OASIS contents..." << contents.lastChild().isElement();
-
-    KoXmlElement body(KoXml::namedItemNS(contents, KoXmlNS::office, "body"));
-
-    if (body.isNull()) {
-        //setErrorMessage( i18n( "Invalid OASIS document. No office:body tag found." ) );
-        return false;
-    }
-
-    body = KoXml::namedItemNS(body, KoXmlNS::office, "drawing");
-    if (body.isNull()) {
+    // the reader is positioned at office:body now
+    if (!findChildElementNS(reader, KoXmlNS::office, "drawing")) {
         //setErrorMessage( i18n( "Invalid OASIS document. No office:drawing tag found." ) );
         return false;
     }
 
-    KoXmlElement page(KoXml::namedItemNS(body, KoXmlNS::draw, "page"));
-    if (page.isNull()) {
+    if (!findChildElementNS(reader, KoXmlNS::draw, "page")) {
         //setErrorMessage( i18n( "Invalid OASIS document. No draw:page tag found." ) );
         return false;
     }
@@ -553,15 +559,27 @@ bool KisShapeLayer::loadLayer(KoStore* store)
         }
     }
 
-    KoXmlElement child;
-    forEachElement(child, page) {
-        KoShape * shape = KoShapeRegistry::instance()->createShapeFromOdf(child, shapeContext);
+    bool result = true;
+
+    while (reader.readNextStartElement()) {
+        KoXmlDocument shapeDoc;
+
+        // the parsing errors are reported by the reader below
+        if (!shapeDoc.setContentFromCurrentElement(&reader)) break;
+
+        KoShape * shape = KoShapeRegistry::instance()->createShapeFromOdf(shapeDoc.documentElement(), shapeContext);
         if (shape) {
             addShape(shape);
         }
     }
 
-    return true;
+    if (reader.hasError()) {
+        warnKrita << "Parsing error in content.xml at line" << reader.lineNumber()
+                  << "column" << reader.columnNumber() << ":" << reader.errorString();
+        result = false;
+    }
+
+    return result;
 
 }
 
@@ -19,6 +19,7 @@
 #include "kis_shape_layer_canvas.h"
 
 #include <QPainter>
+#include <QVector>
 #include <QMutexLocker>
 
 #include <KoShapeManager.h>
@@ -103,41 +104,94 @@ void KisShapeLayerCanvas::updateCanvas(const QRectF& rc)
     emit forwardRepaint();
 }
 
+namespace {
+
+/**
+ * The dirty region is repainted in patches aligned to the tiles of
+ * the projection. The patches are limited in size, so that every one
+ * of them asks the shape manager only for the shapes intersecting it
+ * and the temporary image never gets too big.
+ */
+const int tileSize = 64;
+const int maxPatchSize = 512;
+
+inline int alignDown(int value)
+{
+    return value >= 0 ?
+        value / tileSize * tileSize :
+        -((-value + tileSize - 1) / tileSize) * tileSize;
+}
+
+inline QRect alignToTiles(const QRect &rc)
+{
+    const int left = alignDown(rc.left());
+    const int top = alignDown(rc.top());
+    const int right = alignDown(rc.right()) + tileSize;
+    const int bottom = alignDown(rc.bottom()) + tileSize;
+
+    return QRect(left, top, right - left, bottom - top);
+}
+
+}
+
 void KisShapeLayerCanvas::repaint()
 {
-    QRect r;
+    QRegion dirtyRegion;
 
     {
         QMutexLocker locker(&m_dirtyRegionMutex);
-        r = m_dirtyRegion.boundingRect();
+        dirtyRegion = m_dirtyRegion;
         m_dirtyRegion = QRegion();
     }
 
-    if (r.isEmpty()) return;
+    if (dirtyRegion.isEmpty()) return;
 
-    r = r.intersected(m_parentLayer->image()->bounds());
-    QImage image(r.width(), r.height(), QImage::Format_ARGB32);
-    image.fill(0);
-    QPainter p(&image);
+    const QRect imageBounds = m_parentLayer->image()->bounds();
 
-    p.setRenderHint(QPainter::Antialiasing);
-    p.setRenderHint(QPainter::TextAntialiasing);
-    p.translate(-r.x(), -r.y());
-    p.setClipRect(r);
-#ifdef DEBUG_REPAINT
-    QColor color = QColor(random() % 255, random() % 255, random() % 255);
-    p.fillRect(r, color);
-#endif
+    /**
+     * Two small shapes changed in the opposite corners of the image
+     * should not make us repaint everything in between, so the
+     * region is not collapsed into its bounding rect
+     */
+    QRegion dirtyTiles;
+    Q_FOREACH (const QRect &rc, dirtyRegion.rects()) {
+        dirtyTiles += alignToTiles(rc) & imageBounds;
+    }
 
-    m_shapeManager->paint(p, *m_viewConverter, false);
-    p.end();
+    QVector<QRect> patches;
+    Q_FOREACH (const QRect &rc, dirtyTiles.rects()) {
+        for (int y = rc.top(); y <= rc.bottom(); y += maxPatchSize) {
+            for (int x = rc.left(); x <= rc.right(); x += maxPatchSize) {
+                patches << (QRect(x, y, maxPatchSize, maxPatchSize) & rc);
+            }
+        }
+    }
 
     KisPaintDeviceSP dev = new KisPaintDevice(m_projection->colorSpace());
-    dev->convertFromQImage(image, 0);
 
-    KisPainter::copyAreaOptimized(r.topLeft(), dev, m_projection, QRect(QPoint(), r.size()));
+    Q_FOREACH (const QRect &patch, patches) {
+        QImage image(patch.width(), patch.height(), QImage::Format_ARGB32);
+        image.fill(0);
+        QPainter p(&image);
+
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setRenderHint(QPainter::TextAntialiasing);
+        p.translate(-patch.x(), -patch.y());
+        p.setClipRect(patch);
+#ifdef DEBUG_REPAINT
+        QColor color = QColor(random() % 255, random() % 255, random() % 255);
+        p.fillRect(patch, color);
+#endif
+
+        // the shape manager fetches only the shapes intersecting the clip rect
+        m_shapeManager->paint(p, *m_viewConverter, false);
+        p.end();
+
+        dev->convertFromQImage(image, 0, patch.x(), patch.y());
+        KisPainter::copyAreaOptimized(patch.topLeft(), dev, m_projection, patch);
+    }
 
-    m_parentLayer->setDirty(r);
+    m_parentLayer->setDirty(patches);
 }
 
 KoToolProxy * KisShapeLayerCanvas::toolProxy() const
@@ -35,6 +35,10 @@
 #include <zlib.h>
 
 #include <QBuffer>
+#include <QVector>
+#include <QtConcurrent>
+#include <QThread>
+#include <QScopedPointer>
 #include <QFile>
 #include <QApplication>
 
@@ -264,6 +268,255 @@ void decode_meta_data(png_textp text, KisMetaData::Store* store, QString type, i
         dbgFile << "Decoding failed";
     }
 }
+
+/**
+ * A band of scanlines of a PNG compressed independently from the
+ * other bands
+ */
+struct CompressedBand
+{
+    int numRows = 0;
+    bool isLast = false;
+
+    QByteArray rows;
+
+    QByteArray data;
+    uLong adler = 0;
+    uLong uncompressedSize = 0;
+    bool success = false;
+};
+
+struct CompressBandJob
+{
+    CompressBandJob(int _rowBytes, int _bytesPerPixel, bool _swapBytes, int _compression)
+        : rowBytes(_rowBytes), bytesPerPixel(_bytesPerPixel),
+          swapBytes(_swapBytes), compression(_compression)
+    {
+    }
+
+    void operator() (CompressedBand &band) const {
+        QByteArray filtered((rowBytes + 1) * band.numRows, 0);
+        QByteArray row(rowBytes, 0);
+
+        quint8 *dst = reinterpret_cast<quint8*>(filtered.data());
+
+        for (int i = 0; i < band.numRows; i++) {
+            const quint8 *src = reinterpret_cast<const quint8*>(band.rows.constData()) + i * rowBytes;
+
+            if (swapBytes) {
+                // PNG stores 16-bit samples in network byte order
+                quint8 *swapped = reinterpret_cast<quint8*>(row.data());
+                for (int j = 0; j < rowBytes; j += 2) {
+                    swapped[j] = src[j + 1];
+                    swapped[j + 1] = src[j];
+                }
+                src = swapped;
+            }
+
+            // "Sub" filter, the previous row is not needed for it
+            *dst++ = 1;
+
+            for (int j = 0; j < bytesPerPixel; j++) {
+                *dst++ = src[j];
+            }
+            for (int j = bytesPerPixel; j < rowBytes; j++) {
+                *dst++ = src[j] - src[j - bytesPerPixel];
+            }
+        }
+
+        // the raw scanlines are not needed anymore
+        band.rows = QByteArray();
+
+        band.uncompressedSize = filtered.size();
+        band.adler = adler32(adler32(0, 0, 0),
+                             reinterpret_cast<const Bytef*>(filtered.constData()),
+                             filtered.size());
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(z_stream));
+
+        // raw deflate: the zlib header is written only once for all the bands
+        if (deflateInit2(&stream, compression, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return;
+        }
+
+        // the sync flush marker takes a few bytes more than deflateBound() expects
+        band.data.resize(deflateBound(&stream, filtered.size()) + 16);
+
+        stream.next_in = reinterpret_cast<Bytef*>(filtered.data());
+        stream.avail_in = filtered.size();
+        stream.next_out = reinterpret_cast<Bytef*>(band.data.data());
+        stream.avail_out = band.data.size();
+
+        /**
+         * The sync flush ends the band on a byte boundary without
+         * marking the last deflate block as final, so the bands can
+         * be concatenated into one stream
+         */
+        const int result = deflate(&stream, band.isLast ? Z_FINISH : Z_SYNC_FLUSH);
+
+        band.success =
+            (band.isLast ? result == Z_STREAM_END : result == Z_OK) &&
+            !stream.avail_in && stream.avail_out;
+
+        band.data.resize(stream.total_out);
+        deflateEnd(&stream);
+    }
+
+    int rowBytes;
+    int bytesPerPixel;
+    bool swapBytes;
+    int compression;
+};
+
+void writeChunk(QIODevice *io, const char *type, const QByteArray &data)
+{
+    const quint32 length = data.size();
+    const char lengthBytes[4] = {
+        char(length >> 24), char(length >> 16), char(length >> 8), char(length)
+    };
+
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data.constData()), data.size());
+
+    const char crcBytes[4] = {
+        char(crc >> 24), char(crc >> 16), char(crc >> 8), char(crc)
+    };
+
+    io->write(lengthBytes, 4);
+    io->write(type, 4);
+    io->write(data);
+    io->write(crcBytes, 4);
+}
+
+/**
+ * Writes the IDAT and IEND chunks of a non-interlaced PNG.
+ *
+ * Compression of the scanlines takes most of the time of saving a big
+ * PNG and libpng does it in a single thread. Here the scanlines are
+ * split into bands, which are filtered and deflated in parallel and
+ * then stitched into a single zlib stream (the same way pigz does it).
+ * The compression ratio is only slightly worse, because the bands
+ * don't share the dictionary.
+ *
+ * The rows are passed one by one and only a few bands per thread are
+ * kept in memory, the compressed bands are written out as soon as
+ * they are ready.
+ */
+class ParallelImageDataWriter
+{
+public:
+    ParallelImageDataWriter(QIODevice *io, int numRows, int rowBytes,
+                            int bytesPerPixel, bool swapBytes, int compression)
+        : m_io(io),
+          m_numRows(numRows),
+          m_rowBytes(rowBytes),
+          m_rowsPassed(0),
+          m_headerWritten(false),
+          m_success(true),
+          m_job(rowBytes, bytesPerPixel, swapBytes, compression)
+    {
+        // big enough bands for deflate to find its matches
+        const int bandSize = 256 * 1024;
+        m_rowsPerBand = qMax(1, bandSize / (rowBytes + 1));
+
+        m_maxPendingBands = 2 * qMax(1, QThread::idealThreadCount());
+        m_adler = adler32(0, 0, 0);
+    }
+
+    void writeRow(const png_byte *row) {
+        if (m_pendingBands.isEmpty() ||
+            m_pendingBands.last().numRows == m_rowsPerBand) {
+
+            if (m_pendingBands.size() == m_maxPendingBands) {
+                flushPendingBands();
+            }
+
+            CompressedBand band;
+            band.rows.reserve(qMin(m_rowsPerBand, m_numRows - m_rowsPassed) * m_rowBytes);
+            m_pendingBands << band;
+        }
+
+        CompressedBand &band = m_pendingBands.last();
+        band.rows.append(reinterpret_cast<const char*>(row), m_rowBytes);
+        band.numRows++;
+
+        m_rowsPassed++;
+    }
+
+    bool finish() {
+        if (m_rowsPassed != m_numRows || m_pendingBands.isEmpty()) return false;
+
+        m_pendingBands.last().isLast = true;
+        flushPendingBands();
+
+        writeChunk(m_io, "IEND", QByteArray());
+
+        return m_success;
+    }
+
+private:
+    void flushPendingBands() {
+        if (!m_success) {
+            m_pendingBands.clear();
+            return;
+        }
+
+        QtConcurrent::blockingMap(m_pendingBands, m_job);
+
+        for (int i = 0; i < m_pendingBands.size(); i++) {
+            const CompressedBand &band = m_pendingBands[i];
+            if (!band.success) {
+                m_success = false;
+                break;
+            }
+
+            m_adler = adler32_combine(m_adler, band.adler, band.uncompressedSize);
+
+            QByteArray chunk;
+
+            if (!m_headerWritten) {
+                // zlib header: deflate with 32K window, the check bits make it divisible by 31
+                const char fastestLevelFlags = 0x01;
+                const char defaultLevelFlags = char(0x9C);
+                const char bestLevelFlags = char(0xDA);
+
+                chunk.append(char(0x78));
+                chunk.append(m_job.compression <= 1 ? fastestLevelFlags :
+                             m_job.compression >= 7 ? bestLevelFlags : defaultLevelFlags);
+                m_headerWritten = true;
+            }
+
+            chunk.append(band.data);
+
+            if (band.isLast) {
+                chunk.append(char(m_adler >> 24));
+                chunk.append(char(m_adler >> 16));
+                chunk.append(char(m_adler >> 8));
+                chunk.append(char(m_adler));
+            }
+
+            writeChunk(m_io, "IDAT", chunk);
+        }
+
+        m_pendingBands.clear();
+    }
+
+private:
+    QIODevice *m_io;
+    int m_numRows;
+    int m_rowBytes;
+    int m_rowsPerBand;
+    int m_maxPendingBands;
+    int m_rowsPassed;
+    bool m_headerWritten;
+    bool m_success;
+    uLong m_adler;
+
+    CompressBandJob m_job;
+    QVector<CompressedBand> m_pendingBands;
+};
+
 }
 
 KisPNGConverter::KisPNGConverter(KisDocument *doc, bool batchMode)
@@ -320,6 +573,81 @@ private:
     quint8* m_buf;
 };
 
+/**
+ * Reads the pixels of the saved rect in bands of rows. The bands are
+ * flattened onto the transparency fill color and converted into the
+ * color space of the file on the fly, so saving never makes a
+ * full-size copy of the device.
+ */
+class KisPNGBandReader
+{
+public:
+    static const int rowsPerBand = 64;
+
+    KisPNGBandReader(KisPaintDeviceSP device, const QRect &rect,
+                     const KoColorSpace *dstColorSpace,
+                     bool flatten, const QColor &fillColor)
+        : m_device(device),
+          m_rect(rect),
+          m_dstColorSpace(dstColorSpace),
+          m_flatten(flatten),
+          m_fillColor(fillColor, device->colorSpace()),
+          m_srcData(rowsPerBand * rect.width() * device->pixelSize()),
+          m_dstData(*device->colorSpace() == *dstColorSpace ?
+                    0 : rowsPerBand * rect.width() * dstColorSpace->pixelSize())
+    {
+    }
+
+    int numBands() const {
+        return (m_rect.height() + rowsPerBand - 1) / rowsPerBand;
+    }
+
+    int bandHeight(int band) const {
+        return qMin(rowsPerBand, m_rect.height() - band * rowsPerBand);
+    }
+
+    /**
+     * \return the pixels of the \p band in the destination color
+     * space. The data stays valid till the next call.
+     */
+    const quint8* readBand(int band) {
+        const QRect bandRect(m_rect.x(), m_rect.y() + band * rowsPerBand,
+                             m_rect.width(), bandHeight(band));
+
+        KisPaintDeviceSP src = m_device;
+
+        if (m_flatten) {
+            src = new KisPaintDevice(m_device->colorSpace());
+            src->fill(bandRect, m_fillColor);
+            KisPainter gc(src);
+            gc.bitBlt(bandRect.topLeft(), m_device, bandRect);
+            gc.end();
+        }
+
+        src->readBytes(m_srcData.data(), bandRect);
+
+        if (m_dstData.isEmpty()) {
+            return m_srcData.constData();
+        }
+
+        m_device->colorSpace()->convertPixelsTo(m_srcData.constData(), m_dstData.data(),
+                                                m_dstColorSpace,
+                                                bandRect.width() * bandRect.height(),
+                                                KoColorConversionTransformation::internalRenderingIntent(),
+                                                KoColorConversionTransformation::internalConversionFlags());
+        return m_dstData.constData();
+    }
+
+private:
+    KisPaintDeviceSP m_device;
+    QRect m_rect;
+    const KoColorSpace *m_dstColorSpace;
+    bool m_flatten;
+    KoColor m_fillColor;
+    QVector<quint8> m_srcData;
+    QVector<quint8> m_dstData;
+};
+
 class KisPNGReaderAbstract
 {
 public:
@@ -835,7 +1163,12 @@ KisImageWSP KisPNGConverter::image()
 
 bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData)
 {
-    if (store->open(filename)) {
+    // the PNG is already compressed, deflating it once more only wastes time
+    store->setCompressionEnabled(false);
+    const bool opened = store->open(filename);
+    store->setCompressionEnabled(true);
+
+    if (opened) {
         KoStoreDevice io(store);
         if (!io.open(QIODevice::WriteOnly)) {
             dbgFile << "Could not open for writing:" << filename;
@@ -848,7 +1181,8 @@ bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &im
             metaDataStore = new KisMetaData::Store(*metaData);
         }
         KisPNGOptions options;
-        options.compression = 0;
+        options.compression = 6;
+        options.parallelCompression = true;
         options.interlace = false;
         options.tryToSaveAsIndexed = false;
         options.alpha = true;
@@ -892,22 +1226,15 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
     if (!device)
         return KisImageBuilder_RESULT_INVALID_ARG;
 
-    if (!options.alpha) {
-        KisPaintDeviceSP tmp = new KisPaintDevice(device->colorSpace());
-        KoColor c(options.transparencyFillColor, device->colorSpace());
-        tmp->fill(imageRect, c);
-        KisPainter gc(tmp);
-        gc.bitBlt(imageRect.topLeft(), device, imageRect);
-        gc.end();
-        device = tmp;
-    }
+    const KoColorSpace *colorSpace = device->colorSpace();
 
     if (options.forceSRGB) {
-        const KoColorSpace* cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), device->colorSpace()->colorDepthId().id(), "sRGB built-in - (lcms internal)");
-        device = new KisPaintDevice(*device);
-        device->convertTo(cs);
+        colorSpace = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), device->colorSpace()->colorDepthId().id(), "sRGB built-in - (lcms internal)");
     }
 
+    // flattening and color conversion are done band by band while writing
+    KisPNGBandReader bandReader(device, imageRect, colorSpace, !options.alpha, options.transparencyFillColor);
+
     // Initialize structures
     png_structp png_ptr =  png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
     if (!png_ptr) {
@@ -950,44 +1277,49 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
     png_set_compression_strategy(png_ptr, Z_DEFAULT_STRATEGY);
     png_set_compression_window_bits(png_ptr, 15);
     png_set_compression_method(png_ptr, 8);
-    png_set_compression_buffer_size(png_ptr, 8192);
+    // fewer and bigger IDAT chunks
+    png_set_compression_buffer_size(png_ptr, 256 * 1024);
 
-    int color_nb_bits = 8 * device->pixelSize() / device->channelCount();
-    int color_type = getColorTypeforColorSpace(device->colorSpace(), options.alpha);
+    int color_nb_bits = 8 * colorSpace->pixelSize() / colorSpace->channelCount();
+    int color_type = getColorTypeforColorSpace(colorSpace, options.alpha);
 
     Q_ASSERT(color_type > -1);
 
     // Try to compute a table of color if the colorspace is RGB8f
     png_colorp palette = 0;
     int num_palette = 0;
-    if (!options.alpha && options.tryToSaveAsIndexed && KoID(device->colorSpace()->id()) == KoID("RGBA")) { // png doesn't handle indexed images and alpha, and only have indexed for RGB8
+    if (!options.alpha && options.tryToSaveAsIndexed && KoID(colorSpace->id()) == KoID("RGBA")) { // png doesn't handle indexed images and alpha, and only have indexed for RGB8
         palette = new png_color[255];
 
-        KisSequentialIterator it(device, imageRect);
+        const int pixelSize = colorSpace->pixelSize();
 
         bool toomuchcolor = false;
-        do {
-            const quint8* c = it.oldRawData();
-            bool findit = false;
-            for (int i = 0; i < num_palette; i++) {
-                if (palette[i].red == c[2] &&
-                        palette[i].green == c[1] &&
-                        palette[i].blue == c[0]) {
-                    findit = true;
-                    break;
+        for (int band = 0; band < bandReader.numBands() && !toomuchcolor; band++) {
+            const quint8 *c = bandReader.readBand(band);
+            const int numPixels = imageRect.width() * bandReader.bandHeight(band);
+
+            for (int p = 0; p < numPixels; p++, c += pixelSize) {
+                bool findit = false;
+                for (int i = 0; i < num_palette; i++) {
+                    if (palette[i].red == c[2] &&
+                            palette[i].green == c[1] &&
+                            palette[i].blue == c[0]) {
+                        findit = true;
+                        break;
+                    }
                 }
-            }
-            if (!findit) {
-                if (num_palette == 255) {
-                    toomuchcolor = true;
-                    break;
+                if (!findit) {
+                    if (num_palette == 255) {
+                        toomuchcolor = true;
+                        break;
+                    }
+                    palette[num_palette].red = c[2];
+                    palette[num_palette].green = c[1];
+                    palette[num_palette].blue = c[0];
+                    num_palette++;
                 }
-                palette[num_palette].red = c[2];
-                palette[num_palette].green = c[1];
-                palette[num_palette].blue = c[0];
-                num_palette++;
             }
-        }  while (it.nextPixel());
+        }
 
         if (!toomuchcolor) {
             dbgFile << "Found a palette of " << num_palette << " colors";
@@ -1017,7 +1349,7 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
 
     // set sRGB only if the profile is sRGB  -- http://www.w3.org/TR/PNG/#11sRGB says sRGB and iCCP should not both be present
 
-    bool sRGB = device->colorSpace()->profile()->name().contains(QLatin1String("srgb"), Qt::CaseInsensitive);
+    bool sRGB = colorSpace->profile()->name().contains(QLatin1String("srgb"), Qt::CaseInsensitive);
     /*
      * This automatically writes the correct gamma and chroma chunks along with the sRGB chunk, but firefox's
      * color management is bugged, so once you give it any incentive to start color managing an sRGB image it
@@ -1062,7 +1394,7 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
     }
 
     // Save the color profile
-    const KoColorProfile* colorProfile = device->colorSpace()->profile();
+    const KoColorProfile* colorProfile = colorSpace->profile();
     QByteArray colorProfileData = colorProfile->rawData();
     if (!sRGB || options.saveSRGBProfile) {
 #if PNG_LIBPNG_VER_MAJOR >= 1 && PNG_LIBPNG_VER_MINOR >= 5
@@ -1156,95 +1488,128 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
     // Write the PNG
     //     png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, 0);
 
-    // Fill the data structure
-    png_byte** row_pointers = new png_byte*[imageRect.height()];
-    int row = 0;
-    for (int y = imageRect.y(); y < imageRect.y() + imageRect.height(); y++, row++) {
-        KisHLineConstIteratorSP it = device->createHLineConstIteratorNG(imageRect.x(), y, imageRect.width());
+    const int rowBytes = png_get_rowbytes(png_ptr, info_ptr);
+    const int pixelSize = colorSpace->pixelSize();
+    const int width = imageRect.width();
 
-        row_pointers[row] = new png_byte[imageRect.width() * device->pixelSize()];
+    QScopedPointer<ParallelImageDataWriter> parallelWriter;
 
-        switch (color_type) {
-        case PNG_COLOR_TYPE_GRAY:
-        case PNG_COLOR_TYPE_GRAY_ALPHA:
-            if (color_nb_bits == 16) {
-                quint16 *dst = reinterpret_cast<quint16 *>(row_pointers[row]);
-                do {
-                    const quint16 *d = reinterpret_cast<const quint16 *>(it->oldRawData());
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[1];
-                } while (it->nextPixel());
-            } else {
-                quint8 *dst = row_pointers[row];
-                do {
-                    const quint8 *d = it->oldRawData();
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[1];
-                } while (it->nextPixel());
-            }
-            break;
-        case PNG_COLOR_TYPE_RGB:
-        case PNG_COLOR_TYPE_RGB_ALPHA:
-            if (color_nb_bits == 16) {
-                quint16 *dst = reinterpret_cast<quint16 *>(row_pointers[row]);
-                do {
-                    const quint16 *d = reinterpret_cast<const quint16 *>(it->oldRawData());
-                    *(dst++) = d[2];
-                    *(dst++) = d[1];
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[3];
-                } while (it->nextPixel());
-            } else {
-                quint8 *dst = row_pointers[row];
-                do {
-                    const quint8 *d = it->oldRawData();
-                    *(dst++) = d[2];
-                    *(dst++) = d[1];
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[3];
-                } while (it->nextPixel());
-            }
-            break;
-        case PNG_COLOR_TYPE_PALETTE: {
-            quint8 *dst = row_pointers[row];
-            KisPNGWriteStream writestream(dst, color_nb_bits);
-            do {
-                const quint8 *d = it->oldRawData();
-                int i;
-                for (i = 0; i < num_palette; i++) {
-                    if (palette[i].red == d[2] &&
-                            palette[i].green == d[1] &&
-                            palette[i].blue == d[0]) {
-                        break;
+    if (options.parallelCompression && interlacetype == PNG_INTERLACE_NONE) {
+        const int bytesPerPixel = qMax(1, png_get_channels(png_ptr, info_ptr) * color_nb_bits / 8);
+
+#ifndef WORDS_BIGENDIAN
+        const bool swapBytes = color_nb_bits > 8;
+#else
+        const bool swapBytes = false;
+#endif
+
+        parallelWriter.reset(new ParallelImageDataWriter(iodevice, imageRect.height(),
+                                                         rowBytes, bytesPerPixel, swapBytes,
+                                                         options.compression));
+    }
+
+    /**
+     * The rows are passed to libpng one by one, so only a single band
+     * of the image is kept in memory. An interlaced image is fetched
+     * once per pass, libpng picks the pixels of the pass from the rows.
+     */
+    const int numPasses = parallelWriter ? 1 : png_set_interlace_handling(png_ptr);
+
+    QVector<png_byte> row(rowBytes);
+
+    for (int pass = 0; pass < numPasses; pass++) {
+        for (int band = 0; band < bandReader.numBands(); band++) {
+            const quint8 *bandData = bandReader.readBand(band);
+            const int numRows = bandReader.bandHeight(band);
+
+            for (int y = 0; y < numRows; y++) {
+                const quint8 *d = bandData + y * width * pixelSize;
+
+                switch (color_type) {
+                case PNG_COLOR_TYPE_GRAY:
+                case PNG_COLOR_TYPE_GRAY_ALPHA:
+                    if (color_nb_bits == 16) {
+                        quint16 *dst = reinterpret_cast<quint16 *>(row.data());
+                        for (int x = 0; x < width; x++, d += pixelSize) {
+                            const quint16 *src = reinterpret_cast<const quint16 *>(d);
+                            *(dst++) = src[0];
+                            if (options.alpha) *(dst++) = src[1];
+                        }
+                    } else {
+                        quint8 *dst = row.data();
+                        for (int x = 0; x < width; x++, d += pixelSize) {
+                            *(dst++) = d[0];
+                            if (options.alpha) *(dst++) = d[1];
+                        }
+                    }
+                    break;
+                case PNG_COLOR_TYPE_RGB:
+                case PNG_COLOR_TYPE_RGB_ALPHA:
+                    if (color_nb_bits == 16) {
+                        quint16 *dst = reinterpret_cast<quint16 *>(row.data());
+                        for (int x = 0; x < width; x++, d += pixelSize) {
+                            const quint16 *src = reinterpret_cast<const quint16 *>(d);
+                            *(dst++) = src[2];
+                            *(dst++) = src[1];
+                            *(dst++) = src[0];
+                            if (options.alpha) *(dst++) = src[3];
+                        }
+                    } else {
+                        quint8 *dst = row.data();
+                        for (int x = 0; x < width; x++, d += pixelSize) {
+                            *(dst++) = d[2];
+                            *(dst++) = d[1];
+                            *(dst++) = d[0];
+                            if (options.alpha) *(dst++) = d[3];
+                        }
+                    }
+                    break;
+                case PNG_COLOR_TYPE_PALETTE: {
+                    KisPNGWriteStream writestream(row.data(), color_nb_bits);
+                    for (int x = 0; x < width; x++, d += pixelSize) {
+                        int i;
+                        for (i = 0; i < num_palette; i++) {
+                            if (palette[i].red == d[2] &&
+                                    palette[i].green == d[1] &&
+                                    palette[i].blue == d[0]) {
+                                break;
+                            }
+                        }
+                        writestream.setNextValue(i);
                     }
                 }
-                writestream.setNextValue(i);
-            } while (it->nextPixel());
-        }
-            break;
-        default:
-            delete[] row_pointers;
-            return KisImageBuilder_RESULT_UNSUPPORTED;
+                    break;
+                default:
+                    png_destroy_write_struct(&png_ptr, &info_ptr);
+                    return KisImageBuilder_RESULT_UNSUPPORTED;
+                }
+
+                if (parallelWriter) {
+                    parallelWriter->writeRow(row.data());
+                } else {
+                    png_write_row(png_ptr, row.data());
+                }
+            }
         }
     }
 
-    png_write_image(png_ptr, row_pointers);
+    bool success = true;
 
-    // Writing is over
-    png_write_end(png_ptr, info_ptr);
+    if (parallelWriter) {
+        success = parallelWriter->finish();
+    } else {
+        // Writing is over
+        png_write_end(png_ptr, info_ptr);
+    }
 
     // Free memory
     png_destroy_write_struct(&png_ptr, &info_ptr);
-    for (int y = 0; y < imageRect.height(); y++) {
-        delete[] row_pointers[y];
-    }
-    delete[] row_pointers;
 
     if (color_type == PNG_COLOR_TYPE_PALETTE) {
         delete [] palette;
     }
     iodevice->close();
-    return KisImageBuilder_RESULT_OK;
+    return success ? KisImageBuilder_RESULT_OK : KisImageBuilder_RESULT_FAILURE;
 }
 
 
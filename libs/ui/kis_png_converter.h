@@ -45,6 +45,7 @@ class Store;
 struct KisPNGOptions {
     KisPNGOptions()
         : compression(0)
+        , parallelCompression(false)
         , interlace(false)
         , alpha(true)
         , exif(true)
@@ -57,6 +58,8 @@ struct KisPNGOptions {
     {}
 
     int compression;
+    /// compress bands of scanlines in multiple threads, ignored for interlaced images
+    bool parallelCompression;
     bool interlace;
     bool alpha;
     bool exif;
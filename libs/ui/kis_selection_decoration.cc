@@ -30,6 +30,7 @@
 #include "flake/kis_shape_selection.h"
 #include "kis_pixel_selection.h"
 #include "kis_update_outline_job.h"
+#include "kis_selection_outline_generator.h"
 #include "kis_selection_manager.h"
 #include "canvas/kis_canvas2.h"
 #include "kis_canvas_resource_provider.h"
@@ -96,7 +97,10 @@ void KisSelectionDecoration::selectionChanged()
             m_signalCompressor.stop();
 
             if (m_mode == Ants) {
-                m_outlinePath = selection->outlineCache();
+                m_outlinePaths.clear();
+                for (int lod = 0; lod < KisSelectionOutlineGenerator::numLevelsOfDetail; lod++) {
+                    m_outlinePaths << selection->simplifiedOutlineCache(lod);
+                }
                 m_antsTimer->start();
             } else {
                 m_thumbnailImage = selection->thumbnailImage();
@@ -111,7 +115,7 @@ void KisSelectionDecoration::selectionChanged()
         }
     } else {
         m_signalCompressor.stop();
-        m_outlinePath = QPainterPath();
+        m_outlinePaths.clear();
         m_thumbnailImage = QImage();
         m_thumbnailImageTransform = QTransform();
         view()->canvasBase()->updateCanvas();
@@ -148,7 +152,7 @@ void KisSelectionDecoration::drawDecoration(QPainter& gc, const QRectF& updateRe
     Q_UNUSED(canvas);
 
     if (!selectionIsActive()) return;
-    if ((m_mode == Ants && m_outlinePath.isEmpty()) ||
+    if ((m_mode == Ants && (m_outlinePaths.isEmpty() || m_outlinePaths.first().isEmpty())) ||
         (m_mode == Mask && m_thumbnailImage.isNull())) return;
 
     KisConfig cfg;
@@ -182,13 +186,18 @@ void KisSelectionDecoration::drawDecoration(QPainter& gc, const QRectF& updateRe
     } else /* if (m_mode == Ants) */ {
         gc.setRenderHints(QPainter::Antialiasing | QPainter::HighQualityAntialiasing, cfg.antialiasSelectionOutline());
 
+        // the details smaller than a screen pixel are not visible anyway
+        const int lod = qMin(KisSelectionOutlineGenerator::levelOfDetailForScale(converter->effectiveZoom()),
+                             m_outlinePaths.size() - 1);
+        const QPainterPath &outlinePath = m_outlinePaths[lod];
+
         // render selection outline in white
         gc.setPen(m_outlinePen);
-        gc.drawPath(m_outlinePath);
+        gc.drawPath(outlinePath);
 
         // render marching ants in black (above the white outline)
         gc.setPen(m_antsPen);
-        gc.drawPath(m_outlinePath);
+        gc.drawPath(outlinePath);
     }
     gc.restore();
 }
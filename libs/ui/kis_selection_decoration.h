@@ -57,7 +57,7 @@ private:
 
 private:
     KisSignalCompressor m_signalCompressor;
-    QPainterPath m_outlinePath;
+    QVector<QPainterPath> m_outlinePaths; // indexed by the level of detail
     QImage m_thumbnailImage;
     QTransform m_thumbnailImageTransform;
     QTimer* m_antsTimer;
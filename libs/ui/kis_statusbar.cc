@@ -298,6 +298,12 @@ void KisStatusBar::updateMemoryStatus()
               formatSize(stats.historicalMemorySize),
               formatSize(stats.swapSize));
 
+    longStats +=
+        i18nc("tooltip on statusbar memory reporting button",
+              "\n\nSelections:\t %1 (unpacked: %2)",
+              formatSize(stats.selectionsSize),
+              formatSize(stats.selectionsUnpackedSize));
+
     QString shortStats = formatSize(stats.imageSize);
     QIcon icon;
     qint64 warnLevel = stats.tilesHardLimit - stats.tilesHardLimit / 8;
@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_kra_layer_data_cache.h"
+
+#include <QHash>
+
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+
+
+struct KisKraLayerDataCache::Private
+{
+    struct Entry {
+        Entry() : used(false), lastUse(0) {}
+
+        KisPaintDeviceSP device;
+        QByteArray data;
+        bool used;
+        quint64 lastUse;
+    };
+
+    QHash<QString, Entry> entries;
+    qint64 maxDataSize = 0;
+    qint64 dataSize = 0;
+    quint64 useCounter = 0;
+    int numHits = 0;
+
+    void removeEntry(QHash<QString, Entry>::iterator it) {
+        dataSize -= it.value().data.size();
+        entries.erase(it);
+    }
+
+    void evictLeastRecentlyUsed();
+};
+
+void KisKraLayerDataCache::Private::evictLeastRecentlyUsed()
+{
+    while (dataSize > maxDataSize && !entries.isEmpty()) {
+        QHash<QString, Entry>::iterator oldest = entries.begin();
+
+        for (QHash<QString, Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+            if (it.value().lastUse < oldest.value().lastUse) {
+                oldest = it;
+            }
+        }
+
+        removeEntry(oldest);
+    }
+}
+
+KisKraLayerDataCache::KisKraLayerDataCache(qint64 maxDataSize)
+    : m_d(new Private)
+{
+    m_d->maxDataSize = maxDataSize;
+}
+
+KisKraLayerDataCache::~KisKraLayerDataCache()
+{
+}
+
+qint64 KisKraLayerDataCache::maxDataSize() const
+{
+    return m_d->maxDataSize;
+}
+
+QByteArray KisKraLayerDataCache::fetch(const QString &key, KisPaintDeviceSP device)
+{
+    QHash<QString, Private::Entry>::iterator it = m_d->entries.find(key);
+    if (it == m_d->entries.end()) return QByteArray();
+
+    Private::Entry &entry = it.value();
+
+    if (!entry.device->dataManager()->sharesAllTileData(device->dataManager().data())) {
+        m_d->removeEntry(it);
+        return QByteArray();
+    }
+
+    /**
+     * Both devices share the same tiles, keep the newer one so that
+     * the previous snapshot of the image could be released completely
+     */
+    entry.device = device;
+    entry.used = true;
+    entry.lastUse = ++m_d->useCounter;
+    m_d->numHits++;
+
+    return entry.data;
+}
+
+void KisKraLayerDataCache::store(const QString &key, KisPaintDeviceSP device, const QByteArray &data)
+{
+    QHash<QString, Private::Entry>::iterator it = m_d->entries.find(key);
+    if (it != m_d->entries.end()) {
+        m_d->removeEntry(it);
+    }
+
+    if (data.size() > m_d->maxDataSize) return;
+
+    Private::Entry &entry = m_d->entries[key];
+    entry.device = device;
+    entry.data = data;
+    entry.used = true;
+    entry.lastUse = ++m_d->useCounter;
+    m_d->dataSize += data.size();
+
+    m_d->evictLeastRecentlyUsed();
+}
+
+void KisKraLayerDataCache::removeUnusedEntries()
+{
+    QHash<QString, Private::Entry>::iterator it = m_d->entries.begin();
+
+    while (it != m_d->entries.end()) {
+        if (!it.value().used) {
+            m_d->dataSize -= it.value().data.size();
+            it = m_d->entries.erase(it);
+        } else {
+            it.value().used = false;
+            ++it;
+        }
+    }
+}
+
+void KisKraLayerDataCache::clear()
+{
+    m_d->entries.clear();
+    m_d->dataSize = 0;
+}
+
+qint64 KisKraLayerDataCache::dataSize() const
+{
+    return m_d->dataSize;
+}
+
+int KisKraLayerDataCache::numHits() const
+{
+    return m_d->numHits;
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_KRA_LAYER_DATA_CACHE_H
+#define __KIS_KRA_LAYER_DATA_CACHE_H
+
+#include <QScopedPointer>
+#include <QByteArray>
+#include <QString>
+
+#include "kis_types.h"
+#include "kritaui_export.h"
+
+
+/**
+ * Keeps the compressed pixel data written for the paint devices of a
+ * document during the previous save, so that the next save can copy
+ * it into the store for the devices that have not been changed since
+ * then instead of compressing all their tiles again.
+ *
+ * A device is considered unchanged when it still consists of the very
+ * same tile data objects as the saved one. To make this check exact,
+ * the cache holds the saved devices themselves (they belong to the
+ * snapshot of the image taken for saving). The tiles of the image stay
+ * shared with them, so painting on a tile makes a copy of its data, and
+ * the changed tile can never be mistaken for the saved one. The price
+ * is that the tiles changed between two saves take twice the memory,
+ * similar to the undo history.
+ *
+ * The size of the kept data is limited by maxDataSize(), the entries
+ * used least recently are dropped first.
+ *
+ * The cache is used by one save at a time, the saves of a document
+ * never overlap.
+ */
+class KRITAUI_EXPORT KisKraLayerDataCache
+{
+public:
+    KisKraLayerDataCache(qint64 maxDataSize = 128 * 1024 * 1024);
+    ~KisKraLayerDataCache();
+
+    /**
+     * \return the maximum size of the data kept in the cache in bytes
+     */
+    qint64 maxDataSize() const;
+
+    /**
+     * \return the data saved for \p key if \p device has not been
+     * changed since it was saved, otherwise an empty array
+     */
+    QByteArray fetch(const QString &key, KisPaintDeviceSP device);
+
+    /**
+     * Remembers \p data written for \p device under \p key. The
+     * device is usually a part of the image snapshot being saved.
+     * Drops the entries used least recently if the cache grows bigger
+     * than maxDataSize(). Data bigger than that is not stored at all.
+     */
+    void store(const QString &key, KisPaintDeviceSP device, const QByteArray &data);
+
+    /**
+     * Drops the entries which have not been fetched or stored since the
+     * previous call, that is the ones of the removed or changed nodes.
+     * Should be called when a save is complete.
+     */
+    void removeUnusedEntries();
+
+    /**
+     * Drops all the entries
+     */
+    void clear();
+
+    /**
+     * \return the size of the data stored in the cache in bytes
+     */
+    qint64 dataSize() const;
+
+    /**
+     * \return the number of fetch() calls which returned the data
+     */
+    int numHits() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_KRA_LAYER_DATA_CACHE_H */
@@ -43,6 +43,7 @@
 #include <kis_adjustment_layer.h>
 #include <filter/kis_filter_configuration.h>
 #include <kis_datamanager.h>
+#include <kis_image_config.h>
 #include <generator/kis_generator_layer.h>
 #include <kis_pixel_selection.h>
 #include <kis_clone_layer.h>
@@ -93,6 +94,7 @@ KisKraLoadVisitor::KisKraLoadVisitor(KisImageWSP image,
         m_keyframeFilenames(keyframeFilenames)
 {
     m_external = false;
+    m_lazyLoading = KisImageConfig(true).lazyLayerLoading();
     m_image = image;
     m_store = store;
     m_name = name;
@@ -403,22 +405,27 @@ QStringList KisKraLoadVisitor::errorMessages() const
 
 struct SimpleDevicePolicy
 {
+    SimpleDevicePolicy(bool lazyLoading)
+        : m_lazyLoading(lazyLoading) {}
+
     bool read(KisPaintDeviceSP dev, QIODevice *stream) {
-        return dev->read(stream);
+        return dev->read(stream, m_lazyLoading);
     }
 
     void setDefaultPixel(KisPaintDeviceSP dev, const KoColor &defaultPixel) const {
         return dev->setDefaultPixel(defaultPixel);
     }
+
+    bool m_lazyLoading;
 };
 
 struct FramedDevicePolicy
 {
-    FramedDevicePolicy(int frameId)
-        :  m_frameId(frameId) {}
+    FramedDevicePolicy(int frameId, bool lazyLoading)
+        :  m_frameId(frameId), m_lazyLoading(lazyLoading) {}
 
     bool read(KisPaintDeviceSP dev, QIODevice *stream) {
-        return dev->framesInterface()->readFrame(stream, m_frameId);
+        return dev->framesInterface()->readFrame(stream, m_frameId, m_lazyLoading);
     }
 
     void setDefaultPixel(KisPaintDeviceSP dev, const KoColor &defaultPixel) const {
@@ -426,6 +433,7 @@ struct FramedDevicePolicy
     }
 
     int m_frameId;
+    bool m_lazyLoading;
 };
 
 bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString& location)
@@ -440,7 +448,7 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
     }
 
     if (!frameInterface || frames.count() <= 1) {
-        return loadPaintDeviceFrame(device, location, SimpleDevicePolicy());
+        return loadPaintDeviceFrame(device, location, SimpleDevicePolicy(m_lazyLoading));
     } else {
         KisRasterKeyframeChannel *keyframeChannel = device->keyframeChannel();
 
@@ -449,7 +457,7 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
             QString frameFilename = getLocation(keyframeChannel->frameFilename(id));
             Q_ASSERT(!frameFilename.isEmpty());
 
-            if (!loadPaintDeviceFrame(device, frameFilename, FramedDevicePolicy(id))) {
+            if (!loadPaintDeviceFrame(device, frameFilename, FramedDevicePolicy(id, m_lazyLoading))) {
                 return false;
             }
         }
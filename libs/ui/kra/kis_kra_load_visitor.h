@@ -82,6 +82,7 @@ private:
     KisImageWSP m_image;
     KoStore *m_store;
     bool m_external;
+    bool m_lazyLoading;
     QString m_uri;
     QMap<KisNode *, QString> m_layerFilenames;
     QMap<KisNode *, QString> m_keyframeFilenames;
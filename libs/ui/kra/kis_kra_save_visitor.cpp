@@ -54,6 +54,7 @@
 
 #include "kis_config.h"
 #include "kis_store_paintdevice_writer.h"
+#include "kis_kra_layer_data_cache.h"
 #include "flake/kis_shape_selection.h"
 
 #include "kis_raster_keyframe_channel.h"
@@ -74,6 +75,7 @@ KisKraSaveVisitor::KisKraSaveVisitor(KoStore *store, const QString & name, QMap<
     , m_name(name)
     , m_nodeFileNames(nodeFileNames)
     , m_writer(new KisStorePaintDeviceWriter(store))
+    , m_layerDataCache(0)
 {
 }
 
@@ -88,6 +90,11 @@ void KisKraSaveVisitor::setExternalUri(const QString &uri)
     m_uri = uri;
 }
 
+void KisKraSaveVisitor::setLayerDataCache(KisKraLayerDataCache *cache)
+{
+    m_layerDataCache = cache;
+}
+
 bool KisKraSaveVisitor::visit(KisExternalLayer * layer)
 {
     bool result = false;
@@ -116,7 +123,7 @@ bool KisKraSaveVisitor::visit(KisExternalLayer * layer)
 
 bool KisKraSaveVisitor::visit(KisPaintLayer *layer)
 {
-    if (!savePaintDevice(layer->paintDevice(), getLocation(layer))) {
+    if (!savePaintDevice(layer->paintDevice(), getLocation(layer), layer->uuid().toString())) {
         m_errorMessages << i18n("Failed to save the pixel data for layer %1.", layer->name());
         return false;
     }
@@ -312,6 +319,49 @@ struct SimpleDevicePolicy
     }
 };
 
+/**
+ * Passes the data to \p writer and keeps a copy of it in \p data,
+ * unless the copy grows bigger than \p maxSize
+ */
+struct KisCachingPaintDeviceWriter : public KisPaintDeviceWriter
+{
+    KisCachingPaintDeviceWriter(KisPaintDeviceWriter *writer, QByteArray *data, qint64 maxSize)
+        : m_writer(writer), m_data(data), m_maxSize(maxSize), m_overflow(false) {}
+
+    bool write(const QByteArray &data) {
+        keep(data.constData(), data.size());
+        return m_writer->write(data);
+    }
+
+    bool write(const char* data, qint64 length) {
+        keep(data, length);
+        return m_writer->write(data, length);
+    }
+
+    bool overflow() const {
+        return m_overflow;
+    }
+
+private:
+    void keep(const char* data, qint64 length) {
+        if (m_overflow) return;
+
+        if (m_data->size() + length > m_maxSize) {
+            m_overflow = true;
+            m_data->clear();
+            return;
+        }
+
+        m_data->append(data, length);
+    }
+
+private:
+    KisPaintDeviceWriter *m_writer;
+    QByteArray *m_data;
+    qint64 m_maxSize;
+    bool m_overflow;
+};
+
 struct FramedDevicePolicy
 {
     FramedDevicePolicy(int frameId)
@@ -329,7 +379,8 @@ struct FramedDevicePolicy
 };
 
 bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
-                                        QString location)
+                                        QString location,
+                                        const QString &cacheKey)
 {
     // Layer data
     KisConfig cfg;
@@ -343,7 +394,11 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
     }
 
     if (!frameInterface || frames.count() <= 1) {
-        savePaintDeviceFrame(device, location, SimpleDevicePolicy());
+        if (m_layerDataCache && !cacheKey.isEmpty()) {
+            savePaintDeviceCached(device, location, cacheKey);
+        } else {
+            savePaintDeviceFrame(device, location, SimpleDevicePolicy());
+        }
     } else {
         KisRasterKeyframeChannel *keyframeChannel = device->keyframeChannel();
 
@@ -384,6 +439,40 @@ bool KisKraSaveVisitor::savePaintDeviceFrame(KisPaintDeviceSP device, QString lo
     return true;
 }
 
+bool KisKraSaveVisitor::savePaintDeviceCached(KisPaintDeviceSP device, QString location, const QString &cacheKey)
+{
+    QByteArray data = m_layerDataCache->fetch(cacheKey, device);
+
+    if (m_store->open(location)) {
+        bool result = false;
+
+        if (!data.isEmpty()) {
+            result = m_store->write(data) == data.size();
+        } else {
+            // the device is written straight into the store, the copy is only kept for the cache
+            KisCachingPaintDeviceWriter writer(m_writer, &data, m_layerDataCache->maxDataSize());
+            result = device->write(writer);
+
+            if (result && !writer.overflow()) {
+                m_layerDataCache->store(cacheKey, device, data);
+            }
+        }
+
+        m_store->close();
+
+        if (!result) {
+            device->disconnect();
+            return false;
+        }
+    }
+    if (m_store->open(location + ".defaultpixel")) {
+        m_store->write((char*)device->defaultPixel().data(), device->colorSpace()->pixelSize());
+        m_store->close();
+    }
+
+    return true;
+}
+
 bool KisKraSaveVisitor::saveAnnotations(KisLayer* layer)
 {
     if (!layer) return false;
@@ -434,7 +523,8 @@ bool KisKraSaveVisitor::saveSelection(KisNode* node)
 
     if (selection->hasPixelSelection()) {
         KisPaintDeviceSP dev = selection->pixelSelection();
-        if (!savePaintDevice(dev, getLocation(node, DOT_PIXEL_SELECTION))) {
+        if (!savePaintDevice(dev, getLocation(node, DOT_PIXEL_SELECTION),
+                             node->uuid().toString() + DOT_PIXEL_SELECTION)) {
             m_errorMessages << i18n("Failed to save the pixel selection data for layer %1.", node->name());
             retval = false;
         }
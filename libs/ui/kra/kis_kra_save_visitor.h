@@ -29,6 +29,7 @@
 
 
 class KisPaintDeviceWriter;
+class KisKraLayerDataCache;
 class KoStore;
 
 class KisKraSaveVisitor : public KisNodeVisitor
@@ -41,6 +42,13 @@ public:
 public:
     void setExternalUri(const QString &uri);
 
+    /**
+     * Lets the visitor reuse the pixel data written by the previous save
+     * for the devices that have not been changed since, see
+     * KisKraLayerDataCache
+     */
+    void setLayerDataCache(KisKraLayerDataCache *cache);
+
     bool visit(KisNode*) {
         return true;
     }
@@ -72,7 +80,8 @@ public:
 
 private:
 
-    bool savePaintDevice(KisPaintDeviceSP device, QString location);
+    bool savePaintDevice(KisPaintDeviceSP device, QString location, const QString &cacheKey = QString());
+    bool savePaintDeviceCached(KisPaintDeviceSP device, QString location, const QString &cacheKey);
 
     template<class DevicePolicy>
     bool savePaintDeviceFrame(KisPaintDeviceSP device, QString location, DevicePolicy policy);
@@ -92,6 +101,7 @@ private:
     QString m_name;
     QMap<const KisNode*, QString> m_nodeFileNames;
     KisPaintDeviceWriter *m_writer;
+    KisKraLayerDataCache *m_layerDataCache;
     QStringList m_errorMessages;
 };
 
@@ -21,9 +21,11 @@
 #include "kis_kra_tags.h"
 #include "kis_kra_save_visitor.h"
 #include "kis_kra_savexml_visitor.h"
+#include "kis_kra_layer_data_cache.h"
 
 #include <QDomDocument>
 #include <QDomElement>
+#include <QPair>
 #include <QString>
 #include <QStringList>
 
@@ -55,6 +57,7 @@
 #include "kis_dom_utils.h"
 #include "kis_grid_config.h"
 #include "kis_guides_config.h"
+#include "kis_layer_utils.h"
 #include "KisProofingConfiguration.h"
 
 
@@ -68,12 +71,21 @@ public:
     QMap<const KisNode*, QString> keyframeFilenames;
     QString imageName;
     QStringList errorMessages;
+    KisKraLayerDataCache *layerDataCache;
+
+    /**
+     * The files of the painting assistants. They belong to the
+     * document, so they are serialized in saveXML() together with the
+     * rest of the document state and only written in saveBinaryData()
+     */
+    QList<QPair<QString, QByteArray> > assistantsFiles;
 };
 
 KisKraSaver::KisKraSaver(KisDocument* document)
         : m_d(new Private)
 {
     m_d->doc = document;
+    m_d->layerDataCache = 0;
 
     m_d->imageName = m_d->doc->documentInfo()->aboutInfo("title");
     if (m_d->imageName.isEmpty()) {
@@ -112,7 +124,22 @@ QDomElement KisKraSaver::saveXML(QDomDocument& doc,  KisImageWSP image)
 
     quint32 count = 1; // We don't save the root layer, but it does count
     KisSaveXmlVisitor visitor(doc, imageElement, count, m_d->doc->url().toLocalFile(), true);
-    visitor.setSelectedNodes(m_d->doc->activeNodes());
+
+    /**
+     * The image may be a snapshot of the document's image, so the
+     * active nodes are looked up in it by their UUIDs
+     */
+    vKisNodeSP selectedNodes;
+    Q_FOREACH (KisNodeSP activeNode, m_d->doc->activeNodes()) {
+        const QUuid uuid = activeNode->uuid();
+        KisNodeSP node = KisLayerUtils::recursiveFindNode(image->root(),
+            [uuid] (KisNodeSP node) { return node->uuid() == uuid; });
+
+        if (node) {
+            selectedNodes.append(node);
+        }
+    }
+    visitor.setSelectedNodes(selectedNodes);
 
     image->rootLayer()->accept(visitor);
     m_d->errorMessages.append(visitor.errorMessages());
@@ -124,6 +151,7 @@ QDomElement KisKraSaver::saveXML(QDomDocument& doc,  KisImageWSP image)
     saveWarningColor(doc, imageElement, image);
     saveCompositions(doc, imageElement, image);
     saveAssistantsList(doc,imageElement);
+    collectAssistants();
     saveGrid(doc,imageElement);
     saveGuides(doc,imageElement);
 
@@ -189,13 +217,23 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageWSP image, const QStrin
     if (external)
         visitor.setExternalUri(uri);
 
+    visitor.setLayerDataCache(m_d->layerDataCache);
+
     image->rootLayer()->accept(visitor);
 
     m_d->errorMessages.append(visitor.errorMessages());
     if (!m_d->errorMessages.isEmpty()) {
+        if (m_d->layerDataCache) {
+            m_d->layerDataCache->clear();
+        }
         return false;
     }
 
+    if (m_d->layerDataCache) {
+        // forget the devices of the removed nodes
+        m_d->layerDataCache->removeUnusedEntries();
+    }
+
     // saving annotations
     // XXX this only saves EXIF and ICC info. This would probably need
     // a redesign of the dtd of the krita file to do this more generally correct
@@ -288,6 +326,11 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageWSP image, const QStrin
     return true;
 }
 
+void KisKraSaver::setLayerDataCache(KisKraLayerDataCache *cache)
+{
+    m_d->layerDataCache = cache;
+}
+
 QStringList KisKraSaver::errorMessages() const
 {
     return m_d->errorMessages;
@@ -325,28 +368,36 @@ void KisKraSaver::saveCompositions(QDomDocument& doc, QDomElement& element, KisI
     }
 }
 
-bool KisKraSaver::saveAssistants(KoStore* store, QString uri, bool external)
+void KisKraSaver::collectAssistants()
 {
-    QString location;
     QMap<QString, int> assistantcounters;
-    QByteArray data;
     QList<KisPaintingAssistantSP> assistants =  m_d->doc->assistants();
     QMap<KisPaintingAssistantHandleSP, int> handlemap;
-    if (!assistants.isEmpty()) {
-        Q_FOREACH (KisPaintingAssistantSP assist, assistants){
-            if (!assistantcounters.contains(assist->id())){
-                assistantcounters.insert(assist->id(),0);
-            }
-            location = external ? QString() : uri;
-            location += m_d->imageName + ASSISTANTS_PATH;
-            location += QString(assist->id()+"%1.assistant").arg(assistantcounters[assist->id()]);
-            data = assist->saveXml(handlemap);
-            store->open(location);
-            store->write(data);
-            store->close();
-            assistantcounters[assist->id()]++;
+
+    m_d->assistantsFiles.clear();
+
+    Q_FOREACH (KisPaintingAssistantSP assist, assistants){
+        if (!assistantcounters.contains(assist->id())){
+            assistantcounters.insert(assist->id(),0);
         }
+        QString name = QString(assist->id()+"%1.assistant").arg(assistantcounters[assist->id()]);
+        m_d->assistantsFiles.append(qMakePair(name, assist->saveXml(handlemap)));
+        assistantcounters[assist->id()]++;
+    }
+}
 
+bool KisKraSaver::saveAssistants(KoStore* store, QString uri, bool external)
+{
+    QString location;
+    typedef QPair<QString, QByteArray> AssistantFile;
+
+    Q_FOREACH (const AssistantFile &file, m_d->assistantsFiles) {
+        location = external ? QString() : uri;
+        location += m_d->imageName + ASSISTANTS_PATH;
+        location += file.first;
+        store->open(location);
+        store->write(file.second);
+        store->close();
     }
     return true;
 }
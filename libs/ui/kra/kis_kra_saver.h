@@ -22,6 +22,7 @@
 #include <kis_types.h>
 
 class KisDocument;
+class KisKraLayerDataCache;
 class QDomElement;
 class QDomDocument;
 class KoStore;
@@ -42,6 +43,13 @@ public:
 
     bool saveBinaryData(KoStore* store, KisImageWSP image, const QString & uri, bool external, bool includeMerge);
 
+    /**
+     * Sets the cache of the pixel data written by the previous save of
+     * the document, saveBinaryData() will reuse the data of the devices
+     * which have not been changed since then
+     */
+    void setLayerDataCache(KisKraLayerDataCache *cache);
+
     /// @return a list with everthing that went wrong while saving
     QStringList errorMessages() const;
 
@@ -49,6 +57,7 @@ private:
     void saveBackgroundColor(QDomDocument& doc, QDomElement& element, KisImageWSP image);
     void saveWarningColor(QDomDocument& doc, QDomElement& element, KisImageWSP image);
     void saveCompositions(QDomDocument& doc, QDomElement& element, KisImageWSP image);
+    void collectAssistants();
     bool saveAssistants(KoStore *store,QString uri, bool external);
     bool saveAssistantsList(QDomDocument& doc, QDomElement& element);
     bool saveGrid(QDomDocument& doc, QDomElement& element);
@@ -127,6 +127,13 @@ void FillProcessingVisitor::fillPaintDevice(KisPaintDeviceSP device, KisUndoAdap
 
         KisPaintDeviceSP sourceDevice = m_unmerged ? device : m_resources->image()->projection();
 
+        /**
+         * The user usually fills many areas of the same layer in a row,
+         * so the differences to the seed color can be shared between the
+         * fills. The projection of the image changes too often for that.
+         */
+        fillPainter.setUseSimilarityCache(m_unmerged);
+
         if (m_usePattern) {
             fillPainter.fillPattern(startPoint.x(), startPoint.y(), sourceDevice);
         } else {
@@ -37,6 +37,10 @@
 #include "kis_image_animation_interface.h"
 #include "kis_keyframe_channel.h"
 #include "kis_time_range.h"
+#include "kis_paint_layer.h"
+#include "kis_image_config.h"
+#include "kis_undo_stores.h"
+#include "tiles3/kis_tile_data_store.h"
 
 void KisKraLoaderTest::initTestCase()
 {
@@ -169,4 +173,95 @@ void KisKraLoaderTest::testLoadAnimated()
 }
 
 
+const QString bigDocumentFileName("lazy_loading_benchmark.kra");
+
+void createBigDocument()
+{
+    const QRect imageRect(0, 0, 2000, 2000);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "lazy loading benchmark");
+
+    QImage gradient(imageRect.size(), QImage::Format_ARGB32);
+
+    for (int i = 0; i < 16; i++) {
+        for (int y = 0; y < imageRect.height(); y++) {
+            QRgb *line = reinterpret_cast<QRgb*>(gradient.scanLine(y));
+            for (int x = 0; x < imageRect.width(); x++) {
+                line[x] = qRgba((x + i) & 0xff, (y * i) & 0xff, (x ^ y) & 0xff, 255);
+            }
+        }
+
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+        layer->paintDevice()->convertFromQImage(gradient, 0);
+
+        // only the topmost layer is needed for the projection
+        layer->setVisible(i == 15);
+        image->addNode(layer);
+    }
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setCurrentImage(image);
+    doc->saveNativeFormat(bigDocumentFileName);
+}
+
+/**
+ * Restores the lazy loading option and removes the generated document
+ * even if one of the checks fails
+ */
+struct BenchmarkLoadingGuard
+{
+    BenchmarkLoadingGuard(bool lazy)
+        : m_oldLazyLoading(KisImageConfig(true).lazyLayerLoading())
+    {
+        KisImageConfig config;
+        config.setLazyLayerLoading(lazy);
+    }
+
+    ~BenchmarkLoadingGuard()
+    {
+        KisImageConfig config;
+        config.setLazyLayerLoading(m_oldLazyLoading);
+
+        QFile::remove(bigDocumentFileName);
+    }
+
+private:
+    bool m_oldLazyLoading;
+};
+
+void benchmarkLoadingImpl(bool lazy)
+{
+    BenchmarkLoadingGuard guard(lazy);
+    createBigDocument();
+
+    const KisTileDataStore::MemoryStatistics before =
+        KisTileDataStore::instance()->memoryStatistics();
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+    QBENCHMARK_ONCE {
+        doc->loadNativeFormat(bigDocumentFileName);
+        doc->image()->waitForDone();
+    }
+
+    const KisTileDataStore::MemoryStatistics after =
+        KisTileDataStore::instance()->memoryStatistics();
+
+    QCOMPARE(doc->image()->nlayers(), 17);
+
+    qDebug() << (lazy ? "Lazy loading:" : "Eager loading:")
+             << "tiles in memory" << (after.totalMemorySize - before.totalMemorySize) / (1 << 20) << "MiB"
+             << "tiles in swap" << (after.swapSize - before.swapSize) / (1 << 20) << "MiB";
+}
+
+void KisKraLoaderTest::benchmarkLoadingEager()
+{
+    benchmarkLoadingImpl(false);
+}
+
+void KisKraLoaderTest::benchmarkLoadingLazy()
+{
+    benchmarkLoadingImpl(true);
+}
+
 QTEST_MAIN(KisKraLoaderTest)
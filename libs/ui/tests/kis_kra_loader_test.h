@@ -32,6 +32,9 @@ private Q_SLOTS:
     void testObligeSingleChildNonTranspPixel();
 
     void testLoadAnimated();
+
+    void benchmarkLoadingEager();
+    void benchmarkLoadingLazy();
 };
 
 #endif
@@ -398,4 +398,198 @@ void KisKraSaverTest::testRoundTripColorizeMask()
     QCOMPARE(strokes[2].color.colorSpace(), weirdCS);
 }
 
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <KoStore.h>
+#include "kra/kis_kra_layer_data_cache.h"
+
+void KisKraSaverTest::testLayerDataCache()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(QRect(0, 0, 200, 200), KoColor(Qt::red, cs));
+
+    KisKraLayerDataCache cache;
+
+    // the snapshots share the tiles with the device
+    KisPaintDeviceSP snapshot1 = new KisPaintDevice(*dev);
+    QVERIFY(cache.fetch("dev", snapshot1).isEmpty());
+    cache.store("dev", snapshot1, QByteArray("data"));
+    QCOMPARE(cache.dataSize(), qint64(4));
+    cache.removeUnusedEntries();
+
+    KisPaintDeviceSP snapshot2 = new KisPaintDevice(*dev);
+    QCOMPARE(cache.fetch("dev", snapshot2), QByteArray("data"));
+    cache.removeUnusedEntries();
+    snapshot1 = 0;
+
+    // the cache holds snapshot2, so painting copies the tiles on write
+    dev->fill(QRect(100, 100, 10, 10), KoColor(Qt::green, cs));
+    KisPaintDeviceSP snapshot3 = new KisPaintDevice(*dev);
+    QVERIFY(cache.fetch("dev", snapshot3).isEmpty());
+    QCOMPARE(cache.dataSize(), qint64(0));
+
+    // a new tile
+    cache.store("dev", snapshot3, QByteArray("data"));
+    dev->fill(QRect(500, 500, 10, 10), KoColor(Qt::green, cs));
+    QVERIFY(cache.fetch("dev", new KisPaintDevice(*dev)).isEmpty());
+
+    // the entries not used since the previous call are removed
+    cache.store("dev", new KisPaintDevice(*dev), QByteArray("data"));
+    cache.removeUnusedEntries();
+    cache.removeUnusedEntries();
+    QVERIFY(cache.fetch("dev", new KisPaintDevice(*dev)).isEmpty());
+    QCOMPARE(cache.numHits(), 1);
+}
+
+void KisKraSaverTest::testLayerDataCacheLimit()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev1 = new KisPaintDevice(cs);
+    KisPaintDeviceSP dev2 = new KisPaintDevice(cs);
+    KisPaintDeviceSP dev3 = new KisPaintDevice(cs);
+
+    KisKraLayerDataCache cache(8);
+    QCOMPARE(cache.maxDataSize(), qint64(8));
+
+    cache.store("dev1", dev1, QByteArray("1111"));
+    cache.store("dev2", dev2, QByteArray("2222"));
+    QCOMPARE(cache.dataSize(), qint64(8));
+
+    // dev2 is the least recently used one now
+    QCOMPARE(cache.fetch("dev1", dev1), QByteArray("1111"));
+    cache.store("dev3", dev3, QByteArray("3333"));
+    QCOMPARE(cache.dataSize(), qint64(8));
+    QVERIFY(cache.fetch("dev2", dev2).isEmpty());
+    QCOMPARE(cache.fetch("dev1", dev1), QByteArray("1111"));
+    QCOMPARE(cache.fetch("dev3", dev3), QByteArray("3333"));
+
+    // the data bigger than the limit is not kept and replaces nothing
+    cache.store("dev1", dev1, QByteArray("111111111"));
+    QCOMPARE(cache.dataSize(), qint64(4));
+    QVERIFY(cache.fetch("dev1", dev1).isEmpty());
+    QCOMPARE(cache.fetch("dev3", dev3), QByteArray("3333"));
+}
+
+void KisKraSaverTest::testRoundTripUnchangedLayers()
+{
+    QRect imageRect(0,0,512,512);
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "test image");
+    KisPaintLayerSP layer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    KisPaintLayerSP layer2 = new KisPaintLayer(image, "paint2", OPACITY_OPAQUE_U8);
+    KisTransparencyMaskSP mask = new KisTransparencyMask();
+    image->addNode(layer1);
+    image->addNode(layer2);
+    image->addNode(mask, layer1);
+
+    layer1->paintDevice()->fill(QRect(100, 100, 100, 100), KoColor(Qt::red, cs));
+    layer2->paintDevice()->fill(QRect(200, 200, 100, 100), KoColor(Qt::green, cs));
+    mask->initSelection(layer1);
+    mask->selection()->pixelSelection()->clear(QRect(150, 150, 20, 20));
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setCurrentImage(image);
+    doc->documentInfo()->setAboutInfo("title", image->objectName());
+
+    QVERIFY(doc->saveNativeFormat("roundtrip_unchanged_layers.kra"));
+    QCOMPARE(doc->layerDataCache()->numHits(), 0);
+    QVERIFY(doc->layerDataCache()->dataSize() > 0);
+
+    // the second save reuses the data of layer1 and the mask
+    layer2->paintDevice()->fill(QRect(300, 300, 100, 100), KoColor(Qt::blue, cs));
+    QVERIFY(doc->saveNativeFormat("roundtrip_unchanged_layers.kra"));
+    QCOMPARE(doc->layerDataCache()->numHits(), 2);
+
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    QVERIFY(doc2->loadNativeFormat("roundtrip_unchanged_layers.kra"));
+    doc2->image()->waitForDone();
+
+    KisNodeSP layer1copy = TestUtil::findNode(doc2->image()->root(), "paint1");
+    KisNodeSP layer2copy = TestUtil::findNode(doc2->image()->root(), "paint2");
+    QVERIFY(layer1copy);
+    QVERIFY(layer2copy);
+
+    KisTransparencyMask *maskCopy = dynamic_cast<KisTransparencyMask*>(layer1copy->firstChild().data());
+    QVERIFY(maskCopy);
+
+    QPoint pt;
+    QVERIFY(TestUtil::comparePaintDevices(pt, layer1->paintDevice(), layer1copy->paintDevice()));
+    QVERIFY(TestUtil::comparePaintDevices(pt, layer2->paintDevice(), layer2copy->paintDevice()));
+    QVERIFY(TestUtil::comparePaintDevices(pt,
+                                          mask->selection()->pixelSelection(),
+                                          maskCopy->selection()->pixelSelection()));
+
+    // the live image (e.g. for the clipboard) is written without the cache
+    QBuffer buffer;
+    KoStore *store = KoStore::createStore(&buffer, KoStore::Write, "application/x-krita", KoStore::Zip);
+    QVERIFY(doc->saveNativeFormatCalligra(store)); // deletes the store
+    QCOMPARE(doc->layerDataCache()->dataSize(), qint64(0));
+}
+
+static void fillNoise(KisPaintDeviceSP dev, const QRect &rc, quint32 seed)
+{
+    const int pixelSize = dev->pixelSize();
+    QByteArray buf(rc.width() * rc.height() * pixelSize, 0);
+    quint8 *ptr = reinterpret_cast<quint8*>(buf.data());
+
+    // a gradient with some noise, compresses about as bad as a painting
+    for (int i = 0; i < buf.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        ptr[i] = ((i / pixelSize) % rc.width()) / 16 + ((seed >> 16) & 0x7);
+    }
+
+    dev->writeBytes(ptr, rc);
+}
+
+void KisKraSaverTest::benchmarkSaveAfterSingleLayerEdit()
+{
+    const int numLayers = 8;
+    QRect imageRect(0,0,2048,2048);
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "test image");
+
+    QVector<KisPaintLayerSP> layers;
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("paint%1").arg(i), OPACITY_OPAQUE_U8);
+        fillNoise(layer->paintDevice(), imageRect, i);
+        image->addNode(layer);
+        layers << layer;
+    }
+
+    const QString fileName = QFileInfo("benchmark_single_layer_edit.kra").absoluteFilePath();
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setCurrentImage(image);
+    doc->documentInfo()->setAboutInfo("title", image->objectName());
+    doc->setLocalFilePath(fileName);
+
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(doc->saveNativeFormat(fileName));
+    qDebug() << "Saving" << numLayers << "layers from scratch:" << timer.elapsed() << "ms";
+
+    // a stroke on a single layer
+    layers[numLayers / 2]->paintDevice()->fill(QRect(1000, 1000, 256, 256), KoColor(Qt::blue, cs));
+    doc->setModified(true);
+
+    // the autosave is written in background and reports it with sigSavingFinished()
+    QSignalSpy spy(doc.data(), SIGNAL(sigSavingFinished()));
+
+    QBENCHMARK_ONCE {
+        timer.restart();
+        QVERIFY(QMetaObject::invokeMethod(doc.data(), "slotAutoSave"));
+        qDebug() << "The autosave blocked the GUI thread for" << timer.elapsed() << "ms";
+
+        QVERIFY(spy.wait(60000));
+    }
+
+    QCOMPARE(doc->layerDataCache()->numHits(), numLayers - 1);
+
+    QFile::remove(QFileInfo(fileName).absolutePath() + "/.benchmark_single_layer_edit.kra-autosave.kra");
+    QFile::remove(fileName);
+}
+
 QTEST_MAIN(KisKraSaverTest)
@@ -41,6 +41,11 @@ private Q_SLOTS:
 
     void testRoundTripColorizeMask();
 
+    void testLayerDataCache();
+    void testLayerDataCacheLimit();
+    void testRoundTripUnchangedLayers();
+    void benchmarkSaveAfterSingleLayerEdit();
+
 };
 
 #endif
@@ -0,0 +1,245 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_png_converter_test.h"
+
+#include <QTest>
+#include <QBuffer>
+#include <QImage>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColor.h>
+
+#include "kis_paint_device.h"
+#include "kis_painter.h"
+#include "kis_png_converter.h"
+
+
+namespace {
+
+KisPaintDeviceSP createTestDevice(const KoColorSpace *cs, const QRect &rc)
+{
+    QImage image(rc.size(), QImage::Format_ARGB32);
+
+    for (int y = 0; y < rc.height(); y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < rc.width(); x++) {
+            // a gradient with some noise, so that every band compresses differently
+            line[x] = qRgba(x & 0xff, y & 0xff, (x * y + qrand() % 8) & 0xff, 128 + (x & 0x7f));
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->convertFromQImage(image, 0, rc.x(), rc.y());
+    return dev;
+}
+
+QByteArray saveToPng(KisPaintDeviceSP dev, const QRect &rc, const KisPNGOptions &options)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    vKisAnnotationSP_it annotIt = 0;
+    KisPNGConverter converter(0, true);
+    KisImageBuilder_Result result =
+        converter.buildFile(&buffer, rc, 72.0, 72.0, dev, annotIt, annotIt, options, 0);
+
+    return result == KisImageBuilder_RESULT_OK ? buffer.data() : QByteArray();
+}
+
+QByteArray saveToPng(KisPaintDeviceSP dev, const QRect &rc, bool parallel)
+{
+    KisPNGOptions options;
+    options.compression = 6;
+    options.parallelCompression = parallel;
+    options.interlace = false;
+    options.tryToSaveAsIndexed = false;
+    options.alpha = true;
+
+    return saveToPng(dev, rc, options);
+}
+
+}
+
+void KisPNGConverterTest::testParallelCompression()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(0, 0, 1000, 1100);
+
+    KisPaintDeviceSP dev = createTestDevice(cs, rc);
+    const QByteArray data = saveToPng(dev, rc, true);
+    QVERIFY(!data.isEmpty());
+
+    QImage result;
+    QVERIFY(result.loadFromData(data, "PNG"));
+    QCOMPARE(result.size(), rc.size());
+
+    QImage reference = dev->convertToQImage(0, rc.x(), rc.y(), rc.width(), rc.height());
+    QCOMPARE(result.convertToFormat(QImage::Format_ARGB32),
+             reference.convertToFormat(QImage::Format_ARGB32));
+}
+
+void KisPNGConverterTest::testParallelCompression16bit()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    const QRect rc(0, 0, 700, 800);
+
+    KisPaintDeviceSP dev = createTestDevice(cs, rc);
+
+    const QByteArray sequentialData = saveToPng(dev, rc, false);
+    const QByteArray parallelData = saveToPng(dev, rc, true);
+
+    QVERIFY(!sequentialData.isEmpty());
+    QVERIFY(!parallelData.isEmpty());
+
+    QImage sequentialImage;
+    QImage parallelImage;
+    QVERIFY(sequentialImage.loadFromData(sequentialData, "PNG"));
+    QVERIFY(parallelImage.loadFromData(parallelData, "PNG"));
+
+    QCOMPARE(parallelImage, sequentialImage);
+}
+
+void KisPNGConverterTest::testFlattenInBands()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(10, 20, 300, 333);
+
+    KisPaintDeviceSP dev = createTestDevice(cs, rc);
+
+    KisPNGOptions options;
+    options.compression = 6;
+    options.tryToSaveAsIndexed = false;
+    options.alpha = false;
+    options.transparencyFillColor = Qt::green;
+
+    KisPaintDeviceSP flattened = new KisPaintDevice(cs);
+    flattened->fill(rc, KoColor(options.transparencyFillColor, cs));
+    KisPainter gc(flattened);
+    gc.bitBlt(rc.topLeft(), dev, rc);
+    gc.end();
+
+    const QImage reference =
+        flattened->convertToQImage(0, rc.x(), rc.y(), rc.width(), rc.height())
+        .convertToFormat(QImage::Format_RGB32);
+
+    for (int i = 0; i < 3; i++) {
+        options.interlace = i == 1;
+        options.parallelCompression = i == 2;
+
+        const QByteArray data = saveToPng(dev, rc, options);
+        QVERIFY(!data.isEmpty());
+
+        QImage result;
+        QVERIFY(result.loadFromData(data, "PNG"));
+        QVERIFY(!result.hasAlphaChannel());
+        QCOMPARE(result.convertToFormat(QImage::Format_RGB32), reference);
+    }
+}
+
+void KisPNGConverterTest::testForceSRGBInBands()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    const QRect rc(0, 0, 257, 300);
+
+    KisPaintDeviceSP dev = createTestDevice(cs, rc);
+
+    KisPNGOptions options;
+    options.compression = 6;
+    options.interlace = false;
+    options.tryToSaveAsIndexed = false;
+    options.alpha = true;
+    options.forceSRGB = true;
+
+    // the old way: convert a full-size copy of the device
+    const KoColorSpace *srgb = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Integer16BitsColorDepthID.id(), "sRGB built-in - (lcms internal)");
+    KisPaintDeviceSP converted = new KisPaintDevice(*dev);
+    converted->convertTo(srgb);
+
+    options.forceSRGB = false;
+    const QByteArray referenceData = saveToPng(converted, rc, options);
+
+    options.forceSRGB = true;
+    const QByteArray data = saveToPng(dev, rc, options);
+
+    QImage reference;
+    QImage result;
+    QVERIFY(reference.loadFromData(referenceData, "PNG"));
+    QVERIFY(result.loadFromData(data, "PNG"));
+    QCOMPARE(result, reference);
+}
+
+void KisPNGConverterTest::benchmarkSequentialCompression()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(0, 0, 4000, 3000);
+
+    KisPaintDeviceSP dev = createTestDevice(cs, rc);
+
+    QByteArray data;
+
+    QBENCHMARK_ONCE {
+        data = saveToPng(dev, rc, false);
+    }
+
+    qDebug() << "Sequential compression size:" << data.size();
+}
+
+void KisPNGConverterTest::benchmarkParallelCompression()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(0, 0, 4000, 3000);
+
+    KisPaintDeviceSP dev = createTestDevice(cs, rc);
+
+    QByteArray data;
+
+    QBENCHMARK_ONCE {
+        data = saveToPng(dev, rc, true);
+    }
+
+    qDebug() << "Parallel compression size:" << data.size();
+}
+
+void KisPNGConverterTest::benchmarkTallImage()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(0, 0, 1000, 30000);
+
+    KisPaintDeviceSP dev = createTestDevice(cs, rc);
+
+    KisPNGOptions options;
+    options.compression = 6;
+    options.parallelCompression = true;
+    options.interlace = false;
+    options.tryToSaveAsIndexed = false;
+    options.alpha = false;
+    options.forceSRGB = true;
+
+    QByteArray data;
+
+    QBENCHMARK_ONCE {
+        data = saveToPng(dev, rc, options);
+    }
+
+    QVERIFY(!data.isEmpty());
+}
+
+QTEST_MAIN(KisPNGConverterTest)
@@ -0,0 +1,238 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_shape_layer_test.h"
+
+#include <QTest>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QPainter>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorBackground.h>
+#include <KoShapeBasedDocumentBase.h>
+#include <KoDocumentResourceManager.h>
+#include <KoImageCollection.h>
+#include <KoPatternBackground.h>
+#include <KoPathShape.h>
+#include <KoStore.h>
+#include <KoXmlReader.h>
+#include <SvgParser.h>
+
+#include "kis_image.h"
+#include "kis_paint_device.h"
+#include "flake/kis_shape_layer.h"
+
+
+namespace {
+
+class TestShapeController : public KoShapeBasedDocumentBase
+{
+public:
+    void addShape(KoShape *shape) { Q_UNUSED(shape); }
+    void removeShape(KoShape *shape) { Q_UNUSED(shape); }
+};
+
+KoPathShape* createRectShape(const QRectF &imageRect, KisImageSP image)
+{
+    QTransform matrix;
+    matrix.scale(1 / image->xRes(), 1 / image->yRes());
+    const QRectF rect = matrix.mapRect(imageRect);
+
+    KoPathShape* shape = new KoPathShape();
+    shape->setShapeId(KoPathShapeId);
+    shape->moveTo(rect.topLeft());
+    shape->lineTo(rect.topLeft() + QPointF(rect.width(), 0));
+    shape->lineTo(rect.bottomRight());
+    shape->lineTo(rect.topLeft() + QPointF(0, rect.height()));
+    shape->close();
+    shape->normalize();
+    shape->setBackground(QSharedPointer<KoShapeBackground>(new KoColorBackground(Qt::red)));
+
+    return shape;
+}
+
+/**
+ * The shape layer canvas repaints the changed areas in a slot queued
+ * after the updates of the shapes, then the image merges them
+ */
+void waitForShapeLayerUpdates(KisImageSP image)
+{
+    QCoreApplication::sendPostedEvents();
+    image->waitForDone();
+}
+
+/**
+ * Builds something resembling a big imported SVG document:
+ * thousands of small curved paths spread over the whole image
+ */
+QString createManyPathsSvg(int size, int step, KisImageSP image)
+{
+    const qreal xScale = 1.0 / image->xRes();
+    const qreal yScale = 1.0 / image->yRes();
+
+    QString svg = QString("<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                          "width=\"%1pt\" height=\"%2pt\">\n")
+        .arg(size * xScale).arg(size * yScale);
+
+    const QStringList colors = QStringList() << "#ff0000" << "#00ff00" << "#0000ff";
+    int index = 0;
+
+    for (int y = 0; y < size; y += step) {
+        for (int x = 0; x < size; x += step) {
+            const qreal left = (x + 5) * xScale;
+            const qreal top = (y + 5) * yScale;
+            const qreal w = (step - 10) * xScale;
+            const qreal h = (step - 10) * yScale;
+
+            svg += QString("<path fill=\"%1\" d=\"M %2 %3 L %4 %3 "
+                           "C %5 %6 %5 %7 %4 %8 L %2 %8 Z\"/>\n")
+                .arg(colors[index++ % colors.size()])
+                .arg(left).arg(top)
+                .arg(left + 0.5 * w)
+                .arg(left + w).arg(top + 0.25 * h).arg(top + 0.75 * h)
+                .arg(top + h);
+        }
+    }
+
+    svg += "</svg>\n";
+
+    return svg;
+}
+
+}
+
+void KisShapeLayerTest::testDistantShapesRepaint()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 2000, 2000, cs, "test");
+
+    TestShapeController controller;
+    KisShapeLayerSP layer = new KisShapeLayer(&controller, image, "shape", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    layer->addShape(createRectShape(QRectF(10, 10, 100, 100), image));
+    layer->addShape(createRectShape(QRectF(1800, 1800, 100, 100), image));
+
+    waitForShapeLayerUpdates(image);
+
+    KisPaintDeviceSP projection = layer->original();
+
+    QCOMPARE(projection->exactBounds(), QRect(10, 10, 1890, 1890));
+
+    QColor color;
+    projection->pixel(50, 50, &color);
+    QCOMPARE(color, QColor(Qt::red));
+
+    projection->pixel(1850, 1850, &color);
+    QCOMPARE(color, QColor(Qt::red));
+
+    // the space between the shapes is not touched at all
+    QVERIFY(!projection->region().contains(QPoint(1000, 1000)));
+}
+
+void KisShapeLayerTest::testRoundTripEmbeddedImage()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 200, 200, cs, "test");
+
+    KoImageCollection imageCollection;
+    TestShapeController controller;
+    controller.resourceManager()->setImageCollection(&imageCollection);
+
+    KisShapeLayerSP layer = new KisShapeLayer(&controller, image, "shape", OPACITY_OPAQUE_U8);
+
+    QImage pattern(32, 32, QImage::Format_ARGB32);
+    pattern.fill(QColor(Qt::blue));
+    {
+        QPainter gc(&pattern);
+        gc.fillRect(QRect(0, 0, 16, 16), Qt::red);
+    }
+
+    // the pattern is saved as a separate file of the store
+    QSharedPointer<KoPatternBackground> background(new KoPatternBackground(&imageCollection));
+    background->setPattern(pattern);
+
+    KoPathShape *shape = createRectShape(QRectF(10, 10, 100, 100), image);
+    shape->setBackground(background);
+    layer->addShape(shape);
+
+    QBuffer buffer;
+
+    {
+        QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+        QVERIFY(layer->saveLayer(store.data()));
+        QVERIFY(store->finalize());
+    }
+
+    KisShapeLayerSP loadedLayer = new KisShapeLayer(&controller, image, "loaded", OPACITY_OPAQUE_U8);
+
+    {
+        QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Read, "application/x-krita", KoStore::Zip));
+        QVERIFY(loadedLayer->loadLayer(store.data()));
+        QVERIFY(!store->isOpen());
+    }
+
+    QCOMPARE(loadedLayer->shapes().size(), 1);
+
+    QSharedPointer<KoPatternBackground> loadedBackground =
+        qSharedPointerDynamicCast<KoPatternBackground>(loadedLayer->shapes().first()->background());
+    QVERIFY(loadedBackground);
+    QCOMPARE(loadedBackground->pattern().convertToFormat(QImage::Format_ARGB32), pattern);
+}
+
+void KisShapeLayerTest::benchmarkManyShapes()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 4000, 4000, cs, "test");
+
+    TestShapeController controller;
+    KisShapeLayerSP layer = new KisShapeLayer(&controller, image, "shape", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    KoXmlDocument doc;
+    QVERIFY(doc.setContent(createManyPathsSvg(4000, 50, image)));
+
+    SvgParser parser(controller.resourceManager());
+    const QList<KoShape*> shapes = parser.parseSvg(doc.documentElement());
+    QCOMPARE(shapes.size(), 80 * 80);
+
+    Q_FOREACH (KoShape *shape, shapes) {
+        layer->addShape(shape);
+    }
+
+    waitForShapeLayerUpdates(image);
+
+    int i = 0;
+
+    QBENCHMARK {
+        // move a few shapes lying far from each other
+        for (int j = 0; j < 4; j++) {
+            KoShape *shape = shapes[(i + j * shapes.size() / 4) % shapes.size()];
+            shape->update();
+            shape->setPosition(shape->position() + QPointF(1, 1));
+            shape->update();
+        }
+        i++;
+
+        waitForShapeLayerUpdates(image);
+    }
+}
+
+QTEST_MAIN(KisShapeLayerTest)
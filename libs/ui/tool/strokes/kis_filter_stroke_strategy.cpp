@@ -95,6 +95,7 @@ KisFilterStrokeStrategy::KisFilterStrokeStrategy(const KisFilterStrokeStrategy &
     // only non-started transaction are allowed
     KIS_ASSERT_RECOVER_NOOP(!m_d->secondaryTransaction);
     m_d->levelOfDetail = levelOfDetail;
+    m_d->filterConfig = m_d->filter->lodScaledConfiguration(m_d->filterConfig, levelOfDetail);
 }
 
 KisFilterStrokeStrategy::~KisFilterStrokeStrategy()
@@ -39,7 +39,7 @@ public:
     virtual void unsetCanvas();
 
 public Q_SLOTS:
-    void startUpdateCanvasProjection();
+    void startUpdateCanvasProjection(const QRect &rect);
     void sigColorSpaceChanged(const KoColorSpace* cs);
     void updateHistogram();
 
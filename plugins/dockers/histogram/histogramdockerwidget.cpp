@@ -23,7 +23,9 @@
 #include <algorithm>
 #include <QTime>
 #include <QPainter>
+#include <QtMath>
 #include <functional>
+#include <QtConcurrentMap>
 
 #include "KoChannelInfo.h"
 #include "kis_paint_device.h"
@@ -32,7 +34,9 @@
 #include "kis_canvas2.h"
 
 HistogramDockerWidget::HistogramDockerWidget(QWidget *parent, const char *name, Qt::WindowFlags f)
-    : QLabel(parent, f), m_paintDevice(nullptr), m_smoothHistogram(true)
+    : QLabel(parent, f), m_paintDevice(nullptr), m_smoothHistogram(true),
+      m_computationInProgress(false), m_updatePending(false),
+      m_generation(0)
 {
     setObjectName(name);
 }
@@ -52,16 +56,58 @@ void HistogramDockerWidget::setPaintDevice(KisCanvas2* canvas)
         m_bounds = QRect();
         m_histogramData.clear();
     }
+
+    m_tileCache = HistogramTileCache();
+    m_dirtyRegion = QRegion();
+
+    /**
+     * A computation for the previous device may still be running. It
+     * will be ignored when ready, so a new one can be started right away
+     */
+    m_generation++;
+    m_computationInProgress = false;
+    m_updatePending = false;
+}
+
+void HistogramDockerWidget::addDirtyRect(const QRect &rect)
+{
+    if (rect.isEmpty()) return;
+
+    /**
+     * Align the rect to the cells grid, otherwise the region becomes
+     * too fragmented during a long stroke
+     */
+    const int cellSize = HistogramTileCache::cellSize;
+
+    const int left = qFloor(qreal(rect.left()) / cellSize) * cellSize;
+    const int top = qFloor(qreal(rect.top()) / cellSize) * cellSize;
+    const int right = qFloor(qreal(rect.right()) / cellSize) * cellSize + cellSize - 1;
+    const int bottom = qFloor(qreal(rect.bottom()) / cellSize) * cellSize + cellSize - 1;
+
+    m_dirtyRegion += QRect(QPoint(left, top), QPoint(right, bottom));
 }
 
 void HistogramDockerWidget::updateHistogram()
 {
     if (!m_paintDevice.isNull()) {
+        /**
+         * The previous computation owns the cells cache, so we should
+         * wait for it to complete and only then start a new one
+         */
+        if (m_computationInProgress) {
+            m_updatePending = true;
+            return;
+        }
+
         KisPaintDeviceSP m_devClone = new KisPaintDevice(m_paintDevice->colorSpace());
 
         m_devClone->makeCloneFrom(m_paintDevice, m_bounds);
 
-        HistogramComputationThread *workerThread = new HistogramComputationThread(m_devClone, m_bounds);
+        HistogramComputationThread *workerThread =
+            new HistogramComputationThread(m_devClone, m_bounds, m_tileCache, m_dirtyRegion, m_generation);
+        m_dirtyRegion = QRegion();
+        m_computationInProgress = true;
+
         connect(workerThread, &HistogramComputationThread::resultReady, this, &HistogramDockerWidget::receiveNewHistogram);
         connect(workerThread, &HistogramComputationThread::finished, workerThread, &QObject::deleteLater);
         workerThread->start();
@@ -73,8 +119,25 @@ void HistogramDockerWidget::updateHistogram()
 
 void HistogramDockerWidget::receiveNewHistogram(HistVector *histogramData)
 {
+    HistogramComputationThread *workerThread =
+        qobject_cast<HistogramComputationThread*>(sender());
+
+    if (!workerThread || workerThread->generation() != m_generation) {
+        // the histogram of the previous paint device
+        return;
+    }
+
+    m_tileCache = workerThread->tileCache();
+
+    m_computationInProgress = false;
+
     m_histogramData = *histogramData;
     update();
+
+    if (m_updatePending) {
+        m_updatePending = false;
+        updateHistogram();
+    }
 }
 
 void HistogramDockerWidget::paintEvent(QPaintEvent *event)
@@ -154,11 +217,52 @@ void HistogramDockerWidget::paintEvent(QPaintEvent *event)
     }
 }
 
+namespace {
+
+struct HistogramCellProcessor
+{
+    HistogramCellProcessor(KisPaintDeviceSP _dev, quint32 _nSkip)
+        : dev(_dev),
+          nSkip(_nSkip)
+    {
+    }
+
+    void operator()(HistogramTileCache::Cell &cell) const {
+        const KoColorSpace *cs = dev->colorSpace();
+        const quint32 channelCount = dev->channelCount();
+        const quint32 pixelSize = dev->pixelSize();
+
+        cell.bins.assign(channelCount, std::vector<quint32>(std::numeric_limits<quint8>::max() + 1));
+
+        KisSequentialConstIterator it(dev, cell.rect);
+        int i;
+        quint32 toSkip = nSkip;
+
+        do {
+            i = it.nConseqPixels();
+            const quint8* pixel = it.rawDataConst();
+            for (int k = 0; k < i; ++k) {
+                if (--toSkip == 0) {
+                    for (int chan = 0; chan < (int)channelCount; ++chan) {
+                        cell.bins[chan][cs->scaleToU8(pixel, chan)]++;
+                    }
+                    toSkip = nSkip;
+                }
+                pixel += pixelSize;
+            }
+        } while (it.nextPixels(i));
+    }
+
+    KisPaintDeviceSP dev;
+    quint32 nSkip;
+};
+
+}
+
 void HistogramComputationThread::run()
 {
     const KoColorSpace *cs = m_dev->colorSpace();
     quint32 channelCount = m_dev->channelCount();
-    quint32 pixelSize = m_dev->pixelSize();
 
     quint32 imageSize = m_bounds.width() * m_bounds.height();
     quint32 nSkip = 1 + (imageSize >> 20); //for speed use about 1M pixels for computing histograms
@@ -169,27 +273,89 @@ void HistogramComputationThread::run()
         bin.resize(std::numeric_limits<quint8>::max() + 1);
     }
 
-    QRect bounds = m_dev->exactBounds();
-    if (bounds.isEmpty())
+    if (!m_cache.colorSpace || !(*m_cache.colorSpace == *cs) ||
+        m_cache.bounds != m_bounds || m_cache.nSkip != nSkip) {
+
+        m_cache = HistogramTileCache();
+        m_cache.colorSpace = cs;
+        m_cache.bounds = m_bounds;
+        m_cache.nSkip = nSkip;
+    }
+
+    const QRect bounds = m_dev->exactBounds() & m_bounds;
+
+    if (bounds.isEmpty()) {
+        m_cache.cells.clear();
+        emit resultReady(&bins);
         return;
+    }
 
-    KisSequentialConstIterator it(m_dev, m_dev->exactBounds());
-    int i;
-    quint32 toSkip = nSkip;
-
-    do {
-        i = it.nConseqPixels();
-        const quint8* pixel = it.rawDataConst();
-        for (int k = 0; k < i; ++k) {
-            if (--toSkip == 0) {
-                for (int chan = 0; chan < (int)channelCount; ++chan) {
-                    bins[chan][cs->scaleToU8(pixel, chan)]++;
-                }
-                toSkip = nSkip;
+    /**
+     * A cell should be binned again if it has been touched by the
+     * updates or if the exact bounds of the image have changed in its
+     * area. The cells which are not covered by the bounds anymore are
+     * just dropped.
+     */
+    typedef QPair<int, int> CellIndex;
+    const int cellSize = HistogramTileCache::cellSize;
+
+    QVector<CellIndex> dirtyIndexes;
+    QVector<HistogramTileCache::Cell> dirtyCells;
+
+    auto it = m_cache.cells.begin();
+    while (it != m_cache.cells.end()) {
+        const QRect cellRect =
+            QRect(it.key().first * cellSize, it.key().second * cellSize, cellSize, cellSize) & bounds;
+
+        if (cellRect.isEmpty()) {
+            it = m_cache.cells.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const int firstCol = bounds.left() / cellSize;
+    const int lastCol = bounds.right() / cellSize;
+    const int firstRow = bounds.top() / cellSize;
+    const int lastRow = bounds.bottom() / cellSize;
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            const CellIndex index(col, row);
+            const QRect cellRect =
+                QRect(col * cellSize, row * cellSize, cellSize, cellSize) & bounds;
+
+            auto cellIt = m_cache.cells.constFind(index);
+
+            if (cellIt == m_cache.cells.constEnd() ||
+                cellIt->rect != cellRect ||
+                m_dirtyRegion.intersects(cellRect)) {
+
+                HistogramTileCache::Cell cell;
+                cell.rect = cellRect;
+
+                dirtyIndexes.append(index);
+                dirtyCells.append(cell);
             }
-            pixel += pixelSize;
         }
-    } while (it.nextPixels(i));
+    }
+
+    QtConcurrent::blockingMap(dirtyCells, HistogramCellProcessor(m_dev, nSkip));
+
+    for (int i = 0; i < dirtyIndexes.size(); i++) {
+        m_cache.cells.insert(dirtyIndexes[i], dirtyCells[i]);
+    }
+
+    Q_FOREACH (const HistogramTileCache::Cell &cell, m_cache.cells) {
+        for (int chan = 0; chan < (int)channelCount; ++chan) {
+            const std::vector<quint32> &src = cell.bins[chan];
+            std::vector<quint32> &dst = bins[chan];
+
+            for (size_t bin = 0; bin < dst.size(); ++bin) {
+                dst[bin] += src[bin];
+            }
+        }
+    }
 
     emit resultReady(&bins);
 }
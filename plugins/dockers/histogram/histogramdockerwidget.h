@@ -23,29 +23,74 @@
 #include <QWidget>
 #include <QLabel>
 #include <QThread>
+#include <QHash>
+#include <QPair>
+#include <QRegion>
 #include "kis_types.h"
 #include <vector>
 
 class KisCanvas2;
+class KoColorSpace;
 
 typedef std::vector<std::vector<quint32> > HistVector; //Don't use QVector here - it's too slow for this purpose
 
+/**
+ * Partial histograms of the image split into square cells. The cells
+ * are binned in parallel and reused between the updates, so when the
+ * user paints only the cells touched by the strokes are binned again.
+ */
+struct HistogramTileCache
+{
+    HistogramTileCache() : colorSpace(0), nSkip(0) {}
+
+    struct Cell {
+        QRect rect;
+        HistVector bins;
+    };
+
+    static const int cellSize = 256;
+
+    QHash<QPair<int, int>, Cell> cells;
+    const KoColorSpace *colorSpace;
+    QRect bounds;
+    quint32 nSkip;
+};
+
 
 class HistogramComputationThread : public QThread
 {
     Q_OBJECT
 public:
-    HistogramComputationThread(KisPaintDeviceSP _dev, const QRect& _bounds) : m_dev(_dev), m_bounds(_bounds)
+    HistogramComputationThread(KisPaintDeviceSP _dev, const QRect& _bounds,
+                               const HistogramTileCache &_cache, const QRegion &_dirtyRegion,
+                               int _generation)
+        : m_dev(_dev), m_bounds(_bounds), m_cache(_cache), m_dirtyRegion(_dirtyRegion),
+          m_generation(_generation)
     {}
 
     void run() override;
 
+    const HistogramTileCache& tileCache() const {
+        return m_cache;
+    }
+
+    /**
+     * The generation of the paint device the histogram is computed for,
+     * see HistogramDockerWidget::setPaintDevice()
+     */
+    int generation() const {
+        return m_generation;
+    }
+
 Q_SIGNALS:
     void resultReady(HistVector*);
 
 private:
     KisPaintDeviceSP m_dev;
     QRect m_bounds;
+    HistogramTileCache m_cache;
+    QRegion m_dirtyRegion;
+    int m_generation;
     HistVector bins;
 };
 
@@ -60,6 +105,11 @@ public:
     void setPaintDevice(KisCanvas2* canvas);
     void paintEvent(QPaintEvent *event);
 
+    /**
+     * Marks \p rect as changed, so the next update will bin it again
+     */
+    void addDirtyRect(const QRect &rect);
+
 public Q_SLOTS:
     void updateHistogram();
     void receiveNewHistogram(HistVector*);
@@ -69,6 +119,18 @@ private:
     HistVector m_histogramData;
     QRect m_bounds;
     bool m_smoothHistogram;
+
+    HistogramTileCache m_tileCache;
+    QRegion m_dirtyRegion;
+    bool m_computationInProgress;
+    bool m_updatePending;
+
+    /**
+     * Incremented every time the paint device is changed, so that the
+     * results of the computations started for the previous device
+     * could be dropped
+     */
+    int m_generation;
 };
 
 #endif // HISTOGRAMDOCKERWIDGET_H
@@ -56,6 +56,8 @@ KisOilPaintFilter::KisOilPaintFilter() : KisFilter(id(), KisFilter::categoryArti
     setSupportsPainting(true);
     setSupportsThreading(false);
     setSupportsAdjustmentLayers(true);
+
+    addLodScaledProperty("brushSize");
 }
 
 void KisOilPaintFilter::processImpl(KisPaintDeviceSP device,
@@ -56,6 +56,9 @@ KisPixelizeFilter::KisPixelizeFilter() : KisFilter(id(), KisFilter::categoryArti
     setSupportsPainting(true);
     setSupportsThreading(false);
     setSupportsAdjustmentLayers(false);
+
+    addLodScaledProperty("pixelWidth");
+    addLodScaledProperty("pixelHeight");
 }
 
 void KisPixelizeFilter::processImpl(KisPaintDeviceSP device,
@@ -51,6 +51,7 @@ KisRoundCornersFilter::KisRoundCornersFilter() : KisFilter(id(), KisFilter::cate
 {
     setSupportsPainting(false);
 
+    addLodScaledProperty("radius");
 }
 
 void KisRoundCornersFilter::processImpl(KisPaintDeviceSP device,
@@ -25,6 +25,7 @@
 #include "filter/kis_filter.h"
 #include "kis_pixel_selection.h"
 #include "kis_transaction.h"
+#include "kis_default_bounds_base.h"
 #include <KoColorSpaceRegistry.h>
 
 bool compareQImages(QPoint & pt, const QImage & image1, const QImage & image2)
@@ -233,6 +234,93 @@ bool testFilterWithSelections(KisFilterSP f)
     return true;
 }
 
+struct TestingLodDefaultBounds : public KisDefaultBoundsBase {
+    TestingLodDefaultBounds(int lod, const QRect &bounds)
+        : m_lod(lod), m_bounds(bounds) {}
+
+    QRect bounds() const override {
+        return m_bounds;
+    }
+    bool wrapAroundMode() const override {
+        return false;
+    }
+    int currentLevelOfDetail() const override {
+        return m_lod;
+    }
+    int currentTime() const override {
+        return 0;
+    }
+    bool externalFrameActive() const override {
+        return false;
+    }
+
+private:
+    int m_lod;
+    QRect m_bounds;
+};
+
+/**
+ * Applies the filter to a LoD1 plane and compares the result with the
+ * downscaled result of the LoD0 filtering. The images cannot be equal,
+ * so we check the average difference of the channels only.
+ */
+bool testFilterLevelOfDetail(KisFilterSP f)
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    const int lod = 1;
+    const int maxAverageDifference = 10;
+
+    QImage qimage(QString(FILES_DATA_DIR) + QDir::separator() + "carrot.png");
+
+    // both dimensions should be even to be able to compare the results
+    const QRect rect(0, 0, qimage.width() & ~1, qimage.height() & ~1);
+    const QRect lodRect(0, 0, rect.width() >> lod, rect.height() >> lod);
+
+    QImage lodImage = qimage.copy(rect).scaled(lodRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->setDefaultBounds(new TestingLodDefaultBounds(0, rect));
+    dev->convertFromQImage(qimage, 0, 0, 0);
+
+    KisPaintDeviceSP lodDev = new KisPaintDevice(cs);
+    lodDev->setDefaultBounds(new TestingLodDefaultBounds(lod, lodRect));
+    lodDev->convertFromQImage(lodImage, 0, 0, 0);
+
+    KisFilterConfigurationSP kfc = f->defaultConfiguration(dev);
+
+    f->process(dev, rect, kfc);
+    f->process(lodDev, lodRect, kfc);
+
+    QImage reference = dev->convertToQImage(0, rect.x(), rect.y(), rect.width(), rect.height());
+    reference = reference.scaled(lodRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    QImage result = lodDev->convertToQImage(0, lodRect.x(), lodRect.y(), lodRect.width(), lodRect.height());
+
+    qint64 difference = 0;
+    for (int y = 0; y < lodRect.height(); ++y) {
+        for (int x = 0; x < lodRect.width(); ++x) {
+            const QRgb ref = reference.pixel(x, y);
+            const QRgb res = result.pixel(x, y);
+
+            difference += qAbs(qRed(ref) - qRed(res)) +
+                qAbs(qGreen(ref) - qGreen(res)) +
+                qAbs(qBlue(ref) - qBlue(res)) +
+                qAbs(qAlpha(ref) - qAlpha(res));
+        }
+    }
+
+    const int numChannels = 4 * lodRect.width() * lodRect.height();
+    const qreal averageDifference = qreal(difference) / numChannels;
+
+    if (averageDifference > maxAverageDifference) {
+        dbgKrita << f->id() << ppVar(averageDifference);
+        result.save(QString("lod_carrot_%1.png").arg(f->id()));
+        reference.save(QString("lod_reference_carrot_%1.png").arg(f->id()));
+        return false;
+    }
+
+    return true;
+}
+
 void KisAllFilterTest::testAllFilters()
 {
     QStringList failures;
@@ -312,5 +400,38 @@ void KisAllFilterTest::testAllFiltersWithSelections()
 }
 
 
+void KisAllFilterTest::testAllFiltersLevelOfDetail()
+{
+    QStringList failures;
+    QStringList successes;
+
+    /**
+     * These filters support LoD, but their result depends on the
+     * scale of the image by design: random pick generates per-pixel
+     * noise and phong bumpmap uses the gradient of the height map.
+     */
+    QStringList scaleDependentFilters;
+    scaleDependentFilters << "randompick" << "phongbumpmap";
+
+    QList<QString> filterList = KisFilterRegistry::instance()->keys();
+    qSort(filterList);
+    for (QList<QString>::Iterator it = filterList.begin(); it != filterList.end(); ++it) {
+        KisFilterSP filter = KisFilterRegistry::instance()->value(*it);
+        if (scaleDependentFilters.contains(*it) ||
+            !filter->supportsLevelOfDetail(KisFilterConfigurationSP(), 1)) {
+
+            continue;
+        }
+
+        if (testFilterLevelOfDetail(filter))
+            successes << *it;
+        else
+            failures << *it;
+    }
+    dbgKrita << "LoD Success: " << successes;
+    if (failures.size() > 0) {
+        QFAIL(QString("LoD Failed filters:\n\t %1").arg(failures.join("\n\t")).toLatin1());
+    }
+}
 
 QTEST_MAIN(KisAllFilterTest)
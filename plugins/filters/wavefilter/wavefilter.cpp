@@ -100,6 +100,12 @@ KisFilterWave::KisFilterWave() : KisFilter(id(), categoryOther(), i18n("&Wave...
     setSupportsPainting(false);
     setSupportsAdjustmentLayers(false);
 
+    addLodScaledProperty("horizontalwavelength");
+    addLodScaledProperty("horizontalshift");
+    addLodScaledProperty("horizontalamplitude");
+    addLodScaledProperty("verticalwavelength");
+    addLodScaledProperty("verticalshift");
+    addLodScaledProperty("verticalamplitude");
 }
 
 KisFilterConfigurationSP KisFilterWave::factoryConfiguration(const KisPaintDeviceSP) const
@@ -26,6 +26,7 @@
 #include <ImfChannelList.h>
 #include <ImfInputFile.h>
 #include <ImfOutputFile.h>
+#include <ImfThreading.h>
 
 #include <ImfStringAttribute.h>
 #include "exr_extra_tags.h"
@@ -34,6 +35,7 @@
 #include <QMessageBox>
 
 #include <QFileInfo>
+#include <QThread>
 
 #include <KoColorSpaceRegistry.h>
 #include <KoCompositeOpRegistry.h>
@@ -60,6 +62,24 @@
 // Do not translate!
 #define HDR_LAYER "HDR Layer"
 
+/**
+ * The number of scanlines read or written at once. It is a multiple
+ * of the line buffer height of all the EXR compression methods, so
+ * every block is decompressed only once, and equals to the height of
+ * a tile of a paint device.
+ */
+static const int blockHeight = 64;
+
+/**
+ * Lets OpenEXR (de)compress the line buffers of a block in parallel
+ */
+static void initExrThreading()
+{
+    static const bool initialized =
+        (Imf::setGlobalThreadCount(QThread::idealThreadCount()), true);
+    Q_UNUSED(initialized);
+}
+
 template<typename _T_>
 struct Rgba {
     _T_ r;
@@ -366,12 +386,17 @@ template<typename _T_>
 void exrConverter::Private::decodeData4(Imf::InputFile& file, ExrPaintLayerInfo& info, KisPaintLayerSP layer, int width, int xstart, int ystart, int height, Imf::PixelType ptype)
 {
     typedef Rgba<_T_> Rgba;
+    typedef typename KoRgbTraits<_T_>::Pixel pixel_type;
+
+    Q_STATIC_ASSERT(sizeof(Rgba) == sizeof(pixel_type));
 
-    QVector<Rgba> pixels(width);
+    QVector<Rgba> pixels(width * blockHeight);
 
     bool hasAlpha = info.channelMap.contains("A");
 
-    for (int y = 0; y < height; ++y) {
+    for (int y = 0; y < height; y += blockHeight) {
+        const int numRows = qMin(blockHeight, height - y);
+
         Imf::FrameBuffer frameBuffer;
         Rgba* frameBufferData = (pixels.data()) - xstart - (ystart + y) * width;
         frameBuffer.insert(info.channelMap["R"].toLatin1().constData(),
@@ -394,29 +419,22 @@ void exrConverter::Private::decodeData4(Imf::InputFile& file, ExrPaintLayerInfo&
         }
 
         file.setFrameBuffer(frameBuffer);
-        file.readPixels(ystart + y);
+        file.readPixels(ystart + y, ystart + y + numRows - 1);
+
         Rgba *rgba = pixels.data();
-        KisHLineIteratorSP it = layer->paintDevice()->createHLineIteratorNG(0, y, width);
-        do {
+        Rgba *end = rgba + width * numRows;
 
+        for (; rgba < end; ++rgba) {
             if (hasAlpha) {
                 unmultiplyAlpha<RgbPixelWrapper<_T_> >(rgba);
-            }
-
-            typename KoRgbTraits<_T_>::Pixel* dst = reinterpret_cast<typename KoRgbTraits<_T_>::Pixel*>(it->rawData());
-
-            dst->red = rgba->r;
-            dst->green = rgba->g;
-            dst->blue = rgba->b;
-            if (hasAlpha) {
-                dst->alpha = rgba->a;
             } else {
-                dst->alpha = 1.0;
+                rgba->a = 1.0;
             }
+        }
 
-
-            ++rgba;
-        } while (it->nextPixel());
+        // the layout of Rgba is the same as the one of the layer pixels
+        layer->paintDevice()->writeBytes(reinterpret_cast<const quint8*>(pixels.constData()),
+                                         QRect(0, y, width, numRows));
     }
 
 }
@@ -430,7 +448,7 @@ void exrConverter::Private::decodeData1(Imf::InputFile& file, ExrPaintLayerInfo&
     KIS_ASSERT_RECOVER_RETURN(
                 layer->paintDevice()->colorSpace()->colorModelId() == GrayAColorModelID);
 
-    QVector<pixel_type> pixels(width);
+    QVector<pixel_type> pixels(width * blockHeight);
 
     Q_ASSERT(info.channelMap.contains("G"));
     dbgFile << "G -> " << info.channelMap["G"];
@@ -439,7 +457,9 @@ void exrConverter::Private::decodeData1(Imf::InputFile& file, ExrPaintLayerInfo&
     dbgFile << "Has Alpha:" << hasAlpha;
 
 
-    for (int y = 0; y < height; ++y) {
+    for (int y = 0; y < height; y += blockHeight) {
+        const int numRows = qMin(blockHeight, height - y);
+
         Imf::FrameBuffer frameBuffer;
         pixel_type* frameBufferData = (pixels.data()) - xstart - (ystart + y) * width;
         frameBuffer.insert(info.channelMap["G"].toLatin1().constData(),
@@ -455,23 +475,21 @@ void exrConverter::Private::decodeData1(Imf::InputFile& file, ExrPaintLayerInfo&
         }
 
         file.setFrameBuffer(frameBuffer);
-        file.readPixels(ystart + y);
+        file.readPixels(ystart + y, ystart + y + numRows - 1);
 
         pixel_type *srcPtr = pixels.data();
-        KisHLineIteratorSP it = layer->paintDevice()->createHLineIteratorNG(0, y, width);
-        do {
+        pixel_type *end = srcPtr + width * numRows;
 
+        for (; srcPtr < end; ++srcPtr) {
             if (hasAlpha) {
                 unmultiplyAlpha<GrayPixelWrapper<_T_> >(srcPtr);
+            } else {
+                srcPtr->alpha = channel_type(1.0);
             }
+        }
 
-            pixel_type* dstPtr = reinterpret_cast<pixel_type*>(it->rawData());
-
-            dstPtr->gray = srcPtr->gray;
-            dstPtr->alpha = hasAlpha ? srcPtr->alpha : channel_type(1.0);
-
-            ++srcPtr;
-        } while (it->nextPixel());
+        layer->paintDevice()->writeBytes(reinterpret_cast<const quint8*>(pixels.constData()),
+                                         QRect(0, y, width, numRows));
     }
 
 }
@@ -560,6 +578,7 @@ bool exrConverter::Private::checkExtraLayersInfoConsistent(const QDomDocument &d
 
 KisImageBuilder_Result exrConverter::decode(const QString &filename)
 {
+    initExrThreading();
     Imf::InputFile file(QFile::encodeName(filename));
 
     Imath::Box2i dw = file.header().dataWindow();
@@ -887,7 +906,7 @@ class Encoder
 public:
     virtual ~Encoder() {}
     virtual void prepareFrameBuffer(Imf::FrameBuffer*, int line) = 0;
-    virtual void encodeData(int line) = 0;
+    virtual void encodeData(int line, int numRows) = 0;
 
 };
 
@@ -895,10 +914,10 @@ template<typename _T_, int size, int alphaPos>
 class EncoderImpl : public Encoder
 {
 public:
-    EncoderImpl(Imf::OutputFile* _file, const ExrPaintLayerSaveInfo* _info, int width) : file(_file), info(_info), pixels(width), m_width(width) {}
+    EncoderImpl(Imf::OutputFile* _file, const ExrPaintLayerSaveInfo* _info, int width) : file(_file), info(_info), pixels(width * blockHeight), m_width(width) {}
     ~EncoderImpl() override {}
     void prepareFrameBuffer(Imf::FrameBuffer*, int line) override;
-    void encodeData(int line) override;
+    void encodeData(int line, int numRows) override;
 private:
     typedef ExrPixel_<_T_, size> ExrPixel;
     Imf::OutputFile* file;
@@ -922,23 +941,20 @@ void EncoderImpl<_T_, size, alphaPos>::prepareFrameBuffer(Imf::FrameBuffer* fram
 }
 
 template<typename _T_, int size, int alphaPos>
-void EncoderImpl<_T_, size, alphaPos>::encodeData(int line)
+void EncoderImpl<_T_, size, alphaPos>::encodeData(int line, int numRows)
 {
-    ExrPixel *rgba = pixels.data();
-    KisHLineIteratorSP it = info->layer->paintDevice()->createHLineIteratorNG(0, line, m_width);
-    do {
-        const _T_* dst = reinterpret_cast < const _T_* >(it->oldRawData());
+    // the layout of ExrPixel is the same as the one of the layer pixels
+    info->layer->paintDevice()->readBytes(reinterpret_cast<quint8*>(pixels.data()),
+                                          QRect(0, line, m_width, numRows));
 
-        for (int i = 0; i < size; ++i) {
-            rgba->data[i] = dst[i];
-        }
+    if (alphaPos != -1) {
+        ExrPixel *rgba = pixels.data();
+        ExrPixel *end = rgba + m_width * numRows;
 
-        if (alphaPos != -1) {
+        for (; rgba < end; ++rgba) {
             multiplyAlpha<_T_, ExrPixel, size, alphaPos>(rgba);
         }
-
-        ++rgba;
-    } while (it->nextPixel());
+    }
 }
 
 Encoder* encoder(Imf::OutputFile& file, const ExrPaintLayerSaveInfo& info, int width)
@@ -988,16 +1004,22 @@ void encodeData(Imf::OutputFile& file, const QList<ExrPaintLayerSaveInfo>& infor
         encoders.push_back(encoder(file, info, width));
     }
 
-    for (int y = 0; y < height; ++y) {
+    /**
+     * Passing many lines to writePixels() at once lets OpenEXR
+     * compress the line buffers in its own thread pool
+     */
+    for (int y = 0; y < height; y += blockHeight) {
+        const int numRows = qMin(blockHeight, height - y);
+
         Imf::FrameBuffer frameBuffer;
         Q_FOREACH (Encoder* encoder, encoders) {
             encoder->prepareFrameBuffer(&frameBuffer, y);
         }
         file.setFrameBuffer(frameBuffer);
         Q_FOREACH (Encoder* encoder, encoders) {
-            encoder->encodeData(y);
+            encoder->encodeData(y, numRows);
         }
-        file.writePixels(1);
+        file.writePixels(numRows);
     }
     qDeleteAll(encoders);
 }
@@ -1045,6 +1067,7 @@ KisImageBuilder_Result exrConverter::buildFile(const QString &filename, KisPaint
     info.pixelType = pixelType;
 
     // Open file for writing
+    initExrThreading();
     Imf::OutputFile file(QFile::encodeName(filename), header);
 
     QList<ExrPaintLayerSaveInfo> informationObjects;
@@ -1291,6 +1314,7 @@ KisImageBuilder_Result exrConverter::buildFile(const QString &filename, KisGroup
     }
 
     // Open file for writing
+    initExrThreading();
     Imf::OutputFile file(QFile::encodeName(filename), header);
 
     encodeData(file, informationObjects, width, height);
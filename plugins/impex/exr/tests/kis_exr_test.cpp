@@ -26,6 +26,12 @@
 #include <QTest>
 #include <half.h>
 #include <KisMimeDatabase.h>
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
 #include "filestest.h"
 
 #ifndef FILES_DATA_DIR
@@ -92,6 +98,108 @@ void KisExrTest::testRoundTrip()
 
 }
 
+static const int benchmarkNumLayers = 32;
+
+/**
+ * Creates a 4K document with many float16 layers, each having a few
+ * areas of different colors
+ */
+KisDocument* createMultiLayerDocument()
+{
+    const QRect imageRect(0, 0, 3840, 2160);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), "");
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "benchmark");
+
+    for (int i = 0; i < benchmarkNumLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer%1").arg(i), OPACITY_OPAQUE_U8, cs);
+
+        for (int j = 0; j < 8; j++) {
+            const QRect rc(j * imageRect.width() / 8, 0, imageRect.width() / 8, imageRect.height());
+            layer->paintDevice()->fill(rc, KoColor(QColor(i * 8, j * 32, 255 - i * 8, 128 + j * 16), cs));
+        }
+
+        image->addNode(layer, image->rootLayer());
+    }
+
+    doc->setCurrentImage(image);
+
+    return doc;
+}
+
+void KisExrTest::benchmarkMultiLayerExport()
+{
+    KisDocument *doc = createMultiLayerDocument();
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".exr"));
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    QString savedFileName(savedFile.fileName());
+    QByteArray mimeType(KisMimeDatabase::mimeTypeForFile(savedFileName).toLatin1());
+
+    KisImportExportFilter::ConversionStatus status;
+
+    {
+        KisImportExportManager manager(doc);
+        manager.setBatchMode(true);
+
+        QBENCHMARK_ONCE {
+            status = manager.exportDocument(savedFileName, mimeType);
+        }
+
+        QCOMPARE(status, KisImportExportFilter::OK);
+    }
+
+    savedFile.close();
+
+    delete doc;
+}
+
+void KisExrTest::benchmarkMultiLayerImport()
+{
+    KisDocument *doc1 = createMultiLayerDocument();
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".exr"));
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    QString savedFileName(savedFile.fileName());
+    QByteArray mimeType(KisMimeDatabase::mimeTypeForFile(savedFileName).toLatin1());
+
+    KisImportExportFilter::ConversionStatus status;
+
+    {
+        KisImportExportManager manager(doc1);
+        manager.setBatchMode(true);
+
+        status = manager.exportDocument(savedFileName, mimeType);
+        QCOMPARE(status, KisImportExportFilter::OK);
+    }
+
+    KisDocument *doc2 = KisPart::instance()->createDocument();
+
+    {
+        KisImportExportManager manager(doc2);
+        manager.setBatchMode(true);
+
+        QBENCHMARK_ONCE {
+            manager.importDocument(savedFileName, QString(), status);
+        }
+
+        QCOMPARE(status, KisImportExportFilter::OK);
+        QVERIFY(doc2->image());
+        QCOMPARE(doc2->image()->root()->childCount(), quint32(benchmarkNumLayers));
+    }
+
+    savedFile.close();
+
+    delete doc2;
+    delete doc1;
+}
+
 QTEST_MAIN(KisExrTest)
 
 
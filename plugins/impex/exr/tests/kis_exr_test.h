@@ -27,6 +27,8 @@ class KisExrTest : public QObject
 private Q_SLOTS:
     void testFiles();
     void testRoundTrip();
+    void benchmarkMultiLayerExport();
+    void benchmarkMultiLayerImport();
 };
 
 #endif
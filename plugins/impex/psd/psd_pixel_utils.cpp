@@ -21,6 +21,7 @@
 #include <QtGlobal>
 #include <QMap>
 #include <QIODevice>
+#include <QThread>
 
 
 #include <KoColorSpace.h>
@@ -29,6 +30,9 @@
 #include <KoCmykColorSpaceTraits.h>
 
 #include <QtEndian>
+#include <QtConcurrent>
+
+#include <KoColor.h>
 
 #include "kis_global.h"
 #include <asl/kis_asl_writer_utils.h>
@@ -45,220 +49,6 @@
 
 namespace PsdPixelUtils {
 
-template <class Traits>
-typename Traits::channels_type convertByteOrder(typename Traits::channels_type value);
-// default implementation is undefined for every color space should be added manually
-
-template <>
-inline quint8 convertByteOrder<KoGrayU8Traits>(quint8 value) {
-    return value;
-}
-
-template <>
-inline quint16 convertByteOrder<KoGrayU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
-}
-
-template <>
-inline quint32 convertByteOrder<KoGrayU32Traits>(quint32 value) {
-    return qFromBigEndian((quint32)value);
-}
-
-template <>
-inline quint8 convertByteOrder<KoBgrU8Traits>(quint8 value) {
-    return value;
-}
-
-template <>
-inline quint16 convertByteOrder<KoBgrU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
-}
-
-template <>
-inline quint32 convertByteOrder<KoBgrU32Traits>(quint32 value) {
-    return qFromBigEndian((quint32)value);
-}
-
-template <>
-inline quint8 convertByteOrder<KoCmykU8Traits>(quint8 value) {
-    return value;
-}
-
-template <>
-inline quint16 convertByteOrder<KoCmykU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
-}
-
-template <>
-inline float convertByteOrder<KoCmykF32Traits>(float value) {
-    return qFromBigEndian((quint32)value);
-}
-
-template <>
-inline quint8 convertByteOrder<KoLabU8Traits>(quint8 value) {
-    return value;
-}
-
-template <>
-inline quint16 convertByteOrder<KoLabU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
-}
-
-template <>
-inline float convertByteOrder<KoLabF32Traits>(float value) {
-    return qFromBigEndian((quint32)value);
-}
-
-template <class Traits>
-void readGrayPixel(const QMap<quint16, QByteArray> &channelBytes,
-                  int col, quint8 *dstPtr)
-{
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
-
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    channels_type opacity = unitValue;
-    if (channelBytes.contains(-1)) {
-        opacity = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[-1].constData())[col]);
-    }
-
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
-
-    channels_type gray = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[0].constData())[col]);
-
-    pixelPtr->gray = gray;
-    pixelPtr->alpha = opacity;
-}
-
-template <class Traits>
-void readRgbPixel(const QMap<quint16, QByteArray> &channelBytes,
-                  int col, quint8 *dstPtr)
-{
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
-
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    channels_type opacity = unitValue;
-    if (channelBytes.contains(-1)) {
-        opacity = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[-1].constData())[col]);
-    }
-
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
-
-    channels_type blue = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[2].constData())[col]);
-    channels_type green = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[1].constData())[col]);
-    channels_type red = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[0].constData())[col]);
-
-    pixelPtr->blue = blue;
-    pixelPtr->green = green;
-    pixelPtr->red = red;
-    pixelPtr->alpha = opacity;
-}
-
-template <class Traits>
-void readCmykPixel(const QMap<quint16, QByteArray> &channelBytes,
-                       int col, quint8 *dstPtr)
-{
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
-
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    channels_type opacity = unitValue;
-    if (channelBytes.contains(-1)) {
-        opacity = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[-1].constData())[col]);
-    }
-
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
-
-    channels_type cyan = unitValue - convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[0].constData())[col]);
-    channels_type magenta = unitValue - convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[1].constData())[col]);
-    channels_type yellow = unitValue - convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[2].constData())[col]);
-    channels_type black = unitValue - convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[3].constData())[col]);
-
-    pixelPtr->cyan = cyan;
-    pixelPtr->magenta = magenta;
-    pixelPtr->yellow = yellow;
-    pixelPtr->black = black;
-    pixelPtr->alpha = opacity;
-}
-
-template <class Traits>
-void readLabPixel(const QMap<quint16, QByteArray> &channelBytes,
-                  int col, quint8 *dstPtr)
-{
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
-
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    channels_type opacity = unitValue;
-    if (channelBytes.contains(-1)) {
-        opacity = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[-1].constData())[col]);
-    }
-
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
-
-    channels_type L = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[0].constData())[col]);
-    channels_type a = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[1].constData())[col]);
-    channels_type b = convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(channelBytes[2].constData())[col]);
-
-    pixelPtr->L = L;
-    pixelPtr->a = a;
-    pixelPtr->b = b;
-    pixelPtr->alpha = opacity;
-}
-
-void readRgbPixelCommon(int channelSize,
-                               const QMap<quint16, QByteArray> &channelBytes,
-                               int col, quint8 *dstPtr)
-{
-    if (channelSize == 1) {
-        readRgbPixel<KoBgrU8Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 2) {
-        readRgbPixel<KoBgrU16Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 4) {
-        readRgbPixel<KoBgrU16Traits>(channelBytes, col, dstPtr);
-    }
-}
-
-void readGrayPixelCommon(int channelSize,
-                                const QMap<quint16, QByteArray> &channelBytes,
-                                int col, quint8 *dstPtr)
-{
-    if (channelSize == 1) {
-        readGrayPixel<KoGrayU8Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 2) {
-        readGrayPixel<KoGrayU16Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 4) {
-        readGrayPixel<KoGrayU32Traits>(channelBytes, col, dstPtr);
-    }
-}
-
-void readCmykPixelCommon(int channelSize,
-                                const QMap<quint16, QByteArray> &channelBytes,
-                                int col, quint8 *dstPtr)
-{
-    if (channelSize == 1) {
-        readCmykPixel<KoCmykU8Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 2) {
-        readCmykPixel<KoCmykU16Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 4) {
-        readCmykPixel<KoCmykF32Traits>(channelBytes, col, dstPtr);
-    }
-}
-
-void readLabPixelCommon(int channelSize,
-                                const QMap<quint16, QByteArray> &channelBytes,
-                                int col, quint8 *dstPtr)
-{
-    if (channelSize == 1) {
-        readLabPixel<KoLabU8Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 2) {
-        readLabPixel<KoLabU16Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 4) {
-        readLabPixel<KoLabF32Traits>(channelBytes, col, dstPtr);
-    }
-}
-
 /**********************************************************************/
 /* Two functions copied from the abandoned PSDParse library (GPL)     */
 /* See: http://www.telegraphics.com.au/svn/psdparse/trunk/psd_zip.c   */
@@ -352,48 +142,133 @@ psd_status psd_unzip_with_prediction(psd_uchar *src_buf, psd_int src_len,
 /* End of third party block                                           */
 /**********************************************************************/
 
-QMap<quint16, QByteArray> fetchChannelsBytes(QIODevice *io, QVector<ChannelInfo*> channelInfoRecords,
-                                            int row, int width, int channelSize)
+/**
+ * The number of rows of a channel decompressed by a single job. RLE
+ * rows are compressed independently, so the channels of big layers
+ * are split into bands decompressed in parallel.
+ */
+const int rowsPerBand = 64;
+
+/**
+ * Converts the values of a channel plane from big endian. CMYK color
+ * channels are also inverted.
+ */
+void convertPlaneFromPsd(quint8 *plane, int numValues, int channelSize, bool invert)
 {
-    const int uncompressedLength = width * channelSize;
+    if (channelSize == 1) {
+        if (invert) {
+            for (int i = 0; i < numValues; i++) {
+                plane[i] = quint8_MAX - plane[i];
+            }
+        }
+    } else if (channelSize == 2) {
+        quint16 *ptr = reinterpret_cast<quint16*>(plane);
+        for (int i = 0; i < numValues; i++) {
+            const quint16 value = qFromBigEndian(ptr[i]);
+            ptr[i] = invert ? quint16_MAX - value : value;
+        }
+    } else if (channelSize == 4) {
+        quint32 *ptr = reinterpret_cast<quint32*>(plane);
+        for (int i = 0; i < numValues; i++) {
+            ptr[i] = qFromBigEndian(ptr[i]);
+        }
 
-    QMap<quint16, QByteArray> channelBytes;
+        if (invert) {
+            // 32-bit CMYK is stored as floats
+            float *floatPtr = reinterpret_cast<float*>(plane);
+            for (int i = 0; i < numValues; i++) {
+                floatPtr[i] = KoColorSpaceMathsTraits<float>::unitValue - floatPtr[i];
+            }
+        }
+    }
+}
 
-    Q_FOREACH (ChannelInfo *channelInfo, channelInfoRecords) {
-        // user supplied masks are ignored here
-        if (channelInfo->channelId < -1) continue;
+/**
+ * A band of rows of a single channel, which is decompressed and
+ * converted in a separate thread
+ */
+struct ChannelBand
+{
+    ChannelInfo *info;
+    int firstRow;
+    int numRows;
 
-        io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
+    QByteArray compressedBytes;
+    quint8 *dst;
+    bool invert;
 
-        if (channelInfo->compressionType == Compression::Uncompressed) {
-            channelBytes[channelInfo->channelId] = io->read(uncompressedLength);
-            channelInfo->channelOffset += uncompressedLength;
-        }
-        else if (channelInfo->compressionType == Compression::RLE) {
-            int rleLength = channelInfo->rleRowLengths[row];
-            QByteArray compressedBytes = io->read(rleLength);
-            QByteArray uncompressedBytes = Compression::uncompress(uncompressedLength, compressedBytes, channelInfo->compressionType);
-            channelBytes.insert(channelInfo->channelId, uncompressedBytes);
-            channelInfo->channelOffset += rleLength;
-        }
-        else {
-            QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
-            dbgFile << "ERROR: fetchChannelsBytes:" << error;
-            throw KisAslReaderUtils::ASLParseException(error);
-        }
+    QString error;
+};
+
+struct DecodeChannelBandJob
+{
+    DecodeChannelBandJob(int _width, int _channelSize)
+        : width(_width), channelSize(_channelSize)
+    {
     }
 
-    return channelBytes;
-}
+    void operator() (ChannelBand &band) const {
+        const int rowSize = width * channelSize;
+        quint8 *dstPtr = band.dst;
 
-typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
+        if (band.info->compressionType == Compression::RLE) {
+            int offset = 0;
+
+            for (int row = band.firstRow; row < band.firstRow + band.numRows; row++) {
+                const int rleLength = band.info->rleRowLengths[row];
+
+                QByteArray compressedRow =
+                    QByteArray::fromRawData(band.compressedBytes.constData() + offset, rleLength);
+                QByteArray uncompressedRow =
+                    Compression::uncompress(rowSize, compressedRow, Compression::RLE);
+
+                if (uncompressedRow.size() != rowSize) {
+                    band.error = QString("Failed to decode RLE data: channel id = %1, row = %2")
+                        .arg(band.info->channelId).arg(row);
+                    return;
+                }
+
+                memcpy(dstPtr + (row - band.firstRow) * rowSize, uncompressedRow.constData(), rowSize);
+                offset += rleLength;
+            }
+
+        } else if (band.info->compressionType == Compression::ZIP ||
+                   band.info->compressionType == Compression::ZIPWithPrediction) {
+
+            const int numBytes = band.numRows * rowSize;
+            bool status = false;
+
+            if (band.info->compressionType == Compression::ZIP) {
+                status = psd_unzip_without_prediction((quint8*)band.compressedBytes.data(), band.compressedBytes.size(),
+                                                      dstPtr, numBytes);
+            } else {
+                status = psd_unzip_with_prediction((quint8*)band.compressedBytes.data(), band.compressedBytes.size(),
+                                                   dstPtr, numBytes,
+                                                   width, channelSize * 8);
+            }
+
+            if (!status) {
+                band.error = QString("Failed to unzip channel data: id = %1, compression = %2")
+                    .arg(band.info->channelId).arg(band.info->compressionType);
+                return;
+            }
+        }
+
+        band.compressedBytes.clear();
+
+        convertPlaneFromPsd(dstPtr, band.numRows * width, channelSize, band.invert);
+    }
+
+    int width;
+    int channelSize;
+};
 
 void readCommon(KisPaintDeviceSP dev,
                 QIODevice *io,
                 const QRect &layerRect,
                 QVector<ChannelInfo*> infoRecords,
                 int channelSize,
-                PixelFunc pixelFunc)
+                psd_color_mode colorMode)
 {
     KisOffsetKeeper keeper(io);
 
@@ -402,62 +277,181 @@ void readCommon(KisPaintDeviceSP dev,
         return;
     }
 
-    if (infoRecords.first()->compressionType == Compression::ZIP ||
-        infoRecords.first()->compressionType == Compression::ZIPWithPrediction) {
+    const int width = layerRect.width();
+    const int height = layerRect.height();
+    const int rowSize = width * channelSize;
 
-        const int numPixels = channelSize * layerRect.width() * layerRect.height();
+    QVector<ChannelInfo*> channels;
+    bool hasZippedChannels = false;
 
-        QMap<quint16, QByteArray> channelBytes;
+    Q_FOREACH (ChannelInfo *info, infoRecords) {
+        // user supplied masks are ignored here
+        if (info->channelId < -1) continue;
 
-        Q_FOREACH (ChannelInfo *info, infoRecords) {
-            io->seek(info->channelDataStart);
-            QByteArray compressedBytes = io->read(info->channelDataLength);
-            QByteArray uncompressedBytes(numPixels, 0);
+        if (info->compressionType == Compression::ZIP ||
+            info->compressionType == Compression::ZIPWithPrediction) {
 
-            bool status = false;
-            if (infoRecords.first()->compressionType == Compression::ZIP) {
-                status = psd_unzip_without_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                      (quint8*)uncompressedBytes.data(), uncompressedBytes.size());
-            } else {
-                status = psd_unzip_with_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                   (quint8*)uncompressedBytes.data(), uncompressedBytes.size(),
-                                                   layerRect.width(), channelSize * 8);
-            }
+            hasZippedChannels = true;
 
-            if (!status) {
-                QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(info->channelId).arg(info->compressionType);
-                dbgFile << "ERROR:" << error;
-                dbgFile << "      " << ppVar(info->channelId);
-                dbgFile << "      " << ppVar(info->channelDataStart);
-                dbgFile << "      " << ppVar(info->channelDataLength);
-                dbgFile << "      " << ppVar(info->compressionType);
+        } else if (info->compressionType == Compression::RLE) {
+            if (info->rleRowLengths.size() < height) {
+                QString error = QString("Not enough RLE row lengths: id = %1").arg(info->channelId);
                 throw KisAslReaderUtils::ASLParseException(error);
             }
+        } else if (info->compressionType != Compression::Uncompressed) {
+            QString error = QString("Unsupported Compression mode: %1").arg(info->compressionType);
+            dbgFile << "ERROR: readCommon:" << error;
+            throw KisAslReaderUtils::ASLParseException(error);
+        }
+
+        channels << info;
+    }
+
+    /**
+     * The layer is decoded in chunks of rows, so that only the planes
+     * of a single chunk are kept in memory. Every chunk is split into
+     * bands, which are decompressed in parallel. Zipped data cannot be
+     * split, so the layers having zipped channels are decoded as a
+     * single chunk.
+     */
+    const int rowsPerChunk = hasZippedChannels ?
+        height : qMin(height, rowsPerBand * qMax(1, QThread::idealThreadCount()));
+
+    /**
+     * The planes are interleaved right into the tiles of the device.
+     * PSD stores the color channels in the display order and the
+     * alpha channel with id -1.
+     */
+    const KoColorSpace *colorSpace = dev->colorSpace();
+    QList<KoChannelInfo*> origChannels = colorSpace->channels();
+    QVector<qint16> psdChannelIds(origChannels.size(), -2);
+
+    QByteArray opaqueAlphaPlane;
+    int alphaChannelIndex = -1;
+    int colorChannelId = 0;
+
+    Q_FOREACH (KoChannelInfo *ch, KoChannelInfo::displayOrderSorted(origChannels)) {
+        const int channelIndex = KoChannelInfo::displayPositionToChannelIndex(ch->displayPosition(), origChannels);
+        psdChannelIds[channelIndex] = ch->channelType() == KoChannelInfo::ALPHA ? -1 : colorChannelId++;
+
+        if (ch->channelType() == KoChannelInfo::ALPHA) {
+            alphaChannelIndex = channelIndex;
+        }
+    }
+
+    for (int chunkRow = 0; chunkRow < height; chunkRow += rowsPerChunk) {
+        const int chunkHeight = qMin(rowsPerChunk, height - chunkRow);
+        const int planeSize = chunkHeight * rowSize;
+
+        QMap<qint16, QByteArray> planes;
+        QVector<ChannelBand> bands;
+
+        /**
+         * The data is read from the device sequentially, then all the
+         * bands of all the channels are decompressed in parallel
+         */
+        Q_FOREACH (ChannelInfo *info, channels) {
+            QByteArray &plane = planes[info->channelId];
+            plane.resize(planeSize);
+
+            ChannelBand band;
+            band.info = info;
+            band.invert = info->channelId >= 0 && colorMode == CMYK;
+
+            if (info->compressionType == Compression::Uncompressed) {
+                io->seek(info->channelDataStart + info->channelOffset);
+
+                if (io->read(plane.data(), planeSize) != planeSize) {
+                    QString error = QString("Failed to read channel data: id = %1").arg(info->channelId);
+                    throw KisAslReaderUtils::ASLParseException(error);
+                }
 
-            channelBytes.insert(info->channelId, uncompressedBytes);
+                info->channelOffset += planeSize;
+
+                for (int row = 0; row < chunkHeight; row += rowsPerBand) {
+                    band.firstRow = chunkRow + row;
+                    band.numRows = qMin(rowsPerBand, chunkHeight - row);
+                    band.dst = reinterpret_cast<quint8*>(plane.data()) + row * rowSize;
+                    bands << band;
+                }
+
+            } else if (info->compressionType == Compression::RLE) {
+                io->seek(info->channelDataStart + info->channelOffset);
+
+                for (int row = 0; row < chunkHeight; row += rowsPerBand) {
+                    band.firstRow = chunkRow + row;
+                    band.numRows = qMin(rowsPerBand, chunkHeight - row);
+                    band.dst = reinterpret_cast<quint8*>(plane.data()) + row * rowSize;
+
+                    qint64 bandLength = 0;
+                    for (int i = band.firstRow; i < band.firstRow + band.numRows; i++) {
+                        bandLength += info->rleRowLengths[i];
+                    }
+
+                    band.compressedBytes = io->read(bandLength);
+                    info->channelOffset += bandLength;
+
+                    if (band.compressedBytes.size() != bandLength) {
+                        QString error = QString("Failed to read RLE data: id = %1").arg(info->channelId);
+                        throw KisAslReaderUtils::ASLParseException(error);
+                    }
+
+                    bands << band;
+                }
+
+            } else {
+                io->seek(info->channelDataStart);
+
+                // zipped data cannot be split into bands
+                band.firstRow = 0;
+                band.numRows = height;
+                band.dst = reinterpret_cast<quint8*>(plane.data());
+                band.compressedBytes = io->read(info->channelDataLength);
+                bands << band;
+            }
+        }
+
+        QtConcurrent::blockingMap(bands, DecodeChannelBandJob(width, channelSize));
+
+        Q_FOREACH (const ChannelBand &band, bands) {
+            if (!band.error.isEmpty()) {
+                dbgFile << "ERROR:" << band.error;
+                dbgFile << "      " << ppVar(band.info->channelId);
+                dbgFile << "      " << ppVar(band.info->channelDataStart);
+                dbgFile << "      " << ppVar(band.info->channelDataLength);
+                dbgFile << "      " << ppVar(band.info->compressionType);
+                throw KisAslReaderUtils::ASLParseException(band.error);
+            }
         }
 
-        KisSequentialIterator it(dev, layerRect);
-        int col = 0;
-        do {
-            pixelFunc(channelSize, channelBytes, col, it.rawData());
-            col++;
-        } while(it.nextPixel());
+        QVector<quint8*> devicePlanes(origChannels.size(), 0);
+
+        for (int i = 0; i < origChannels.size(); i++) {
+            const qint16 psdChannelId = psdChannelIds[i];
 
-    } else {
-        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(), layerRect.top(), layerRect.width());
-        for (int i = 0 ; i < layerRect.height(); i++) {
-            QMap<quint16, QByteArray> channelBytes;
+            if (planes.contains(psdChannelId)) {
+                devicePlanes[i] = reinterpret_cast<quint8*>(planes[psdChannelId].data());
+            } else if (i == alphaChannelIndex) {
+                KIS_ASSERT_RECOVER(origChannels[i]->size() == channelSize) { continue; }
 
-            channelBytes = fetchChannelsBytes(io, infoRecords,
-                                              i, layerRect.width(), channelSize);
+                // the first chunk is the biggest one, so the plane is filled only once
+                if (opaqueAlphaPlane.isEmpty()) {
+                    const KoColor opaque(Qt::black, colorSpace);
+                    const quint8 *unitValue = opaque.data() + origChannels[i]->pos();
 
-            for (qint64 col = 0; col < layerRect.width(); col++){
-                pixelFunc(channelSize, channelBytes, col, it->rawData());
-                it->nextPixel();
+                    opaqueAlphaPlane.resize(planeSize);
+                    for (int j = 0; j < planeSize; j += channelSize) {
+                        memcpy(opaqueAlphaPlane.data() + j, unitValue, channelSize);
+                    }
+                }
+
+                devicePlanes[i] = reinterpret_cast<quint8*>(opaqueAlphaPlane.data());
             }
-            it->nextRow();
         }
+
+        dev->writePlanarBytes(devicePlanes,
+                              layerRect.x() - dev->x(), layerRect.y() - dev->y() + chunkRow,
+                              width, chunkHeight);
     }
 }
 
@@ -470,16 +464,10 @@ void readChannels(QIODevice *io,
 {
     switch (colorMode) {
     case Grayscale:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readGrayPixelCommon);
-        break;
     case RGB:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readRgbPixelCommon);
-        break;
     case CMYK:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readCmykPixelCommon);
-        break;
     case Lab:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readLabPixelCommon);
+        readCommon(device, io, layerRect, infoRecords, channelSize, colorMode);
         break;
     case Bitmap:
     case Indexed:
@@ -492,53 +480,6 @@ void readChannels(QIODevice *io,
     }
 }
 
-void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSize, const QRect &rc, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
-{
-    typedef KisAslWriterUtils::OffsetStreamPusher<quint32> Pusher;
-    QScopedPointer<Pusher> channelBlockSizeExternalTag;
-    if (sizeFieldOffset >= 0) {
-        channelBlockSizeExternalTag.reset(new Pusher(io, 0, sizeFieldOffset));
-    }
-
-    if (writeCompressionType) {
-        SAFE_WRITE_EX(io, (quint16)Compression::RLE);
-    }
-
-    const bool externalRleBlock = rleBlockOffset >= 0;
-
-    // the start of RLE sizes block
-    const qint64 channelRLESizePos = externalRleBlock ? rleBlockOffset : io->pos();
-
-    {
-        QScopedPointer<KisOffsetKeeper> rleOffsetKeeper;
-
-        if (externalRleBlock) {
-            rleOffsetKeeper.reset(new KisOffsetKeeper(io));
-            io->seek(rleBlockOffset);
-        }
-
-        // write zero's for the channel lengths block
-        for(int i = 0; i < rc.height(); ++i) {
-            // XXX: choose size for PSB!
-            const quint16 fakeRLEBLockSize = 0;
-            SAFE_WRITE_EX(io, fakeRLEBLockSize);
-        }
-    }
-
-    quint32 stride = channelSize * rc.width();
-    for (qint32 row = 0; row < rc.height(); ++row) {
-
-        QByteArray uncompressed = QByteArray::fromRawData((const char*)plane + row * stride, stride);
-        QByteArray compressed = Compression::compress(uncompressed, Compression::RLE);
-
-        KisAslWriterUtils::OffsetStreamPusher<quint16> rleExternalTag(io, 0, channelRLESizePos + row * sizeof(quint16));
-
-        if (io->write(compressed) != compressed.size()) {
-            throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
-        }
-    }
-}
-
 inline void preparePixelForWrite(quint8 *dataPlane,
                                  int numPixels,
                                  int channelSize,
@@ -582,6 +523,113 @@ inline void preparePixelForWrite(quint8 *dataPlane,
     }
 }
 
+/**
+ * A band of rows of a channel plane, which is prepared and
+ * compressed in a separate thread
+ */
+struct RleBand
+{
+    quint8 *plane;
+    int width;
+    int channelSize;
+    int firstRow;
+    int numRows;
+
+    bool preparePixels;
+    qint16 channelId;
+    psd_color_mode colorMode;
+
+    QByteArray *compressedRows;
+};
+
+void compressRleBand(RleBand &band)
+{
+    const int stride = band.channelSize * band.width;
+    quint8 *bandPtr = band.plane + band.firstRow * stride;
+
+    if (band.preparePixels) {
+        preparePixelForWrite(bandPtr, band.numRows * band.width,
+                             band.channelSize, band.channelId, band.colorMode);
+    }
+
+    for (int i = 0; i < band.numRows; i++) {
+        QByteArray uncompressed = QByteArray::fromRawData((const char*)bandPtr + i * stride, stride);
+        band.compressedRows[band.firstRow + i] = Compression::compress(uncompressed, Compression::RLE);
+    }
+}
+
+void appendRleBands(QVector<RleBand> &bands, quint8 *plane, const QRect &rc, int channelSize,
+                    bool preparePixels, qint16 channelId, psd_color_mode colorMode,
+                    QByteArray *compressedRows)
+{
+    for (int row = 0; row < rc.height(); row += rowsPerBand) {
+        RleBand band;
+        band.plane = plane;
+        band.width = rc.width();
+        band.channelSize = channelSize;
+        band.firstRow = row;
+        band.numRows = qMin(rowsPerBand, rc.height() - row);
+        band.preparePixels = preparePixels;
+        band.channelId = channelId;
+        band.colorMode = colorMode;
+        band.compressedRows = compressedRows;
+
+        bands << band;
+    }
+}
+
+void writeCompressedRowsRLE(QIODevice *io, const QVector<QByteArray> &compressedRows, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
+{
+    typedef KisAslWriterUtils::OffsetStreamPusher<quint32> Pusher;
+    QScopedPointer<Pusher> channelBlockSizeExternalTag;
+    if (sizeFieldOffset >= 0) {
+        channelBlockSizeExternalTag.reset(new Pusher(io, 0, sizeFieldOffset));
+    }
+
+    if (writeCompressionType) {
+        SAFE_WRITE_EX(io, (quint16)Compression::RLE);
+    }
+
+    const bool externalRleBlock = rleBlockOffset >= 0;
+
+    {
+        QScopedPointer<KisOffsetKeeper> rleOffsetKeeper;
+
+        if (externalRleBlock) {
+            rleOffsetKeeper.reset(new KisOffsetKeeper(io));
+            io->seek(rleBlockOffset);
+        }
+
+        // the rows are already compressed, so their lengths are
+        // written right away without seeking back for every row
+        for (int i = 0; i < compressedRows.size(); ++i) {
+            // XXX: choose size for PSB!
+            const quint16 rleRowSize = compressedRows[i].size();
+            SAFE_WRITE_EX(io, rleRowSize);
+        }
+    }
+
+    Q_FOREACH (const QByteArray &compressed, compressedRows) {
+        if (io->write(compressed) != compressed.size()) {
+            throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
+        }
+    }
+}
+
+void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSize, const QRect &rc, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
+{
+    QVector<QByteArray> compressedRows(rc.height());
+    QVector<RleBand> bands;
+
+    // the plane is not modified when preparePixels is false
+    appendRleBands(bands, const_cast<quint8*>(plane), rc, channelSize,
+                   false, 0, COLORMODE_UNKNOWN, compressedRows.data());
+
+    QtConcurrent::blockingMap(bands, &compressRleBand);
+
+    writeCompressedRowsRLE(io, compressedRows, sizeFieldOffset, rleBlockOffset, writeCompressionType);
+}
+
 void writePixelDataCommon(QIODevice *io,
                           KisPaintDeviceSP dev,
                           const QRect &rc,
@@ -635,7 +683,21 @@ void writePixelDataCommon(QIODevice *io,
 
     KIS_ASSERT_RECOVER_RETURN(planes.size() >= writingInfoList.size());
 
-    const int numPixels = rc.width() * rc.height();
+    // prepare and compress all the planes in parallel
+
+    QVector<QVector<QByteArray> > compressedPlanes(writingInfoList.size());
+    QVector<RleBand> bands;
+
+    for (int i = 0; i < writingInfoList.size(); i++) {
+        QVector<QByteArray> &compressedRows = compressedPlanes[i];
+        compressedRows.resize(rc.height());
+
+        appendRleBands(bands, planes[i], rc, channelSize,
+                       true, writingInfoList[i].channelId, colorMode,
+                       compressedRows.data());
+    }
+
+    QtConcurrent::blockingMap(bands, &compressRleBand);
 
     // write down the planes
 
@@ -644,12 +706,9 @@ void writePixelDataCommon(QIODevice *io,
             const ChannelWritingInfo &info = writingInfoList[i];
 
             dbgFile << "\tWriting channel" << i << "psd channel id" << info.channelId;
-
-            preparePixelForWrite(planes[i], numPixels, channelSize, info.channelId, colorMode);
-
             dbgFile << "\t\tchannel start" << ppVar(io->pos());
 
-            writeChannelDataRLE(io, planes[i], channelSize, rc, info.sizeFieldOffset, info.rleBlockOffset, writeCompressionType);
+            writeCompressedRowsRLE(io, compressedPlanes[i], info.sizeFieldOffset, info.rleBlockOffset, writeCompressionType);
         }
 
     } catch (KisAslWriterUtils::ASLWriteException &e) {
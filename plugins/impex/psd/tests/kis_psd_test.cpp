@@ -21,6 +21,7 @@
 
 #include <QTest>
 #include <QCoreApplication>
+#include <QTemporaryDir>
 
 #include <QTest>
 
@@ -34,6 +35,7 @@
 #include "kis_group_layer.h"
 #include "kis_psd_layer_style.h"
 #include "kis_paint_device_debug_utils.h"
+#include "kis_paint_layer.h"
 
 
 void KisPSDTest::testFiles()
@@ -336,6 +338,89 @@ void KisPSDTest::testSavingAllFormats()
     }
 }
 
+static const int benchmarkNumLayers = 300;
+
+/**
+ * Creates a document with many big layers, each covering a half of
+ * the image with a few colors
+ */
+QSharedPointer<KisDocument> createManyLayersDocument()
+{
+    const QRect imageRect(0, 0, 3000, 2000);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QSharedPointer<KisDocument> doc(qobject_cast<KisDocument*>(KisPart::instance()->createDocument()));
+
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "benchmark");
+
+    for (int i = 0; i < benchmarkNumLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer%1").arg(i), OPACITY_OPAQUE_U8, cs);
+
+        const QRect layerRect((i * 37) % (imageRect.width() / 2), (i * 23) % (imageRect.height() / 2),
+                              imageRect.width() / 2, imageRect.height() / 2);
+
+        for (int j = 0; j < 4; j++) {
+            QRect rc = layerRect;
+            rc.setTop(layerRect.top() + j * layerRect.height() / 4);
+            rc.setHeight(layerRect.height() / 4);
+            layer->paintDevice()->fill(rc, KoColor(QColor(i % 256, j * 64, 255 - i % 256, 64 + j * 32), cs));
+        }
+
+        image->addNode(layer, image->rootLayer());
+    }
+
+    image->initialRefreshGraph();
+    doc->setCurrentImage(image);
+
+    doc->setBackupFile(false);
+    doc->setOutputMimeType("image/vnd.adobe.photoshop");
+
+    return doc;
+}
+
+void KisPSDTest::benchmarkSaveManyLayers()
+{
+    QSharedPointer<KisDocument> doc = createManyLayersDocument();
+
+    QTemporaryDir dstDir;
+    QVERIFY(dstDir.isValid());
+    QFileInfo dstFileInfo(dstDir.path() + QDir::separator() + "test_many_layers.psd");
+
+    bool retval = false;
+
+    QBENCHMARK_ONCE {
+        retval = doc->saveAs(QUrl::fromLocalFile(dstFileInfo.absoluteFilePath()));
+    }
+
+    QVERIFY(retval);
+}
+
+void KisPSDTest::benchmarkLoadManyLayers()
+{
+    QSharedPointer<KisDocument> doc = createManyLayersDocument();
+
+    const QRect imageRect = doc->image()->bounds();
+    QImage refImage = doc->image()->projection()->convertToQImage(0, imageRect);
+
+    QTemporaryDir dstDir;
+    QVERIFY(dstDir.isValid());
+    QFileInfo dstFileInfo(dstDir.path() + QDir::separator() + "test_many_layers.psd");
+
+    QVERIFY(doc->saveAs(QUrl::fromLocalFile(dstFileInfo.absoluteFilePath())));
+
+    QSharedPointer<KisDocument> doc2;
+
+    QBENCHMARK_ONCE {
+        doc2 = openPsdDocument(dstFileInfo);
+    }
+
+    QVERIFY(doc2->image());
+    QCOMPARE(doc2->image()->root()->childCount(), quint32(benchmarkNumLayers));
+
+    doc2->image()->initialRefreshGraph();
+    QImage resultImage = doc2->image()->projection()->convertToQImage(0, imageRect);
+    QCOMPARE(resultImage, refImage);
+}
 
 QTEST_MAIN(KisPSDTest)
 
@@ -40,6 +40,9 @@ private Q_SLOTS:
     void testOpeningFromOpenCanvas();
     void testOpeningAllFormats();
     void testSavingAllFormats();
+
+    void benchmarkSaveManyLayers();
+    void benchmarkLoadManyLayers();
 };
 
 #endif
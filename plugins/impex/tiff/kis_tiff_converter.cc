@@ -25,6 +25,7 @@
 #include <QApplication>
 
 #include <QFileInfo>
+#include <QThread>
 
 #include <KoDocumentInfo.h>
 #include <KoUnit.h>
@@ -45,6 +46,7 @@
 #include "kis_tiff_ycbcr_reader.h"
 #include "kis_buffer_stream.h"
 #include "kis_tiff_writer_visitor.h"
+#include "kis_tiff_parallel_codec.h"
 
 #if TIFFLIB_VERSION < 20111221
 typedef size_t tmsize_t;
@@ -523,10 +525,30 @@ KisImageBuilder_Result KisTIFFConverter::readTIFFDirectory(TIFF* image)
             delete [] lineSizes;
         }
         dbgFile << linewidth << "" << nbchannels << "" << layer->paintDevice()->colorSpace()->colorChannelCount();
+
+        const bool useParallelCodec =
+            planarconfig == PLANARCONFIG_CONTIG && KisTIFFParallelCodec::isSupported(image);
+
         for (y = 0; y < height; y += tileHeight) {
+            // decompress the whole row of tiles in parallel
+            QVector<QByteArray> decodedTiles;
+            if (useParallelCodec) {
+                QVector<uint32> tileIndexes;
+                for (x = 0; x < width; x += tileWidth) {
+                    tileIndexes << TIFFComputeTile(image, x, y, 0, 0);
+                }
+                if (!KisTIFFParallelCodec::readChunks(image, tileIndexes, &decodedTiles)) {
+                    dbgFile << "Failed to decode the tiles in parallel, y =" << y;
+                    decodedTiles.clear();
+                }
+            }
+
             for (x = 0; x < width; x += tileWidth) {
                 dbgFile << "Reading tile x =" << x << " y =" << y;
-                if (planarconfig == PLANARCONFIG_CONTIG) {
+                if (!decodedTiles.isEmpty()) {
+                    memcpy(buf, decodedTiles[x / tileWidth].constData(), TIFFTileSize(image));
+                }
+                else if (planarconfig == PLANARCONFIG_CONTIG) {
                     TIFFReadTile(image, buf, x, y, 0, (tsample_t) - 1);
                 }
                 else {
@@ -579,9 +601,42 @@ KisImageBuilder_Result KisTIFFConverter::readTIFFDirectory(TIFF* image)
         dbgFile << "Scanline size =" << TIFFRasterScanlineSize(image) << " / strip size =" << TIFFStripSize(image) << " / rowsPerStrip =" << rowsPerStrip << " stripsize/rowsPerStrip =" << stripsize / rowsPerStrip;
         uint32 y = 0;
         dbgFile << " NbOfStrips =" << TIFFNumberOfStrips(image) << " rowsPerStrip =" << rowsPerStrip << " stripsize =" << stripsize;
+
+        bool useParallelCodec =
+            planarconfig == PLANARCONFIG_CONTIG && KisTIFFParallelCodec::isSupported(image);
+
+        // the strips are decompressed in parallel in batches
+        const uint32 stripsBatchSize = 4 * QThread::idealThreadCount();
+        QVector<QByteArray> decodedStrips;
+        uint32 firstDecodedStrip = 0;
+
         for (uint32 strip = 0; y < height; strip++) {
             if (planarconfig == PLANARCONFIG_CONTIG) {
-                TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, 0) , buf, (tsize_t) - 1);
+                const uint32 stripIndex = TIFFComputeStrip(image, y, 0);
+
+                if (useParallelCodec &&
+                    (stripIndex < firstDecodedStrip ||
+                     stripIndex >= firstDecodedStrip + decodedStrips.size())) {
+
+                    QVector<uint32> stripIndexes;
+                    const uint32 lastStrip = qMin(stripIndex + stripsBatchSize, TIFFNumberOfStrips(image));
+                    for (uint32 i = stripIndex; i < lastStrip; i++) {
+                        stripIndexes << i;
+                    }
+
+                    firstDecodedStrip = stripIndex;
+                    if (!KisTIFFParallelCodec::readChunks(image, stripIndexes, &decodedStrips)) {
+                        dbgFile << "Failed to decode the strips in parallel, strip =" << stripIndex;
+                        decodedStrips.clear();
+                        useParallelCodec = false;
+                    }
+                }
+
+                if (useParallelCodec) {
+                    memcpy(buf, decodedStrips[stripIndex - firstDecodedStrip].constData(), stripsize);
+                } else {
+                    TIFFReadEncodedStrip(image, stripIndex, buf, (tsize_t) - 1);
+                }
             }
             else {
                 for (uint i = 0; i < nbchannels; i++) {
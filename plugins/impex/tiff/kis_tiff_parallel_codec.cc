@@ -0,0 +1,306 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tiff_parallel_codec.h"
+
+#include <zlib.h>
+
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <kis_assert.h>
+#include <kis_debug.h>
+
+namespace
+{
+
+struct ChunkFormat
+{
+    uint16 compression = COMPRESSION_NONE;
+    uint16 predictor = PREDICTOR_NONE;
+    uint16 bitsPerSample = 8;
+    uint16 samplesPerPixel = 1;
+    int deflateLevel = Z_DEFAULT_COMPRESSION;
+    bool byteSwapped = false;
+
+    tmsize_t rowSize = 0;
+    tmsize_t chunkSize = 0;
+};
+
+ChunkFormat chunkFormat(TIFF *image)
+{
+    ChunkFormat format;
+
+    TIFFGetFieldDefaulted(image, TIFFTAG_COMPRESSION, &format.compression);
+    TIFFGetFieldDefaulted(image, TIFFTAG_PREDICTOR, &format.predictor);
+    TIFFGetFieldDefaulted(image, TIFFTAG_BITSPERSAMPLE, &format.bitsPerSample);
+    TIFFGetFieldDefaulted(image, TIFFTAG_SAMPLESPERPIXEL, &format.samplesPerPixel);
+
+    if (format.compression == COMPRESSION_ADOBE_DEFLATE ||
+        format.compression == COMPRESSION_DEFLATE) {
+
+        TIFFGetField(image, TIFFTAG_ZIPQUALITY, &format.deflateLevel);
+    }
+
+    format.byteSwapped = TIFFIsByteSwapped(image);
+
+    if (TIFFIsTiled(image)) {
+        format.rowSize = TIFFTileRowSize(image);
+        format.chunkSize = TIFFTileSize(image);
+    } else {
+        format.rowSize = TIFFScanlineSize(image);
+        format.chunkSize = TIFFStripSize(image);
+    }
+
+    return format;
+}
+
+template <typename T>
+void swapBytes(quint8 *data, tmsize_t size)
+{
+    T *ptr = reinterpret_cast<T*>(data);
+    T *end = ptr + size / sizeof(T);
+
+    for (; ptr < end; ++ptr) {
+        *ptr = qbswap(*ptr);
+    }
+}
+
+template <typename T>
+void undoHorizontalPredictor(quint8 *data, tmsize_t size, const ChunkFormat &format)
+{
+    const int stride = format.samplesPerPixel;
+    const tmsize_t rowLength = format.rowSize / sizeof(T);
+
+    for (quint8 *row = data; row < data + size; row += format.rowSize) {
+        T *ptr = reinterpret_cast<T*>(row);
+
+        for (tmsize_t i = stride; i < rowLength; i++) {
+            ptr[i] += ptr[i - stride];
+        }
+    }
+}
+
+template <typename T>
+void applyHorizontalPredictor(quint8 *data, tmsize_t size, const ChunkFormat &format)
+{
+    const int stride = format.samplesPerPixel;
+    const tmsize_t rowLength = format.rowSize / sizeof(T);
+
+    for (quint8 *row = data; row < data + size; row += format.rowSize) {
+        T *ptr = reinterpret_cast<T*>(row);
+
+        for (tmsize_t i = rowLength - 1; i >= stride; i--) {
+            ptr[i] -= ptr[i - stride];
+        }
+    }
+}
+
+struct DecodeChunkJob
+{
+    DecodeChunkJob(const ChunkFormat &_format) : format(_format) {}
+
+    typedef QByteArray result_type;
+
+    /**
+     * Gets the raw data of the chunk and returns the decoded one, the
+     * same sequence libtiff follows: decompression, byte swapping,
+     * predictor.
+     */
+    QByteArray operator() (const QByteArray &rawData) const {
+        QByteArray result(format.chunkSize, 0);
+        quint8 *data = reinterpret_cast<quint8*>(result.data());
+        tmsize_t decodedSize = 0;
+
+        if (format.compression == COMPRESSION_NONE) {
+            decodedSize = qMin(format.chunkSize, tmsize_t(rawData.size()));
+            memcpy(data, rawData.constData(), decodedSize);
+        } else {
+            uLongf size = format.chunkSize;
+
+            // the last strip is shorter than the others, so Z_BUF_ERROR is not an error
+            const int status = uncompress(data, &size,
+                                          reinterpret_cast<const Bytef*>(rawData.constData()),
+                                          rawData.size());
+
+            if (status != Z_OK && status != Z_BUF_ERROR) {
+                warnFile << "Failed to decompress a TIFF chunk:" << status;
+                return QByteArray();
+            }
+
+            decodedSize = size;
+        }
+
+        // only the complete rows are processed
+        decodedSize -= decodedSize % format.rowSize;
+
+        if (format.byteSwapped) {
+            if (format.bitsPerSample == 16) {
+                swapBytes<quint16>(data, decodedSize);
+            } else if (format.bitsPerSample == 32) {
+                swapBytes<quint32>(data, decodedSize);
+            }
+        }
+
+        if (format.predictor == PREDICTOR_HORIZONTAL) {
+            if (format.bitsPerSample == 8) {
+                undoHorizontalPredictor<quint8>(data, decodedSize, format);
+            } else if (format.bitsPerSample == 16) {
+                undoHorizontalPredictor<quint16>(data, decodedSize, format);
+            } else if (format.bitsPerSample == 32) {
+                undoHorizontalPredictor<quint32>(data, decodedSize, format);
+            }
+        }
+
+        return result;
+    }
+
+    ChunkFormat format;
+};
+
+struct EncodeChunkJob
+{
+    EncodeChunkJob(const ChunkFormat &_format) : format(_format) {}
+
+    void operator() (QByteArray &chunk) const {
+        quint8 *data = reinterpret_cast<quint8*>(chunk.data());
+
+        if (format.predictor == PREDICTOR_HORIZONTAL) {
+            if (format.bitsPerSample == 8) {
+                applyHorizontalPredictor<quint8>(data, chunk.size(), format);
+            } else if (format.bitsPerSample == 16) {
+                applyHorizontalPredictor<quint16>(data, chunk.size(), format);
+            } else if (format.bitsPerSample == 32) {
+                applyHorizontalPredictor<quint32>(data, chunk.size(), format);
+            }
+        }
+
+        if (format.byteSwapped) {
+            if (format.bitsPerSample == 16) {
+                swapBytes<quint16>(data, chunk.size());
+            } else if (format.bitsPerSample == 32) {
+                swapBytes<quint32>(data, chunk.size());
+            }
+        }
+
+        if (format.compression == COMPRESSION_NONE) return;
+
+        uLongf size = compressBound(chunk.size());
+        QByteArray result(size, 0);
+
+        const int status = compress2(reinterpret_cast<Bytef*>(result.data()), &size,
+                                     reinterpret_cast<const Bytef*>(chunk.constData()),
+                                     chunk.size(), format.deflateLevel);
+
+        if (status != Z_OK) {
+            warnFile << "Failed to compress a TIFF chunk:" << status;
+            chunk.clear();
+            return;
+        }
+
+        result.resize(size);
+        chunk = result;
+    }
+
+    ChunkFormat format;
+};
+
+}
+
+bool KisTIFFParallelCodec::isSupported(TIFF *image)
+{
+    uint16 planarConfig = PLANARCONFIG_CONTIG;
+    uint16 photometric = PHOTOMETRIC_RGB;
+    uint16 fillOrder = FILLORDER_MSB2LSB;
+
+    TIFFGetFieldDefaulted(image, TIFFTAG_PLANARCONFIG, &planarConfig);
+    TIFFGetFieldDefaulted(image, TIFFTAG_FILLORDER, &fillOrder);
+    TIFFGetField(image, TIFFTAG_PHOTOMETRIC, &photometric);
+
+    const ChunkFormat format = chunkFormat(image);
+
+    return planarConfig == PLANARCONFIG_CONTIG &&
+        fillOrder == FILLORDER_MSB2LSB &&
+        photometric != PHOTOMETRIC_YCBCR &&
+        (format.compression == COMPRESSION_NONE ||
+         format.compression == COMPRESSION_ADOBE_DEFLATE ||
+         format.compression == COMPRESSION_DEFLATE) &&
+        (format.predictor == PREDICTOR_NONE ||
+         (format.predictor == PREDICTOR_HORIZONTAL &&
+          (format.bitsPerSample == 8 ||
+           format.bitsPerSample == 16 ||
+           format.bitsPerSample == 32))) &&
+        format.rowSize > 0 && format.chunkSize > 0;
+}
+
+bool KisTIFFParallelCodec::readChunks(TIFF *image, const QVector<uint32> &chunkIndexes, QVector<QByteArray> *chunks)
+{
+    const ChunkFormat format = chunkFormat(image);
+    const bool isTiled = TIFFIsTiled(image);
+
+    QVector<QByteArray> rawChunks;
+    rawChunks.reserve(chunkIndexes.size());
+
+    Q_FOREACH (uint32 index, chunkIndexes) {
+        // tiles and strips share the array of byte counts
+        const tmsize_t rawSize = TIFFRawStripSize(image, index);
+        if (rawSize <= 0) return false;
+
+        QByteArray rawData(rawSize, 0);
+
+        const tmsize_t bytesRead = isTiled ?
+            TIFFReadRawTile(image, index, rawData.data(), rawSize) :
+            TIFFReadRawStrip(image, index, rawData.data(), rawSize);
+
+        if (bytesRead != rawSize) return false;
+
+        rawChunks << rawData;
+    }
+
+    *chunks = QtConcurrent::blockingMapped<QVector<QByteArray> >(rawChunks, DecodeChunkJob(format));
+
+    Q_FOREACH (const QByteArray &chunk, *chunks) {
+        if (chunk.isEmpty()) return false;
+    }
+
+    return true;
+}
+
+bool KisTIFFParallelCodec::writeChunks(TIFF *image, const QVector<uint32> &chunkIndexes, QVector<QByteArray> &chunks)
+{
+    KIS_ASSERT_RECOVER_RETURN_VALUE(chunkIndexes.size() == chunks.size(), false);
+
+    const ChunkFormat format = chunkFormat(image);
+    const bool isTiled = TIFFIsTiled(image);
+
+    QtConcurrent::blockingMap(chunks, EncodeChunkJob(format));
+
+    for (int i = 0; i < chunks.size(); i++) {
+        QByteArray &chunk = chunks[i];
+        if (chunk.isEmpty()) return false;
+
+        const tmsize_t bytesWritten = isTiled ?
+            TIFFWriteRawTile(image, chunkIndexes[i], chunk.data(), chunk.size()) :
+            TIFFWriteRawStrip(image, chunkIndexes[i], chunk.data(), chunk.size());
+
+        if (bytesWritten != chunk.size()) return false;
+    }
+
+    return true;
+}
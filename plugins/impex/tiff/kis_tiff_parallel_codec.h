@@ -0,0 +1,72 @@
+/*
+ *  Copyright (c) 2026 agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _KIS_TIFF_PARALLEL_CODEC_H_
+#define _KIS_TIFF_PARALLEL_CODEC_H_
+
+// On some platforms, tiffio.h #defines 0 in a bad
+// way for C++, as (void *)0 instead of using the correct
+// C++ value 0. Include stdio.h first to get the right one.
+#include <stdio.h>
+#include <tiffio.h>
+
+#include <QByteArray>
+#include <QVector>
+
+#if TIFFLIB_VERSION < 20111221
+typedef size_t tmsize_t;
+#endif
+
+/**
+ * libtiff compresses and decompresses the strips and tiles of a
+ * file one by one in the calling thread, and its handles cannot be
+ * shared between threads. For the codecs that are simple enough
+ * (no compression and deflate, with or without the horizontal
+ * predictor) KisTIFFParallelCodec does the (de)compression itself
+ * in multiple threads, leaving only the raw I/O to libtiff.
+ *
+ * A "chunk" is either a strip or a tile, depending on the layout of
+ * the file. Only contiguous planar configuration is supported.
+ */
+class KisTIFFParallelCodec
+{
+public:
+    /**
+     * \return true if the chunks of the current directory of \p image
+     * can be (de)compressed by this class
+     */
+    static bool isSupported(TIFF *image);
+
+    /**
+     * Reads the chunks \p chunkIndexes of \p image and decompresses
+     * them in parallel. The decompressed chunks are stored in \p
+     * chunks, every chunk has the full size (TIFFTileSize() or
+     * TIFFStripSize()) and the host byte order.
+     */
+    static bool readChunks(TIFF *image, const QVector<uint32> &chunkIndexes, QVector<QByteArray> *chunks);
+
+    /**
+     * Compresses \p chunks in parallel and writes them into chunks
+     * \p chunkIndexes of \p image. The data of the chunks is
+     * modified by the predictor.
+     */
+    static bool writeChunks(TIFF *image, const QVector<uint32> &chunkIndexes, QVector<QByteArray> &chunks);
+};
+
+#endif /* _KIS_TIFF_PARALLEL_CODEC_H_ */
@@ -20,6 +20,8 @@
 #include "kis_tiff_writer_visitor.h"
 
 #include <QMessageBox>
+#include <QVector>
+#include <QtConcurrent>
 #include <klocalizedstring.h>
 
 #include <KoColorProfile.h>
@@ -34,6 +36,7 @@
 #include <kis_types.h>
 #include <generator/kis_generator_layer.h>
 #include "kis_tiff_converter.h"
+#include "kis_tiff_parallel_codec.h"
 #include <kis_iterator_ng.h>
 #include <kis_shape_layer.h>
 
@@ -44,6 +47,21 @@
 
 namespace
 {
+    /**
+     * The size of the tiles of the saved file. It is a multiple of
+     * the tile size of a paint device, and of 16 as TIFF requires.
+     */
+    const int tileSize = 256;
+
+    struct TileData {
+        TileData() : x(0), y(0) {}
+        TileData(int _x, int _y) : x(_x), y(_y) {}
+
+        int x;
+        int y;
+        QByteArray data;
+    };
+
     bool writeColorSpaceInformation(TIFF* image, const KoColorSpace * cs, uint16& color_type, uint16& sample_format)
     {
         dbgKrita << cs->id();
@@ -213,8 +231,9 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer * layer)
 
     // Use contiguous configuration
     TIFFSetField(image(), TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-    // Use 8 rows per strip
-    TIFFSetField(image(), TIFFTAG_ROWSPERSTRIP, 8);
+    // Use tiles, so that they can be compressed independently
+    TIFFSetField(image(), TIFFTAG_TILEWIDTH, tileSize);
+    TIFFSetField(image(), TIFFTAG_TILELENGTH, tileSize);
 
     // Save profile
     if (m_options->saveProfile) {
@@ -224,45 +243,89 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer * layer)
             TIFFSetField(image(), TIFFTAG_ICCPROFILE, ba.size(), ba.constData());
         }
     }
-    tsize_t stripsize = TIFFStripSize(image());
-    tdata_t buff = _TIFFmalloc(stripsize);
+
+    quint8 poses[5];
+    uint8 nbcolorssamples = 0;
+
+    switch (color_type) {
+    case PHOTOMETRIC_MINISBLACK:
+        poses[0] = 0; poses[1] = 1;
+        nbcolorssamples = 1;
+        break;
+    case PHOTOMETRIC_RGB:
+        if (sample_format == SAMPLEFORMAT_IEEEFP) {
+            poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
+        } else {
+            poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
+        }
+        nbcolorssamples = 3;
+        break;
+    case PHOTOMETRIC_SEPARATED:
+        poses[0] = 0; poses[1] = 1; poses[2] = 2; poses[3] = 3; poses[4] = 4;
+        nbcolorssamples = 4;
+        break;
+    case PHOTOMETRIC_ICCLAB:
+        poses[0] = 0; poses[1] = 1; poses[2] = 2; poses[3] = 3;
+        nbcolorssamples = 3;
+        break;
+    default:
+        return false;
+    }
+
+    const tsize_t tilesize = TIFFTileSize(image());
+    const tsize_t tileRowSize = TIFFTileRowSize(image());
+    const bool useParallelCodec = KisTIFFParallelCodec::isSupported(image());
+
     qint32 height = layer->image()->height();
     qint32 width = layer->image()->width();
-    bool r = true;
-    for (int y = 0; y < height; y++) {
-        KisHLineConstIteratorSP it = pd->createHLineConstIteratorNG(0, y, width);
-        switch (color_type) {
-        case PHOTOMETRIC_MINISBLACK: {
-                quint8 poses[] = { 0, 1 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 1, poses);
-            }
-            break;
-        case PHOTOMETRIC_RGB: {
-                quint8 poses[4];
-                if (sample_format == SAMPLEFORMAT_IEEEFP) {
-                    poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
-                } else {
-                    poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
+
+    for (int y = 0; y < height; y += tileSize) {
+        QVector<TileData> tiles;
+        for (int x = 0; x < width; x += tileSize) {
+            tiles << TileData(x, y);
+        }
+
+        // the pixels of a row of tiles are copied in parallel
+        QtConcurrent::blockingMap(tiles, [&] (TileData &tile) {
+            tile.data = QByteArray(tilesize, 0);
+
+            const int tileWidth = qMin(tileSize, width - tile.x);
+            const int tileHeight = qMin(tileSize, height - tile.y);
+
+            for (int row = 0; row < tileHeight; row++) {
+                KisHLineConstIteratorSP it = pd->createHLineConstIteratorNG(tile.x, tile.y + row, tileWidth);
+                tdata_t buff = tile.data.data() + row * tileRowSize;
+
+                if (!copyDataToStrips(it, buff, depth, sample_format, nbcolorssamples, poses)) {
+                    tile.data.clear();
+                    return;
                 }
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
             }
-            break;
-        case PHOTOMETRIC_SEPARATED: {
-                quint8 poses[] = { 0, 1, 2, 3, 4 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 4, poses);
+        });
+
+        QVector<uint32> tileIndexes(tiles.size());
+        QVector<QByteArray> tileData(tiles.size());
+
+        for (int i = 0; i < tiles.size(); i++) {
+            if (tiles[i].data.isEmpty()) return false;
+
+            tileIndexes[i] = TIFFComputeTile(image(), tiles[i].x, tiles[i].y, 0, 0);
+            tileData[i].swap(tiles[i].data);
+        }
+
+        if (useParallelCodec) {
+            if (!KisTIFFParallelCodec::writeChunks(image(), tileIndexes, tileData)) {
+                return false;
             }
-            break;
-        case PHOTOMETRIC_ICCLAB: {
-                quint8 poses[] = { 0, 1, 2, 3 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
+        } else {
+            for (int i = 0; i < tileData.size(); i++) {
+                if (TIFFWriteEncodedTile(image(), tileIndexes[i], tileData[i].data(), tileData[i].size()) < 0) {
+                    return false;
+                }
             }
-            break;
-            return false;
         }
-        if (!r) return false;
-        TIFFWriteScanline(image(), buff, y, (tsample_t) - 1);
     }
-    _TIFFfree(buff);
+
     TIFFWriteDirectory(image());
     return true;
 }
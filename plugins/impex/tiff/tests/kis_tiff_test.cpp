@@ -28,6 +28,11 @@
 
 #include <KoColorModelStandardIds.h>
 #include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_properties_configuration.h>
 
 #include "kisexiv2/kis_exiv2.h"
 
@@ -111,5 +116,134 @@ void KisTiffTest::testRoundTripRGBF16()
 #endif
 }
 
+namespace {
+
+KisDocument* createTestDocument(const QRect &imageRect, const KoColorSpace *cs)
+{
+    KisDocument *doc = KisPart::instance()->createDocument();
+
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "test");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8, cs);
+
+    // stripes of different colors crossing the tile borders
+    const int numStripes = 16;
+    for (int i = 0; i < numStripes; i++) {
+        const QRect rc(0, i * imageRect.height() / numStripes, imageRect.width() - i * 7, imageRect.height() / numStripes);
+        layer->paintDevice()->fill(rc, KoColor(QColor(i * 16, 255 - i * 16, i * 5, 255 - i), cs));
+    }
+
+    image->addNode(layer, image->rootLayer());
+    image->initialRefreshGraph();
+
+    doc->setCurrentImage(image);
+
+    return doc;
+}
+
+KisPropertiesConfigurationSP deflateConfiguration()
+{
+    KisPropertiesConfigurationSP cfg = new KisPropertiesConfiguration();
+    cfg->setProperty("compressiontype", 2); // deflate
+    cfg->setProperty("predictor", 1); // horizontal
+    cfg->setProperty("alpha", true);
+    cfg->setProperty("flatten", true);
+    cfg->setProperty("deflate", 6);
+    cfg->setProperty("saveProfile", true);
+    return cfg;
+}
+
+}
+
+void KisTiffTest::testRoundTripTiledDeflate()
+{
+    const QRect imageRect(0, 0, 1000, 700);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+
+    KisDocument *doc1 = createTestDocument(imageRect, cs);
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".tiff"));
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    QString savedFileName(savedFile.fileName());
+    QByteArray mimeType("image/tiff");
+
+    KisImportExportFilter::ConversionStatus status;
+
+    {
+        KisImportExportManager manager(doc1);
+        manager.setBatchMode(true);
+        status = manager.exportDocument(savedFileName, mimeType, deflateConfiguration());
+        QCOMPARE(status, KisImportExportFilter::OK);
+    }
+
+    KisDocument *doc2 = KisPart::instance()->createDocument();
+
+    {
+        KisImportExportManager manager(doc2);
+        manager.setBatchMode(true);
+        manager.importDocument(savedFileName, QString(), status);
+        QCOMPARE(status, KisImportExportFilter::OK);
+        QVERIFY(doc2->image());
+    }
+
+    QVERIFY(TestUtil::comparePaintDevicesClever<quint16>(
+                doc1->image()->projection(),
+                doc2->image()->root()->firstChild()->paintDevice()));
+
+    savedFile.close();
+
+    delete doc2;
+    delete doc1;
+}
+
+void KisTiffTest::benchmarkTiledDeflate16bit()
+{
+    const QRect imageRect(0, 0, 20000, 20000);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+
+    KisDocument *doc1 = createTestDocument(imageRect, cs);
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".tiff"));
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    QString savedFileName(savedFile.fileName());
+    QByteArray mimeType("image/tiff");
+
+    KisImportExportFilter::ConversionStatus status;
+
+    {
+        KisImportExportManager manager(doc1);
+        manager.setBatchMode(true);
+
+        QBENCHMARK_ONCE {
+            status = manager.exportDocument(savedFileName, mimeType, deflateConfiguration());
+        }
+
+        QCOMPARE(status, KisImportExportFilter::OK);
+    }
+
+    delete doc1;
+
+    KisDocument *doc2 = KisPart::instance()->createDocument();
+
+    {
+        KisImportExportManager manager(doc2);
+        manager.setBatchMode(true);
+
+        QBENCHMARK_ONCE {
+            manager.importDocument(savedFileName, QString(), status);
+        }
+
+        QCOMPARE(status, KisImportExportFilter::OK);
+        QVERIFY(doc2->image());
+    }
+
+    savedFile.close();
+
+    delete doc2;
+}
+
 QTEST_MAIN(KisTiffTest)
 
@@ -27,6 +27,8 @@ class KisTiffTest : public QObject
 private Q_SLOTS:
     void testFiles();
     void testRoundTripRGBF16();
+    void testRoundTripTiledDeflate();
+    void benchmarkTiledDeflate16bit();
 };
 
 #endif
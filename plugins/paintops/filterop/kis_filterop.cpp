@@ -117,7 +117,13 @@ KisSpacingInformation KisFilterOp::paintAt(const KisPaintInformation& info)
 
 
     // Filter the paint device
-    QRect neededRect = m_filter->neededRect(dstRect, m_filterConfiguration, painter()->device()->defaultBounds()->currentLevelOfDetail());
+    /**
+     * process() runs the filter with the configuration scaled to the
+     * level of detail of the device, so the needed rect should be
+     * calculated with the same scaled configuration
+     */
+    const int lod = m_tmpDevice->defaultBounds()->currentLevelOfDetail();
+    QRect neededRect = m_filter->neededRect(dstRect, m_filter->lodScaledConfiguration(m_filterConfiguration, lod), lod);
 
     KisPainter p(m_tmpDevice);
     if (!m_smudgeMode) {
@@ -106,6 +106,7 @@ void KisToolSelectContiguous::beginPrimaryAction(KoPointerEvent *event)
     image->lock();
     fillpainter.setFeather(m_feather);
     fillpainter.setSizemod(m_sizemod);
+    fillpainter.setUseSimilarityCache(m_limitToCurrentLayer);
     KisSelectionSP selection = fillpainter.createFloodSelection(pos.x(), pos.y(), sourceDevice);
     image->unlock();
 